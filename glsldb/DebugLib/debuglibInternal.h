@@ -58,7 +58,7 @@ typedef struct {
 #else /* _WIN32 */
 	CRITICAL_SECTION lock;
 #endif /* _WIN32 */
-	Hash queries;
+	QueryTracker queries;
 } Globals;
 
 DBGLIBLOCAL int checkGLVersionSupported(int majorVersion, int minorVersion);
@@ -108,6 +108,27 @@ DBGLIBLOCAL int setGLErrorCode(void);
 
 DBGLIBLOCAL void (*glXGetProcAddressHook(const GLubyte *n))(void);
 
+/* ISO C has no conversion between object and function pointers, entry points
+   returned or stored as void* go through this union
+*/
+typedef union {
+	void *object;
+	void (*function)(void);
+} FunctionPointer;
+
+#ifndef _WIN32
+/* our hook of a GL or GLX function, NULL if name is not hooked */
+DBGLIBLOCAL void (*getHookFunction(const char *name))(void);
+
+/* cache for the original function of a hooked name, NULL if name is not
+ * hooked
+ */
+DBGLIBLOCAL void (**getOrigFuncSlot(const char *fname))(void);
+
+/* resolves the originals of all hooked names, returns the number resolved */
+DBGLIBLOCAL int resolveOrigFunctions(void *(*resolve)(const char *name));
+#endif /* _WIN32 */
+
 DBGLIBLOCAL void (*getDbgFunction(void))(void);
 	
 DBGLIBLOCAL void storeFunctionCall(const char *fname, int numArgs, ...);
@@ -122,10 +143,32 @@ DBGLIBLOCAL int getDbgOperation(void);
 
 DBGLIBLOCAL void setExecuting(void);
 
-DBGLIBLOCAL int keepExecuting(const char *calledName);
+/* arguments are passed as (address, DBG_TYPE) pairs as for storeFunctionCall
+   and are only evaluated by DBG_JUMP_TO_BREAKPOINT
+*/
+DBGLIBLOCAL int keepExecuting(int functionId, const char *calledName,
+                              int numArgs, ...);
+
+/* frame and call number of the call of the running hook */
+DBGLIBLOCAL void getCallPosition(long long *frame, long long *call);
 
 DBGLIBLOCAL int checkGLErrorInExecution(void);
 
+/* whether the hook of the current call queried its GL error; if not, the
+   error passed to a *_POSTEXECUTE function is always GL_NO_ERROR
+*/
+DBGLIBLOCAL int isGLErrorChecked(void);
+
+/* index of fname in glFunctions or -1 */
+DBGLIBLOCAL int getFunctionId(const char *fname);
+
+/* count a call executed without trace in the shared call statistics;
+   returns a start time if CPU timing is enabled, 0 else
+*/
+DBGLIBLOCAL long long startCallStatistics(int functionId);
+
+DBGLIBLOCAL void stopCallStatistics(int functionId, long long start);
+
 DBGLIBLOCAL void executeDefaultDbgOperation(int op);
 
 /* work-around for external debug functions */
@@ -138,6 +181,15 @@ DBGLIBLOCAL void executeDefaultDbgOperation(int op);
 DBGLIBEXPORT void DEBUGLIB_EXTERNAL_setErrorCode(int error);
 DBGLIBEXPORT void (*DEBUGLIB_EXTERNAL_getOrigFunc(const char *fname))(void);
 
+/* the offline replay tool calls the regular GL entry points, so that it can
+ * run under the debug library itself
+ */
+#ifdef GLSLDB_REPLAY_TOOL
+#  undef ORIG_GL
+#  define ORIG_GL(fname) ((PFN##fname##PROC)replayGetProcAddress(#fname))
+DBGLIBLOCAL void (*replayGetProcAddress(const char *fname))(void);
+#endif
+
 #ifdef DEBUG
 #  define DMARK dbgPrint(DBGLVL_DEBUG, "DMARK %s: %s (%i)\n", __FILE__, __FUNCTION__, __LINE__);
 #else
@@ -0,0 +1,189 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "debuglibInternal.h"
+#include "drawTiming.h"
+#include "glstate.h"
+#include "dbgprint.h"
+
+#ifdef _WIN32
+#include "trampolines.h"
+#endif /* _WIN32 */
+
+#define DRAW_TIMER_POOL_SIZE 256
+
+extern GLFunctionList glFunctions[];
+extern Globals G;
+
+/* Queries are used round robin; the ones in flight form the range
+ * [first, first + num) of the pool and complete in this order. Query objects
+ * are not shared between contexts, so the pool belongs to the context that
+ * was current when it was generated.
+ */
+static struct {
+	int supported;
+	GLuint queries[DRAW_TIMER_POOL_SIZE];
+	DbgDrawTiming tags[DRAW_TIMER_POOL_SIZE];
+	int first;
+	int num;
+	int active;
+	const void *context;
+	DbgDrawTimingTable *table;
+} t = {-1, {0}, {{0, 0, 0, 0, 0}}, 0, 0, -1, NULL, NULL};
+
+static int initDrawTimers(void)
+{
+	if (t.supported < 0) {
+		t.supported = checkGLVersionSupported(1, 5) &&
+		              (checkGLExtensionSupported("GL_EXT_timer_query") ||
+		               checkGLExtensionSupported("GL_ARB_timer_query"));
+		if (t.supported) {
+			ORIG_GL(glGenQueries)(DRAW_TIMER_POOL_SIZE, t.queries);
+		}
+		dbgPrint(DBGLVL_INFO, "draw timing supported: %i\n", t.supported);
+	}
+	return t.supported;
+}
+
+void beginDrawTiming(DbgDrawTimingTable *table, int functionId,
+                     long long frame, long long call)
+{
+	DbgDrawTiming *tag;
+
+	t.active = -1;
+	t.table = table;
+
+	/* no queries inside glBegin/glEnd */
+	if (!table->enabled || !G.errorCheckAllowed ||
+	    !strcmp(glFunctions[functionId].fname, "glBegin") ||
+	    !initDrawTimers()) {
+		return;
+	}
+
+	if (t.num == DRAW_TIMER_POOL_SIZE) {
+		resolveDrawTimings(table);
+		if (t.num == DRAW_TIMER_POOL_SIZE) {
+			/* never stall the pipeline for a free query */
+			table->numSkipped++;
+			return;
+		}
+	}
+
+	/* timer queries cannot be nested */
+	if (G.queries.timerQuery) {
+		table->numSkipped++;
+		return;
+	}
+
+	t.active = (t.first + t.num) % DRAW_TIMER_POOL_SIZE;
+	tag = &t.tags[t.active];
+	tag->frame = frame;
+	tag->call = call;
+	tag->function = functionId;
+	tag->program = getGLStateShadow(GLSTATE_PROGRAM)->program;
+	tag->gpuTime = 0;
+	ORIG_GL(glBeginQuery)(GL_TIME_ELAPSED_EXT, t.queries[t.active]);
+}
+
+void endDrawTiming(void)
+{
+	if (t.active < 0) {
+		return;
+	}
+	ORIG_GL(glEndQuery)(GL_TIME_ELAPSED_EXT);
+	t.num++;
+	t.active = -1;
+}
+
+static void resolveQueries(DbgDrawTimingTable *table, int wait)
+{
+	GLint available;
+	GLuint64EXT time;
+	DbgDrawTiming *timing;
+
+	while (t.num > 0) {
+		GLuint query = t.queries[t.first];
+
+		if (!wait) {
+			ORIG_GL(glGetQueryObjectiv)(query, GL_QUERY_RESULT_AVAILABLE,
+			                            &available);
+			if (!available) {
+				break;
+			}
+		}
+		ORIG_GL(glGetQueryObjectui64vEXT)(query, GL_QUERY_RESULT, &time);
+
+		timing = &table->timings[table->numWritten % DBG_MAX_DRAW_TIMINGS];
+		*timing = t.tags[t.first];
+		timing->gpuTime = (ALIGNED_DATA)time;
+		table->numWritten++;
+
+		t.first = (t.first + 1) % DRAW_TIMER_POOL_SIZE;
+		t.num--;
+	}
+}
+
+void resolveDrawTimings(DbgDrawTimingTable *table)
+{
+	resolveQueries(table, 0);
+}
+
+void drawTimingSetContext(const void *context)
+{
+	if (context == t.context) {
+		return;
+	}
+	/* still in the old context: wait for its queries and free the pool, the
+	 * next draw call generates a new one in the new context
+	 */
+	if (t.supported > 0) {
+		if (t.table) {
+			resolveQueries(t.table, 1);
+		}
+		ORIG_GL(glDeleteQueries)(DRAW_TIMER_POOL_SIZE, t.queries);
+	}
+	cleanupDrawTimings();
+	t.context = context;
+}
+
+void cleanupDrawTimings(void)
+{
+	/* the context may be gone already; queries die with it */
+	t.supported = -1;
+	t.first = 0;
+	t.num = 0;
+	t.active = -1;
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef DRAW_TIMING_H
+#define DRAW_TIMING_H
+
+#include "debuglibExport.h"
+#include "../debuglib.h"
+
+/* Starts a GL_TIME_ELAPSED query for a debuggable draw call if draw timing is
+ * enabled, a query of the pool is free, and the application has no timer query
+ * of its own running. Must be followed by endDrawTiming after the draw call.
+ */
+DBGLIBLOCAL void beginDrawTiming(DbgDrawTimingTable *table, int functionId,
+                                 long long frame, long long call);
+
+DBGLIBLOCAL void endDrawTiming(void);
+
+/* Moves all available query results to the shared ring buffer without
+ * waiting for pending ones.
+ */
+DBGLIBLOCAL void resolveDrawTimings(DbgDrawTimingTable *table);
+
+/* Called before context becomes current. Waits for the queries of the old
+ * context and releases its pool.
+ */
+DBGLIBLOCAL void drawTimingSetContext(const void *context);
+
+DBGLIBLOCAL void cleanupDrawTimings(void);
+
+#endif
@@ -0,0 +1,941 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+
+#include "debuglibInternal.h"
+#include "frameCapture.h"
+#include "glstate.h"
+#include "shader.h"
+#include "dbgprint.h"
+
+#ifdef _WIN32
+#include "trampolines.h"
+#endif /* _WIN32 */
+
+/* texture units and vertex attributes beyond these are not captured */
+#define CAPTURE_MAX_UNITS      32
+#define CAPTURE_MAX_ATTRIBUTES 32
+#define CAPTURE_MAX_LEVELS     16
+
+extern GLFunctionList glFunctions[];
+
+/* The snapshot only queries state the GL version or an extension guarantees,
+ * so it raises no GL errors of its own.
+ */
+static struct {
+	int enabled;
+	CaptureWriter writer;
+	/* frames to capture, lastFrame is -1 if there is no end */
+	long long firstFrame;
+	long long lastFrame;
+	StreamRecorder rec;
+	/* position of the first call of the stream being recorded */
+	long long frame;
+	long long call;
+	/* the stream started with glBegin and ends with glEnd */
+	int inBeginEnd;
+	int drawSlot;
+	GLStateShadow state;
+	ObjectSnapshot snapshot;
+} c;
+
+/* argument positions of the draw calls whose vertex range can be told, -1 if
+ * the function has no such argument
+ */
+typedef struct {
+	const char *fname;
+	int first;
+	int count;
+	int type;
+	int indices;
+	int end;
+} DrawArguments;
+
+static const DrawArguments drawArguments[] = {
+	{"glDrawArrays", 1, 2, -1, -1, -1},
+	{"glDrawArraysEXT", 1, 2, -1, -1, -1},
+	{"glDrawArraysInstanced", 1, 2, -1, -1, -1},
+	{"glDrawArraysInstancedARB", 1, 2, -1, -1, -1},
+	{"glDrawArraysInstancedEXT", 1, 2, -1, -1, -1},
+	{"glDrawElements", -1, 1, 2, 3, -1},
+	{"glDrawElementsInstanced", -1, 1, 2, 3, -1},
+	{"glDrawElementsInstancedARB", -1, 1, 2, 3, -1},
+	{"glDrawElementsInstancedEXT", -1, 1, 2, 3, -1},
+	{"glDrawRangeElements", -1, 3, 4, 5, 2},
+	{"glDrawRangeElementsEXT", -1, 3, 4, 5, 2},
+	{NULL, -1, -1, -1, -1, -1}
+};
+
+/* the vertex range of the draw call of the stream */
+typedef struct {
+	/* number of vertices the arrays provide, 0 if unknown */
+	int numVertices;
+	/* client index array, NULL if the indices are in a buffer */
+	const GLvoid *indices;
+	GLenum type;
+	GLsizei count;
+} DrawRange;
+
+/* the conventional vertex arrays, size is 0 if the array has a fixed number
+ * of components
+ */
+typedef struct {
+	GLenum array;
+	int components;
+	GLenum size;
+	GLenum type;
+	GLenum stride;
+	GLenum pointer;
+	GLenum buffer;
+} ClientArray;
+
+static const ClientArray clientArrays[] = {
+	{GL_VERTEX_ARRAY, 0, GL_VERTEX_ARRAY_SIZE, GL_VERTEX_ARRAY_TYPE,
+	 GL_VERTEX_ARRAY_STRIDE, GL_VERTEX_ARRAY_POINTER,
+	 GL_VERTEX_ARRAY_BUFFER_BINDING},
+	{GL_NORMAL_ARRAY, 3, 0, GL_NORMAL_ARRAY_TYPE, GL_NORMAL_ARRAY_STRIDE,
+	 GL_NORMAL_ARRAY_POINTER, GL_NORMAL_ARRAY_BUFFER_BINDING},
+	{GL_COLOR_ARRAY, 0, GL_COLOR_ARRAY_SIZE, GL_COLOR_ARRAY_TYPE,
+	 GL_COLOR_ARRAY_STRIDE, GL_COLOR_ARRAY_POINTER,
+	 GL_COLOR_ARRAY_BUFFER_BINDING},
+	{GL_SECONDARY_COLOR_ARRAY, 0, GL_SECONDARY_COLOR_ARRAY_SIZE,
+	 GL_SECONDARY_COLOR_ARRAY_TYPE, GL_SECONDARY_COLOR_ARRAY_STRIDE,
+	 GL_SECONDARY_COLOR_ARRAY_POINTER,
+	 GL_SECONDARY_COLOR_ARRAY_BUFFER_BINDING},
+	{GL_FOG_COORD_ARRAY, 1, 0, GL_FOG_COORD_ARRAY_TYPE,
+	 GL_FOG_COORD_ARRAY_STRIDE, GL_FOG_COORD_ARRAY_POINTER,
+	 GL_FOG_COORD_ARRAY_BUFFER_BINDING}
+};
+
+static const GLenum textureTargets[] = {
+	GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP,
+	GL_TEXTURE_RECTANGLE_ARB
+};
+
+static const GLenum textureBindings[] = {
+	GL_TEXTURE_BINDING_1D, GL_TEXTURE_BINDING_2D, GL_TEXTURE_BINDING_3D,
+	GL_TEXTURE_BINDING_CUBE_MAP, GL_TEXTURE_BINDING_RECTANGLE_ARB
+};
+
+#define NUM_TEXTURE_TARGETS \
+	((int)(sizeof(textureTargets)/sizeof(textureTargets[0])))
+
+static int getTypeSize(GLenum type)
+{
+	switch (type) {
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			return 2;
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+		case GL_DOUBLE:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+/* number of texture targets of this GL */
+static int getNumTextureTargets(void)
+{
+	if (!checkGLVersionSupported(1, 3)) {
+		return 3;
+	}
+	if (!checkGLExtensionSupported("GL_ARB_texture_rectangle") &&
+	    !checkGLExtensionSupported("GL_NV_texture_rectangle")) {
+		return 4;
+	}
+	return NUM_TEXTURE_TARGETS;
+}
+
+CaptureObject *addCaptureObject(ObjectSnapshot *s, unsigned int type,
+                                const void *data, size_t size)
+{
+	CaptureObject *o;
+
+	if (s->numObjects == s->maxObjects) {
+		int maxObjects = s->maxObjects ? 2*s->maxObjects : 64;
+		o = realloc(s->objects, maxObjects*sizeof(CaptureObject));
+		if (!o) {
+			dbgPrint(DBGLVL_ERROR, "Allocation of capture objects failed\n");
+			exit(1); /* TODO: proper error handling */
+		}
+		s->objects = o;
+		s->maxObjects = maxObjects;
+	}
+	o = &s->objects[s->numObjects++];
+	memset(o, 0, sizeof(CaptureObject));
+	o->type = type;
+	if (size > 0) {
+		o->dataOffset = recordPayloadData(s->rec, data, size);
+		o->dataSize = size;
+	}
+	return o;
+}
+
+static int findCaptureObject(ObjectSnapshot *s, unsigned int type,
+                             unsigned int name)
+{
+	int i;
+	for (i = 0; i < s->numObjects; i++) {
+		if (s->objects[i].type == type && s->objects[i].name == name) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void openFrameCapture(void)
+{
+	const char *filename = getenv("GLSL_DEBUGGER_CAPTURE");
+	const char *frames = getenv("GLSL_DEBUGGER_CAPTURE_FRAMES");
+	char *end;
+	int error;
+
+	if (!filename || !*filename) {
+		return;
+	}
+	c.firstFrame = 0;
+	c.lastFrame = -1;
+	if (frames && *frames) {
+		c.firstFrame = strtoll(frames, &end, 10);
+		if (*end != '-') {
+			c.lastFrame = c.firstFrame;
+		} else if (end[1]) {
+			c.lastFrame = strtoll(end + 1, NULL, 10);
+		}
+	}
+	error = openStreamCapture(&c.writer, filename);
+	if (error) {
+		dbgPrint(DBGLVL_WARNING, "Cannot create capture %s: %s\n", filename,
+		         strerror(error));
+		return;
+	}
+	initStreamRecorder(&c.rec);
+	c.snapshot.rec = &c.rec;
+	c.enabled = 1;
+	dbgPrint(DBGLVL_INFO, "Capturing frames %lli to %lli to %s\n",
+	         c.firstFrame, c.lastFrame, filename);
+}
+
+static void writeStream(int haveDraw)
+{
+	CaptureStream head;
+	int error = 0;
+
+	memset(&head, 0, sizeof(head));
+	head.frame = c.frame;
+	head.call = c.call;
+	if (haveDraw) {
+		head.drawSlot = c.drawSlot;
+		if (c.snapshot.numObjects > 0) {
+			head.objectsOffset =
+				recordPayloadData(&c.rec, c.snapshot.objects,
+				                  c.snapshot.numObjects*sizeof(CaptureObject));
+			head.numObjects = c.snapshot.numObjects;
+		}
+		error = captureWriteState(&c.writer, GLSTATE_SHADOW_VERSION,
+		                          &c.state, sizeof(c.state));
+	} else {
+		head.drawSlot = c.rec.codeSize;
+	}
+	if (!error) {
+		error = captureRecordedCalls(&c.rec, &c.writer, &head);
+	}
+	clearRecordedCalls(&c.rec);
+	c.snapshot.numObjects = 0;
+	if (error) {
+		dbgPrint(DBGLVL_WARNING, "Writing capture failed: %s\n",
+		         strerror(error));
+		closeFrameCapture();
+	}
+}
+
+void closeFrameCapture(void)
+{
+	if (!c.enabled) {
+		return;
+	}
+	if (c.rec.numCalls > 0) {
+		writeStream(c.inBeginEnd);
+	}
+	/* writeStream may have closed the capture already */
+	if (c.enabled) {
+		captureClose(&c.writer);
+		c.enabled = 0;
+	}
+	clearRecordedCalls(&c.rec);
+	free(c.snapshot.objects);
+	c.snapshot.objects = NULL;
+	c.snapshot.numObjects = 0;
+	c.snapshot.maxObjects = 0;
+	c.inBeginEnd = 0;
+}
+
+int isFrameCaptureEnabled(void)
+{
+	return c.enabled;
+}
+
+int isCapturingFrame(void)
+{
+	long long frame, call;
+
+	if (!c.enabled) {
+		return 0;
+	}
+	getCallPosition(&frame, &call);
+	return frame >= c.firstFrame && (c.lastFrame < 0 || frame <= c.lastFrame);
+}
+
+/* decode the vertex range from the operands of the recorded draw call */
+static void getDrawRange(DrawRange *range, const char *fname,
+                         GLint elementBuffer)
+{
+	const DrawArguments *a;
+	const ReplaySlot *op = &c.rec.code[c.drawSlot + 1];
+	GLsizei i, count;
+	GLuint maxIndex = 0;
+	int size;
+	void *indices;
+
+	memset(range, 0, sizeof(DrawRange));
+	for (a = drawArguments; a->fname; a++) {
+		if (!strcmp(a->fname, fname)) {
+			break;
+		}
+	}
+	/* glBegin and glMultiDraw*: the arrays are not captured */
+	if (!a->fname) {
+		return;
+	}
+	count = *(const GLsizei*)&op[a->count];
+	if (count <= 0) {
+		return;
+	}
+	if (a->first >= 0) {
+		range->numVertices = *(const GLint*)&op[a->first] + count;
+		return;
+	}
+	range->count = count;
+	range->type = *(const GLenum*)&op[a->type];
+	if (!elementBuffer) {
+		range->indices = *(const GLvoid* const*)&op[a->indices];
+	}
+	if (a->end >= 0) {
+		range->numVertices = *(const GLuint*)&op[a->end] + 1;
+		return;
+	}
+
+	size = getTypeSize(range->type);
+	if (!size) {
+		return;
+	}
+	if (range->indices) {
+		indices = (void*)range->indices;
+	} else {
+		/* the indices are at this offset of the element buffer */
+		indices = malloc((size_t)count*size);
+		if (!indices) {
+			return;
+		}
+		ORIG_GL(glGetBufferSubData)(GL_ELEMENT_ARRAY_BUFFER,
+		             (GLintptr)*(const GLvoid* const*)&op[a->indices],
+		             (GLsizeiptr)count*size, indices);
+	}
+	for (i = 0; i < count; i++) {
+		GLuint index;
+		switch (range->type) {
+			case GL_UNSIGNED_BYTE:
+				index = ((const GLubyte*)indices)[i];
+				break;
+			case GL_UNSIGNED_SHORT:
+				index = ((const GLushort*)indices)[i];
+				break;
+			default:
+				index = ((const GLuint*)indices)[i];
+				break;
+		}
+		if (index > maxIndex) {
+			maxIndex = index;
+		}
+	}
+	if (!range->indices) {
+		free(indices);
+	}
+	range->numVertices = (int)maxIndex + 1;
+}
+
+static void snapshotMatrices(ObjectSnapshot *s)
+{
+	static const GLfloat identity[16] = {
+		1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f
+	};
+	GLfloat m[16];
+	GLint numUnits = 1, activeTexture, i;
+
+	ORIG_GL(glGetFloatv)(GL_MODELVIEW_MATRIX, m);
+	addCaptureObject(s, CAPTURE_OBJECT_MATRIX, m, sizeof(m))->target =
+		GL_MODELVIEW;
+	ORIG_GL(glGetFloatv)(GL_PROJECTION_MATRIX, m);
+	addCaptureObject(s, CAPTURE_OBJECT_MATRIX, m, sizeof(m))->target =
+		GL_PROJECTION;
+
+	if (!checkGLVersionSupported(1, 3)) {
+		return;
+	}
+	ORIG_GL(glGetIntegerv)(GL_ACTIVE_TEXTURE, &activeTexture);
+	ORIG_GL(glGetIntegerv)(GL_MAX_TEXTURE_UNITS, &numUnits);
+	if (numUnits > CAPTURE_MAX_UNITS) {
+		numUnits = CAPTURE_MAX_UNITS;
+	}
+	for (i = 0; i < numUnits; i++) {
+		CaptureObject *o;
+		ORIG_GL(glActiveTexture)(GL_TEXTURE0 + i);
+		ORIG_GL(glGetFloatv)(GL_TEXTURE_MATRIX, m);
+		/* the replay starts with identity matrices */
+		if (!memcmp(m, identity, sizeof(m))) {
+			continue;
+		}
+		o = addCaptureObject(s, CAPTURE_OBJECT_MATRIX, m, sizeof(m));
+		o->target = GL_TEXTURE;
+		o->index = i;
+	}
+	ORIG_GL(glActiveTexture)(activeTexture);
+}
+
+/* texture units with an enabled target, for fixed function draw calls */
+static unsigned int getEnabledTextureUnits(void)
+{
+	GLint numUnits = 1, activeTexture = GL_TEXTURE0, i;
+	int t, numTargets = getNumTextureTargets();
+	unsigned int units = 0;
+
+	if (checkGLVersionSupported(1, 3)) {
+		ORIG_GL(glGetIntegerv)(GL_ACTIVE_TEXTURE, &activeTexture);
+		ORIG_GL(glGetIntegerv)(GL_MAX_TEXTURE_UNITS, &numUnits);
+		if (numUnits > CAPTURE_MAX_UNITS) {
+			numUnits = CAPTURE_MAX_UNITS;
+		}
+	}
+	for (i = 0; i < numUnits; i++) {
+		if (checkGLVersionSupported(1, 3)) {
+			ORIG_GL(glActiveTexture)(GL_TEXTURE0 + i);
+		}
+		for (t = 0; t < numTargets; t++) {
+			if (ORIG_GL(glIsEnabled)(textureTargets[t])) {
+				units |= 1u << i;
+			}
+		}
+	}
+	if (checkGLVersionSupported(1, 3)) {
+		ORIG_GL(glActiveTexture)(activeTexture);
+	}
+	return units;
+}
+
+/* read back a level of the texture bound to target (or its cube map face);
+ * returns 0 if the level does not exist
+ */
+static int snapshotImage(ObjectSnapshot *s, GLenum target, GLenum face,
+                         int level)
+{
+	static const GLenum componentSizes[] = {
+		GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE,
+		GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_LUMINANCE_SIZE,
+		GL_TEXTURE_INTENSITY_SIZE
+	};
+	GLint width = 0, height = 1, depth = 1, format = 0, compressed = 0;
+	GLint depthSize = 0, size, maxSize = 0;
+	GLenum dataFormat = GL_RGBA, dataType = GL_UNSIGNED_BYTE;
+	int i, texelSize = 4;
+	size_t dataSize;
+	void *data;
+	CaptureObject *o;
+
+	ORIG_GL(glGetTexLevelParameteriv)(face, level, GL_TEXTURE_WIDTH, &width);
+	if (width <= 0) {
+		return 0;
+	}
+	if (target != GL_TEXTURE_1D) {
+		ORIG_GL(glGetTexLevelParameteriv)(face, level, GL_TEXTURE_HEIGHT,
+		                                  &height);
+	}
+	if (target == GL_TEXTURE_3D) {
+		ORIG_GL(glGetTexLevelParameteriv)(face, level, GL_TEXTURE_DEPTH,
+		                                  &depth);
+	}
+	ORIG_GL(glGetTexLevelParameteriv)(face, level,
+	                                  GL_TEXTURE_INTERNAL_FORMAT, &format);
+	if (checkGLVersionSupported(1, 3)) {
+		ORIG_GL(glGetTexLevelParameteriv)(face, level, GL_TEXTURE_COMPRESSED,
+		                                  &compressed);
+	}
+	if (checkGLVersionSupported(1, 4)) {
+		ORIG_GL(glGetTexLevelParameteriv)(face, level, GL_TEXTURE_DEPTH_SIZE,
+		                                  &depthSize);
+	}
+	for (i = 0; i < (int)(sizeof(componentSizes)/sizeof(GLenum)); i++) {
+		size = 0;
+		ORIG_GL(glGetTexLevelParameteriv)(face, level, componentSizes[i],
+		                                  &size);
+		if (size > maxSize) {
+			maxSize = size;
+		}
+	}
+
+	/* images are stored uncompressed in a format that keeps their precision */
+	if (depthSize > 0) {
+		dataFormat = GL_DEPTH_COMPONENT;
+		dataType = GL_FLOAT;
+	} else if (maxSize > 8) {
+		dataType = GL_FLOAT;
+		texelSize = 16;
+	}
+	if (compressed) {
+		format = GL_RGBA8;
+	}
+
+	dataSize = (size_t)width*height*depth*texelSize;
+	data = malloc(dataSize);
+	if (!data) {
+		dbgPrint(DBGLVL_WARNING, "capture: no memory for a %ix%ix%i image\n",
+		         width, height, depth);
+		return 1;
+	}
+	ORIG_GL(glGetTexImage)(face, level, dataFormat, dataType, data);
+
+	o = addCaptureObject(s, CAPTURE_OBJECT_IMAGE, data, dataSize);
+	o->target = face;
+	o->level = level;
+	o->format = format;
+	o->size[0] = width;
+	o->size[1] = height;
+	o->size[2] = depth;
+	o->dataFormat = dataFormat;
+	o->dataType = dataType;
+	free(data);
+	return 1;
+}
+
+/* the texture bound to target of the active unit */
+static void snapshotTexture(ObjectSnapshot *s, GLenum target, GLuint name)
+{
+	static const GLenum params[] = {
+		GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S,
+		GL_TEXTURE_WRAP_T, GL_TEXTURE_WRAP_R, GL_TEXTURE_COMPARE_MODE,
+		GL_TEXTURE_COMPARE_FUNC, GL_TEXTURE_BASE_LEVEL, GL_TEXTURE_MAX_LEVEL
+	};
+	CaptureObject *o;
+	int i, level, face, numParams, numFaces;
+
+	/* wrap r and the levels are GL 1.2, the compare state GL 1.4 */
+	numParams = checkGLVersionSupported(1, 2) ? 5 : 4;
+	o = addCaptureObject(s, CAPTURE_OBJECT_TEXTURE, NULL, 0);
+	o->name = name;
+	o->target = target;
+	for (i = 0; i < numParams; i++) {
+		ORIG_GL(glGetTexParameteriv)(target, params[i], &o->params[i]);
+	}
+	if (checkGLVersionSupported(1, 4)) {
+		ORIG_GL(glGetTexParameteriv)(target, params[5], &o->params[5]);
+		ORIG_GL(glGetTexParameteriv)(target, params[6], &o->params[6]);
+	}
+	if (checkGLVersionSupported(1, 2)) {
+		ORIG_GL(glGetTexParameteriv)(target, params[7], &o->params[7]);
+		ORIG_GL(glGetTexParameteriv)(target, params[8], &o->params[8]);
+	} else {
+		o->params[8] = 1000;
+	}
+
+	numFaces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+	for (level = 0; level < CAPTURE_MAX_LEVELS; level++) {
+		for (face = 0; face < numFaces; face++) {
+			GLenum f = numFaces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face
+			                         : target;
+			if (!snapshotImage(s, target, f, level)) {
+				return;
+			}
+		}
+	}
+}
+
+static void snapshotTextures(ObjectSnapshot *s, unsigned int units)
+{
+	GLint activeTexture = GL_TEXTURE0, packAlignment, packBuffer = 0;
+	GLint packRowLength, packSkipRows, packSkipPixels;
+	GLint packImageHeight = 0, packSkipImages = 0;
+	int i, t, numTargets = getNumTextureTargets();
+
+	if (!units) {
+		return;
+	}
+
+	ORIG_GL(glGetIntegerv)(GL_PACK_ALIGNMENT, &packAlignment);
+	ORIG_GL(glGetIntegerv)(GL_PACK_ROW_LENGTH, &packRowLength);
+	ORIG_GL(glGetIntegerv)(GL_PACK_SKIP_ROWS, &packSkipRows);
+	ORIG_GL(glGetIntegerv)(GL_PACK_SKIP_PIXELS, &packSkipPixels);
+	ORIG_GL(glPixelStorei)(GL_PACK_ALIGNMENT, 1);
+	ORIG_GL(glPixelStorei)(GL_PACK_ROW_LENGTH, 0);
+	ORIG_GL(glPixelStorei)(GL_PACK_SKIP_ROWS, 0);
+	ORIG_GL(glPixelStorei)(GL_PACK_SKIP_PIXELS, 0);
+	if (checkGLVersionSupported(1, 2)) {
+		ORIG_GL(glGetIntegerv)(GL_PACK_IMAGE_HEIGHT, &packImageHeight);
+		ORIG_GL(glGetIntegerv)(GL_PACK_SKIP_IMAGES, &packSkipImages);
+		ORIG_GL(glPixelStorei)(GL_PACK_IMAGE_HEIGHT, 0);
+		ORIG_GL(glPixelStorei)(GL_PACK_SKIP_IMAGES, 0);
+	}
+	if (checkGLVersionSupported(2, 1)) {
+		ORIG_GL(glGetIntegerv)(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+		ORIG_GL(glBindBuffer)(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	if (checkGLVersionSupported(1, 3)) {
+		ORIG_GL(glGetIntegerv)(GL_ACTIVE_TEXTURE, &activeTexture);
+	}
+
+	for (i = 0; i < CAPTURE_MAX_UNITS; i++) {
+		if (!(units & (1u << i))) {
+			continue;
+		}
+		if (checkGLVersionSupported(1, 3)) {
+			ORIG_GL(glActiveTexture)(GL_TEXTURE0 + i);
+		} else if (i > 0) {
+			break;
+		}
+		for (t = 0; t < numTargets; t++) {
+			GLint name = 0;
+			CaptureObject *o;
+
+			ORIG_GL(glGetIntegerv)(textureBindings[t], &name);
+			if (!name) {
+				continue;
+			}
+			o = addCaptureObject(s, CAPTURE_OBJECT_BINDING, NULL, 0);
+			o->name = name;
+			o->target = textureTargets[t];
+			o->index = i;
+			if (!findCaptureObject(s, CAPTURE_OBJECT_TEXTURE, name)) {
+				snapshotTexture(s, textureTargets[t], name);
+			}
+		}
+	}
+
+	if (checkGLVersionSupported(1, 3)) {
+		ORIG_GL(glActiveTexture)(activeTexture);
+	}
+	if (checkGLVersionSupported(2, 1)) {
+		ORIG_GL(glBindBuffer)(GL_PIXEL_PACK_BUFFER, packBuffer);
+	}
+	if (checkGLVersionSupported(1, 2)) {
+		ORIG_GL(glPixelStorei)(GL_PACK_IMAGE_HEIGHT, packImageHeight);
+		ORIG_GL(glPixelStorei)(GL_PACK_SKIP_IMAGES, packSkipImages);
+	}
+	ORIG_GL(glPixelStorei)(GL_PACK_ALIGNMENT, packAlignment);
+	ORIG_GL(glPixelStorei)(GL_PACK_ROW_LENGTH, packRowLength);
+	ORIG_GL(glPixelStorei)(GL_PACK_SKIP_ROWS, packSkipRows);
+	ORIG_GL(glPixelStorei)(GL_PACK_SKIP_PIXELS, packSkipPixels);
+}
+
+/* contents of a buffer object, once per snapshot */
+static void snapshotBuffer(ObjectSnapshot *s, GLuint name)
+{
+	GLint size = 0, mapped = GL_FALSE, usage = 0, arrayBuffer = 0;
+	void *data = NULL;
+	CaptureObject *o;
+
+	if (!name || findCaptureObject(s, CAPTURE_OBJECT_BUFFER, name)) {
+		return;
+	}
+	ORIG_GL(glGetIntegerv)(GL_ARRAY_BUFFER_BINDING, &arrayBuffer);
+	ORIG_GL(glBindBuffer)(GL_ARRAY_BUFFER, name);
+	ORIG_GL(glGetBufferParameteriv)(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+	ORIG_GL(glGetBufferParameteriv)(GL_ARRAY_BUFFER, GL_BUFFER_USAGE, &usage);
+	ORIG_GL(glGetBufferParameteriv)(GL_ARRAY_BUFFER, GL_BUFFER_MAPPED,
+	                                &mapped);
+	if (mapped) {
+		/* cannot be read, the replay gets an uninitialized buffer */
+		dbgPrint(DBGLVL_WARNING, "capture: buffer %u is mapped\n", name);
+	} else if (size > 0) {
+		data = malloc(size);
+		if (data) {
+			ORIG_GL(glGetBufferSubData)(GL_ARRAY_BUFFER, 0, size, data);
+		}
+	}
+	o = addCaptureObject(s, CAPTURE_OBJECT_BUFFER, data, data ? size : 0);
+	o->name = name;
+	o->size[0] = size;
+	o->params[0] = usage;
+	free(data);
+	ORIG_GL(glBindBuffer)(GL_ARRAY_BUFFER, arrayBuffer);
+}
+
+static void addArray(ObjectSnapshot *s, GLenum target, int index,
+                     GLint size, GLenum type, GLint normalized,
+                     GLint stride, GLint buffer, const GLvoid *pointer,
+                     const DrawRange *range)
+{
+	CaptureObject *o;
+	const void *data = NULL;
+	size_t dataSize = 0;
+	/* GL_BGRA colors have four components */
+	int elementSize = (size == GL_BGRA ? 4 : size)*getTypeSize(type);
+
+	if (buffer) {
+		snapshotBuffer(s, buffer);
+	} else if (pointer && range->numVertices > 0 && elementSize > 0) {
+		data = pointer;
+		dataSize = (size_t)(range->numVertices - 1)*
+		           (stride ? stride : elementSize) + elementSize;
+	}
+	o = addCaptureObject(s, CAPTURE_OBJECT_ARRAY, data, dataSize);
+	o->target = target;
+	o->index = index;
+	o->size[0] = size;
+	o->dataType = type;
+	o->params[0] = GL_TRUE;
+	o->params[1] = normalized;
+	o->params[2] = stride;
+	o->params[3] = buffer;
+	o->pointer = (unsigned long long)(size_t)pointer;
+}
+
+static void snapshotClientArray(ObjectSnapshot *s, const ClientArray *a,
+                                int unit, const DrawRange *range)
+{
+	GLint size = a->components, type = 0, stride = 0, buffer = 0;
+	GLvoid *pointer = NULL;
+
+	if (!ORIG_GL(glIsEnabled)(a->array)) {
+		return;
+	}
+	if (a->size) {
+		ORIG_GL(glGetIntegerv)(a->size, &size);
+	}
+	ORIG_GL(glGetIntegerv)(a->type, &type);
+	ORIG_GL(glGetIntegerv)(a->stride, &stride);
+	if (checkGLVersionSupported(1, 5)) {
+		ORIG_GL(glGetIntegerv)(a->buffer, &buffer);
+	}
+	ORIG_GL(glGetPointerv)(a->pointer, &pointer);
+	addArray(s, a->array, unit, size, type, GL_FALSE, stride, buffer,
+	         pointer, range);
+}
+
+static void snapshotArrays(ObjectSnapshot *s, const DrawRange *range)
+{
+	static const ClientArray texCoordArray = {
+		GL_TEXTURE_COORD_ARRAY, 0, GL_TEXTURE_COORD_ARRAY_SIZE,
+		GL_TEXTURE_COORD_ARRAY_TYPE, GL_TEXTURE_COORD_ARRAY_STRIDE,
+		GL_TEXTURE_COORD_ARRAY_POINTER, GL_TEXTURE_COORD_ARRAY_BUFFER_BINDING
+	};
+	GLint numArrays, numUnits = 1, clientActiveTexture, i;
+
+	/* secondary color and fog coordinate arrays are GL 1.4 */
+	numArrays = checkGLVersionSupported(1, 4) ? 5 : 3;
+	for (i = 0; i < numArrays; i++) {
+		snapshotClientArray(s, &clientArrays[i], 0, range);
+	}
+	if (checkGLVersionSupported(1, 3)) {
+		ORIG_GL(glGetIntegerv)(GL_CLIENT_ACTIVE_TEXTURE,
+		                       &clientActiveTexture);
+		ORIG_GL(glGetIntegerv)(GL_MAX_TEXTURE_UNITS, &numUnits);
+		if (numUnits > CAPTURE_MAX_UNITS) {
+			numUnits = CAPTURE_MAX_UNITS;
+		}
+		for (i = 0; i < numUnits; i++) {
+			ORIG_GL(glClientActiveTexture)(GL_TEXTURE0 + i);
+			snapshotClientArray(s, &texCoordArray, i, range);
+		}
+		ORIG_GL(glClientActiveTexture)(clientActiveTexture);
+	} else {
+		snapshotClientArray(s, &texCoordArray, 0, range);
+	}
+
+	if (!checkGLVersionSupported(2, 0)) {
+		return;
+	}
+	ORIG_GL(glGetIntegerv)(GL_MAX_VERTEX_ATTRIBS, &numArrays);
+	if (numArrays > CAPTURE_MAX_ATTRIBUTES) {
+		numArrays = CAPTURE_MAX_ATTRIBUTES;
+	}
+	for (i = 0; i < numArrays; i++) {
+		GLint enabled = 0, size = 4, type = GL_FLOAT, normalized = 0;
+		GLint stride = 0, buffer = 0;
+		GLvoid *pointer = NULL;
+		GLfloat current[4];
+		CaptureObject *o;
+
+		ORIG_GL(glGetVertexAttribiv)(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED,
+		                             &enabled);
+		if (enabled) {
+			ORIG_GL(glGetVertexAttribiv)(i, GL_VERTEX_ATTRIB_ARRAY_SIZE,
+			                             &size);
+			ORIG_GL(glGetVertexAttribiv)(i, GL_VERTEX_ATTRIB_ARRAY_TYPE,
+			                             &type);
+			ORIG_GL(glGetVertexAttribiv)(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED,
+			                             &normalized);
+			ORIG_GL(glGetVertexAttribiv)(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE,
+			                             &stride);
+			ORIG_GL(glGetVertexAttribiv)(i,
+			                GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+			ORIG_GL(glGetVertexAttribPointerv)(i,
+			                GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+			addArray(s, 0, i, size, type, normalized, stride, buffer,
+			         pointer, range);
+		} else if (i > 0) {
+			/* attribute 0 aliases the vertex position, it has no value */
+			ORIG_GL(glGetVertexAttribfv)(i, GL_CURRENT_VERTEX_ATTRIB, current);
+			o = addCaptureObject(s, CAPTURE_OBJECT_ARRAY, current,
+			                     sizeof(current));
+			o->index = i;
+			o->size[0] = 4;
+			o->dataType = GL_FLOAT;
+		}
+	}
+}
+
+/* everything the draw call of the stream uses besides the state shadow */
+static void snapshotObjects(const char *fname)
+{
+	ObjectSnapshot *s = &c.snapshot;
+	GLint elementBuffer = 0, arrayBuffer = 0;
+	unsigned int units = 0;
+	DrawRange range;
+	CaptureObject *o;
+
+	s->numObjects = 0;
+	c.state = *getGLStateShadow(GLSTATE_ALL);
+
+	if (checkGLVersionSupported(1, 5)) {
+		ORIG_GL(glGetIntegerv)(GL_ELEMENT_ARRAY_BUFFER_BINDING,
+		                       &elementBuffer);
+		ORIG_GL(glGetIntegerv)(GL_ARRAY_BUFFER_BINDING, &arrayBuffer);
+	}
+	getDrawRange(&range, fname, elementBuffer);
+
+	snapshotMatrices(s);
+
+	if (c.state.program) {
+		snapshotCurrentProgram(s, &units);
+	} else {
+		addCaptureObject(s, CAPTURE_OBJECT_PROGRAM, NULL, 0);
+		units = getEnabledTextureUnits();
+	}
+	snapshotTextures(s, units);
+
+	snapshotArrays(s, &range);
+	if (elementBuffer) {
+		snapshotBuffer(s, elementBuffer);
+		o = addCaptureObject(s, CAPTURE_OBJECT_BINDING, NULL, 0);
+		o->name = elementBuffer;
+		o->target = GL_ELEMENT_ARRAY_BUFFER;
+	}
+	if (arrayBuffer) {
+		o = addCaptureObject(s, CAPTURE_OBJECT_BINDING, NULL, 0);
+		o->name = arrayBuffer;
+		o->target = GL_ARRAY_BUFFER;
+	}
+	if (range.indices && getTypeSize(range.type)) {
+		o = addCaptureObject(s, CAPTURE_OBJECT_INDICES, range.indices,
+		                     (size_t)range.count*getTypeSize(range.type));
+		o->pointer = (unsigned long long)(size_t)range.indices;
+		o->dataType = range.type;
+	}
+}
+
+void captureFunctionCall(int functionId, const char *fname, int numArgs, ...)
+{
+	va_list argp;
+	int isDraw = functionId >= 0 &&
+	             glFunctions[functionId].isDebuggableDrawCall &&
+	             !c.inBeginEnd;
+
+	if (c.rec.numCalls == 0) {
+		getCallPosition(&c.frame, &c.call);
+	}
+	if (isDraw) {
+		c.drawSlot = c.rec.codeSize;
+	}
+	va_start(argp, numArgs);
+	vrecordFunctionCall(&c.rec, fname, numArgs, argp);
+	va_end(argp);
+
+	if (c.inBeginEnd) {
+		if (!strcmp(fname, "glEnd")) {
+			c.inBeginEnd = 0;
+			writeStream(1);
+		}
+		return;
+	}
+	/* a draw call that could not be recorded gets no snapshot */
+	if (!isDraw || c.rec.lastInstruction != c.drawSlot) {
+		return;
+	}
+	snapshotObjects(fname);
+	if (!strcmp(fname, "glBegin")) {
+		c.inBeginEnd = 1;
+		return;
+	}
+	writeStream(1);
+}
+
+void endCaptureFrame(void)
+{
+	long long frame, call;
+
+	if (!c.enabled) {
+		return;
+	}
+	if (c.rec.numCalls > 0) {
+		/* a glBegin without glEnd still has its snapshot */
+		writeStream(c.inBeginEnd);
+		c.inBeginEnd = 0;
+	}
+	getCallPosition(&frame, &call);
+	if (c.lastFrame >= 0 && frame >= c.lastFrame) {
+		dbgPrint(DBGLVL_INFO, "Capture of frames %lli to %lli done\n",
+		         c.firstFrame, c.lastFrame);
+		closeFrameCapture();
+	}
+}
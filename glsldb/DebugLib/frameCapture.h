@@ -0,0 +1,85 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <stddef.h>
+
+#include "debuglibExport.h"
+#include "../utils/capture.h"
+#include "streamRecorder.h"
+
+/* Whole frame captures, see utils/capture.h.
+ *
+ * If GLSL_DEBUGGER_CAPTURE names a file, every recordable call of the frames
+ * selected by GLSL_DEBUGGER_CAPTURE_FRAMES ("first-last" or "first", all
+ * frames by default) is recorded, no matter whether the debugger steps
+ * through it. A stream ends with each debuggable draw call, or with the glEnd
+ * of a glBegin, and carries the GL state shadow and the objects the draw call
+ * uses, taken right before it is executed. The calls after the last draw call
+ * of a frame are written when the frame ends.
+ */
+DBGLIBLOCAL void openFrameCapture(void);
+
+DBGLIBLOCAL void closeFrameCapture(void);
+
+/* whether GLSL_DEBUGGER_CAPTURE asked for a capture at all */
+DBGLIBLOCAL int isFrameCaptureEnabled(void);
+
+/* whether the call of the running hook belongs to a captured frame */
+DBGLIBLOCAL int isCapturingFrame(void);
+
+/* arguments are passed as (address, size) pairs as for recordFunctionCall */
+DBGLIBLOCAL void captureFunctionCall(int functionId, const char *fname,
+                                     int numArgs, ...);
+
+/* called by the frame end call before it is executed */
+DBGLIBLOCAL void endCaptureFrame(void);
+
+/* objects of a draw call, their data is stored in the payload of rec */
+typedef struct {
+	StreamRecorder *rec;
+	CaptureObject *objects;
+	int numObjects;
+	int maxObjects;
+} ObjectSnapshot;
+
+/* append an object with all fields 0 but type and data; the pointer is valid
+ * until the next object is added
+ */
+DBGLIBLOCAL CaptureObject *addCaptureObject(ObjectSnapshot *s,
+                                            unsigned int type,
+                                            const void *data, size_t size);
+
+#endif
@@ -145,9 +145,33 @@ sub printArgumentReferences
 	}
 }
 
+# number of arguments followed by (address, DBG_TYPE) pairs
+sub printArgumentTypeList
+{
+	my @arguments = @_;
+	if ($#arguments > 1 || @arguments[0] !~ /^void$|^$/i) {
+		printf("%i, ", $#arguments + 1);
+		for (my $i = 0; $i <= $#arguments; $i++) {
+			print "&arg$i, ";
+			print getTypeId(@arguments[$i]);
+			if ($i != $#arguments) {
+				print ", ";
+			}
+		}
+	} else {
+		print "0";
+	}
+}
+
 sub printPreExecute
 {
 	my ($indent, $fname, @arguments) = @_;
+	if (scalar grep {$fname eq $_} @uniformWriteList) {
+		print "${indent}uniformCacheMarkCurrentDirty();\n";
+	}
+	if (scalar grep {$fname eq $_} @programUniformWriteList) {
+		print "${indent}uniformCacheMarkDirty(arg0);\n";
+	}
 	if (scalar grep {$fname eq $_} @preExecutionList) {
 		print "$indent$fname";
 		print "_PREEXECUTE(";
@@ -163,10 +187,58 @@ sub printPostExecute
 		print "$indent$fname";
 		print "_POSTEXECUTE(";
 		printArgumentReferences(@arguments);
+		if ($#arguments > 1 || @arguments[0] !~ /^void$|^$/i) {
+			print ", ";
+		}
 		if ($retval !~ /^void$|^$/i) {
-			print ", &result";
+			print "&result, ";
 		}
-		print ", &error);\n";
+		print "&error);\n";
+	}
+}
+
+# number of arguments followed by (address, size) pairs for recordFunctionCall
+sub printRecordArguments
+{
+	my ($fname, @arguments) = @_;
+	if ($#arguments > 1 || @arguments[0] !~ /^void$|^$/i) {
+		printf("%i, ", $#arguments + 1);
+		for (my $i = 0; $i <= $#arguments; $i++) {
+			if (@arguments[$i] =~ /[*]$/) {
+				if (scalar grep {$fname eq $_} @justCopyPointersList) {
+					print "&arg$i, sizeof(void*)";
+				} else {
+					print "arg$i, ";
+					if ($fname =~ /gl\D+([1234])\D{1,3}v[A-Z]*/ &&
+						$fname !~ /glProgramNamedParameter\SvNV/) {
+						print "$1*sizeof(";
+						my $type = stripStorageQualifiers(@arguments[$i]);
+						$type =~ s/\*//;
+						$type =~ s/\s*$//;
+						print "$type)";
+					} else {
+						print "$fname";
+						print "_getArg$i";
+						print "Size(";
+						for (my $j = 0; $j <= $#arguments; $j++) {
+							print "arg$j";
+							if ($j != $#arguments) {
+								print ", ";
+							}
+						}
+						print ")"
+					}
+				}
+			} else {
+				print "&arg$i, ";
+				printf("sizeof(%s)", stripStorageQualifiers(@arguments[$i]));
+			}
+			if ($i != $#arguments) {
+				print ", ";
+			}
+		}
+	} else {
+		print "0";
 	}
 }
 
@@ -218,7 +290,9 @@ sub createBody
 	# first store name of called function and its arguments in the shared memory
 	# segment, then call dbgFunctionCall that stops the process/thread and waits
 	# for the debugger to handle the actual debugging
-	print "\t\tint op, error;\n";
+	print "\t\tint op, error, execute;\n";
+	print "\t\tstatic int functionId = -2;\n";
+	print "\t\tlong long callStart;\n";
 	if (defined $WIN32) {
 		print "\t\tDbgRec *rec;\n";
 		print "\t\tdbgPrint(DBGLVL_DEBUG, \"entering $fname\\n\");\n";
@@ -254,9 +328,28 @@ sub createBody
 	} else {
 		print "\t\tpthread_mutex_lock(&G.lock);\n";
 	}
-	print "\t\tif (keepExecuting(\"$fname\")) {\n";
+	print "\t\tif (functionId == -2) {\n";
+	print "\t\t\tfunctionId = getFunctionId(\"$fname\");\n";
+	print "\t\t}\n";
+	print "\t\texecute = keepExecuting(functionId, \"$fname\", ";
+	printArgumentTypeList(@arguments);
+	print ");\n";
+	# frame captures record every call, whatever the debugger does with it
+	print "#ifdef DBG_STREAM_HINT_";
+	printf("%s", uc($fname));
+	print "\n#  if DBG_STREAM_HINT_";
+	printf("%s", uc($fname));
+	print " != DBG_NO_RECORD\n";
+	print "\t\tif (isCapturingFrame()) {\n";
+	print "\t\t\tcaptureFunctionCall(functionId, \"$fname\", ";
+	printRecordArguments($fname, @arguments);
+	print ");\n";
+	print "\t\t}\n";
+	print "#  endif\n#endif\n";
+	print "\t\tif (execute) {\n";
 	print "\t\t\t$unlockStatement";
 	printPreExecute("\t\t\t", $fname, @arguments);
+	print "\t\t\tcallStart = startCallStatistics(functionId);\n";
 	if ($retval !~ /^void$|^$/i) {
 		print "\t\t\tresult = ";
 	} else {
@@ -265,6 +358,7 @@ sub createBody
 	print "ORIG_GL($fname)(";
 	printArguments(@arguments);
 	print ");\n";
+	print "\t\t\tstopCallStatistics(functionId, callStart);\n";
 
 	print "\t\t\tif (checkGLErrorInExecution()) {\n";
 
@@ -345,18 +439,7 @@ sub createBody
 	#print "\t\tfprintf(stderr, \"ThreadID: %li\\n\", (unsigned long)pthread_self());\n";
 	print "
 		storeFunctionCall(\"$fname\", ";
-	if ($#arguments > 1 || @arguments[0] !~ /^void$|^$/i) {
-		printf("%i, ", $#arguments + 1);
-		for (my $i = 0; $i <= $#arguments; $i++) {
-			print "&arg$i, ";
-			print getTypeId(@arguments[$i]);
-			if ($i != $#arguments) {
-				print ", ";
-			}
-		}
-	} else {
-		print "0";
-	}
+	printArgumentTypeList(@arguments);
 	print ");
 		stop();
 		op = getDbgOperation();
@@ -391,45 +474,7 @@ sub createBody
 	printf("%s", uc($fname));
 	print " != DBG_NO_RECORD
 				recordFunctionCall(&G.recordedStream, \"$fname\", ";
-	if ($#arguments > 1 || @arguments[0] !~ /^void$|^$/i) {
-		printf("%i, ", $#arguments + 1);
-		for (my $i = 0; $i <= $#arguments; $i++) {
-			if (@arguments[$i] =~ /[*]$/) {
-				if (scalar grep {$fname eq $_} @justCopyPointersList) {
-					print "&arg$i, sizeof(void*)";
-				} else {
-					print "arg$i, ";
-					if ($fname =~ /gl\D+([1234])\D{1,3}v[A-Z]*/ &&
-						$fname !~ /glProgramNamedParameter\SvNV/) {
-						print "$1*sizeof(";
-						my $type = stripStorageQualifiers(@arguments[$i]);
-						$type =~ s/\*//;
-						$type =~ s/\s*$//;
-						print "$type)";
-					} else {
-						print "$fname";
-						print "_getArg$i";
-						print "Size(";
-						for (my $j = 0; $j <= $#arguments; $j++) {
-							print "arg$j";
-							if ($j != $#arguments) {
-								print ", ";
-							}
-						}
-						print ")"
-					}
-				}
-			} else {
-				print "&arg$i, ";
-				printf("sizeof(%s)", stripStorageQualifiers(@arguments[$i]));
-			}
-			if ($i != $#arguments) {
-				print ", ";
-			}
-		}
-	} else {
-		print "0";
-	}
+	printRecordArguments($fname, @arguments);
 	print ");\n#  endif\n#  if DBG_STREAM_HINT_";
 	printf("%s", uc($fname));
 	print " == DBG_RECORD_AND_FINAL
@@ -43,38 +43,207 @@ __declspec(dllexport) PROC APIENTRY DetouredwglGetProcAddress(LPCSTR arg0) {
     dbgPrint(DBGLVL_DEBUG, \"DetouredwglGetProcAddress(\\\"%s\\\")\\n\", arg0);
 		";  
 		  
-    } else {
-        print "
-	DBGLIBLOCAL void (*glXGetProcAddressHook(const GLubyte *n))(void)
-	{
-		void (*result)(void) = NULL;
+    }
+}
 
-		/*fprintf(stderr, \"glXGetProcAddressARB(%s)\\n\", (const char*)n);*/
-		
-		if (!(strcmp(\"glXGetProcAddressARB\", (char*)n) &&
-			  strcmp(\"glXGetProcAddress\", (char*)n))) {
-			return (void(*)(void))glXGetProcAddressHook;
+# Hashes and placement of the minimal perfect hash; keep in sync with
+# hookHash and lookupHook in the generated code. All arithmetic stays below
+# 2^64 so that perl computes it exactly.
+sub hookHash
+{
+	my ($name, $seed) = @_;
+	my $h = (2166136261 ^ $seed) & 0xffffffff;
+	foreach my $c (unpack("C*", $name)) {
+		$h = (($h ^ $c)*16777619) & 0xffffffff;
+	}
+	return $h;
+}
+
+sub hookMix
+{
+	my $h = shift;
+	$h ^= $h >> 16;
+	$h = ($h*0x85ebca6b) & 0xffffffff;
+	$h ^= $h >> 13;
+	$h = ($h*0xc2b2ae35) & 0xffffffff;
+	$h ^= $h >> 16;
+	return $h;
+}
+
+# Hash and displace: names are distributed to buckets by their hash, then
+# each bucket, largest first, gets the smallest displacement that moves all
+# its names to free slots. A lookup costs one hash of the name, one mix and
+# one compare of the hash stored in the slot; only if that matches are the
+# names compared, so a miss never touches the strings.
+sub buildPerfectHash
+{
+	my $n = scalar @hooks;
+	my $numBuckets = int(($n + 3)/4);
+	my ($seed, @hashes, @buckets, @displacements, @slots);
+
+	$numBuckets = 1 if $numBuckets < 1;
+	SEED: for ($seed = 0; ; $seed++) {
+		my %seen;
+		@hashes = map { hookHash($_->[0], $seed) } @hooks;
+		foreach my $h (@hashes) {
+			next SEED if $seen{$h}++;
 		}
+		last;
+	}
 
-		";
+	@buckets = map { [] } 1..$numBuckets;
+	for (my $i = 0; $i < $n; $i++) {
+		push @{$buckets[$hashes[$i] % $numBuckets]}, $i;
 	}
+	@slots = (-1) x $n;
+	@displacements = (0) x $numBuckets;
+	foreach my $b (sort { scalar @{$buckets[$b]} <=> scalar @{$buckets[$a]} ||
+	                      $a <=> $b } 0..$numBuckets - 1) {
+		my @items = @{$buckets[$b]};
+		next unless @items;
+		DISPLACEMENT: for (my $d = 0; ; $d++) {
+			my %taken;
+			foreach my $i (@items) {
+				my $slot = hookMix($hashes[$i] ^ $d) % $n;
+				next DISPLACEMENT if $slots[$slot] >= 0 || $taken{$slot}++;
+			}
+			foreach my $i (@items) {
+				$slots[hookMix($hashes[$i] ^ $d) % $n] = $i;
+			}
+			$displacements[$b] = $d;
+			last;
+		}
+	}
+	return ($seed, \@displacements, \@slots);
 }
 
 sub createBodyFooter
 {
 	if (defined $WIN32) {
 	    print "\n\treturn NULL;\n}";
-	    
-	} else {
-	    print " {
-			/*fprintf(stderr, \"glXGetProcAddressARB no overload found for %s\\n\", (const char*)n);*/
-			/*return ORIG_GL(glXGetProcAddressARB)(n);*/
-			return G.origGlXGetProcAddress(n);
+	    return;
+	}
+
+	my ($seed, $displacements, $slots) = buildPerfectHash();
+	my $n = scalar @hooks;
+	my $numBuckets = scalar @$displacements;
+
+	print "/* Minimal perfect hash of all hooked names, see genGetProcAddressHook.pl.
+ * Define GLSLDB_HOOK_NAMES_ONLY to get the name lookup without the hooks.
+ */
+#define HOOK_TABLE_SIZE $n
+#define HOOK_TABLE_BUCKETS $numBuckets
+#define HOOK_HASH_SEED ${seed}u
+
+static const char *const hookNames[HOOK_TABLE_SIZE] = {
+";
+	foreach my $i (@$slots) {
+		print "\t\"$hooks[$i]->[0]\",\n";
+	}
+	print "};
+
+static const unsigned int hookHashes[HOOK_TABLE_SIZE] = {
+";
+	for (my $s = 0; $s < $n; $s += 6) {
+		my $last = $s + 5 < $n - 1 ? $s + 5 : $n - 1;
+		print "\t", join(", ", map { sprintf("0x%08xu", hookHash($hooks[$_]->[0], $seed)) } @$slots[$s..$last]), ",\n";
+	}
+	print "};
+
+static const unsigned int hookDisplacements[HOOK_TABLE_BUCKETS] = {
+";
+	for (my $b = 0; $b < $numBuckets; $b += 8) {
+		my $last = $b + 7 < $numBuckets - 1 ? $b + 7 : $numBuckets - 1;
+		print "\t", join(", ", @$displacements[$b..$last]), ",\n";
+	}
+	print "};
+
+static unsigned int hookHash(const char *name)
+{
+	unsigned int h = 2166136261u ^ HOOK_HASH_SEED;
+	const unsigned char *c;
+	for (c = (const unsigned char *)name; *c; c++) {
+		h = (h ^ *c)*16777619u;
+	}
+	return h;
+}
+
+static unsigned int hookMix(unsigned int h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+/* slot of name in the hook table, -1 if it is not hooked */
+static int lookupHook(const char *name)
+{
+	unsigned int h = hookHash(name);
+	int i = (int)(hookMix(h ^ hookDisplacements[h % HOOK_TABLE_BUCKETS]) %
+	              HOOK_TABLE_SIZE);
+	if (hookHashes[i] != h || strcmp(hookNames[i], name)) {
+		return -1;
+	}
+	return i;
+}
+
+#ifndef GLSLDB_HOOK_NAMES_ONLY
+static void (*const hookFunctions[HOOK_TABLE_SIZE])(void) = {
+";
+	foreach my $i (@$slots) {
+		print "\t(void(*)(void))$hooks[$i]->[1],\n";
+	}
+	print "};
+
+/* original functions of the hooked names, resolved by getOrigFunc */
+static void (*hookOrigFunctions[HOOK_TABLE_SIZE])(void);
+
+DBGLIBLOCAL void (*getHookFunction(const char *name))(void)
+{
+	int i = lookupHook(name);
+	return i < 0 ? NULL : hookFunctions[i];
+}
+
+DBGLIBLOCAL void (*glXGetProcAddressHook(const GLubyte *n))(void)
+{
+	int i = lookupHook((const char *)n);
+
+	if (i < 0) {
+		return G.origGlXGetProcAddress(n);
+	}
+	return hookFunctions[i];
+}
+
+DBGLIBLOCAL void (**getOrigFuncSlot(const char *fname))(void)
+{
+	int i = lookupHook(fname);
+	return i < 0 ? NULL : &hookOrigFunctions[i];
+}
+
+/* fills the original functions of all hooked names in one pass over the
+ * table, names that resolve to NULL are left to getOrigFunc
+ */
+DBGLIBLOCAL int resolveOrigFunctions(void *(*resolve)(const char *name))
+{
+	int i, n = 0;
+
+	for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+		if (!hookOrigFunctions[i]) {
+			FunctionPointer orig;
+			orig.object = resolve(hookNames[i]);
+			hookOrigFunctions[i] = orig.function;
+		}
+		if (hookOrigFunctions[i]) {
+			n++;
 		}
-		/*fprintf(stderr, \"glXGetProcAddressARB result: %p\\n\", result);*/
-		return result;
-	}\n";
 	}
+	return n;
+}
+#endif /* GLSLDB_HOOK_NAMES_ONLY */
+";
 }
 
 sub createFunctionHook
@@ -101,10 +270,11 @@ sub createFunctionHook
     }
         ";
     } else {
-	    my $pfname = join("","PFN",uc($fname),"PROC");
-
-	    print "if (!strcmp(\"$fname\", (char*)n)) {
-			    return (void(*)(void))$fname;\n\t\t}\n\t\t";
+	    # both names return our own glXGetProcAddress
+	    my $hook = $fname =~ /^glXGetProcAddress(ARB)?$/ ?
+	               "glXGetProcAddressHook" : $fname;
+	    # gl.h and glext.h declare some functions twice
+	    push @hooks, [$fname, $hook] unless $hooked{$fname}++;
     }
 }
 
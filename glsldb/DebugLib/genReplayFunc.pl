@@ -53,85 +53,135 @@ sub createBodyHeader
 	print "#include \"debuglibInternal.h\"\n";
 	print "#include \"streamRecording.h\"\n";
 	print "#include \"replayFunction.h\"\n\n";
-	print "void replayFunctionCall(StoredCall *f, int final)\n{\n";
 }
 
-sub createBodyFooter
+sub argumentKinds
 {
-	print "\t{\n\t\tfprintf(stderr, \"Cannot replay %s: unknown function\\n\", f->fname);\n\t}\n}\n";
+	my $fname = shift;
+	my @arguments = @_;
+	my $kinds = "";
+	if ($#arguments > 1 || @arguments[0] !~ /^void$|^$/) {
+		for (my $i = 0; $i <= $#arguments; $i++) {
+			if (@arguments[$i] =~ /[*]$/ &&
+			    !(scalar grep {$fname eq $_} @justCopyPointersList)) {
+				# arrays the call only reads may be shared between calls
+				if (@arguments[$i] =~ /^\s*const\s[^*]*[*]$/) {
+					$kinds .= "c";
+				} else {
+					$kinds .= "p";
+				}
+			} elsif (@arguments[$i] =~ /[*]$/) {
+				# the pointer itself is recorded, not what it points to
+				$kinds .= "a";
+			} else {
+				$kinds .= "s";
+			}
+		}
+	}
+	return $kinds;
+}
+
+sub createFunctionTableEntry
+{
+	my $retval = shift;
+	my $fname = shift;
+	my $argString = shift;
+	my @arguments = buildArgumentList($argString);
+	my $ucfname = uc($fname);
+	my $kinds = argumentKinds($fname, @arguments);
+	print "#if DBG_STREAM_HINT_$ucfname == DBG_RECORD_AND_REPLAY || DBG_STREAM_HINT_$ucfname == DBG_RECORD_AND_FINAL\n";
+	printf "\t{\"$fname\", %i, \"$kinds\"},\n", length($kinds);
+	print "#else\n";
+	print "\t{NULL, 0, NULL},\n";
+	print "#endif\n";
 }
 
-sub createFunctionHook
+sub createFunctionCase
 {
 	my $retval = shift;
 	my $fname = shift;
 	my $argString = shift;
 	my @arguments = buildArgumentList($argString);
 	my $ucfname = uc($fname);
+	my $kinds = argumentKinds($fname, @arguments);
 	print "#if DBG_STREAM_HINT_$ucfname == DBG_RECORD_AND_REPLAY || DBG_STREAM_HINT_$ucfname == DBG_RECORD_AND_FINAL\n";
-	print "\tif (!strcmp(\"$fname\", (char*)f->fname)) {\n";
+	print "\t\tcase $opcode:\n";
 	print "#if DBG_STREAM_HINT_$ucfname == DBG_RECORD_AND_FINAL\n";
-	print "\t\tif (final) {\n";
+	print "\t\t\tif (!final) {\n\t\t\t\tbreak;\n\t\t\t}\n";
 	print "#endif\n";
-	print "\t\t\tORIG_GL($fname)(";
-	if ($#arguments > 1 || @arguments[0] !~ /^void$|^$/) {
-		for (my $i = 0; $i <= $#arguments; $i++) {
-			if (scalar grep {$fname eq $_} @justCopyPointersList) {
-				print "*(@arguments[$i] *)f->arguments[$i]";
-			} elsif (@arguments[$i] =~ /[*]$/) {
-				print "(@arguments[$i])f->arguments[$i]";
-			} else {
-				print "*(@arguments[$i] *)f->arguments[$i]";
-			}
-			if ($i != $#arguments) {
-				print ", ";
-			}
+	printf "\t\t\tfor (i = 0; i < count; i++, s += %i) {\n", length($kinds);
+	print "\t\t\t\tORIG_GL($fname)(";
+	for (my $i = 0; $i < length($kinds); $i++) {
+		if (substr($kinds, $i, 1) eq "p" || substr($kinds, $i, 1) eq "c") {
+			print "(@arguments[$i])(payload + s[$i].offset)";
+		} else {
+			print "*(@arguments[$i] *)&s[$i]";
+		}
+		if ($i != length($kinds) - 1) {
+			print ", ";
 		}
 	}
 	print ");\n";
-	print "#if DBG_STREAM_HINT_$ucfname == DBG_RECORD_AND_FINAL\n";
-	print "\t\t}\n";
-	print "#endif\n";
-	#print "\t} else\n";
-	print "\t\treturn;\n\t}\n";
+	print "\t\t\t}\n";
+	print "\t\t\tbreak;\n";
 	print "#endif\n";
 }
 
-createBodyHeader();
-
-foreach my $filename ("../GL/gl.h", "../GL/glext.h") {
-	my $indefinition = 0;
-	my $inprototypes = 0;
-	$extname = "GL_VERSION_1_0";
-	open(IN, $filename) || die "Couldn’t read $filename: $!";
-	while (<IN>) {
-		
-		if (/^\s*WINGDIAPI\s+(\S.*\S)\s+APIENTRY\s+(\S+)\s*\((.*)\)/) {
-			createFunctionHook($1, $2, $3);
-		}
+sub forAllFunctions
+{
+	my $callback = shift;
+	$opcode = 0;
+	foreach my $filename ("../GL/gl.h", "../GL/glext.h") {
+		my $indefinition = 0;
+		my $inprototypes = 0;
+		$extname = "GL_VERSION_1_0";
+		open(IN, $filename) || die "Couldn’t read $filename: $!";
+		while (<IN>) {
+			
+			if (/^\s*WINGDIAPI\s+(\S.*\S)\s+APIENTRY\s+(\S+)\s*\((.*)\)/) {
+				&$callback($1, $2, $3);
+				$opcode++;
+			}
 
-		if ($indefinition == 1) {
-			if (/^#define\s+$extname\s+1/) {
-				$inprototypes = 1;
+			if ($indefinition == 1) {
+				if (/^#define\s+$extname\s+1/) {
+					$inprototypes = 1;
+				}
 			}
-		}
-		
-		if ($inprototypes == 1) {
-			if (/^\s*(?:GLAPI|extern)\s+(\S+)\s+APIENTRY\s+(\S+)\s*\((.*)\)/) {
-				createFunctionHook($1, $2, $3);
+			
+			if ($inprototypes == 1) {
+				if (/^\s*(?:GLAPI|extern)\s+(\S+)\s+APIENTRY\s+(\S+)\s*\((.*)\)/) {
+					&$callback($1, $2, $3);
+					$opcode++;
+				}
+			}
+			if (/^#endif/ && $inprototypes == 1) {
+				$inprototypes = 0;
+				$indefinition = 0;
 			}
-		}
-		if (/^#endif/ && $inprototypes == 1) {
-			$inprototypes = 0;
-			$indefinition = 0;
-		}
 
-		if (/^#ifndef\s+(GL_\S+)/) {
-			$extname = $1;
-			$indefinition = 1;
+			if (/^#ifndef\s+(GL_\S+)/) {
+				$extname = $1;
+				$indefinition = 1;
+			}
 		}
+		close(IN);
 	}
-	close(IN);
 }
-createBodyFooter();
 
+createBodyHeader();
+
+print "const ReplayFunction replayFunctions[] = {\n";
+forAllFunctions(\&createFunctionTableEntry);
+print "};\n\n";
+print "const int replayNumFunctions = $opcode;\n\n";
+
+print "void replayInstruction(int opcode, int count, const ReplaySlot *operands,\n";
+print "                       char *payload, int final)\n{\n";
+print "\tconst ReplaySlot *s = operands;\n";
+print "\tint i;\n\n";
+print "\tswitch (opcode) {\n";
+forAllFunctions(\&createFunctionCase);
+print "\t\tdefault:\n";
+print "\t\t\tfprintf(stderr, \"Cannot replay opcode %i: unknown function\\n\", opcode);\n";
+print "\t}\n}\n";
@@ -43,59 +43,456 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "trampolines.h"
 #endif /* _WIN32 */
 
+/* FIXME: one shadow for all contexts, it is invalidated on context switches */
+static GLStateShadow shadow;
+
+static struct {
+	GLStateShadow saved;
+	int pushedAttribs;
+} g;
+
+static GLboolean *capabilityFlag(GLStateShadow *state, GLenum cap)
+{
+	switch (cap) {
+		case GL_ALPHA_TEST:
+			return &state->alphaTest;
+		case GL_BLEND:
+			return &state->blend;
+		case GL_DEPTH_TEST:
+			return &state->depthTest;
+		case GL_SCISSOR_TEST:
+			return &state->scissorTest;
+		case GL_STENCIL_TEST:
+			return &state->stencilTest;
+		default:
+			return NULL;
+	}
+}
+
+static void syncDrawBuffers(void)
+{
+	GLint buffer;
+	int i;
+
+	if (checkGLVersionSupported(2, 0)) {
+		GLint maxDrawBuffers;
+		ORIG_GL(glGetIntegerv)(GL_MAX_DRAW_BUFFERS, &maxDrawBuffers);
+		if (maxDrawBuffers > GLSTATE_MAX_DRAW_BUFFERS) {
+			maxDrawBuffers = GLSTATE_MAX_DRAW_BUFFERS;
+		}
+		shadow.numDrawBuffers = 1;
+		for (i = 0; i < maxDrawBuffers; i++) {
+			ORIG_GL(glGetIntegerv)(GL_DRAW_BUFFER0 + i, &buffer);
+			shadow.drawBuffers[i] = buffer;
+			if (buffer != GL_NONE) {
+				shadow.numDrawBuffers = i + 1;
+			}
+		}
+	} else {
+		ORIG_GL(glGetIntegerv)(GL_DRAW_BUFFER, &buffer);
+		shadow.drawBuffers[0] = buffer;
+		shadow.numDrawBuffers = 1;
+	}
+}
+
+static void syncFramebuffers(void)
+{
+	GLint fbo;
+
+	if (!checkGLExtensionSupported("GL_EXT_framebuffer_object")) {
+		shadow.drawFramebuffer = 0;
+		shadow.readFramebuffer = 0;
+		return;
+	}
+	ORIG_GL(glGetIntegerv)(GL_FRAMEBUFFER_BINDING_EXT, &fbo);
+	shadow.drawFramebuffer = fbo;
+	if (checkGLExtensionSupported("GL_EXT_framebuffer_blit")) {
+		ORIG_GL(glGetIntegerv)(GL_READ_FRAMEBUFFER_BINDING_EXT, &fbo);
+	}
+	shadow.readFramebuffer = fbo;
+}
+
+/* query the invalid groups of mask from GL */
+static void syncGLStateShadow(unsigned int groups)
+{
+	GLint value;
+
+	groups &= ~shadow.valid;
+	if (!groups) {
+		return;
+	}
+	dbgPrint(DBGLVL_INFO, "syncGLStateShadow: 0x%x\n", groups);
+	if (groups & GLSTATE_VIEWPORT) {
+		ORIG_GL(glGetIntegerv)(GL_VIEWPORT, shadow.viewport);
+	}
+	if (groups & GLSTATE_SCISSOR) {
+		ORIG_GL(glGetIntegerv)(GL_SCISSOR_BOX, shadow.scissorBox);
+	}
+	if (groups & GLSTATE_DRAW_BUFFERS) {
+		syncDrawBuffers();
+	}
+	if (groups & GLSTATE_READ_BUFFER) {
+		ORIG_GL(glGetIntegerv)(GL_READ_BUFFER, &value);
+		shadow.readBuffer = value;
+	}
+	if (groups & GLSTATE_FRAMEBUFFER) {
+		syncFramebuffers();
+	}
+	if (groups & GLSTATE_COLOR_MASK) {
+		ORIG_GL(glGetBooleanv)(GL_COLOR_WRITEMASK, shadow.colorMask);
+	}
+	if (groups & GLSTATE_DEPTH_MASK) {
+		ORIG_GL(glGetBooleanv)(GL_DEPTH_WRITEMASK, &shadow.depthMask);
+	}
+	if (groups & GLSTATE_CAPABILITIES) {
+		shadow.alphaTest = ORIG_GL(glIsEnabled)(GL_ALPHA_TEST);
+		shadow.blend = ORIG_GL(glIsEnabled)(GL_BLEND);
+		shadow.depthTest = ORIG_GL(glIsEnabled)(GL_DEPTH_TEST);
+		shadow.scissorTest = ORIG_GL(glIsEnabled)(GL_SCISSOR_TEST);
+		shadow.stencilTest = ORIG_GL(glIsEnabled)(GL_STENCIL_TEST);
+	}
+	if (groups & GLSTATE_PROGRAM) {
+		if (checkGLVersionSupported(2, 0)) {
+			ORIG_GL(glGetIntegerv)(GL_CURRENT_PROGRAM, &value);
+			shadow.program = value;
+		} else if (checkGLExtensionSupported("GL_ARB_shader_objects")) {
+			shadow.program = ORIG_GL(glGetHandleARB)(GL_PROGRAM_OBJECT_ARB);
+		} else {
+			shadow.program = 0;
+		}
+	}
+	shadow.valid |= groups;
+}
+
+const GLStateShadow *getGLStateShadow(unsigned int groups)
+{
+	syncGLStateShadow(groups);
+	return &shadow;
+}
+
+void invalidateGLStateShadow(unsigned int groups)
+{
+	shadow.valid &= ~groups;
+}
+
+void trackViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	shadow.viewport[0] = x;
+	shadow.viewport[1] = y;
+	shadow.viewport[2] = width;
+	shadow.viewport[3] = height;
+	shadow.valid |= GLSTATE_VIEWPORT;
+}
+
+void trackScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	shadow.scissorBox[0] = x;
+	shadow.scissorBox[1] = y;
+	shadow.scissorBox[2] = width;
+	shadow.scissorBox[3] = height;
+	shadow.valid |= GLSTATE_SCISSOR;
+}
+
+void trackDrawBuffers(GLsizei n, const GLenum *bufs)
+{
+	int i;
+
+	if (n < 1 || n > GLSTATE_MAX_DRAW_BUFFERS) {
+		/* invalid or more than we shadow */
+		shadow.valid &= ~GLSTATE_DRAW_BUFFERS;
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		shadow.drawBuffers[i] = bufs[i];
+	}
+	shadow.numDrawBuffers = n;
+	shadow.valid |= GLSTATE_DRAW_BUFFERS;
+}
+
+void trackReadBuffer(GLenum mode)
+{
+	shadow.readBuffer = mode;
+	shadow.valid |= GLSTATE_READ_BUFFER;
+}
+
+void trackBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	switch (target) {
+		case GL_FRAMEBUFFER_EXT:
+			shadow.drawFramebuffer = framebuffer;
+			shadow.readFramebuffer = framebuffer;
+			break;
+		case GL_DRAW_FRAMEBUFFER_EXT:
+			shadow.drawFramebuffer = framebuffer;
+			break;
+		case GL_READ_FRAMEBUFFER_EXT:
+			shadow.readFramebuffer = framebuffer;
+			break;
+		default:
+			shadow.valid &= ~GLSTATE_FRAMEBUFFER;
+			return;
+	}
+	/* draw and read buffers are framebuffer state */
+	shadow.valid &= ~(GLSTATE_DRAW_BUFFERS | GLSTATE_READ_BUFFER);
+}
+
+void trackDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+	int i;
+
+	/* deleting a bound framebuffer binds the default one */
+	for (i = 0; i < n; i++) {
+		if (framebuffers[i] != 0 &&
+		    (framebuffers[i] == shadow.drawFramebuffer ||
+		     framebuffers[i] == shadow.readFramebuffer)) {
+			shadow.valid &= ~(GLSTATE_FRAMEBUFFER | GLSTATE_DRAW_BUFFERS |
+			                  GLSTATE_READ_BUFFER);
+			return;
+		}
+	}
+}
+
+void trackColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                    GLboolean alpha)
+{
+	shadow.colorMask[0] = red;
+	shadow.colorMask[1] = green;
+	shadow.colorMask[2] = blue;
+	shadow.colorMask[3] = alpha;
+	shadow.valid |= GLSTATE_COLOR_MASK;
+}
+
+void trackDepthMask(GLboolean flag)
+{
+	shadow.depthMask = flag;
+	shadow.valid |= GLSTATE_DEPTH_MASK;
+}
+
+void trackCapability(GLenum cap, GLboolean enabled)
+{
+	GLboolean *flag = capabilityFlag(&shadow, cap);
+
+	if (flag) {
+		*flag = enabled;
+	}
+}
+
+void trackUseProgram(GLuint program)
+{
+	shadow.program = program;
+	shadow.valid |= GLSTATE_PROGRAM;
+}
+
+/* the apply* functions change GL state unconditionally */
+
+static void applyScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	ORIG_GL(glScissor)(x, y, width, height);
+	trackScissor(x, y, width, height);
+}
+
+static void applyDrawBuffers(GLsizei n, const GLenum *bufs)
+{
+	if (n == 1) {
+		ORIG_GL(glDrawBuffer)(bufs[0]);
+	} else {
+		ORIG_GL(glDrawBuffers)(n, bufs);
+	}
+	trackDrawBuffers(n, bufs);
+}
+
+static void applyReadBuffer(GLenum mode)
+{
+	ORIG_GL(glReadBuffer)(mode);
+	trackReadBuffer(mode);
+}
+
+static void applyFramebuffers(GLuint drawFramebuffer, GLuint readFramebuffer)
+{
+	if (drawFramebuffer == readFramebuffer) {
+		ORIG_GL(glBindFramebufferEXT)(GL_FRAMEBUFFER_EXT, drawFramebuffer);
+		trackBindFramebuffer(GL_FRAMEBUFFER_EXT, drawFramebuffer);
+	} else {
+		ORIG_GL(glBindFramebufferEXT)(GL_DRAW_FRAMEBUFFER_EXT, drawFramebuffer);
+		ORIG_GL(glBindFramebufferEXT)(GL_READ_FRAMEBUFFER_EXT, readFramebuffer);
+		trackBindFramebuffer(GL_DRAW_FRAMEBUFFER_EXT, drawFramebuffer);
+		trackBindFramebuffer(GL_READ_FRAMEBUFFER_EXT, readFramebuffer);
+	}
+}
+
+static void applyColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                           GLboolean alpha)
+{
+	ORIG_GL(glColorMask)(red, green, blue, alpha);
+	trackColorMask(red, green, blue, alpha);
+}
+
+static void applyDepthMask(GLboolean flag)
+{
+	ORIG_GL(glDepthMask)(flag);
+	trackDepthMask(flag);
+}
+
+static void applyCapability(GLenum cap, GLboolean enabled)
+{
+	if (enabled) {
+		ORIG_GL(glEnable)(cap);
+	} else {
+		ORIG_GL(glDisable)(cap);
+	}
+	trackCapability(cap, enabled);
+}
+
+void setScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	syncGLStateShadow(GLSTATE_SCISSOR);
+	if (x != shadow.scissorBox[0] || y != shadow.scissorBox[1] ||
+	    width != shadow.scissorBox[2] || height != shadow.scissorBox[3]) {
+		applyScissor(x, y, width, height);
+	}
+}
+
+void setDrawBuffers(GLsizei n, const GLenum *bufs)
+{
+	int i;
+
+	syncGLStateShadow(GLSTATE_DRAW_BUFFERS);
+	if (n == shadow.numDrawBuffers) {
+		for (i = 0; i < n && bufs[i] == shadow.drawBuffers[i]; i++);
+		if (i == n) {
+			return;
+		}
+	}
+	applyDrawBuffers(n, bufs);
+}
+
+void setDrawBuffer(GLenum mode)
+{
+	setDrawBuffers(1, &mode);
+}
+
+void setReadBuffer(GLenum mode)
+{
+	syncGLStateShadow(GLSTATE_READ_BUFFER);
+	if (mode != shadow.readBuffer) {
+		applyReadBuffer(mode);
+	}
+}
+
+void setFramebuffers(GLuint drawFramebuffer, GLuint readFramebuffer)
+{
+	syncGLStateShadow(GLSTATE_FRAMEBUFFER);
+	if (drawFramebuffer != shadow.drawFramebuffer ||
+	    readFramebuffer != shadow.readFramebuffer) {
+		applyFramebuffers(drawFramebuffer, readFramebuffer);
+	}
+}
+
+void setColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                  GLboolean alpha)
+{
+	syncGLStateShadow(GLSTATE_COLOR_MASK);
+	if (red != shadow.colorMask[0] || green != shadow.colorMask[1] ||
+	    blue != shadow.colorMask[2] || alpha != shadow.colorMask[3]) {
+		applyColorMask(red, green, blue, alpha);
+	}
+}
+
+void setDepthMask(GLboolean flag)
+{
+	syncGLStateShadow(GLSTATE_DEPTH_MASK);
+	if (flag != shadow.depthMask) {
+		applyDepthMask(flag);
+	}
+}
+
+void setCapability(GLenum cap, GLboolean enabled)
+{
+	GLboolean *flag;
+
+	syncGLStateShadow(GLSTATE_CAPABILITIES);
+	flag = capabilityFlag(&shadow, cap);
+	if (!flag || *flag != enabled) {
+		applyCapability(cap, enabled);
+	}
+}
+
+void setProgram(GLuint program)
+{
+	syncGLStateShadow(GLSTATE_PROGRAM);
+	if (program == shadow.program) {
+		return;
+	}
+	if (checkGLVersionSupported(2, 0)) {
+		ORIG_GL(glUseProgram)(program);
+	} else {
+		ORIG_GL(glUseProgramObjectARB)(program);
+	}
+	trackUseProgram(program);
+}
+
+/* Set all of the saved state in GL, even where the shadow claims it is already set:
+ * a shadow gone stale must not leave the application with the debugger's
+ * state.
+ */
+static void applyGLState(const GLStateShadow *state)
+{
+	if (checkGLExtensionSupported("GL_EXT_framebuffer_blit")) {
+		applyFramebuffers(state->drawFramebuffer, state->readFramebuffer);
+	} else if (checkGLExtensionSupported("GL_EXT_framebuffer_object")) {
+		applyFramebuffers(state->drawFramebuffer, state->drawFramebuffer);
+	}
+	applyDrawBuffers(state->numDrawBuffers, state->drawBuffers);
+	applyReadBuffer(state->readBuffer);
+	applyScissor(state->scissorBox[0], state->scissorBox[1],
+	             state->scissorBox[2], state->scissorBox[3]);
+	applyColorMask(state->colorMask[0], state->colorMask[1],
+	               state->colorMask[2], state->colorMask[3]);
+	applyDepthMask(state->depthMask);
+	applyCapability(GL_ALPHA_TEST, state->alphaTest);
+	applyCapability(GL_BLEND, state->blend);
+	applyCapability(GL_DEPTH_TEST, state->depthTest);
+	applyCapability(GL_SCISSOR_TEST, state->scissorTest);
+	applyCapability(GL_STENCIL_TEST, state->stencilTest);
+}
+
+/* The state the debugger modifies is saved from the shadow, which only saves
+ * the queries, and restored unconditionally. Replayed streams may also hold
+ * display lists and recorded state calls that change any server state, so all
+ * attributes are pushed as well where the context has an attribute stack.
+ */
 int saveGLState(void)
 {
-	int error;
-	
 	DMARK
-	/* save original gl state */
+	syncGLStateShadow(GLSTATE_ALL & ~GLSTATE_VIEWPORT & ~GLSTATE_PROGRAM);
+	g.saved = shadow;
+
 	ORIG_GL(glPushAttrib)(GL_ALL_ATTRIB_BITS);
-	error = glError();
-	if (error) {
-		return error;
-	}
-	
-	/*glPushClientAttrib*/
-	
+	g.pushedAttribs = glError() == GL_NO_ERROR;
+
 	return DBG_NO_ERROR;
 }
 
 int setSavedGLState(int target)
-{ 
-	int error;
-	
+{
 	DMARK
-	/* restore original gl state */
-	ORIG_GL(glPopAttrib)();
-	error = glError();
-	if (error) {
-		return error;
-	}
-	
-	/* save original gl state */
-	error = saveGLState();
-	if (error) {
-		return error;
-	}
-	
-/* FIXME CHECK AGAIN!!!! 	*/
-#if 0
-	/* disable everything that could interfere when writting the debug result to
-	 * the debug buffer and setup draw and read buffer.
-	 */
-	error = setDbgRenderState(target);
-	if (error) {
-		return error;
-	}
-#endif	
-	return DBG_NO_ERROR;
+	/* restore saved gl state */
+	if (g.pushedAttribs) {
+		ORIG_GL(glPopAttrib)();
+		ORIG_GL(glPushAttrib)(GL_ALL_ATTRIB_BITS);
+	}
+	applyGLState(&g.saved);
+	return glError();
 }
 
 int restoreGLState(void)
 {
 	DMARK
-	/* restore original gl state */
-	ORIG_GL(glPopAttrib)();
+	/* restore saved gl state */
+	if (g.pushedAttribs) {
+		ORIG_GL(glPopAttrib)();
+		g.pushedAttribs = 0;
+	}
+	applyGLState(&g.saved);
 	return glError();
 }
-
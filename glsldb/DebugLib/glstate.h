@@ -36,6 +36,81 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "debuglibExport.h"
 
+/* groups of shadowed state, a group is either completely valid or has to be
+ * queried from GL on its next use
+ */
+#define GLSTATE_VIEWPORT     0x01
+#define GLSTATE_DRAW_BUFFERS 0x02
+#define GLSTATE_READ_BUFFER  0x04
+#define GLSTATE_FRAMEBUFFER  0x08
+#define GLSTATE_COLOR_MASK   0x10
+#define GLSTATE_DEPTH_MASK   0x20
+#define GLSTATE_CAPABILITIES 0x40
+#define GLSTATE_PROGRAM      0x80
+#define GLSTATE_SCISSOR      0x100
+#define GLSTATE_ALL          0x1ff
+
+#define GLSTATE_MAX_DRAW_BUFFERS 8
+
+/* layout version of GLStateShadow snapshots in captures */
+#define GLSTATE_SHADOW_VERSION 2
+
+/* Shadow of the GL state the debugger reads and modifies. It is kept up to
+ * date by the post-execution hooks of the application's calls and by the
+ * set* functions below for the debugger's own changes.
+ */
+typedef struct {
+	unsigned int valid;
+	GLint viewport[4];
+	GLint scissorBox[4];
+	GLsizei numDrawBuffers;
+	GLenum drawBuffers[GLSTATE_MAX_DRAW_BUFFERS];
+	GLenum readBuffer;
+	GLuint drawFramebuffer;
+	GLuint readFramebuffer;
+	GLboolean colorMask[4];
+	GLboolean depthMask;
+	GLboolean alphaTest;
+	GLboolean blend;
+	GLboolean depthTest;
+	GLboolean scissorTest;
+	GLboolean stencilTest;
+	GLuint program;
+} GLStateShadow;
+
+/* return the shadow with all groups in the mask valid */
+DBGLIBLOCAL const GLStateShadow *getGLStateShadow(unsigned int groups);
+
+/* force the groups in the mask to be queried again */
+DBGLIBLOCAL void invalidateGLStateShadow(unsigned int groups);
+
+/* record state changes of the application, called by the hooks */
+DBGLIBLOCAL void trackViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+DBGLIBLOCAL void trackScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+DBGLIBLOCAL void trackDrawBuffers(GLsizei n, const GLenum *bufs);
+DBGLIBLOCAL void trackReadBuffer(GLenum mode);
+DBGLIBLOCAL void trackBindFramebuffer(GLenum target, GLuint framebuffer);
+DBGLIBLOCAL void trackDeleteFramebuffers(GLsizei n, const GLuint *framebuffers);
+DBGLIBLOCAL void trackColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                                GLboolean alpha);
+DBGLIBLOCAL void trackDepthMask(GLboolean flag);
+DBGLIBLOCAL void trackCapability(GLenum cap, GLboolean enabled);
+DBGLIBLOCAL void trackUseProgram(GLuint program);
+
+/* change state from within the debug library; calls that would not change
+ * the shadowed state are skipped
+ */
+DBGLIBLOCAL void setScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+DBGLIBLOCAL void setDrawBuffers(GLsizei n, const GLenum *bufs);
+DBGLIBLOCAL void setDrawBuffer(GLenum mode);
+DBGLIBLOCAL void setReadBuffer(GLenum mode);
+DBGLIBLOCAL void setFramebuffers(GLuint drawFramebuffer, GLuint readFramebuffer);
+DBGLIBLOCAL void setColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                              GLboolean alpha);
+DBGLIBLOCAL void setDepthMask(GLboolean flag);
+DBGLIBLOCAL void setCapability(GLenum cap, GLboolean enabled);
+DBGLIBLOCAL void setProgram(GLuint program);
+
 DBGLIBLOCAL int saveGLState(void);
 DBGLIBLOCAL int setSavedGLState(int target);
 DBGLIBLOCAL int restoreGLState(void);
@@ -55,6 +55,8 @@ extern Globals G;
 
 #include "preExecution.h"
 #include "postExecution.h"
+#include "shader.h"
+#include "frameCapture.h"
 #ifdef _WIN32
 #include "trampolines.inc"
 #endif /* _WIN32 */
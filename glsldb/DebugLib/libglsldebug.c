@@ -45,6 +45,10 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdio.h>
 #include <stdarg.h>
 #include <signal.h>
+#ifndef _WIN32
+#include <time.h>
+#include <sys/time.h>
+#endif /* _WIN32 */
 #ifdef _WIN32
 #define _WIN32_WINNT 0x0400 
 #include <windows.h>
@@ -68,6 +72,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../utils/dbgprint.h"
 #include "../utils/dlutils.h"
 #include "../utils/hash.h"
+#include "../utils/timer.h"
 #include "../glenumerants/glenumerants.h"
 #include "debuglib.h"
 #include "debuglibInternal.h"
@@ -79,16 +84,26 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "shader.h"
 #include "initLib.h"
 #include "queries.h"
+#include "drawTiming.h"
+#include "roiReplay.h"
+#include "frameCapture.h"
 
 #ifdef _WIN32
 #  define LIBGL "opengl32.dll"
 #  define SO_EXTENSION ".dll"
+#  define DIR_SEPARATOR '\\'
 #define SHMEM_NAME_LEN 64
 #else
 #  define LIBGL "libGL.so"
 #  define SO_EXTENSION ".so"
+#  define DIR_SEPARATOR '/'
 #endif
 
+/* lists the debug functions of GLSL_DEBUGGER_DBGFCTNS_PATH, see
+ * loadDbgFunctionManifest
+ */
+#define DBG_FUNCTIONS_MANIFEST "dbgfunctions.manifest"
+
 #define USE_DLSYM_HARDCODED_LIB
 
 extern GLFunctionList glFunctions[];
@@ -97,6 +112,10 @@ typedef struct {
 	LibraryHandle handle;
 	const char *fname;
 	void (*function)(void);
+	/* module of a manifest entry, opened when function is first needed;
+	 * fname and file are owned by the entry
+	 */
+	char *file;
 } DbgFunction;
 
 /* TODO: threads! Should be local to each thread, isn't it? */
@@ -109,6 +128,8 @@ static struct {
 	void *(*origdlsym)(void *, const char *);
 	
 	DbgRec *fcalls;
+	/* fcalls is private memory, there is no debugger */
+	int standalone;
 	DbgFunction *dbgFunctions;
 	int numDbgFunctions;
 	Hash origFunctions;
@@ -119,9 +140,10 @@ static struct {
 #endif	
 		NULL, /* origdlsym */ 
 		NULL, /* fcalls */
+		0, /* standalone */
 		NULL, /* dbgFunctions */
 		0, /* numDbgFunctions */
-		{0, NULL, NULL, NULL} /* origFunctions */
+		{0, 0, 0, NULL, NULL, NULL, 0} /* origFunctions */
 	};
 #else /* _WIN32 */
 static struct {
@@ -137,6 +159,17 @@ static struct {
 /* global data */
 DBGLIBLOCAL Globals G;
 
+/* position of the current call, updated by keepExecuting */
+static long long currentFrame = 0;
+static long long currentCall = 0;
+static long long nextCall = 0;
+
+void getCallPosition(long long *frame, long long *call)
+{
+	*frame = currentFrame;
+	*call = currentCall;
+}
+
 #ifndef _WIN32
 static int getShmid()
 {
@@ -149,6 +182,26 @@ static int getShmid()
 		exit(1);
 	}
 }
+
+/* Without a debugger the library can still write a frame capture: private
+ * records replace the shared memory and let every thread run.
+ */
+static DbgRec *createStandaloneRecords(void)
+{
+	DbgRec *fcalls = (DbgRec*)calloc(1, SHM_TOTAL_SIZE);
+	int i;
+
+	if (!fcalls) {
+		return NULL;
+	}
+	for (i = 0; i < SHM_MAX_THREADS; i++) {
+		fcalls[i].operation = DBG_EXECUTE;
+		fcalls[i].items[0] = DBG_EXECUTE_RUN;
+		/* no debugger to stop for on errors */
+		fcalls[i].items[1] = 0;
+	}
+	return fcalls;
+}
 #endif /* !_WIN32 */
 
 static void setLogging(void)
@@ -194,50 +247,100 @@ static void setLogging(void)
 	}
 }
 
-static void addDbgFunction(const char *soFile)
+static int openDbgFunction(const char *soFile, LibraryHandle *handle,
+                           const char **provides, void (**dbgFunc)(void))
 {
-    LibraryHandle handle = NULL;
-	void (*dbgFunc)(void) = NULL;
-	const char *provides = NULL; 
-	
-	if (!(handle = openLibrary(soFile))) {
+	if (!(*handle = openLibrary(soFile))) {
 		dbgPrint(DBGLVL_WARNING, "Opening dbgPlugin \"%s\" failed\n", soFile);
-		return;
+		return 0;
 	}
 #ifdef _WIN32
-    if ((provides = (char *) GetProcAddress(handle, "provides")) == NULL) {
+    if ((*provides = (char *) GetProcAddress(*handle, "provides")) == NULL) {
 #else /* _WIN32 */
-	if (!(provides = g.origdlsym(handle, "provides"))) {
+	if (!(*provides = g.origdlsym(*handle, "provides"))) {
 #endif /* _WIN32 */
         dbgPrint(DBGLVL_WARNING, "Could not determine what \"%s\" provides!\n"
 		                         "Export the " "\"provides\"-string!\n", soFile);
-		closeLibrary(handle);
-		return;
+		closeLibrary(*handle);
+		*handle = NULL;
+		return 0;
 	}
 
 #ifdef _WIN32
-    if ((dbgFunc = (void (*)(void)) GetProcAddress(handle, provides)) == NULL) {
+    if ((*dbgFunc = (void (*)(void)) GetProcAddress(*handle, *provides)) == NULL) {
 #else /* _WIN32 */
-    if (!(dbgFunc = (void (*)(void))g.origdlsym(handle, provides))) {
+    if (!(*dbgFunc = (void (*)(void))g.origdlsym(*handle, *provides))) {
 #endif /* _WIN32 */
-		closeLibrary(handle);
-		return;
+		closeLibrary(*handle);
+		*handle = NULL;
+		return 0;
 	}
+	return 1;
+}
+
+static DbgFunction *appendDbgFunction(void)
+{
 	g.numDbgFunctions++;
 	g.dbgFunctions = realloc(g.dbgFunctions,
 	                         g.numDbgFunctions*sizeof(DbgFunction));
 	if (!g.dbgFunctions) {
 		dbgPrint(DBGLVL_ERROR, "Allocating g.dbgFunctions failed: %s (%d)\n",
 				strerror(errno), g.numDbgFunctions*sizeof(DbgFunction));
-		closeLibrary(handle);
 		exit(1);
 	}
-	g.dbgFunctions[g.numDbgFunctions-1].handle = handle;
-	g.dbgFunctions[g.numDbgFunctions-1].fname = provides;
-	g.dbgFunctions[g.numDbgFunctions-1].function = dbgFunc;
+	return &g.dbgFunctions[g.numDbgFunctions-1];
 }
 
+static void addDbgFunction(const char *soFile)
+{
+    LibraryHandle handle = NULL;
+	void (*dbgFunc)(void) = NULL;
+	const char *provides = NULL; 
+	DbgFunction *f;
+	
+	if (!openDbgFunction(soFile, &handle, &provides, &dbgFunc)) {
+		return;
+	}
+	f = appendDbgFunction();
+	f->handle = handle;
+	f->fname = provides;
+	f->function = dbgFunc;
+	f->file = NULL;
+}
 
+static void dbgFunctionNOP(void);
+
+/* logs the time since the end of the previous startup phase and returns the
+ * end of this one
+ */
+static long long reportStartupPhase(const char *phase, long long since)
+{
+	long long now = getMonotonicTimeNs();
+	dbgPrint(DBGLVL_INFO, "STARTUP: %s %.3f ms\n", phase, (now - since)*1e-6);
+	return now;
+}
+
+/* open the module of a manifest entry */
+static void openLazyDbgFunction(DbgFunction *f)
+{
+	const char *provides = NULL;
+	long long t = getMonotonicTimeNs();
+
+	if (!openDbgFunction(f->file, &f->handle, &provides, &f->function) ||
+	    strcmp(provides, f->fname)) {
+		dbgPrint(DBGLVL_WARNING, "\"%s\" does not provide %s\n", f->file,
+		         f->fname);
+		if (f->handle) {
+			closeLibrary(f->handle);
+			f->handle = NULL;
+		}
+		/* do not try again */
+		f->function = dbgFunctionNOP;
+		return;
+	}
+	dbgPrint(DBGLVL_INFO, "loaded debug function %s from \"%s\" in %.3f ms\n",
+	         f->fname, f->file, (getMonotonicTimeNs() - t)*1e-6);
+}
 
 static void freeDbgFunctions()
 {
@@ -248,6 +351,11 @@ static void freeDbgFunctions()
             closeLibrary(g.dbgFunctions[i].handle);
             g.dbgFunctions[i].handle = NULL;
         }
+		if (g.dbgFunctions[i].file) {
+			free((char*)g.dbgFunctions[i].fname);
+			free(g.dbgFunctions[i].file);
+			g.dbgFunctions[i].file = NULL;
+		}
 	}
 }
 
@@ -257,6 +365,58 @@ static int endsWith(const char *s, const char *t)
 	return strlen(t) < strlen(s) && !strcmp(s + strlen(s) - strlen(t), t);
 }
 
+static char *joinPath(const char *dir, const char *file)
+{
+	size_t len = strlen(dir);
+	char *path;
+
+	if (!(path = (char *)malloc(len + strlen(file) + 2))) {
+		dbgPrint(DBGLVL_ERROR, "not enough memory for file template\n");
+		exit(1);
+	}
+	strcpy(path, dir);
+	if (len > 0 && dir[len - 1] != DIR_SEPARATOR) {
+		path[len++] = DIR_SEPARATOR;
+		path[len] = '\0';
+	}
+	strcat(path, file);
+	return path;
+}
+
+/* Each line of the manifest names a debug function and the module providing
+ * it, relative to the manifest, e.g. "glEnd libglEnd.so". Only the manifest
+ * is read at startup, a module is opened when its function is first needed.
+ * Returns 0 if there is no manifest.
+ */
+static int loadDbgFunctionManifest(const char *dbgFctsPath)
+{
+	char *manifest = joinPath(dbgFctsPath, DBG_FUNCTIONS_MANIFEST);
+	char line[512], fname[256], module[256];
+	FILE *f = fopen(manifest, "r");
+
+	free(manifest);
+	if (!f) {
+		return 0;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		DbgFunction *d;
+		if (line[0] == '#' ||
+		    sscanf(line, "%255s %255s", fname, module) != 2) {
+			continue;
+		}
+		d = appendDbgFunction();
+		d->handle = NULL;
+		d->function = NULL;
+		d->file = joinPath(dbgFctsPath, module);
+		if (!(d->fname = strdup(fname))) {
+			dbgPrint(DBGLVL_ERROR, "not enough memory for debug function\n");
+			exit(1);
+		}
+	}
+	fclose(f);
+	return 1;
+}
+
 static void loadDbgFunctions(void)
 {
 	char *file;
@@ -291,6 +451,11 @@ static void loadDbgFunctions(void)
 		dbgPrint(DBGLVL_ERROR, "No dbgFctsPath! Set GLSL_DEBUGGER_DBGFCTNS_PATH!\n");
 		exit(1);
 	}
+
+	if (loadDbgFunctionManifest(dbgFctsPath)) {
+		return;
+	}
+	/* without a manifest every module of the directory is opened now */
 	
 #if ! defined WIN32
 	if ((dp = opendir(dbgFctsPath)) == NULL) {
@@ -372,9 +537,17 @@ __declspec(dllexport) BOOL __cdecl uninitialiseDll(void) {
 
     freeDbgFunctions();
 
+	closeFrameCapture();
+
 	clearRecordedCalls(&G.recordedStream);
 
 	cleanupQueryStateTracker();
+
+	cleanupUniformCache();
+
+	cleanupDrawTimings();
+
+	invalidateRegionOfInterest();
 	
     /* We must detach first, as trampolines use events. */
     if (detachTrampolines()) {
@@ -443,7 +616,7 @@ BOOL APIENTRY DllMain(HANDLE hModule,
             }
 
             /* Attach to shared mem segment */
-            if (!openSharedMemory(&g.hShMem, &g.fcalls, SHM_SIZE)) {
+            if (!openSharedMemory(&g.hShMem, &g.fcalls, SHM_TOTAL_SIZE)) {
                 return FALSE;
             }
 
@@ -460,6 +633,7 @@ BOOL APIENTRY DllMain(HANDLE hModule,
 
             G.errorCheckAllowed = 1;
             initStreamRecorder(&G.recordedStream);
+            openFrameCapture();
             
 			initQueryStateTracker();
 			
@@ -470,6 +644,7 @@ BOOL APIENTRY DllMain(HANDLE hModule,
              * MSDN says "It [DllMain] must not call the LoadLibrary or 
              * LoadLibraryEx function (or a function that calls  these functions), 
              * ..."
+             * With a manifest the modules are loaded on first use instead.
              */
             loadDbgFunctions();
             
@@ -500,13 +675,27 @@ BOOL APIENTRY DllMain(HANDLE hModule,
 }
 #else
 
+/* plain dlsym lookup of an original function, NULL if it is not exported */
+static void *resolveOrigFunction(const char *fname)
+{
+#ifdef USE_DLSYM_HARDCODED_LIB
+	return g.origdlsym(g.libgl, fname);
+#else
+	return g.origdlsym(RTLD_NEXT, fname);
+#endif
+}
+
 void __attribute__ ((constructor)) debuglib_init(void)
 {
+	long long start, t;
+
 #ifndef RTLD_DEEPBIND
 	g.origdlsym = dlsym;
 #endif
 
+	start = getMonotonicTimeNs();
 	setLogging();	
+	t = reportStartupPhase("logging", start);
 	
 #ifdef USE_DLSYM_HARDCODED_LIB	
 	if (!(g.libgl = openLibrary(LIBGL))) {
@@ -515,8 +704,15 @@ void __attribute__ ((constructor)) debuglib_init(void)
 	}
 #endif
 	
-	/* attach to shared mem segment */
-	if (!(g.fcalls = shmat(getShmid(), NULL, 0))) {
+	/* attach to shared mem segment, a capture alone needs no debugger */
+	if (!getenv("GLSL_DEBUGGER_SHMID") && getenv("GLSL_DEBUGGER_CAPTURE")) {
+		g.standalone = 1;
+		if (!(g.fcalls = createStandaloneRecords())) {
+			dbgPrint(DBGLVL_ERROR, "Could not allocate call records\n");
+			exit(1);
+		}
+		dbgPrint(DBGLVL_INFO, "No debugger, only capturing frames\n");
+	} else if (!(g.fcalls = shmat(getShmid(), NULL, 0))) {
 		dbgPrint(DBGLVL_ERROR, "Could not attach to shared memory segment: %s\n", strerror(errno));
 		exit(1);
 	}
@@ -526,6 +722,7 @@ void __attribute__ ((constructor)) debuglib_init(void)
 	hash_create(&g.origFunctions, hashString, compString, 512, 0);
 
 	initQueryStateTracker();
+	t = reportStartupPhase("shared memory and state", t);
 	
 #ifdef USE_DLSYM_HARDCODED_LIB	
 	/* paranoia mode: ensure that g.origdlsym is initialized */
@@ -554,18 +751,35 @@ void __attribute__ ((constructor)) debuglib_init(void)
 #endif	
 
 	G.errorCheckAllowed = 1;
+	t = reportStartupPhase("glXGetProcAddress", t);
 	
 	initStreamRecorder(&G.recordedStream);
+
+	openFrameCapture();
+	t = reportStartupPhase("recorder and capture", t);
 	
 	loadDbgFunctions();
+	t = reportStartupPhase("debug functions", t);
+
+	/* resolve the originals now instead of on the first call of each
+	 * function, extensions not exported by libGL stay lazy
+	 */
+	dbgPrint(DBGLVL_INFO, "STARTUP: resolved %i original functions\n",
+	         resolveOrigFunctions(resolveOrigFunction));
+	t = reportStartupPhase("original functions", t);
 	
 	g.initialized = 1;
+	dbgPrint(DBGLVL_INFO, "STARTUP: total %.3f ms\n", (t - start)*1e-6);
 }
 
 void __attribute__ ((destructor)) debuglib_fini(void)
 {
 	/* detach shared mem segment */
-	shmdt(g.fcalls);
+	if (g.standalone) {
+		free(g.fcalls);
+	} else {
+		shmdt(g.fcalls);
+	}
 	
 #ifdef USE_DLSYM_HARDCODED_LIB
 	if (g.libgl) {
@@ -578,6 +792,14 @@ void __attribute__ ((destructor)) debuglib_fini(void)
 	hash_free(&g.origFunctions);
 
 	cleanupQueryStateTracker();
+
+	cleanupUniformCache();
+
+	cleanupDrawTimings();
+
+	invalidateRegionOfInterest();
+
+	closeFrameCapture();
 	
 	clearRecordedCalls(&G.recordedStream);
 
@@ -670,6 +892,42 @@ static void printArgument(void *addr, int type)
 	}
 }
 
+/* bytes of an argument value stored for DBG_FUNCTION_CALL */
+static size_t getArgumentSize(int type)
+{
+	switch (type) {
+	case DBG_TYPE_CHAR:
+	case DBG_TYPE_UNSIGNED_CHAR:
+		return sizeof(char);
+	case DBG_TYPE_SHORT_INT:
+	case DBG_TYPE_UNSIGNED_SHORT_INT:
+		return sizeof(short);
+	case DBG_TYPE_INT:
+	case DBG_TYPE_UNSIGNED_INT:
+		return sizeof(int);
+	case DBG_TYPE_LONG_INT:
+	case DBG_TYPE_UNSIGNED_LONG_INT:
+		return sizeof(long);
+	case DBG_TYPE_LONG_LONG_INT:
+	case DBG_TYPE_UNSIGNED_LONG_LONG_INT:
+		return sizeof(long long);
+	case DBG_TYPE_FLOAT:
+		return sizeof(float);
+	case DBG_TYPE_DOUBLE:
+		return sizeof(double);
+	case DBG_TYPE_POINTER:
+		return sizeof(void*);
+	case DBG_TYPE_BOOLEAN:
+		return sizeof(GLboolean);
+	case DBG_TYPE_BITFIELD:
+		return sizeof(GLbitfield);
+	case DBG_TYPE_ENUM:
+		return sizeof(GLenum);
+	default:
+		return 0;
+	}
+}
+
 void storeFunctionCall(const char *fname, int numArgs, ...)
 {
 	int i;
@@ -690,9 +948,16 @@ void storeFunctionCall(const char *fname, int numArgs, ...)
 	dbgPrint(DBGLVL_INFO, "STORE CALL: %s(", rec->fname);
 	va_start(argp, numArgs);
 	for (i = 0; i < numArgs; i++) {
-		rec->items[2*i] = (ALIGNED_DATA)va_arg(argp, void*);
-		rec->items[2*i + 1] = (ALIGNED_DATA)va_arg(argp, int);
-		printArgument((void*)rec->items[2*i], rec->items[2*i + 1]);
+		void *addr = va_arg(argp, void*);
+		int type = va_arg(argp, int);
+		rec->items[2*i] = (ALIGNED_DATA)addr;
+		rec->items[2*i + 1] = (ALIGNED_DATA)type;
+		/* snapshot the value, the debugger then reads the whole call from
+		 * the shared record instead of one process copy per argument
+		 */
+		memcpy(&rec->items[DBG_ARG_VALUE_ITEM(numArgs, i)], addr,
+		       getArgumentSize(type));
+		printArgument(addr, type);
 	}	
 	va_end(argp);
 	dbgPrintNoPrefix(DBGLVL_INFO, ")\n");
@@ -761,6 +1026,7 @@ static void startRecording(void)
 {
 	DMARK
 	clearRecordedCalls(&G.recordedStream);
+	invalidateRegionOfInterest();
 	setErrorCode(DBG_NO_ERROR);
 }
 
@@ -784,6 +1050,44 @@ static void endReplay(void)
 	setErrorCode(glError());
 }
 
+/* adds the time since since to a phase of timing, returns the end time */
+static long long stepPhase(DbgStepTiming *timing, int phase, long long since)
+{
+	long long now = getMonotonicTimeNs();
+	timing->phaseTime[phase] += now - since;
+	return now;
+}
+
+/* splits the time of loading the debug program into driver compile, driver
+ * link and the rest
+ */
+static long long stepProgramPhases(DbgStepTiming *timing, long long since)
+{
+	long long compileTime, linkTime;
+	long long now = stepPhase(timing, DBG_STEP_PHASE_PROGRAM, since);
+
+	getDbgShaderLoadTime(&compileTime, &linkTime);
+	timing->phaseTime[DBG_STEP_PHASE_COMPILE] += compileTime;
+	timing->phaseTime[DBG_STEP_PHASE_LINK] += linkTime;
+	timing->phaseTime[DBG_STEP_PHASE_PROGRAM] -= compileTime + linkTime;
+	return now;
+}
+
+static void storeStepTiming(DbgRec *rec, const DbgStepTiming *timing)
+{
+	memcpy(&rec->items[DBG_STEP_TIMING_ITEM], timing, sizeof(DbgStepTiming));
+	rec->numItems = DBG_STEP_TIMING_ITEM + DBG_STEP_TIMING_NUM_ITEMS;
+	dbgPrint(DBGLVL_INFO, "STEP TIMING: region %.3f compile %.3f link %.3f "
+	         "program %.3f state %.3f replay %.3f readback %.3f ms\n",
+	         timing->phaseTime[DBG_STEP_PHASE_REGION]*1e-6,
+	         timing->phaseTime[DBG_STEP_PHASE_COMPILE]*1e-6,
+	         timing->phaseTime[DBG_STEP_PHASE_LINK]*1e-6,
+	         timing->phaseTime[DBG_STEP_PHASE_PROGRAM]*1e-6,
+	         timing->phaseTime[DBG_STEP_PHASE_STATE]*1e-6,
+	         timing->phaseTime[DBG_STEP_PHASE_REPLAY]*1e-6,
+	         timing->phaseTime[DBG_STEP_PHASE_READBACK]*1e-6);
+}
+
 /* 
 	Does all operations necessary to get the result of a given debug shader
 	back to the caller, i.e. setup the shader and its environment, replay the
@@ -796,6 +1100,8 @@ static void endReplay(void)
 		if target == DBG_TARGET_FRAGMENT_SHADER:
 			items[4] : number of components to read (1:R, 3:RGB, 4:RGBA)
 			items[5] : format of readback (GL_FLOAT, GL_INT, GL_UINT)
+			items[6] : only return covered pixels
+			items[7..10] : region of interest, see debuglib.h
 		if target == DBG_TARGET_VERTEX_SHADER or DBG_TARGET_GEOMETRY_SHADER:
 			items[4] : primitive mode
 			items[5] : force primitive mode even for geometry shader target
@@ -813,10 +1119,14 @@ static void endReplay(void)
 			items[0] : buffer address
 			items[1] : number of vertices
 			items[2] : number of primitives
+		for all targets:
+			items[DBG_STEP_TIMING_ITEM...] : DbgStepTiming of this step
 */
 static void shaderStep(void)
 {
-	int error;
+	int i, error;
+	DbgStepTiming timing;
+	long long t;
 
 #ifdef _WIN32
 	/* HAZARD BUG OMGWTF This is plain wrong. Use GetCurrentThreadId() */
@@ -829,6 +1139,12 @@ static void shaderStep(void)
 	const char *fshader = (const char *)rec->items[2];
 	int target = (int)rec->items[3];
 
+	memset(&timing, 0, sizeof(timing));
+	for (i = 0; i < 3; i++) {
+		const char *src = (const char *)rec->items[i];
+		timing.sourceSize[i] = src ? (ALIGNED_DATA)strlen(src) : 0;
+	}
+
 	dbgPrint(DBGLVL_COMPILERINFO, "SHADER STEP: v=%p g=%p f=%p target=%i\n",
 	         vshader, gshader, fshader, target);
 			
@@ -852,12 +1168,14 @@ static void shaderStep(void)
 		float *buffer;
 		
 		/* set debug shader code */
+		t = getMonotonicTimeNs();
 		error = loadDbgShader(vshader, gshader, fshader, target,
 		                      forcePointPrimitiveMode);
 		if (error) {
 			setErrorCode(error);
 			return;
 		}
+		t = stepProgramPhases(&timing, t);
 
 		/* replay recorded drawcall */
 		error = setSavedGLState(target);
@@ -883,6 +1201,7 @@ static void shaderStep(void)
 			setErrorCode(error);
 			return;
 		}
+		t = stepPhase(&timing, DBG_STEP_PHASE_STATE, t);
 		
 		replayFunctionCalls(&G.recordedStream, 0);
 		error = glError();
@@ -890,6 +1209,7 @@ static void shaderStep(void)
 			setErrorCode(error);
 			return;
 		}
+		t = stepPhase(&timing, DBG_STEP_PHASE_REPLAY, t);
 		
 		/* readback feedback buffer */
 		error = endTransformFeedback(primitiveMode, numFloatsPerVertex, &buffer,
@@ -897,16 +1217,28 @@ static void shaderStep(void)
 		if (error) {
 			setErrorCode(error);
 		} else {
+			stepPhase(&timing, DBG_STEP_PHASE_READBACK, t);
 			rec->result = DBG_READBACK_RESULT_VERTEX_DATA;
 			rec->items[0] = (ALIGNED_DATA)buffer;
 			rec->items[1] = (ALIGNED_DATA)numVertices;
 			rec->items[2] = (ALIGNED_DATA)numPrimitives;
+			storeStepTiming(rec, &timing);
 		}
 	} else if (target == DBG_TARGET_FRAGMENT_SHADER) {
 		int numComponents = (int)rec->items[4];
 		int format = (int)rec->items[5];
-		int width, height;
+		int sparse = (int)rec->items[6];
+		int roi[4];
+		int width, height, numPixels;
 		void *buffer;
+
+		roi[0] = (int)rec->items[7];
+		roi[1] = (int)rec->items[8];
+		roi[2] = (int)rec->items[9];
+		roi[3] = (int)rec->items[10];
+		t = getMonotonicTimeNs();
+		prepareRegionOfInterest(&G.recordedStream, vshader, gshader, roi);
+		t = stepPhase(&timing, DBG_STEP_PHASE_REGION, t);
 		
 		/* set debug shader code */
 		error = loadDbgShader(vshader, gshader, fshader, target, 0);
@@ -914,6 +1246,7 @@ static void shaderStep(void)
 			setErrorCode(error);
 			return;
 		}
+		t = stepProgramPhases(&timing, t);
 		
 		/* replay recorded drawcall */
 		error = setSavedGLState(target);
@@ -921,24 +1254,34 @@ static void shaderStep(void)
 			setErrorCode(error);
 			return;
 		}
-		replayFunctionCalls(&G.recordedStream, 0);
+		t = stepPhase(&timing, DBG_STEP_PHASE_STATE, t);
+		replayRegionOfInterest(&G.recordedStream, roi);
 		error = glError();
 		if (error) {
 			setErrorCode(error);
 			return;
 		}
+		t = stepPhase(&timing, DBG_STEP_PHASE_REPLAY, t);
 
 		/* readback framebuffer */
 		DMARK
 		error = readBackRenderBuffer(numComponents, format, &width, &height, &buffer);
 		DMARK
+		numPixels = width*height;
+		if (!error && sparse) {
+			error = gatherCoveredPixels(buffer, numComponents, format, width,
+			                            height, &numPixels);
+		}
 		if (error) {
 			setErrorCode(error);
 		} else {
+			stepPhase(&timing, DBG_STEP_PHASE_READBACK, t);
 			rec->result = DBG_READBACK_RESULT_FRAGMENT_DATA;
 			rec->items[0] = (ALIGNED_DATA)buffer;
 			rec->items[1] = (ALIGNED_DATA)width;
 			rec->items[2] = (ALIGNED_DATA)height;
+			rec->items[3] = (ALIGNED_DATA)numPixels;
+			storeStepTiming(rec, &timing);
 		}
 	} else {
 		dbgPrint(DBGLVL_COMPILERINFO, "\n");
@@ -983,7 +1326,265 @@ static int isShaderSwitch(const char *name)
 	return 0;
 }
 
-int keepExecuting(const char *calledName)
+static DbgBreakpointTable *getBreakpointTable(void)
+{
+	return (DbgBreakpointTable*)((char*)g.fcalls + SHM_BREAKPOINTS_OFFSET);
+}
+
+/* kind of value returned by getArgumentValue */
+#define DBG_BP_VALUE_NONE 0
+#define DBG_BP_VALUE_INTEGER 1
+#define DBG_BP_VALUE_FLOAT 2
+
+/* floating-point arguments are returned in *fvalue, all others in *value */
+static int getArgumentValue(void *addr, int type, long long *value,
+                            double *fvalue)
+{
+	switch (type) {
+	case DBG_TYPE_CHAR:
+		*value = *(char*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_UNSIGNED_CHAR:
+		*value = *(unsigned char*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_SHORT_INT:
+		*value = *(short*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_UNSIGNED_SHORT_INT:
+		*value = *(unsigned short*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_INT:
+		*value = *(int*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_UNSIGNED_INT:
+		*value = *(unsigned int*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_LONG_INT:
+		*value = *(long*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_UNSIGNED_LONG_INT:
+		*value = (long long)*(unsigned long*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_LONG_LONG_INT:
+		*value = *(long long*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_UNSIGNED_LONG_LONG_INT:
+		*value = (long long)*(unsigned long long*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_FLOAT:
+		*fvalue = *(float*)addr;
+		return DBG_BP_VALUE_FLOAT;
+	case DBG_TYPE_DOUBLE:
+		*fvalue = *(double*)addr;
+		return DBG_BP_VALUE_FLOAT;
+	case DBG_TYPE_POINTER:
+		*value = (long long)(intptr_t)*(void**)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_BOOLEAN:
+		*value = *(GLboolean*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_BITFIELD:
+		*value = *(GLbitfield*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	case DBG_TYPE_ENUM:
+		*value = *(GLenum*)addr;
+		return DBG_BP_VALUE_INTEGER;
+	default:
+		return DBG_BP_VALUE_NONE;
+	}
+}
+
+static int compareValue(long long a, int op, long long b)
+{
+	switch (op) {
+	case DBG_BP_EQUAL:
+		return a == b;
+	case DBG_BP_NOT_EQUAL:
+		return a != b;
+	case DBG_BP_LESS:
+		return a < b;
+	case DBG_BP_LESS_EQUAL:
+		return a <= b;
+	case DBG_BP_GREATER:
+		return a > b;
+	case DBG_BP_GREATER_EQUAL:
+		return a >= b;
+	case DBG_BP_MASK:
+		return (a & b) != 0;
+	default:
+		return 0;
+	}
+}
+
+static int compareFloatValue(double a, int op, double b)
+{
+	switch (op) {
+	case DBG_BP_EQUAL:
+		return a == b;
+	case DBG_BP_NOT_EQUAL:
+		return a != b;
+	case DBG_BP_LESS:
+		return a < b;
+	case DBG_BP_LESS_EQUAL:
+		return a <= b;
+	case DBG_BP_GREATER:
+		return a > b;
+	case DBG_BP_GREATER_EQUAL:
+		return a >= b;
+	default:
+		return 0;
+	}
+}
+
+/* evaluates the conditions of bp for the current call; arguments are passed
+ * as (address, DBG_TYPE) pairs as for storeFunctionCall
+ */
+static int matchBreakpoint(DbgBreakpoint *bp, int functionId,
+                           long long frame, int numArgs, va_list argp)
+{
+	int i, j, kind;
+	long long value;
+	double fvalue;
+	va_list args;
+
+	if (!bp->enabled) {
+		return 0;
+	}
+	if ((bp->firstFrame >= 0 && frame < bp->firstFrame) ||
+	    (bp->lastFrame >= 0 && frame > bp->lastFrame)) {
+		return 0;
+	}
+	if (bp->function >= 0 && bp->function != functionId) {
+		return 0;
+	}
+	for (i = 0; i < bp->numConditions && i < DBG_MAX_BREAKPOINT_CONDITIONS; i++) {
+		DbgBreakpointCondition *c = &bp->conditions[i];
+		if (c->argument == DBG_BP_ARG_PROGRAM) {
+			/* no glGet* allowed between glBegin and glEnd, only use the
+			 * shadowed program there
+			 */
+			const GLStateShadow *state =
+				getGLStateShadow(G.errorCheckAllowed ? GLSTATE_PROGRAM : 0);
+			if (!(state->valid & GLSTATE_PROGRAM)) {
+				return 0;
+			}
+			value = state->program;
+			kind = DBG_BP_VALUE_INTEGER;
+		} else {
+			void *addr = NULL;
+			int type = -1;
+			if (c->argument < 0 || c->argument >= numArgs) {
+				return 0;
+			}
+			va_copy(args, argp);
+			for (j = 0; j <= c->argument; j++) {
+				addr = va_arg(args, void*);
+				type = va_arg(args, int);
+			}
+			va_end(args);
+			kind = getArgumentValue(addr, type, &value, &fvalue);
+		}
+		if (kind == DBG_BP_VALUE_FLOAT) {
+			if (!compareFloatValue(fvalue, c->op, c->fvalue)) {
+				return 0;
+			}
+		} else if (kind == DBG_BP_VALUE_INTEGER) {
+			if (!compareValue(value, c->op, c->value)) {
+				return 0;
+			}
+		} else {
+			return 0;
+		}
+	}
+	bp->hits++;
+	return bp->hits >= bp->hitCount;
+}
+
+static int matchBreakpoints(int functionId, long long frame,
+                            int numArgs, va_list argp)
+{
+	DbgBreakpointTable *table = getBreakpointTable();
+	int i;
+
+	for (i = 0; i < table->numBreakpoints && i < DBG_MAX_BREAKPOINTS; i++) {
+		if (matchBreakpoint(&table->breakpoints[i], functionId, frame,
+		                    numArgs, argp)) {
+			table->hitBreakpoint = i;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int getFunctionId(const char *fname)
+{
+	int i = 0;
+	while (glFunctions[i].fname != NULL) {
+		if (!strcmp(fname, glFunctions[i].fname)) {
+			return i;
+		}
+		i++;
+	}
+	return -1;
+}
+
+static DbgCallStatisticsTable *getCallStatisticsTable(void)
+{
+	return (DbgCallStatisticsTable*)((char*)g.fcalls +
+	                                 SHM_CALL_STATISTICS_OFFSET);
+}
+
+static DbgDrawTimingTable *getDrawTimingTable(void)
+{
+	return (DbgDrawTimingTable*)((char*)g.fcalls + SHM_DRAW_TIMINGS_OFFSET);
+}
+
+long long startCallStatistics(int functionId)
+{
+	DbgCallStatisticsTable *table = getCallStatisticsTable();
+	DbgDrawTimingTable *timings = getDrawTimingTable();
+
+	if (functionId < 0 || functionId >= DBG_MAX_PROFILED_FUNCTIONS) {
+		return 0;
+	}
+	if (timings->enabled) {
+		if (glFunctions[functionId].isFrameEnd) {
+			resolveDrawTimings(timings);
+		} else if (glFunctions[functionId].isDebuggableDrawCall) {
+			beginDrawTiming(timings, functionId, currentFrame, currentCall);
+		}
+	}
+	if (table->mode == DBG_CALL_STATISTICS_OFF) {
+		return 0;
+	}
+	table->counters[functionId].calls++;
+	if (table->mode == DBG_CALL_STATISTICS_TIME) {
+		return getMonotonicTimeNs();
+	}
+	return 0;
+}
+
+void stopCallStatistics(int functionId, long long start)
+{
+	DbgCallCounter *counter;
+	long long t;
+	int bucket = 0;
+
+	t = start ? getMonotonicTimeNs() - start : 0;
+	endDrawTiming();
+	if (!start) {
+		return;
+	}
+	counter = &getCallStatisticsTable()->counters[functionId];
+	counter->totalTime += t;
+	while (t > 1 && bucket < DBG_CALL_TIME_BUCKETS - 1) {
+		t >>= 1;
+		bucket++;
+	}
+	counter->histogram[bucket]++;
+}
+
+int keepExecuting(int functionId, const char *calledName, int numArgs, ...)
 {
 #ifndef _WIN32
 	pid_t pid = getpid();
@@ -992,6 +1593,19 @@ int keepExecuting(const char *calledName)
 	DWORD pid = GetCurrentProcessId();
 #endif /* _WIN32 */
 	DbgRec *rec = getThreadRecord(pid);
+	DbgBreakpointTable *table = getBreakpointTable();
+	long long frame = table->frame;
+	va_list argp;
+	int match;
+
+	currentFrame = frame;
+	currentCall = nextCall++;
+	if (functionId >= 0 && glFunctions[functionId].isFrameEnd) {
+		endCaptureFrame();
+		table->frame++;
+		nextCall = 0;
+	}
+
 	if (rec->operation == DBG_STOP_EXECUTION) {
 		return 0;
 	} else if (rec->operation == DBG_EXECUTE) {
@@ -1005,6 +1619,11 @@ int keepExecuting(const char *calledName)
 				return !isDebuggableDrawCall(calledName);
 			case DBG_JUMP_TO_USER_DEFINED:
 				return strcmp(rec->fname, calledName);
+			case DBG_JUMP_TO_BREAKPOINT:
+				va_start(argp, numArgs);
+				match = matchBreakpoints(functionId, frame, numArgs, argp);
+				va_end(argp);
+				return !match;
 			default:
 				break;
 		}
@@ -1026,6 +1645,25 @@ int checkGLErrorInExecution(void)
 	return 1;
 }
 
+int isGLErrorChecked(void)
+{
+#ifndef _WIN32
+	pid_t pid = getpid();
+#else /* _WIN32 */
+	/* HAZARD BUG OMGWTF This is plain wrong. Use GetCurrentThreadId() */
+	DWORD pid = GetCurrentProcessId();
+#endif /* _WIN32 */
+	DbgRec *rec = getThreadRecord(pid);
+
+	if (!G.errorCheckAllowed) {
+		return 0;
+	}
+	if (rec->operation == DBG_EXECUTE) {
+		return rec->items[1];
+	}
+	return 1;
+}
+
 void setExecuting(void)
 {
 #ifndef _WIN32
@@ -1127,9 +1765,13 @@ void (*getDbgFunction(void))(void)
 	int i;
 	
 	for (i = 0; i < g.numDbgFunctions; i++) {
-		if (!strcmp(g.dbgFunctions[i].fname, rec->fname)) {
+		DbgFunction *f = &g.dbgFunctions[i];
+		if (!strcmp(f->fname, rec->fname)) {
+			if (!f->function) {
+				openLazyDbgFunction(f);
+			}
 			dbgPrint(DBGLVL_INFO, "found special detour for %s\n", rec->fname);
-			return g.dbgFunctions[i].function;
+			return f->function;
 		}
 	}
 	return dbgFunctionNOP;
@@ -1152,23 +1794,36 @@ void (*getOrigFunc(const char *fname))(void)
 	    !strcmp(fname, "glXGetProcAddressARB")) {
 		return (void (*)(void))glXGetProcAddressHook;
 	} else {
-		void *result = hash_find(&g.origFunctions, (void*)fname);
+		/* hooked names keep their original in a slot of the perfect hash,
+		 * others are hashed once for both lookup and insertion
+		 */
+		void (**slot)(void) = getOrigFuncSlot(fname);
+		unsigned int h = 0;
+		FunctionPointer result;
 
-		if (!result) {
-#ifdef USE_DLSYM_HARDCODED_LIB			
-			void *origFunc = g.origdlsym(g.libgl, fname);
-#else
-			void *origFunc = g.origdlsym(RTLD_NEXT, fname);
-#endif
-			if (!origFunc) {
-				origFunc = G.origGlXGetProcAddress((const GLubyte *)fname);
-				if (!origFunc) {
+		if (slot) {
+			result.function = *slot;
+		} else {
+			h = hash_key(&g.origFunctions, (void*)fname);
+			result.object = hash_find_prehashed(&g.origFunctions, (void*)fname,
+			                                    h);
+		}
+		if (!result.object) {
+			result.object = resolveOrigFunction(fname);
+			if (!result.object) {
+				result.function =
+					G.origGlXGetProcAddress((const GLubyte *)fname);
+				if (!result.function) {
 					dbgPrint(DBGLVL_ERROR, "Error: Cannot resolve %s\n", fname);
 					exit(1); /* TODO: proper error handling */
 				}
 			}
-			hash_insert(&g.origFunctions, (void*)fname, origFunc);
-			result = origFunc;
+			if (slot) {
+				*slot = result.function;
+			} else {
+				hash_insert_prehashed(&g.origFunctions, (void*)fname, h,
+				                      result.object);
+			}
 		}
 
 		/* FIXME: Is there a better place for this ??? */
@@ -1177,8 +1832,8 @@ void (*getOrigFunc(const char *fname))(void)
 		} else if (!strcmp(fname, "glEnd")) {
 			G.errorCheckAllowed = 1;
 		}
-		dbgPrint(DBGLVL_INFO, "ORIG_GL: %s (%p)\n", fname, result);
-		return (void (*)(void))result;
+		dbgPrint(DBGLVL_INFO, "ORIG_GL: %s (%p)\n", fname, result.object);
+		return result.function;
 	}
 }
 #endif /* _WIN32 */
@@ -1273,7 +1928,6 @@ TFBVersion getTFBVersion()
 void *dlsym(void *handle, const char *symbol)
 {
 	char *s;
-	void *sym;
 	
 	if (!g.origdlsym) {
 		void *origDlsymHandle;
@@ -1299,10 +1953,12 @@ void *dlsym(void *handle, const char *symbol)
 		unsetenv("GLSL_DEBUGGER_DLSYM");
 	}
 	
+	/* names we do not hook cost one hash and one compare */
 	if (g.initialized) {
-		sym = (void*)glXGetProcAddressHook((GLubyte *)symbol);
-		if (sym) {
-			return sym;
+		FunctionPointer hook;
+		hook.function = getHookFunction(symbol);
+		if (hook.function) {
+			return hook.object;
 		}
 	}
 	
@@ -34,13 +34,14 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "postExecution.h"
 #include "dbgprint.h"
 #include "queries.h"
+#include "glstate.h"
 
 extern Globals G;
 
 void glGetQueryObjectiv_POSTEXECUTE(GLuint *id, GLenum *pname,
                                     GLint **params, GLint *error)
 {
-	Query *q = (Query*)hash_find(&G.queries, id);
+	Query *q = findQuery(*id);
 	if (q != NULL) {
 		**params += q->value;
 	}
@@ -51,7 +52,7 @@ void glGetQueryObjectiv_POSTEXECUTE(GLuint *id, GLenum *pname,
 void glGetQueryObjectuiv_POSTEXECUTE(GLuint *id, GLenum *pname,
                                      GLuint **params,  GLint *error)
 {
-	Query *q = (Query*)hash_find(&G.queries, id);
+	Query *q = findQuery(*id);
 	if (q != NULL) {
 		**params += q->value;
 	}
@@ -62,7 +63,7 @@ void glGetQueryObjectuiv_POSTEXECUTE(GLuint *id, GLenum *pname,
 void glGetQueryObjectivARB_POSTEXECUTE(GLuint *id, GLenum *pname,
                                        GLint **params,  GLint *error)
 {
-	Query *q = (Query*)hash_find(&G.queries, id);
+	Query *q = findQuery(*id);
 	if (q != NULL) {
 		**params += q->value;
 	}
@@ -73,7 +74,7 @@ void glGetQueryObjectivARB_POSTEXECUTE(GLuint *id, GLenum *pname,
 void glGetQueryObjectuivARB_POSTEXECUTE(GLuint *id, GLenum *pname,
                                         GLuint **params,  GLint *error)
 {
-	Query *q = (Query*)hash_find(&G.queries, id);
+	Query *q = findQuery(*id);
 	if (q != NULL) {
 		**params += q->value;
 	}
@@ -84,7 +85,7 @@ void glGetQueryObjectuivARB_POSTEXECUTE(GLuint *id, GLenum *pname,
 void glGetOcclusionQueryivNV_POSTEXECUTE(GLuint *id, GLenum *pname,
                                          GLint **params,  GLint *error)
 {
-	Query *q = (Query*)hash_find(&G.queries, id);
+	Query *q = findQuery(*id);
 	if (q != NULL) {
 		**params += q->value;
 	}
@@ -95,7 +96,7 @@ void glGetOcclusionQueryivNV_POSTEXECUTE(GLuint *id, GLenum *pname,
 void glGetOcclusionQueryuivNV_POSTEXECUTE(GLuint *id, GLenum *pname,
                                           GLuint **params,  GLint *error)
 {
-	Query *q = (Query*)hash_find(&G.queries, id);
+	Query *q = findQuery(*id);
 	if (q != NULL) {
 		**params += q->value;
 	}
@@ -106,7 +107,7 @@ void glGetOcclusionQueryuivNV_POSTEXECUTE(GLuint *id, GLenum *pname,
 void glGetQueryObjecti64vEXT_POSTEXECUTE(GLuint *id, GLenum *pname,
                                          GLint64EXT **params, GLint *error)
 {
-	Query *q = (Query*)hash_find(&G.queries, id);
+	Query *q = findQuery(*id);
 	if (q != NULL) {
 		**params += q->value;
 	}
@@ -117,7 +118,7 @@ void glGetQueryObjecti64vEXT_POSTEXECUTE(GLuint *id, GLenum *pname,
 void glGetQueryObjectui64vEXT_POSTEXECUTE(GLuint *id, GLenum *pname,
                                           GLuint64EXT **params, GLint *error)
 {
-	Query *q = (Query*)hash_find(&G.queries, id);
+	Query *q = findQuery(*id);
 	if (q != NULL) {
 		**params += q->value;
 	}
@@ -125,3 +126,239 @@ void glGetQueryObjectui64vEXT_POSTEXECUTE(GLuint *id, GLenum *pname,
 			 *id, *pname, **params, *error);
 }
 
+/* The application's active timer query. A begin whose error was not checked
+ * is taken as successful: draw timing rather skips draw calls than nests
+ * queries. An end leaves no timer query active, even if it failed.
+ */
+
+void glBeginQuery_POSTEXECUTE(GLenum *target, GLuint *id, GLint *error)
+{
+	if (*target == GL_TIME_ELAPSED_EXT && *error == GL_NO_ERROR) {
+		G.queries.timerQuery = *id;
+	}
+}
+
+void glBeginQueryARB_POSTEXECUTE(GLenum *target, GLuint *id, GLint *error)
+{
+	if (*target == GL_TIME_ELAPSED_EXT && *error == GL_NO_ERROR) {
+		G.queries.timerQuery = *id;
+	}
+}
+
+void glEndQuery_POSTEXECUTE(GLenum *target, GLint *error)
+{
+	if (*target == GL_TIME_ELAPSED_EXT) {
+		G.queries.timerQuery = 0;
+	}
+}
+
+void glEndQueryARB_POSTEXECUTE(GLenum *target, GLint *error)
+{
+	if (*target == GL_TIME_ELAPSED_EXT) {
+		G.queries.timerQuery = 0;
+	}
+}
+
+/* Shadowed GL state, see glstate.c. A call that failed changed no state. If
+ * the error of the call was not checked, the state it may have changed is
+ * invalidated and queried again on its next use.
+ */
+static int trackState(const GLint *error, unsigned int groups)
+{
+	if (*error != GL_NO_ERROR) {
+		return 0;
+	}
+	if (!isGLErrorChecked()) {
+		invalidateGLStateShadow(groups);
+		return 0;
+	}
+	return 1;
+}
+
+void glUseProgram_POSTEXECUTE(GLuint *program, GLint *error)
+{
+	if (trackState(error, GLSTATE_PROGRAM)) {
+		trackUseProgram(*program);
+	}
+}
+
+void glUseProgramObjectARB_POSTEXECUTE(GLhandleARB *programObj, GLint *error)
+{
+	if (trackState(error, GLSTATE_PROGRAM)) {
+		trackUseProgram(*programObj);
+	}
+}
+
+void glViewport_POSTEXECUTE(GLint *x, GLint *y, GLsizei *width,
+                            GLsizei *height, GLint *error)
+{
+	if (trackState(error, GLSTATE_VIEWPORT)) {
+		trackViewport(*x, *y, *width, *height);
+	}
+}
+
+void glScissor_POSTEXECUTE(GLint *x, GLint *y, GLsizei *width,
+                           GLsizei *height, GLint *error)
+{
+	if (trackState(error, GLSTATE_SCISSOR)) {
+		trackScissor(*x, *y, *width, *height);
+	}
+}
+
+void glDrawBuffer_POSTEXECUTE(GLenum *mode, GLint *error)
+{
+	if (trackState(error, GLSTATE_DRAW_BUFFERS)) {
+		trackDrawBuffers(1, mode);
+	}
+}
+
+void glDrawBuffers_POSTEXECUTE(GLsizei *n, const GLenum **bufs, GLint *error)
+{
+	if (trackState(error, GLSTATE_DRAW_BUFFERS)) {
+		trackDrawBuffers(*n, *bufs);
+	}
+}
+
+void glDrawBuffersARB_POSTEXECUTE(GLsizei *n, const GLenum **bufs,
+                                  GLint *error)
+{
+	if (trackState(error, GLSTATE_DRAW_BUFFERS)) {
+		trackDrawBuffers(*n, *bufs);
+	}
+}
+
+void glDrawBuffersATI_POSTEXECUTE(GLsizei *n, const GLenum **bufs,
+                                  GLint *error)
+{
+	if (trackState(error, GLSTATE_DRAW_BUFFERS)) {
+		trackDrawBuffers(*n, *bufs);
+	}
+}
+
+void glReadBuffer_POSTEXECUTE(GLenum *mode, GLint *error)
+{
+	if (trackState(error, GLSTATE_READ_BUFFER)) {
+		trackReadBuffer(*mode);
+	}
+}
+
+void glBindFramebuffer_POSTEXECUTE(GLenum *target, GLuint *framebuffer,
+                                   GLint *error)
+{
+	if (trackState(error, GLSTATE_FRAMEBUFFER | GLSTATE_DRAW_BUFFERS |
+	                      GLSTATE_READ_BUFFER)) {
+		trackBindFramebuffer(*target, *framebuffer);
+	}
+}
+
+void glBindFramebufferEXT_POSTEXECUTE(GLenum *target, GLuint *framebuffer,
+                                      GLint *error)
+{
+	if (trackState(error, GLSTATE_FRAMEBUFFER | GLSTATE_DRAW_BUFFERS |
+	                      GLSTATE_READ_BUFFER)) {
+		trackBindFramebuffer(*target, *framebuffer);
+	}
+}
+
+void glDeleteFramebuffers_POSTEXECUTE(GLsizei *n, const GLuint **framebuffers,
+                                      GLint *error)
+{
+	if (trackState(error, GLSTATE_FRAMEBUFFER | GLSTATE_DRAW_BUFFERS |
+	                      GLSTATE_READ_BUFFER)) {
+		trackDeleteFramebuffers(*n, *framebuffers);
+	}
+}
+
+void glDeleteFramebuffersEXT_POSTEXECUTE(GLsizei *n,
+                                         const GLuint **framebuffers,
+                                         GLint *error)
+{
+	if (trackState(error, GLSTATE_FRAMEBUFFER | GLSTATE_DRAW_BUFFERS |
+	                      GLSTATE_READ_BUFFER)) {
+		trackDeleteFramebuffers(*n, *framebuffers);
+	}
+}
+
+void glColorMask_POSTEXECUTE(GLboolean *red, GLboolean *green,
+                             GLboolean *blue, GLboolean *alpha, GLint *error)
+{
+	if (trackState(error, GLSTATE_COLOR_MASK)) {
+		trackColorMask(*red, *green, *blue, *alpha);
+	}
+}
+
+void glColorMaski_POSTEXECUTE(GLuint *index, GLboolean *r, GLboolean *g,
+                              GLboolean *b, GLboolean *a, GLint *error)
+{
+	invalidateGLStateShadow(GLSTATE_COLOR_MASK);
+}
+
+void glColorMaskIndexedEXT_POSTEXECUTE(GLuint *index, GLboolean *r,
+                                       GLboolean *g, GLboolean *b,
+                                       GLboolean *a, GLint *error)
+{
+	invalidateGLStateShadow(GLSTATE_COLOR_MASK);
+}
+
+void glDepthMask_POSTEXECUTE(GLboolean *flag, GLint *error)
+{
+	if (trackState(error, GLSTATE_DEPTH_MASK)) {
+		trackDepthMask(*flag);
+	}
+}
+
+void glEnable_POSTEXECUTE(GLenum *cap, GLint *error)
+{
+	if (trackState(error, GLSTATE_CAPABILITIES)) {
+		trackCapability(*cap, GL_TRUE);
+	}
+}
+
+void glDisable_POSTEXECUTE(GLenum *cap, GLint *error)
+{
+	if (trackState(error, GLSTATE_CAPABILITIES)) {
+		trackCapability(*cap, GL_FALSE);
+	}
+}
+
+void glEnablei_POSTEXECUTE(GLenum *target, GLuint *index, GLint *error)
+{
+	invalidateGLStateShadow(GLSTATE_CAPABILITIES);
+}
+
+void glDisablei_POSTEXECUTE(GLenum *target, GLuint *index, GLint *error)
+{
+	invalidateGLStateShadow(GLSTATE_CAPABILITIES);
+}
+
+void glEnableIndexedEXT_POSTEXECUTE(GLenum *target, GLuint *index,
+                                    GLint *error)
+{
+	invalidateGLStateShadow(GLSTATE_CAPABILITIES);
+}
+
+void glDisableIndexedEXT_POSTEXECUTE(GLenum *target, GLuint *index,
+                                     GLint *error)
+{
+	invalidateGLStateShadow(GLSTATE_CAPABILITIES);
+}
+
+void glPopAttrib_POSTEXECUTE(GLint *error)
+{
+	/* framebuffer bindings and the program are not part of the attrib stack */
+	invalidateGLStateShadow(GLSTATE_ALL & ~GLSTATE_FRAMEBUFFER &
+	                        ~GLSTATE_PROGRAM);
+}
+
+/* display lists can hold any of the shadowed state changes */
+
+void glCallList_POSTEXECUTE(GLuint *list, GLint *error)
+{
+	invalidateGLStateShadow(GLSTATE_ALL);
+}
+
+void glCallLists_POSTEXECUTE(GLsizei *n, GLenum *type, const GLvoid **lists,
+                             GLint *error)
+{
+	invalidateGLStateShadow(GLSTATE_ALL);
+}
@@ -54,4 +54,65 @@ DBGLIBLOCAL void glGetOcclusionQueryivNV_POSTEXECUTE(GLuint *id, GLenum *pname,
 DBGLIBLOCAL void glGetOcclusionQueryuivNV_POSTEXECUTE(GLuint *id, GLenum *pname,
                                                       GLuint **params,  GLint *error);
 
+/* the application's timer query, draw timing must not nest with it */
+DBGLIBLOCAL void glBeginQuery_POSTEXECUTE(GLenum *target, GLuint *id,
+                                          GLint *error);
+DBGLIBLOCAL void glBeginQueryARB_POSTEXECUTE(GLenum *target, GLuint *id,
+                                             GLint *error);
+DBGLIBLOCAL void glEndQuery_POSTEXECUTE(GLenum *target, GLint *error);
+DBGLIBLOCAL void glEndQueryARB_POSTEXECUTE(GLenum *target, GLint *error);
+
+/* GL state shadow tracking, see glstate.c */
+DBGLIBLOCAL void glUseProgram_POSTEXECUTE(GLuint *program, GLint *error);
+DBGLIBLOCAL void glUseProgramObjectARB_POSTEXECUTE(GLhandleARB *programObj,
+                                                   GLint *error);
+DBGLIBLOCAL void glViewport_POSTEXECUTE(GLint *x, GLint *y, GLsizei *width,
+                                        GLsizei *height, GLint *error);
+DBGLIBLOCAL void glScissor_POSTEXECUTE(GLint *x, GLint *y, GLsizei *width,
+                                       GLsizei *height, GLint *error);
+DBGLIBLOCAL void glDrawBuffer_POSTEXECUTE(GLenum *mode, GLint *error);
+DBGLIBLOCAL void glDrawBuffers_POSTEXECUTE(GLsizei *n, const GLenum **bufs,
+                                           GLint *error);
+DBGLIBLOCAL void glDrawBuffersARB_POSTEXECUTE(GLsizei *n, const GLenum **bufs,
+                                              GLint *error);
+DBGLIBLOCAL void glDrawBuffersATI_POSTEXECUTE(GLsizei *n, const GLenum **bufs,
+                                              GLint *error);
+DBGLIBLOCAL void glReadBuffer_POSTEXECUTE(GLenum *mode, GLint *error);
+DBGLIBLOCAL void glBindFramebuffer_POSTEXECUTE(GLenum *target,
+                                               GLuint *framebuffer,
+                                               GLint *error);
+DBGLIBLOCAL void glBindFramebufferEXT_POSTEXECUTE(GLenum *target,
+                                                  GLuint *framebuffer,
+                                                  GLint *error);
+DBGLIBLOCAL void glDeleteFramebuffers_POSTEXECUTE(GLsizei *n,
+                                                  const GLuint **framebuffers,
+                                                  GLint *error);
+DBGLIBLOCAL void glDeleteFramebuffersEXT_POSTEXECUTE(GLsizei *n,
+                                                     const GLuint **framebuffers,
+                                                     GLint *error);
+DBGLIBLOCAL void glColorMask_POSTEXECUTE(GLboolean *red, GLboolean *green,
+                                         GLboolean *blue, GLboolean *alpha,
+                                         GLint *error);
+DBGLIBLOCAL void glColorMaski_POSTEXECUTE(GLuint *index, GLboolean *r,
+                                          GLboolean *g, GLboolean *b,
+                                          GLboolean *a, GLint *error);
+DBGLIBLOCAL void glColorMaskIndexedEXT_POSTEXECUTE(GLuint *index, GLboolean *r,
+                                                   GLboolean *g, GLboolean *b,
+                                                   GLboolean *a, GLint *error);
+DBGLIBLOCAL void glDepthMask_POSTEXECUTE(GLboolean *flag, GLint *error);
+DBGLIBLOCAL void glEnable_POSTEXECUTE(GLenum *cap, GLint *error);
+DBGLIBLOCAL void glDisable_POSTEXECUTE(GLenum *cap, GLint *error);
+DBGLIBLOCAL void glEnablei_POSTEXECUTE(GLenum *target, GLuint *index,
+                                       GLint *error);
+DBGLIBLOCAL void glDisablei_POSTEXECUTE(GLenum *target, GLuint *index,
+                                        GLint *error);
+DBGLIBLOCAL void glEnableIndexedEXT_POSTEXECUTE(GLenum *target, GLuint *index,
+                                                GLint *error);
+DBGLIBLOCAL void glDisableIndexedEXT_POSTEXECUTE(GLenum *target, GLuint *index,
+                                                 GLint *error);
+DBGLIBLOCAL void glPopAttrib_POSTEXECUTE(GLint *error);
+DBGLIBLOCAL void glCallList_POSTEXECUTE(GLuint *list, GLint *error);
+DBGLIBLOCAL void glCallLists_POSTEXECUTE(GLsizei *n, GLenum *type,
+                                         const GLvoid **lists, GLint *error);
+
 #endif
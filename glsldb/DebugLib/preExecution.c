@@ -34,24 +34,107 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "preExecution.h"
 #include "dbgprint.h"
 #include "queries.h"
+#include "shader.h"
+#include "glstate.h"
+#include "drawTiming.h"
 
 extern Globals G;
 
 void glBeginQuery_PREEXECUTE(GLenum *target, GLuint *id)
 {
-	hash_remove(&G.queries, id);
+	removeQuery(*id);
 	dbgPrint(DBGLVL_INFO, "glBeginQuery_PREEXECUTE %i %u\n", *target, *id);
 }
 
 void glBeginQueryARB_PREEXECUTE(GLenum *target, GLuint *id)
 {
-	hash_remove(&G.queries, id);
+	removeQuery(*id);
 	dbgPrint(DBGLVL_INFO, "glBeginQueryARB_PREEXECUTE %i %u\n", *target, *id);
 }
 
 void glBeginOcclusionQueryNV_PREEXECUTE(GLuint *id)
 {
-	hash_remove(&G.queries, id);
+	removeQuery(*id);
 	dbgPrint(DBGLVL_INFO, "glBeginOcclusionQueryNV_PREEXECUTE %u\n", *id);
 }
 
+/* The uniform cache in shader.c keeps a snapshot of the uniforms of each
+ * program. Calls that write uniforms mark the snapshot dirty (the hooks of
+ * @uniformWriteList and @programUniformWriteList in prePostExecuteList.pl do
+ * this directly), linking or deleting a program drops it, making another
+ * context current drops all.
+ */
+
+void glDeleteObjectARB_PREEXECUTE(GLhandleARB *obj)
+{
+	uniformCacheInvalidate(*obj);
+}
+
+void glDeleteProgram_PREEXECUTE(GLuint *program)
+{
+	uniformCacheInvalidate(*program);
+}
+
+void glLinkProgram_PREEXECUTE(GLuint *program)
+{
+	uniformCacheInvalidate(*program);
+}
+
+void glLinkProgramARB_PREEXECUTE(GLhandleARB *programObj)
+{
+	uniformCacheInvalidate(*programObj);
+}
+
+/* Shadowed GL state, see glstate.c. The state itself is tracked by the
+ * post-execution hooks, another context has other state. The same holds for
+ * the timer queries of drawTiming.c.
+ */
+
+#ifndef _WIN32
+void glXMakeCurrent_PREEXECUTE(Display **dpy, GLXDrawable *drawable,
+                               GLXContext *ctx)
+{
+	invalidateGLStateShadow(GLSTATE_ALL);
+	uniformCacheSetContext(*ctx);
+	drawTimingSetContext(*ctx);
+}
+
+void glXMakeContextCurrent_PREEXECUTE(Display **dpy, GLXDrawable *draw,
+                                      GLXDrawable *read, GLXContext *ctx)
+{
+	invalidateGLStateShadow(GLSTATE_ALL);
+	uniformCacheSetContext(*ctx);
+	drawTimingSetContext(*ctx);
+}
+
+void glXMakeCurrentReadSGI_PREEXECUTE(Display **dpy, GLXDrawable *draw,
+                                      GLXDrawable *read, GLXContext *ctx)
+{
+	invalidateGLStateShadow(GLSTATE_ALL);
+	uniformCacheSetContext(*ctx);
+	drawTimingSetContext(*ctx);
+}
+#else /* _WIN32 */
+void wglMakeCurrent_PREEXECUTE(HDC *hdc, HGLRC *hglrc)
+{
+	invalidateGLStateShadow(GLSTATE_ALL);
+	uniformCacheSetContext(*hglrc);
+	drawTimingSetContext(*hglrc);
+}
+
+void wglMakeContextCurrentARB_PREEXECUTE(HDC *hDrawDC, HDC *hReadDC,
+                                         HGLRC *hglrc)
+{
+	invalidateGLStateShadow(GLSTATE_ALL);
+	uniformCacheSetContext(*hglrc);
+	drawTimingSetContext(*hglrc);
+}
+
+void wglMakeContextCurrentEXT_PREEXECUTE(HDC *hDrawDC, HDC *hReadDC,
+                                         HGLRC *hglrc)
+{
+	invalidateGLStateShadow(GLSTATE_ALL);
+	uniformCacheSetContext(*hglrc);
+	drawTimingSetContext(*hglrc);
+}
+#endif /* _WIN32 */
@@ -40,5 +40,33 @@ DBGLIBLOCAL void glBeginQuery_PREEXECUTE(GLenum *target, GLuint *id);
 DBGLIBLOCAL void glBeginQueryARB_PREEXECUTE(GLenum *target, GLuint *id);
 DBGLIBLOCAL void glBeginOcclusionQueryNV_PREEXECUTE(GLuint *id);
 
+/* uniform cache tracking, see shader.c */
+DBGLIBLOCAL void glDeleteObjectARB_PREEXECUTE(GLhandleARB *obj);
+DBGLIBLOCAL void glDeleteProgram_PREEXECUTE(GLuint *program);
+DBGLIBLOCAL void glLinkProgram_PREEXECUTE(GLuint *program);
+DBGLIBLOCAL void glLinkProgramARB_PREEXECUTE(GLhandleARB *programObj);
+
+/* context switches drop the GL state shadow and the uniform cache */
+#ifndef _WIN32
+DBGLIBLOCAL void glXMakeCurrent_PREEXECUTE(Display **dpy, GLXDrawable *drawable,
+                                           GLXContext *ctx);
+DBGLIBLOCAL void glXMakeContextCurrent_PREEXECUTE(Display **dpy,
+                                                  GLXDrawable *draw,
+                                                  GLXDrawable *read,
+                                                  GLXContext *ctx);
+DBGLIBLOCAL void glXMakeCurrentReadSGI_PREEXECUTE(Display **dpy,
+                                                  GLXDrawable *draw,
+                                                  GLXDrawable *read,
+                                                  GLXContext *ctx);
+#else /* _WIN32 */
+DBGLIBLOCAL void wglMakeCurrent_PREEXECUTE(HDC *hdc, HGLRC *hglrc);
+DBGLIBLOCAL void wglMakeContextCurrentARB_PREEXECUTE(HDC *hDrawDC,
+                                                     HDC *hReadDC,
+                                                     HGLRC *hglrc);
+DBGLIBLOCAL void wglMakeContextCurrentEXT_PREEXECUTE(HDC *hDrawDC,
+                                                     HDC *hReadDC,
+                                                     HGLRC *hglrc);
+#endif /* _WIN32 */
+
 #endif
 
@@ -40,6 +40,124 @@
 	glBeginQuery,
 	glBeginQueryARB,
 	glBeginOcclusionQueryNV,
+	# uniform cache: programs whose uniform layout changes
+	glDeleteObjectARB,
+	glDeleteProgram,
+	glLinkProgram,
+	glLinkProgramARB,
+	# uniform cache and GL state shadow: context switches
+	glXMakeCurrent,
+	glXMakeContextCurrent,
+	glXMakeCurrentReadSGI,
+	wglMakeCurrent,
+	wglMakeContextCurrentARB,
+	wglMakeContextCurrentEXT,
+);
+
+# functions that write uniforms of the current program; their hooks mark the
+# uniform cache of that program dirty before executing the original function
+@uniformWriteList = (
+	glUniform1f,
+	glUniform1fARB,
+	glUniform1fv,
+	glUniform1fvARB,
+	glUniform1i,
+	glUniform1iARB,
+	glUniform1iv,
+	glUniform1ivARB,
+	glUniform1ui,
+	glUniform1uiEXT,
+	glUniform1uiv,
+	glUniform1uivEXT,
+	glUniform2f,
+	glUniform2fARB,
+	glUniform2fv,
+	glUniform2fvARB,
+	glUniform2i,
+	glUniform2iARB,
+	glUniform2iv,
+	glUniform2ivARB,
+	glUniform2ui,
+	glUniform2uiEXT,
+	glUniform2uiv,
+	glUniform2uivEXT,
+	glUniform3f,
+	glUniform3fARB,
+	glUniform3fv,
+	glUniform3fvARB,
+	glUniform3i,
+	glUniform3iARB,
+	glUniform3iv,
+	glUniform3ivARB,
+	glUniform3ui,
+	glUniform3uiEXT,
+	glUniform3uiv,
+	glUniform3uivEXT,
+	glUniform4f,
+	glUniform4fARB,
+	glUniform4fv,
+	glUniform4fvARB,
+	glUniform4i,
+	glUniform4iARB,
+	glUniform4iv,
+	glUniform4ivARB,
+	glUniform4ui,
+	glUniform4uiEXT,
+	glUniform4uiv,
+	glUniform4uivEXT,
+	glUniformMatrix2fv,
+	glUniformMatrix2fvARB,
+	glUniformMatrix2x3fv,
+	glUniformMatrix2x4fv,
+	glUniformMatrix3fv,
+	glUniformMatrix3fvARB,
+	glUniformMatrix3x2fv,
+	glUniformMatrix3x4fv,
+	glUniformMatrix4fv,
+	glUniformMatrix4fvARB,
+	glUniformMatrix4x2fv,
+	glUniformMatrix4x3fv,
+	glUniformui64NV,
+	glUniformui64vNV,
+);
+
+# functions that write uniforms of the program given as first argument
+@programUniformWriteList = (
+	glProgramUniform1fEXT,
+	glProgramUniform1fvEXT,
+	glProgramUniform1iEXT,
+	glProgramUniform1ivEXT,
+	glProgramUniform1uiEXT,
+	glProgramUniform1uivEXT,
+	glProgramUniform2fEXT,
+	glProgramUniform2fvEXT,
+	glProgramUniform2iEXT,
+	glProgramUniform2ivEXT,
+	glProgramUniform2uiEXT,
+	glProgramUniform2uivEXT,
+	glProgramUniform3fEXT,
+	glProgramUniform3fvEXT,
+	glProgramUniform3iEXT,
+	glProgramUniform3ivEXT,
+	glProgramUniform3uiEXT,
+	glProgramUniform3uivEXT,
+	glProgramUniform4fEXT,
+	glProgramUniform4fvEXT,
+	glProgramUniform4iEXT,
+	glProgramUniform4ivEXT,
+	glProgramUniform4uiEXT,
+	glProgramUniform4uivEXT,
+	glProgramUniformMatrix2fvEXT,
+	glProgramUniformMatrix2x3fvEXT,
+	glProgramUniformMatrix2x4fvEXT,
+	glProgramUniformMatrix3fvEXT,
+	glProgramUniformMatrix3x2fvEXT,
+	glProgramUniformMatrix3x4fvEXT,
+	glProgramUniformMatrix4fvEXT,
+	glProgramUniformMatrix4x2fvEXT,
+	glProgramUniformMatrix4x3fvEXT,
+	glProgramUniformui64NV,
+	glProgramUniformui64vNV,
 );
 
 # this list contains functions for which a special post-execution function exits
@@ -49,10 +167,42 @@
 # the original function, the result variable, and the error code of the original
 # call
 @postExecutionList = (
+	# timer query of the application, see drawTiming.c
+	glBeginQuery,
+	glBeginQueryARB,
+	glEndQuery,
+	glEndQueryARB,
 	glGetQueryObjectiv,
 	glGetQueryObjectuiv,
 	glGetQueryObjectivARB,
 	glGetQueryObjectuivARB,
 	glGetOcclusionQueryivNV,
 	glGetOcclusionQueryuivNV,
+	# GL state shadow
+	glUseProgram,
+	glUseProgramObjectARB,
+	glViewport,
+	glScissor,
+	glDrawBuffer,
+	glDrawBuffers,
+	glDrawBuffersARB,
+	glDrawBuffersATI,
+	glReadBuffer,
+	glBindFramebuffer,
+	glBindFramebufferEXT,
+	glDeleteFramebuffers,
+	glDeleteFramebuffersEXT,
+	glColorMask,
+	glColorMaski,
+	glColorMaskIndexedEXT,
+	glDepthMask,
+	glEnable,
+	glDisable,
+	glEnablei,
+	glDisablei,
+	glEnableIndexedEXT,
+	glDisableIndexedEXT,
+	glPopAttrib,
+	glCallList,
+	glCallLists,
 );
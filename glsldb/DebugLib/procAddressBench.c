@@ -0,0 +1,167 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/* Micro benchmark of the name lookup behind glXGetProcAddressHook and the
+ * dlsym interposer. It resolves every hooked GL and GLX name through the
+ * generated perfect hash, the strcmp chain the generator emitted before and
+ * the hash table in utils. Build with -DGLSLDB_BENCHMARKS=ON and run
+ * bin/procaddressbench.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../utils/hash.h"
+
+#define GLSLDB_HOOK_NAMES_ONLY
+#include "getProcAddressHook.inc"
+
+/* the former generated code: one strcmp per hooked name until a match */
+static int chainLookup(const char *name)
+{
+	int i;
+	for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+		if (!strcmp(hookNames[i], name)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static double now(void)
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void report(const char *table, const char *op, long ops,
+                   double seconds)
+{
+	printf("%-8s %-5s %10.1f ns/op\n", table, op,
+	       seconds * 1e9 / (double)ops);
+}
+
+/* names a loader asks for that are not hooked, e.g. newer extensions */
+static char **makeMisses(void)
+{
+	char **misses = (char**)malloc(HOOK_TABLE_SIZE*sizeof(char*));
+	int i;
+	for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+		misses[i] = (char*)malloc(strlen(hookNames[i]) + 4);
+		sprintf(misses[i], "%sXYZ", hookNames[i]);
+	}
+	return misses;
+}
+
+static void freeMisses(char **misses)
+{
+	int i;
+	for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+		free(misses[i]);
+	}
+	free(misses);
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = argc > 1 ? atoi(argv[1]) : 200;
+	char **misses = makeMisses();
+	long found = 0;
+	long ops = (long)rounds*HOOK_TABLE_SIZE;
+	double t;
+	Hash h;
+	int r, i;
+
+	printf("%i hooked names, %i rounds\n", HOOK_TABLE_SIZE, rounds);
+
+	/* the chain is slow, give it fewer rounds */
+	t = now();
+	for (r = 0; r < rounds/10 + 1; r++) {
+		for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+			found += chainLookup(hookNames[i]) >= 0;
+		}
+	}
+	report("strcmp", "hit", (long)(rounds/10 + 1)*HOOK_TABLE_SIZE, now() - t);
+	t = now();
+	for (r = 0; r < rounds/10 + 1; r++) {
+		for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+			found += chainLookup(misses[i]) >= 0;
+		}
+	}
+	report("strcmp", "miss", (long)(rounds/10 + 1)*HOOK_TABLE_SIZE, now() - t);
+
+	hash_create(&h, hashString, compString, HOOK_TABLE_SIZE, 0);
+	for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+		hash_insert(&h, (void*)hookNames[i], (void*)hookNames[i]);
+	}
+	t = now();
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+			found += hash_find(&h, (void*)hookNames[i]) != NULL;
+		}
+	}
+	report("hash", "hit", ops, now() - t);
+	t = now();
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+			found += hash_find(&h, misses[i]) != NULL;
+		}
+	}
+	report("hash", "miss", ops, now() - t);
+	hash_free(&h);
+
+	t = now();
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+			found += lookupHook(hookNames[i]) >= 0;
+		}
+	}
+	report("perfect", "hit", ops, now() - t);
+	t = now();
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < HOOK_TABLE_SIZE; i++) {
+			found += lookupHook(misses[i]) >= 0;
+		}
+	}
+	report("perfect", "miss", ops, now() - t);
+
+	/* every hit must be found by all lookups, no miss by any */
+	if (found != (long)(rounds/10 + 1 + 2*rounds)*HOOK_TABLE_SIZE) {
+		printf("lookup mismatch\n");
+		freeMisses(misses);
+		return 1;
+	}
+	freeMisses(misses);
+	return 0;
+}
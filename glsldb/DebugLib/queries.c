@@ -51,41 +51,213 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 extern Globals G;
 
-static int hashUInt(void *key, int numBuckets)
+#define QUERY_MIN_SLOT_BITS 7
+
+static int hashId(GLuint id, int slotBits)
 {
-	return *(GLuint*)key % numBuckets;
+	/* Fibonacci hashing, ids are mostly small and consecutive */
+	return (int)((id * 2654435761u) >> (32 - slotBits));
 }
 
-static int compUInt(void *key1, void *key2)
+static int allocSlots(QueryTracker *t, int slotBits)
 {
-	return *(GLuint*)key1 == *(GLuint*)key2;
+	int i, n = 1 << slotBits;
+
+	if (!(t->slots = (QuerySlot*)malloc(n*sizeof(QuerySlot)))) {
+		return DBG_ERROR_MEMORY_ALLOCATION_FAILED;
+	}
+	for (i = 0; i < n; i++) {
+		t->slots[i].index = -1;
+	}
+	t->slotBits = slotBits;
+	return DBG_NO_ERROR;
 }
 
-int initQueryStateTracker(void)
+/* return the slot holding id or the empty slot where it would be inserted */
+static int findSlot(QueryTracker *t, GLuint id)
+{
+	int mask = (1 << t->slotBits) - 1;
+	int i = hashId(id, t->slotBits);
+
+	while (t->slots[i].index != -1 && t->slots[i].id != id) {
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+static int growSlots(QueryTracker *t)
+{
+	QuerySlot *oldSlots = t->slots;
+	int i, error;
+
+	if ((error = allocSlots(t, t->slotBits + 1)) != DBG_NO_ERROR) {
+		t->slots = oldSlots;
+		return error;
+	}
+	for (i = 0; i < t->numQueries; i++) {
+		int slot = findSlot(t, t->queries[i].id);
+		t->slots[slot].id = t->queries[i].id;
+		t->slots[slot].index = i;
+	}
+	free(oldSlots);
+	return DBG_NO_ERROR;
+}
+
+/* remove the entry in slot i keeping all probe sequences intact */
+static void clearSlot(QueryTracker *t, int i)
+{
+	int mask = (1 << t->slotBits) - 1;
+	int j = i;
+
+	for (;;) {
+		int home;
+		t->slots[i].index = -1;
+		do {
+			j = (j + 1) & mask;
+			if (t->slots[j].index == -1) {
+				return;
+			}
+			home = hashId(t->slots[j].id, t->slotBits);
+		} while (i <= j ? (i < home && home <= j) : (i < home || home <= j));
+		t->slots[i] = t->slots[j];
+		i = j;
+	}
+}
+
+static int targetIndex(GLenum target)
+{
+	switch (target) {
+		case GL_SAMPLES_PASSED:
+			return QUERY_TARGET_SAMPLES_PASSED;
+		case GL_PRIMITIVES_GENERATED_NV:
+			return QUERY_TARGET_PRIMITIVES_GENERATED;
+		case GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN_NV:
+			return QUERY_TARGET_TFB_PRIMITIVES_WRITTEN;
+		default:
+			return QUERY_TARGET_OCCLUSION_NV;
+	}
+}
+
+/* store the result of an interrupted query; results of several
+ * interruptions of the same query add up
+ */
+static int saveQuery(GLuint id, GLenum target, GLint value)
 {
-	hash_create(&G.queries, hashUInt, compUInt, 128, 1);
+	QueryTracker *t = &G.queries;
+	Query *q;
+	int slot = findSlot(t, id);
+
+	if (t->slots[slot].index == -1) {
+		if (2*(t->numQueries + 1) > (1 << t->slotBits)) {
+			if (growSlots(t) != DBG_NO_ERROR) {
+				return DBG_ERROR_MEMORY_ALLOCATION_FAILED;
+			}
+			slot = findSlot(t, id);
+		}
+		if (t->numQueries == t->maxQueries) {
+			int n = t->maxQueries ? 2*t->maxQueries : 16;
+			Query *queries = (Query*)realloc(t->queries, n*sizeof(Query));
+			if (!queries) {
+				return DBG_ERROR_MEMORY_ALLOCATION_FAILED;
+			}
+			t->queries = queries;
+			t->maxQueries = n;
+		}
+		t->slots[slot].id = id;
+		t->slots[slot].index = t->numQueries;
+		q = &t->queries[t->numQueries++];
+		q->id = id;
+		q->value = 0;
+	} else {
+		q = &t->queries[t->slots[slot].index];
+	}
+	q->target = target;
+	q->value += value;
+	q->interrupted = 1;
+	t->active[targetIndex(target)] = t->slots[slot].index;
+	dbgPrint(DBGLVL_INFO, "interruptAndSaveQuery: id=%i target=%s value=%i\n",
+	         q->id, lookupEnum(q->target), q->value);
 	return DBG_NO_ERROR;
 }
 
+Query *findQuery(GLuint id)
+{
+	QueryTracker *t = &G.queries;
+	int slot = findSlot(t, id);
+
+	if (t->slots[slot].index == -1) {
+		return NULL;
+	}
+	return &t->queries[t->slots[slot].index];
+}
+
+void removeQuery(GLuint id)
+{
+	QueryTracker *t = &G.queries;
+	int i, last, slot = findSlot(t, id);
+	int index = t->slots[slot].index;
+
+	if (index == -1) {
+		return;
+	}
+	clearSlot(t, slot);
+
+	/* move the last query into the gap */
+	last = --t->numQueries;
+	if (index != last) {
+		t->queries[index] = t->queries[last];
+		t->slots[findSlot(t, t->queries[index].id)].index = index;
+	}
+	for (i = 0; i < QUERY_TARGET_COUNT; i++) {
+		if (t->active[i] == index) {
+			t->active[i] = -1;
+		} else if (t->active[i] == last) {
+			t->active[i] = index;
+		}
+	}
+}
+
+int initQueryStateTracker(void)
+{
+	QueryTracker *t = &G.queries;
+	int i;
+
+	t->queries = NULL;
+	t->numQueries = 0;
+	t->maxQueries = 0;
+	for (i = 0; i < QUERY_TARGET_COUNT; i++) {
+		t->active[i] = -1;
+	}
+	t->timerQuery = 0;
+	return allocSlots(t, QUERY_MIN_SLOT_BITS);
+}
+
 int cleanupQueryStateTracker(void)
 {
-	hash_free(&G.queries);
+	QueryTracker *t = &G.queries;
+
+	free(t->queries);
+	free(t->slots);
+	t->queries = NULL;
+	t->slots = NULL;
+	t->numQueries = 0;
+	t->maxQueries = 0;
 	return DBG_NO_ERROR;
 }
 
 void interruptAndSaveQueries(void)
 {
-	Query *activeQuery;
 	GLint qid;
 	GLint value;
-	int i, n;
+	int i, error;
 
 	dbgPrint(DBGLVL_INFO, "interruptAndSaveQueries called\n");
-	/* reset state of hashed but not restarted queries */
-	n = hash_count(&G.queries);
-	for (i = 0; i < n; i++) {
-		Query *q = hash_element(&G.queries, i);
-		q->interrupted = 0;
+	/* reset state of saved but not restarted queries */
+	for (i = 0; i < QUERY_TARGET_COUNT; i++) {
+		if (G.queries.active[i] != -1) {
+			G.queries.queries[G.queries.active[i]].interrupted = 0;
+			G.queries.active[i] = -1;
+		}
 	}
 	
 	if (checkGLVersionSupported(1, 5)) {
@@ -96,17 +268,10 @@ void interruptAndSaveQueries(void)
 			ORIG_GL(glEndQuery)(GL_SAMPLES_PASSED);
 			ORIG_GL(glGetQueryObjectiv)(qid, GL_QUERY_RESULT,
 			                            &value);
-			if (!(activeQuery = (Query*)malloc(sizeof(Query)))) {
-				setErrorCode(DBG_ERROR_MEMORY_ALLOCATION_FAILED);
+			if ((error = saveQuery(qid, GL_SAMPLES_PASSED, value)) != DBG_NO_ERROR) {
+				setErrorCode(error);
 				return;
 			}
-			activeQuery->id = qid;
-			activeQuery->value = value;
-			activeQuery->target = GL_SAMPLES_PASSED;
-			activeQuery->interrupted = 1;
-			dbgPrint(DBGLVL_INFO, "interruptAndSaveQuery: id=%i target=%s value=%i\n",  
-			         activeQuery->id, lookupEnum(activeQuery->target), activeQuery->value);
-			hash_insert(&G.queries, &activeQuery->id, activeQuery);
 		}
 		/* check timer query??? */
 		/* check tfb queries */
@@ -118,15 +283,10 @@ void interruptAndSaveQueries(void)
 					ORIG_GL(glEndQuery)(GL_PRIMITIVES_GENERATED_NV);
 					ORIG_GL(glGetQueryObjectiv)(qid, GL_QUERY_RESULT,
 							&value);
-					if (!(activeQuery = (Query*)malloc(sizeof(Query)))) {
-						setErrorCode(DBG_ERROR_MEMORY_ALLOCATION_FAILED);
+					if ((error = saveQuery(qid, GL_PRIMITIVES_GENERATED_NV, value)) != DBG_NO_ERROR) {
+						setErrorCode(error);
 						return;
 					}
-					activeQuery->id = qid;
-					activeQuery->value = value;
-					activeQuery->target = GL_PRIMITIVES_GENERATED_NV;
-					activeQuery->interrupted = 1;
-					hash_insert(&G.queries, &activeQuery->id, activeQuery);
 				}
 				ORIG_GL(glGetQueryiv)(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN_NV,
 						GL_CURRENT_QUERY, &qid);
@@ -134,15 +294,10 @@ void interruptAndSaveQueries(void)
 					ORIG_GL(glEndQuery)(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN_NV);
 					ORIG_GL(glGetQueryObjectiv)(qid, GL_QUERY_RESULT,
 							&value);
-					if (!(activeQuery = (Query*)malloc(sizeof(Query)))) {
-						setErrorCode(DBG_ERROR_MEMORY_ALLOCATION_FAILED);
+					if ((error = saveQuery(qid, GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN_NV, value)) != DBG_NO_ERROR) {
+						setErrorCode(error);
 						return;
 					}
-					activeQuery->id = qid;
-					activeQuery->value = value;
-					activeQuery->target = GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN_NV;
-					activeQuery->interrupted = 1;
-					hash_insert(&G.queries, &activeQuery->id, activeQuery);
 				}
 				break;
 			case TFBVersion_EXT:
@@ -152,15 +307,10 @@ void interruptAndSaveQueries(void)
 					ORIG_GL(glEndQuery)(GL_PRIMITIVES_GENERATED_EXT);
 					ORIG_GL(glGetQueryObjectiv)(qid, GL_QUERY_RESULT,
 							&value);
-					if (!(activeQuery = (Query*)malloc(sizeof(Query)))) {
-						setErrorCode(DBG_ERROR_MEMORY_ALLOCATION_FAILED);
+					if ((error = saveQuery(qid, GL_PRIMITIVES_GENERATED_EXT, value)) != DBG_NO_ERROR) {
+						setErrorCode(error);
 						return;
 					}
-					activeQuery->id = qid;
-					activeQuery->value = value;
-					activeQuery->target = GL_PRIMITIVES_GENERATED_EXT;
-					activeQuery->interrupted = 1;
-					hash_insert(&G.queries, &activeQuery->id, activeQuery);
 				}
 				ORIG_GL(glGetQueryiv)(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN_EXT,
 						GL_CURRENT_QUERY, &qid);
@@ -168,15 +318,10 @@ void interruptAndSaveQueries(void)
 					ORIG_GL(glEndQuery)(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN_EXT);
 					ORIG_GL(glGetQueryObjectiv)(qid, GL_QUERY_RESULT,
 							&value);
-					if (!(activeQuery = (Query*)malloc(sizeof(Query)))) {
-						setErrorCode(DBG_ERROR_MEMORY_ALLOCATION_FAILED);
+					if ((error = saveQuery(qid, GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN_EXT, value)) != DBG_NO_ERROR) {
+						setErrorCode(error);
 						return;
 					}
-					activeQuery->id = qid;
-					activeQuery->value = value;
-					activeQuery->target = GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN_EXT;
-					activeQuery->interrupted = 1;
-					hash_insert(&G.queries, &activeQuery->id, activeQuery);
 				}
 				break;
 			default:
@@ -191,15 +336,10 @@ void interruptAndSaveQueries(void)
 			ORIG_GL(glEndQueryARB)(GL_SAMPLES_PASSED_ARB);
 			ORIG_GL(glGetQueryObjectivARB)(qid, GL_QUERY_RESULT_ARB,
 			                               &value);
-			if (!(activeQuery = (Query*)malloc(sizeof(Query)))) {
-				setErrorCode(DBG_ERROR_MEMORY_ALLOCATION_FAILED);
+			if ((error = saveQuery(qid, GL_SAMPLES_PASSED_ARB, value)) != DBG_NO_ERROR) {
+				setErrorCode(error);
 				return;
 			}
-			activeQuery->id = qid;
-			activeQuery->value = value;
-			activeQuery->target = GL_SAMPLES_PASSED_ARB;
-			activeQuery->interrupted = 1;
-			hash_insert(&G.queries, &activeQuery->id, activeQuery);
 		}
 	} else if (checkGLExtensionSupported("GL_NV_occlusion_query")) {
 		/* check occlusion query */
@@ -208,15 +348,10 @@ void interruptAndSaveQueries(void)
 			ORIG_GL(glEndOcclusionQueryNV)();
 			ORIG_GL(glGetOcclusionQueryivNV)(qid, GL_PIXEL_COUNT_NV,
 			                                 &value);
-			if (!(activeQuery = (Query*)malloc(sizeof(Query)))) {
-				setErrorCode(DBG_ERROR_MEMORY_ALLOCATION_FAILED);
+			if ((error = saveQuery(qid, GL_CURRENT_OCCLUSION_QUERY_ID_NV, value)) != DBG_NO_ERROR) {
+				setErrorCode(error);
 				return;
 			}
-			activeQuery->id = qid;
-			activeQuery->value = value;
-			activeQuery->target = GL_CURRENT_OCCLUSION_QUERY_ID_NV;
-			activeQuery->interrupted = 1;
-			hash_insert(&G.queries, &activeQuery->id, activeQuery);
 		}
 	}
 	setErrorCode(DBG_NO_ERROR);
@@ -225,11 +360,14 @@ void interruptAndSaveQueries(void)
 void restartQueries(void)
 {
 	int i;
-	int n = hash_count(&G.queries);
-	
-	dbgPrint(DBGLVL_INFO, "restartQueries: %i\n", n);
-	for (i = 0; i < n; i++) {
-		Query *q = hash_element(&G.queries, i);
+
+	dbgPrint(DBGLVL_INFO, "restartQueries: %i\n", G.queries.numQueries);
+	for (i = 0; i < QUERY_TARGET_COUNT; i++) {
+		Query *q;
+		if (G.queries.active[i] == -1) {
+			continue;
+		}
+		q = &G.queries.queries[G.queries.active[i]];
 		dbgPrint(DBGLVL_INFO, "restarting query %i: id=%i target=%s value=%i interrupted=%i\n",
 		         i, q->id, lookupEnum(q->target), q->value, q->interrupted);
 		if (q->interrupted) {
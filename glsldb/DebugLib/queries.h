@@ -43,6 +43,37 @@ typedef struct {
 	int interrupted;
 } Query;
 
+/* query targets that can be interrupted, at most one query is active per
+ * target
+ */
+typedef enum {
+	QUERY_TARGET_SAMPLES_PASSED,
+	QUERY_TARGET_PRIMITIVES_GENERATED,
+	QUERY_TARGET_TFB_PRIMITIVES_WRITTEN,
+	QUERY_TARGET_OCCLUSION_NV,
+	QUERY_TARGET_COUNT
+} QueryTarget;
+
+/* open addressing slot of the id map; index -1 marks an empty slot */
+typedef struct {
+	GLuint id;
+	int index;
+} QuerySlot;
+
+typedef struct {
+	/* dense array of all queries with saved results */
+	Query *queries;
+	int numQueries;
+	int maxQueries;
+	/* sparse map from query id to position in queries */
+	QuerySlot *slots;
+	int slotBits;
+	/* queries interrupted at the last stop, -1 if none */
+	int active[QUERY_TARGET_COUNT];
+	/* the application's active GL_TIME_ELAPSED query, 0 if none */
+	GLuint timerQuery;
+} QueryTracker;
+
 DBGLIBLOCAL int initQueryStateTracker(void);
 
 DBGLIBLOCAL int cleanupQueryStateTracker(void);
@@ -51,4 +82,10 @@ DBGLIBLOCAL void interruptAndSaveQueries(void);
 
 DBGLIBLOCAL void restartQueries(void);
 
+/* return the saved result of query id or NULL if there is none */
+DBGLIBLOCAL Query *findQuery(GLuint id);
+
+/* forget the saved result of query id */
+DBGLIBLOCAL void removeQuery(GLuint id);
+
 #endif
@@ -82,15 +82,7 @@ static struct {
 	/*GLuint dbgStencilBuffer;*/
 	
 	/* fraembuffer saved state */
-	GLuint activeFBO;
-	GLint activeDrawbuffer;
-	GLint activeReadbuffer;
-	GLboolean activeColorMask[4];
-	GLboolean activeDepthMask;
-	GLboolean activeAlphaTest;
-	GLboolean activeStencilTest;
-	GLboolean activeDepthTest;
-	GLboolean activeBlending;
+	GLStateShadow activeState;
 	GLint activeRedBits;
 	GLint activeGreenBits;
 	GLint activeBlueBits;
@@ -102,10 +94,17 @@ static struct {
 	GLfloat *depthBuffer;
 	GLint *stencilBuffer;
 
+	/* bits of the last GL_BITMAP readback, see gatherCoveredPixels */
+	unsigned char *coverage;
+	int coverageWidth;
+	int coverageHeight;
+
 	/* transform feedback dbg state */
 	GLuint tfbBuffer;
 	GLuint tfbQueries[2];
 	TFBState savedTfbState;
+	/* array buffer binding replaced by a position feedback */
+	GLint savedArrayBuffer;
 } g;
 
 typedef struct {
@@ -327,17 +326,10 @@ static int setDbgRenderState(int target, int alphaTestOption,
 {
 	DMARK
 	if (target == DBG_TARGET_FRAGMENT_SHADER) {
-		/* save state */
-		ORIG_GL(glGetBooleanv)(GL_COLOR_WRITEMASK, g.activeColorMask);
-		ORIG_GL(glGetBooleanv)(GL_DEPTH_WRITEMASK, &g.activeDepthMask);
-		ORIG_GL(glGetBooleanv)(GL_ALPHA_TEST, &g.activeAlphaTest);
-		ORIG_GL(glGetBooleanv)(GL_STENCIL_TEST, &g.activeStencilTest);
-		ORIG_GL(glGetBooleanv)(GL_DEPTH_TEST, &g.activeDepthTest);
-		ORIG_GL(glGetBooleanv)(GL_BLEND, &g.activeBlending);
-		/* set state */
-		ORIG_GL(glDrawBuffer)(GL_COLOR_ATTACHMENT0_EXT);
-		ORIG_GL(glReadBuffer)(GL_COLOR_ATTACHMENT0_EXT);
-		ORIG_GL(glColorMask)(GL_TRUE, GL_FALSE, GL_FALSE, g.activeColorMask[3]);
+		/* state was saved in g.activeState */
+		setDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+		setReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+		setColorMask(GL_TRUE, GL_FALSE, GL_FALSE, g.activeState.colorMask[3]);
 		dbgPrint(DBGLVL_INFO, "setDbgRenderState: stencilTestOption: %i "
 				              "alphaTestOption: %i depthTestOption: %i "
 							  "blendingOption: %i\n",
@@ -345,10 +337,10 @@ static int setDbgRenderState(int target, int alphaTestOption,
 		         blendingOption);
 		switch (stencilTestOption) {
 			case DBG_PFT_FORCE_DISABLED:
-				ORIG_GL(glDisable)(GL_STENCIL_TEST);
+				setCapability(GL_STENCIL_TEST, GL_FALSE);
 				break;
 			case DBG_PFT_FORCE_ENABLED:
-				ORIG_GL(glEnable)(GL_STENCIL_TEST);
+				setCapability(GL_STENCIL_TEST, GL_TRUE);
 				break;
 			case DBG_PFT_KEEP:
 			default:
@@ -356,10 +348,10 @@ static int setDbgRenderState(int target, int alphaTestOption,
 		}
 		switch (alphaTestOption) {
 			case DBG_PFT_FORCE_DISABLED:
-				ORIG_GL(glDisable)(GL_ALPHA_TEST);
+				setCapability(GL_ALPHA_TEST, GL_FALSE);
 				break;
 			case DBG_PFT_FORCE_ENABLED:
-				ORIG_GL(glEnable)(GL_ALPHA_TEST);
+				setCapability(GL_ALPHA_TEST, GL_TRUE);
 				break;
 			case DBG_PFT_KEEP:
 			default:
@@ -367,10 +359,10 @@ static int setDbgRenderState(int target, int alphaTestOption,
 		}
 		switch (depthTestOption) {
 			case DBG_PFT_FORCE_DISABLED:
-				ORIG_GL(glDisable)(GL_DEPTH_TEST);
+				setCapability(GL_DEPTH_TEST, GL_FALSE);
 				break;
 			case DBG_PFT_FORCE_ENABLED:
-				ORIG_GL(glEnable)(GL_DEPTH_TEST);
+				setCapability(GL_DEPTH_TEST, GL_TRUE);
 				break;
 			case DBG_PFT_KEEP:
 			default:
@@ -378,10 +370,10 @@ static int setDbgRenderState(int target, int alphaTestOption,
 		}
 		switch (blendingOption) {
 			case DBG_PFT_FORCE_DISABLED:
-				ORIG_GL(glDisable)(GL_BLEND);
+				setCapability(GL_BLEND, GL_FALSE);
 				break;
 			case DBG_PFT_FORCE_ENABLED:
-				ORIG_GL(glEnable)(GL_BLEND);
+				setCapability(GL_BLEND, GL_TRUE);
 				break;
 			case DBG_PFT_KEEP:
 			default:
@@ -432,32 +424,16 @@ static int restoreDbgRenderState(int target)
 {
 	DMARK
 	if (target == DBG_TARGET_FRAGMENT_SHADER) {
-		/* TODO: MRTs */
-		ORIG_GL(glDrawBuffer)(g.activeDrawbuffer);
-		ORIG_GL(glReadBuffer)(g.activeReadbuffer);
-		ORIG_GL(glColorMask)(g.activeColorMask[0], g.activeColorMask[1],
-		                     g.activeColorMask[2], g.activeColorMask[3]);
-		ORIG_GL(glDepthMask)(g.activeDepthMask);
-		if (g.activeStencilTest) {
-			ORIG_GL(glEnable)(GL_STENCIL_TEST);
-		} else {
-			ORIG_GL(glDisable)(GL_STENCIL_TEST);
-		}
-		if (g.activeAlphaTest) {
-			ORIG_GL(glEnable)(GL_ALPHA_TEST);
-		} else {
-			ORIG_GL(glDisable)(GL_ALPHA_TEST);
-		}
-		if (g.activeDepthTest) {
-			ORIG_GL(glEnable)(GL_DEPTH_TEST);
-		} else {
-			ORIG_GL(glDisable)(GL_DEPTH_TEST);
-		}
-		if (g.activeBlending) {
-			ORIG_GL(glEnable)(GL_BLEND);
-		} else {
-			ORIG_GL(glDisable)(GL_BLEND);
-		}
+		setDrawBuffers(g.activeState.numDrawBuffers,
+		               g.activeState.drawBuffers);
+		setReadBuffer(g.activeState.readBuffer);
+		setColorMask(g.activeState.colorMask[0], g.activeState.colorMask[1],
+		             g.activeState.colorMask[2], g.activeState.colorMask[3]);
+		setDepthMask(g.activeState.depthMask);
+		setCapability(GL_STENCIL_TEST, g.activeState.stencilTest);
+		setCapability(GL_ALPHA_TEST, g.activeState.alphaTest);
+		setCapability(GL_DEPTH_TEST, g.activeState.depthTest);
+		setCapability(GL_BLEND, g.activeState.blend);
 	} else {
 		/* restore transform feedback state */
 		restoreTransformFeedbackState(&g.savedTfbState);
@@ -678,6 +654,63 @@ int endTransformFeedback(int primitiveType, int numFloatsPerVertex, float **data
 	return DBG_NO_ERROR;
 }
 
+static void freePositionFeedback(void)
+{
+	ORIG_GL(glBindBuffer)(GL_ARRAY_BUFFER, g.savedArrayBuffer);
+	ORIG_GL(glDeleteBuffers)(1, &g.tfbBuffer);
+	ORIG_GL(glDeleteQueries)(2, g.tfbQueries);
+	g.tfbBuffer = 0;
+}
+
+int beginPositionFeedback(int primitiveType, int numVertices)
+{
+	int error;
+
+	DMARK
+	/* the fragment output target has no feedback buffer, use one that fits
+	 * exactly the positions of the draw call
+	 */
+	ORIG_GL(glGetIntegerv)(GL_ARRAY_BUFFER_BINDING, &g.savedArrayBuffer);
+	ORIG_GL(glGenQueries)(2, g.tfbQueries);
+	ORIG_GL(glGenBuffers)(1, &g.tfbBuffer);
+	ORIG_GL(glBindBuffer)(GL_ARRAY_BUFFER, g.tfbBuffer);
+	ORIG_GL(glBufferData)(GL_ARRAY_BUFFER, 4*numVertices*sizeof(GLfloat),
+	                      NULL, GL_STREAM_READ);
+	switch (getTFBVersion()) {
+		case TFBVersion_NV:
+			ORIG_GL(glBindBufferBaseNV)(GL_TRANSFORM_FEEDBACK_BUFFER_NV, 0, g.tfbBuffer);
+			break;
+		case TFBVersion_EXT:
+			ORIG_GL(glBindBufferBaseEXT)(GL_TRANSFORM_FEEDBACK_BUFFER_EXT, 0, g.tfbBuffer);
+			break;
+		default:
+			dbgPrint(DBGLVL_ERROR, "Unhandled TFB version!\n");
+			freePositionFeedback();
+			return GL_INVALID_OPERATION;
+	}
+	error = glError();
+	if (!error) {
+		error = beginTransformFeedback(primitiveType);
+	}
+	if (error) {
+		freePositionFeedback();
+	}
+	return error;
+}
+
+int endPositionFeedback(int primitiveType, float **positions,
+                        int *numPrimitives, int *numVertices)
+{
+	int error;
+
+	/* the feedback buffer is mapped through the array buffer binding */
+	ORIG_GL(glBindBuffer)(GL_ARRAY_BUFFER, g.tfbBuffer);
+	error = endTransformFeedback(primitiveType, 4, positions, numPrimitives,
+	                             numVertices);
+	freePositionFeedback();
+	return error;
+}
+
 #ifdef DEBUG
 static void writeDbgImage(const char *filename, int width, int height,
                           int numComponents, float *data)
@@ -694,7 +727,7 @@ static void setDbgOutputTargetFragmentData(int alphaTestOption,
                                            int blendingOption)
 {
 	pixelTransferState savedState;
-	GLint viewport[4];
+	const GLint *viewport;
 	int error;
 
 	DMARK
@@ -702,16 +735,15 @@ static void setDbgOutputTargetFragmentData(int alphaTestOption,
 	g.depthBuffer = NULL;
 	g.stencilBuffer = NULL;
 	
-	ORIG_GL(glGetIntegerv)(GL_VIEWPORT, viewport);
-
 	/* TODO: check for fbo support! Do it in debugger!*/
 	
-	/* check whether a fbo is active */
-	ORIG_GL(glGetIntegerv)(GL_FRAMEBUFFER_BINDING_EXT, &g.activeFBO);
+	/* store viewport, active fbo, draw and read buffers, write masks and
+	 * tests; all of them are shadowed, so this usually does not query GL
+	 */
+	g.activeState = *getGLStateShadow(GLSTATE_ALL);
+	viewport = g.activeState.viewport;
 
-	/* store currently active draw buffer and bit depths */
-	ORIG_GL(glGetIntegerv)(GL_DRAW_BUFFER, &g.activeDrawbuffer);
-	/* TODO: MRT draw buffers */
+	/* store bit depths */
 	ORIG_GL(glGetIntegerv)(GL_RED_BITS, &g.activeRedBits);
 	ORIG_GL(glGetIntegerv)(GL_GREEN_BITS, &g.activeGreenBits);
 	ORIG_GL(glGetIntegerv)(GL_BLUE_BITS, &g.activeBlueBits);
@@ -732,7 +764,7 @@ static void setDbgOutputTargetFragmentData(int alphaTestOption,
 	}
 
 	dbgPrint(DBGLVL_INFO, "ACTIVE BUFFER: %s r=%i g=%i b=%i a=%i i=%i d=%i s=%i\n",
-			lookupEnum(g.activeDrawbuffer), g.activeRedBits, g.activeGreenBits,
+			lookupEnum(g.activeState.drawBuffers[0]), g.activeRedBits, g.activeGreenBits,
 			g.activeBlueBits, g.activeAlphaBits, g.activeIndexBits,
 			g.activeDepthBits, g.activeStencilBits);
 
@@ -743,8 +775,7 @@ static void setDbgOutputTargetFragmentData(int alphaTestOption,
 		setErrorCode(DBG_ERROR_MEMORY_ALLOCATION_FAILED);
 		return;
 	}
-	ORIG_GL(glGetIntegerv)(GL_READ_BUFFER, &g.activeReadbuffer);
-	ORIG_GL(glReadBuffer)(g.activeDrawbuffer);
+	setReadBuffer(g.activeState.drawBuffers[0]);
 	ORIG_GL(glReadPixels)(viewport[0], viewport[1], viewport[2], viewport[3],
 	                      GL_RGBA, GL_FLOAT, g.colorBuffer);
 	if (setGLErrorCode()) {
@@ -801,7 +832,7 @@ static void setDbgOutputTargetFragmentData(int alphaTestOption,
 	
 	/* create a new fbo with a RGBA float attachment */
 	ORIG_GL(glGenFramebuffersEXT)(1, &g.dbgFBO);
-	ORIG_GL(glBindFramebufferEXT)(GL_FRAMEBUFFER_EXT, g.dbgFBO);
+	setFramebuffers(g.dbgFBO, g.dbgFBO);
 	if (setGLErrorCode()) {
 		return;
 	}
@@ -947,7 +978,8 @@ static void restoreOutputTargetFragmentData(void)
 	free(g.colorBuffer);
 	g.colorBuffer = NULL;
 	
-	ORIG_GL(glBindFramebufferEXT)(GL_FRAMEBUFFER_EXT, g.activeFBO);
+	setFramebuffers(g.activeState.drawFramebuffer,
+	                g.activeState.readFramebuffer);
 	ORIG_GL(glDeleteRenderbuffersEXT)(1, &g.dbgBufferFloat);
 	if(setGLErrorCode()) {
 		return;
@@ -1028,19 +1060,34 @@ void restoreOutputTarget(void)
 
 }
 
+/* pack n bytes that are 0 or 1 into bits in place, least significant first */
+static void packBits(unsigned char *data, int n)
+{
+	int i, j;
+
+	for (i = 0; i < n; i += 8) {
+		unsigned char bits = 0;
+		for (j = 0; j < 8 && i + j < n; j++) {
+			bits |= (data[i + j] != 0) << j;
+		}
+		data[i/8] = bits;
+	}
+}
+
 int readBackRenderBuffer(int numComponents, int dataFormat, int *width, int *height,
                          void **buffer)
 {
 	pixelTransferState savedState;
 	GLint viewport[4];
-	int format, lineWidth;
+	int format, readFormat, lineWidth;
 	void *line;
 	char *bf, *bb;
 	int j, error;
 	int formatSize;
 	
 	DMARK
-	ORIG_GL(glGetIntegerv)(GL_VIEWPORT, viewport);
+	memcpy(viewport, getGLStateShadow(GLSTATE_VIEWPORT)->viewport,
+	       sizeof(viewport));
 	
 	switch (numComponents) {
 		case 1:	format = GL_RED; break;
@@ -1052,10 +1099,25 @@ int readBackRenderBuffer(int numComponents, int dataFormat, int *width, int *hei
 					numComponents);
 			return DBG_ERROR_READBACK_INVALID_COMPONENTS;
 	}
+	readFormat = dataFormat;
 	switch (dataFormat) {
 		case GL_FLOAT:
 			formatSize = sizeof(GLfloat);
 			break;
+		case GL_BITMAP:
+			/* coverage masks, read as bytes and packed afterwards */
+			if (numComponents != 1) {
+				return DBG_ERROR_READBACK_INVALID_COMPONENTS;
+			}
+			readFormat = GL_UNSIGNED_BYTE;
+			formatSize = sizeof(GLubyte);
+			break;
+		case GL_HALF_FLOAT_ARB:
+			formatSize = sizeof(GLhalfARB);
+			break;
+		case GL_UNSIGNED_BYTE:
+			formatSize = sizeof(GLubyte);
+			break;
 		case GL_INT:
 			formatSize = sizeof(GLint);
 			break;
@@ -1087,8 +1149,19 @@ int readBackRenderBuffer(int numComponents, int dataFormat, int *width, int *hei
 		free(*buffer);
 		return error;
 	}
+	/* rows of the small formats are not padded */
+	ORIG_GL(glPixelStorei)(GL_PACK_ALIGNMENT, 1);
+	if (readFormat == GL_UNSIGNED_BYTE) {
+		/* read small integral values such as booleans exactly instead of
+		 * normalized
+		 */
+		ORIG_GL(glPixelTransferf)(GL_RED_SCALE, 1.0f/255.0f);
+		ORIG_GL(glPixelTransferf)(GL_GREEN_SCALE, 1.0f/255.0f);
+		ORIG_GL(glPixelTransferf)(GL_BLUE_SCALE, 1.0f/255.0f);
+		ORIG_GL(glPixelTransferf)(GL_ALPHA_SCALE, 1.0f/255.0f);
+	}
 	ORIG_GL(glReadPixels)(viewport[0], viewport[1], viewport[2],
-			viewport[3], format, dataFormat, *buffer);
+			viewport[3], format, readFormat, *buffer);
 	error = glError();
 	if (error) {
 		free(*buffer);
@@ -1105,7 +1178,7 @@ int readBackRenderBuffer(int numComponents, int dataFormat, int *width, int *hei
 	*height = viewport[3];
 	
 	/* flip buffer content */
-	lineWidth = numComponents*viewport[2]*sizeof(float);
+	lineWidth = numComponents*viewport[2]*formatSize;
 	bf = (char*)*buffer;
 	bb = (char*)*buffer + (viewport[3] - 1)*lineWidth;
 	for (j = 0; j < viewport[3]/2; j++) {
@@ -1117,6 +1190,57 @@ int readBackRenderBuffer(int numComponents, int dataFormat, int *width, int *hei
 	}
 	free(line);
 
+	if (dataFormat == GL_BITMAP) {
+		int size = (viewport[2]*viewport[3] + 7)/8;
+		packBits((unsigned char*)*buffer, viewport[2]*viewport[3]);
+		/* remember the covered pixels for sparse readbacks */
+		free(g.coverage);
+		if ((g.coverage = malloc(size))) {
+			memcpy(g.coverage, *buffer, size);
+			g.coverageWidth = viewport[2];
+			g.coverageHeight = viewport[3];
+		}
+	}
+
+	return DBG_NO_ERROR;
+}
+
+int gatherCoveredPixels(void *buffer, int numComponents, int dataFormat,
+                        int width, int height, int *numPixels)
+{
+	size_t pixelSize;
+	char *src = (char*)buffer;
+	char *dst = (char*)buffer;
+	int i;
+
+	*numPixels = width*height;
+	if (!g.coverage || g.coverageWidth != width ||
+	    g.coverageHeight != height || dataFormat == GL_BITMAP) {
+		/* nothing to gather with, the data stays dense */
+		return DBG_NO_ERROR;
+	}
+	switch (dataFormat) {
+		case GL_HALF_FLOAT_ARB:
+			pixelSize = numComponents*sizeof(GLhalfARB);
+			break;
+		case GL_UNSIGNED_BYTE:
+			pixelSize = numComponents*sizeof(GLubyte);
+			break;
+		default:
+			pixelSize = numComponents*sizeof(GLfloat);
+	}
+
+	/* compact in place, covered pixels keep their order */
+	*numPixels = 0;
+	for (i = 0; i < width*height; i++, src += pixelSize) {
+		if (g.coverage[i >> 3] & (1 << (i & 7))) {
+			if (dst != src) {
+				memcpy(dst, src, pixelSize);
+			}
+			dst += pixelSize;
+			(*numPixels)++;
+		}
+	}
 	return DBG_NO_ERROR;
 }
 
@@ -1197,24 +1321,30 @@ typedef struct {
 
 static void saveCopyState(pixelCopyState *savedState)
 {
+	const GLStateShadow *state = getGLStateShadow(GLSTATE_COLOR_MASK |
+	                                              GLSTATE_DEPTH_MASK |
+	                                              GLSTATE_CAPABILITIES |
+	                                              GLSTATE_PROGRAM);
+
 	/* Masks */
-	ORIG_GL(glGetBooleanv)(GL_COLOR_WRITEMASK, savedState->color_write_mask);
-	ORIG_GL(glGetBooleanv)(GL_DEPTH_WRITEMASK, &savedState->depth_write_mask);
+	memcpy(savedState->color_write_mask, state->colorMask,
+	       sizeof(savedState->color_write_mask));
+	savedState->depth_write_mask = state->depthMask;
 	ORIG_GL(glGetBooleanv)(GL_INDEX_WRITEMASK, &savedState->index_write_mask);
 	ORIG_GL(glGetBooleanv)(GL_STENCIL_WRITEMASK, &savedState->stencil_write_mask);
 
 	/* Tests */
-	ORIG_GL(glGetBooleanv)(GL_ALPHA_TEST, &savedState->alpha_test);
+	savedState->alpha_test = state->alphaTest;
     ORIG_GL(glGetIntegerv)(GL_ALPHA_TEST_FUNC, &savedState->alpha_test_func);
     ORIG_GL(glGetFloatv)(GL_ALPHA_TEST_REF, &savedState->alpha_test_ref);
     
-	ORIG_GL(glGetBooleanv)(GL_DEPTH_TEST, &savedState->depth_test);
+	savedState->depth_test = state->depthTest;
     ORIG_GL(glGetIntegerv)(GL_DEPTH_FUNC, &savedState->depth_func);
     
-	ORIG_GL(glGetBooleanv)(GL_SCISSOR_TEST, &savedState->scissor_test);
+	savedState->scissor_test = state->scissorTest;
 	ORIG_GL(glGetIntegerv)(GL_SCISSOR_BOX, savedState->scissor_box);
     
-    ORIG_GL(glGetBooleanv)(GL_STENCIL_TEST, &savedState->stencil_test);
+    savedState->stencil_test = state->stencilTest;
     ORIG_GL(glGetIntegerv)(GL_STENCIL_FAIL, &savedState->stencil_fail);
     ORIG_GL(glGetIntegerv)(GL_STENCIL_FUNC, &savedState->stencil_func);
     ORIG_GL(glGetIntegerv)(GL_STENCIL_PASS_DEPTH_FAIL, &savedState->stencil_pass_depth_fail);
@@ -1223,7 +1353,7 @@ static void saveCopyState(pixelCopyState *savedState)
     ORIG_GL(glGetIntegerv)(GL_STENCIL_VALUE_MASK, &savedState->stencil_value_mask);
     
 	/* Blending */
-	ORIG_GL(glGetBooleanv)(GL_BLEND, &savedState->blend);
+	savedState->blend = state->blend;
     ORIG_GL(glGetIntegerv)(GL_BLEND_DST, &savedState->blend_dst);
     ORIG_GL(glGetIntegerv)(GL_BLEND_EQUATION, &savedState->blend_equation);
     ORIG_GL(glGetIntegerv)(GL_BLEND_SRC, &savedState->blend_src);
@@ -1237,51 +1367,31 @@ static void saveCopyState(pixelCopyState *savedState)
     ORIG_GL(glGetBooleanv)(GL_TEXTURE_3D, &savedState->texture_3D);
     
     /* Fragment Program */
-    if (checkGLVersionSupported(2, 0)) {
-        ORIG_GL(glGetIntegerv)(GL_CURRENT_PROGRAM, &savedState->shader_handle);
-    } else {
-        savedState->shader_handle = ORIG_GL(glGetHandleARB)(GL_PROGRAM_OBJECT_ARB);
-    }
+    savedState->shader_handle = state->program;
 
 }
 
 static void restoreCopyState(pixelCopyState *savedState)
 {
 	/* Masks */
-	ORIG_GL(glColorMask)(savedState->color_write_mask[0], savedState->color_write_mask[1],
-                         savedState->color_write_mask[2], savedState->color_write_mask[3]);
-	ORIG_GL(glDepthMask)(savedState->depth_write_mask);
+	setColorMask(savedState->color_write_mask[0], savedState->color_write_mask[1],
+                 savedState->color_write_mask[2], savedState->color_write_mask[3]);
+	setDepthMask(savedState->depth_write_mask);
 	ORIG_GL(glIndexMask)(savedState->index_write_mask);
 	ORIG_GL(glStencilMask)(savedState->stencil_write_mask);
 
 	/* Tests */
-    if (savedState->alpha_test == GL_TRUE) {
-        ORIG_GL(glEnable)(GL_ALPHA_TEST);
-    } else {
-        ORIG_GL(glDisable)(GL_ALPHA_TEST);
-    }
+    setCapability(GL_ALPHA_TEST, savedState->alpha_test);
     ORIG_GL(glAlphaFunc)(savedState->alpha_test_func, savedState->alpha_test_ref);
     
-    if (savedState->depth_test == GL_TRUE) {
-        ORIG_GL(glEnable)(GL_DEPTH_TEST);
-    } else {
-        ORIG_GL(glDisable)(GL_DEPTH_TEST);
-    }
+    setCapability(GL_DEPTH_TEST, savedState->depth_test);
     ORIG_GL(glDepthFunc)(savedState->depth_func);
     
-    if (savedState->scissor_test == GL_TRUE) {
-        ORIG_GL(glEnable)(GL_SCISSOR_TEST);
-    } else {
-        ORIG_GL(glDisable)(GL_SCISSOR_TEST);
-    }
+    setCapability(GL_SCISSOR_TEST, savedState->scissor_test);
 	ORIG_GL(glScissor)(savedState->scissor_box[0], savedState->scissor_box[1],
                        savedState->scissor_box[2], savedState->scissor_box[3]);
     
-    if (savedState->stencil_test == GL_TRUE) {
-        ORIG_GL(glEnable)(GL_STENCIL_TEST);
-    } else {
-        ORIG_GL(glDisable)(GL_STENCIL_TEST);
-    }
+    setCapability(GL_STENCIL_TEST, savedState->stencil_test);
     
     ORIG_GL(glStencilFunc)(savedState->stencil_func,
                            savedState->stencil_ref,
@@ -1292,11 +1402,7 @@ static void restoreCopyState(pixelCopyState *savedState)
                          savedState->stencil_pass_depth_pass);
 
 	/* Blending */
-    if (savedState->blend == GL_TRUE) {
-        ORIG_GL(glEnable)(GL_BLEND);
-    } else {
-        ORIG_GL(glDisable)(GL_BLEND);
-    }
+    setCapability(GL_BLEND, savedState->blend);
     ORIG_GL(glBlendFunc)(savedState->blend_src, savedState->blend_dst);
     ORIG_GL(glBlendEquation)(savedState->blend_equation);
 
@@ -1325,11 +1431,7 @@ static void restoreCopyState(pixelCopyState *savedState)
     }
     
     /* Fragment Program */
-    if (checkGLVersionSupported(2, 0)) {
-        ORIG_GL(glUseProgram)(savedState->shader_handle);
-    } else {
-        ORIG_GL(glUseProgramObjectARB)(savedState->shader_handle);
-    }
+    setProgram(savedState->shader_handle);
 }
 
 typedef enum {
@@ -1343,15 +1445,11 @@ static void setCopyState(copyStateTarget csTarget)
 {
 	/* Masks */
     if (csTarget == CS_COLOR) {
-        ORIG_GL(glColorMask)(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    } else {
-        ORIG_GL(glColorMask)(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-    }
-    if (csTarget == CS_DEPTH) {
-        ORIG_GL(glDepthMask)(GL_TRUE);
+        setColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     } else {
-        ORIG_GL(glDepthMask)(GL_FALSE);
+        setColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
     }
+    setDepthMask(csTarget == CS_DEPTH);
     if (csTarget == CS_INDEX) {
         ORIG_GL(glIndexMask)(GL_TRUE);
     } else {
@@ -1364,18 +1462,18 @@ static void setCopyState(copyStateTarget csTarget)
     }
 
 	/* Tests */
-    ORIG_GL(glDisable)(GL_ALPHA_TEST);
+    setCapability(GL_ALPHA_TEST, GL_FALSE);
     if (csTarget == CS_DEPTH) {
-        ORIG_GL(glEnable)(GL_DEPTH_TEST);
+        setCapability(GL_DEPTH_TEST, GL_TRUE);
         ORIG_GL(glDepthFunc)(GL_ALWAYS);
     } else {
-        ORIG_GL(glDisable)(GL_DEPTH_TEST);
+        setCapability(GL_DEPTH_TEST, GL_FALSE);
     }
-    ORIG_GL(glDisable)(GL_SCISSOR_TEST);
-    ORIG_GL(glDisable)(GL_STENCIL_TEST);
+    setCapability(GL_SCISSOR_TEST, GL_FALSE);
+    setCapability(GL_STENCIL_TEST, GL_FALSE);
     
 	/* Blending */
-    ORIG_GL(glDisable)(GL_BLEND);
+    setCapability(GL_BLEND, GL_FALSE);
 
     /* Fog */
     ORIG_GL(glDisable)(GL_FOG);
@@ -1386,11 +1484,7 @@ static void setCopyState(copyStateTarget csTarget)
     ORIG_GL(glDisable)(GL_TEXTURE_3D);
 
     /* Fragment Program */
-    if (checkGLVersionSupported(2, 0)) {
-        ORIG_GL(glUseProgram)(0);
-    } else {
-        ORIG_GL(glUseProgramObjectARB)(0);
-    }
+    setProgram(0);
 }
 
 /*
@@ -1424,7 +1518,7 @@ void clearRenderBuffer(void)
 	GLfloat clearColor[4];
 	GLfloat clearDepth;
 	GLint clearStencil;
-	GLint viewport[4];
+	const GLint *viewport;
 	GLfloat rasterPos[4];
 	GLfloat projectionMatrix[16];
 	GLfloat modelViewMatrix[16];
@@ -1440,7 +1534,7 @@ void clearRenderBuffer(void)
 	/* save state */
 	saveCopyState(&copyState);
     
-	ORIG_GL(glGetIntegerv)(GL_VIEWPORT, viewport);
+	viewport = getGLStateShadow(GLSTATE_VIEWPORT)->viewport;
 	ORIG_GL(glGetFloatv)(GL_CURRENT_RASTER_POSITION, rasterPos);
 	ORIG_GL(glGetFloatv)(GL_PROJECTION_MATRIX, projectionMatrix);
 	ORIG_GL(glGetFloatv)(GL_MODELVIEW_MATRIX, modelViewMatrix);
@@ -1521,17 +1615,13 @@ void clearRenderBuffer(void)
 		ORIG_GL(glGetFloatv)(GL_COLOR_CLEAR_VALUE, clearColor);
 		ORIG_GL(glClearColor)(*(float*)&rec->items[1], *(float*)&rec->items[2],
 		                      *(float*)&rec->items[3], *(float*)&rec->items[4]);
-		ORIG_GL(glColorMask)(rec->items[0] & DBG_CLEAR_RGB,
-		                     rec->items[0] & DBG_CLEAR_RGB,
-		                     rec->items[0] & DBG_CLEAR_RGB,
-		                     g.activeAlphaBits &&
-		                     (rec->items[0] & DBG_CLEAR_ALPHA));
-	}
-    if (rec->items[0] & DBG_CLEAR_DEPTH) {
-        ORIG_GL(glDepthMask)(GL_TRUE);
-    } else {
-        ORIG_GL(glDepthMask)(GL_FALSE);
-    }
+		setColorMask((rec->items[0] & DBG_CLEAR_RGB) != 0,
+		             (rec->items[0] & DBG_CLEAR_RGB) != 0,
+		             (rec->items[0] & DBG_CLEAR_RGB) != 0,
+		             g.activeAlphaBits &&
+		             (rec->items[0] & DBG_CLEAR_ALPHA));
+	}
+    setDepthMask((rec->items[0] & DBG_CLEAR_DEPTH) != 0);
     if (rec->items[0] & DBG_CLEAR_STENCIL) {
         ORIG_GL(glStencilMask)(GL_TRUE);
     } else {
@@ -1543,10 +1633,10 @@ void clearRenderBuffer(void)
 	/* copy color buffer content */
 	if (!(rec->items[0] & DBG_CLEAR_RGB) || !(rec->items[0] & DBG_CLEAR_ALPHA)) {
         setCopyState(CS_COLOR);
-		ORIG_GL(glColorMask)(!(rec->items[0] & DBG_CLEAR_RGB),
-		                     !(rec->items[0] & DBG_CLEAR_RGB),
-		                     !(rec->items[0] & DBG_CLEAR_RGB),
-		                     !(rec->items[0] & DBG_CLEAR_ALPHA));
+		setColorMask(!(rec->items[0] & DBG_CLEAR_RGB),
+		             !(rec->items[0] & DBG_CLEAR_RGB),
+		             !(rec->items[0] & DBG_CLEAR_RGB),
+		             !(rec->items[0] & DBG_CLEAR_ALPHA));
 		ORIG_GL(glDrawPixels)(viewport[2], viewport[3], GL_RGBA, GL_FLOAT,
 		                      g.colorBuffer);
 	}
@@ -1555,7 +1645,7 @@ void clearRenderBuffer(void)
 	if ((rec->items[0] & DBG_CLEAR_RGB) || (rec->items[0] & DBG_CLEAR_ALPHA)) {	
 		ORIG_GL(glClearColor)(clearColor[0], clearColor[1], clearColor[2],
 		                      clearColor[3]);
-		ORIG_GL(glColorMask)(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		setColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 	}
 	if (g.activeDepthBits > 0 && (rec->items[0] & DBG_CLEAR_DEPTH)) {
 		ORIG_GL(glClearDepth)(clearDepth);
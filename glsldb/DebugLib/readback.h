@@ -46,6 +46,14 @@ DBGLIBLOCAL int readBackRenderBuffer(int numComponents, int format,
                                      int *width, int *height,
                                      void **buffer);
 
+/* reduce a readback to the pixels covered in the last GL_BITMAP readback of
+ * the same size, in pixel order; numPixels is width*height if the data stays
+ * dense
+ */
+DBGLIBLOCAL int gatherCoveredPixels(void *buffer, int numComponents,
+                                    int dataFormat, int width, int height,
+                                    int *numPixels);
+
 DBGLIBLOCAL void clearRenderBuffer(void);
 
 /* FIXME CHECK AGAIN!!!
@@ -58,4 +66,12 @@ DBGLIBLOCAL int endTransformFeedback(int primitiveType, int numFloatsPerVertex,
 
 DBGLIBLOCAL int beginTransformFeedback(int primitiveType);
 
+/* record the clip space positions of numVertices vertices while debugging
+ * fragments, positions holds 4 floats per vertex
+ */
+DBGLIBLOCAL int beginPositionFeedback(int primitiveType, int numVertices);
+
+DBGLIBLOCAL int endPositionFeedback(int primitiveType, float **positions,
+                                    int *numPrimitives, int *numVertices);
+
 #endif
@@ -37,7 +37,16 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "debuglibExport.h"
 #include "streamRecorder.h"
 
-DBGLIBLOCAL void replayFunctionCall(StoredCall *f, int final);
+/* all functions that can be replayed, indexed by opcode; functions excluded
+ * by their stream hint have a NULL name
+ */
+DBGLIBLOCAL extern const ReplayFunction replayFunctions[];
+DBGLIBLOCAL extern const int replayNumFunctions;
+
+/* execute count calls of the function opcode with the given operand slots */
+DBGLIBLOCAL void replayInstruction(int opcode, int count,
+                                   const ReplaySlot *operands, char *payload,
+                                   int final);
 
 #endif
 
@@ -0,0 +1,1197 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/* Offline replay of captured streams, see utils/capture.h.
+ *
+ * The tool renders into a GLX pbuffer and calls GL through its regular entry
+ * points. With LIBGL_ALWAYS_SOFTWARE=1 Mesa's llvmpipe does the rendering, so
+ * no GPU is needed. Started from the debugger like any other program, the
+ * debug library hooks the replayed calls and all shader stepping and
+ * readback operations work on them.
+ *
+ * The calls of a stream before its draw call are replayed first. Then the
+ * state shadow and the object snapshot are applied: textures and buffers are
+ * recreated under the application's names, the program is built again from
+ * its sources and gets the captured uniform values, and client arrays point
+ * to the captured vertices. Calls that refer to programs, framebuffers or
+ * vertex array objects by name are left out, framebuffer objects are not
+ * recreated and all draw calls render into the pbuffer.
+ *
+ * Pointers stored in a stream are addresses of the captured process, so a
+ * stream that holds one is rejected. The exception is the index pointer of
+ * the draw call if an element buffer was bound or the snapshot holds the
+ * indices.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define GLX_GLXEXT_PROTOTYPES 1
+#include "../GL/gl.h"
+#include "../GL/glext.h"
+#include "../GL/glx.h"
+#include "../GL/glxext.h"
+#include "debuglibInternal.h"
+#include "replayFunction.h"
+#include "glstate.h"
+#include "../utils/capture.h"
+#include "../utils/hash.h"
+#include "../utils/pfm.h"
+#include "../utils/dbgprint.h"
+
+#define DEFAULT_SIZE 512
+
+/* slots of a draw call instruction whose pointer operand is replaced */
+#define REPLAY_MAX_DRAW_SLOTS 16
+
+static struct {
+	Display *dpy;
+	GLXPbuffer pbuffer;
+	GLXContext ctx;
+	int width;
+	int height;
+	/* function name -> entry point */
+	Hash procs;
+	/* capture function id -> replay opcode, -1 if unknown */
+	int *opcodes;
+	/* capture function id -> calls are left out, see skippedFunctions */
+	char *skip;
+	char *payload;
+	unsigned long long payloadSize;
+	/* application's program name -> ReplayProgram */
+	Hash programs;
+} g;
+
+/* a program built from snapshots; key holds the shader sources and attribute
+ * locations it was built from
+ */
+typedef struct {
+	GLuint name;
+	GLuint program;
+	char *key;
+	size_t keySize;
+} ReplayProgram;
+
+/* ISO C has no conversion between object and function pointers, the hash
+ * stores entry points through this union
+ */
+typedef union {
+	void *object;
+	void (*function)(void);
+} ProcPointer;
+
+void (*replayGetProcAddress(const char *fname))(void)
+{
+	ProcPointer proc;
+
+	proc.object = hash_find(&g.procs, (void*)fname);
+	if (!proc.object) {
+		proc.function = glXGetProcAddressARB((const GLubyte*)fname);
+		if (!proc.function) {
+			dbgPrint(DBGLVL_ERROR, "No entry point for %s\n", fname);
+			exit(1);
+		}
+		/* fname is a literal of replayFunction.c */
+		hash_insert(&g.procs, (void*)fname, proc.object);
+	}
+	return proc.function;
+}
+
+static int createContext(int width, int height)
+{
+	static const int configAttribs[] = {
+		GLX_DRAWABLE_TYPE, GLX_PBUFFER_BIT,
+		GLX_RENDER_TYPE, GLX_RGBA_BIT,
+		GLX_RED_SIZE, 8,
+		GLX_GREEN_SIZE, 8,
+		GLX_BLUE_SIZE, 8,
+		GLX_ALPHA_SIZE, 8,
+		GLX_DEPTH_SIZE, 24,
+		GLX_STENCIL_SIZE, 8,
+		None
+	};
+	int pbufferAttribs[] = {
+		GLX_PBUFFER_WIDTH, width,
+		GLX_PBUFFER_HEIGHT, height,
+		None
+	};
+	GLXFBConfig *configs;
+	int numConfigs;
+
+	if (!(g.dpy = XOpenDisplay(NULL))) {
+		dbgPrint(DBGLVL_ERROR, "Cannot open display\n");
+		return 0;
+	}
+	configs = glXChooseFBConfig(g.dpy, DefaultScreen(g.dpy), configAttribs,
+	                            &numConfigs);
+	if (!configs || numConfigs == 0) {
+		dbgPrint(DBGLVL_ERROR, "No pbuffer config available\n");
+		return 0;
+	}
+	g.pbuffer = glXCreatePbuffer(g.dpy, configs[0], pbufferAttribs);
+	g.ctx = glXCreateNewContext(g.dpy, configs[0], GLX_RGBA_TYPE, NULL, True);
+	XFree(configs);
+	if (!g.pbuffer || !g.ctx ||
+	    !glXMakeContextCurrent(g.dpy, g.pbuffer, g.pbuffer, g.ctx)) {
+		dbgPrint(DBGLVL_ERROR, "Cannot create %ix%i pbuffer context\n",
+		         width, height);
+		return 0;
+	}
+	g.width = width;
+	g.height = height;
+	dbgPrint(DBGLVL_INFO, "Replaying with %s\n", glGetString(GL_RENDERER));
+	return 1;
+}
+
+static void destroyContext(void)
+{
+	if (!g.dpy) {
+		return;
+	}
+	glXMakeContextCurrent(g.dpy, None, None, NULL);
+	if (g.ctx) {
+		glXDestroyContext(g.dpy, g.ctx);
+	}
+	if (g.pbuffer) {
+		glXDestroyPbuffer(g.dpy, g.pbuffer);
+	}
+	XCloseDisplay(g.dpy);
+}
+
+static void enableCapability(GLenum cap, GLboolean enabled)
+{
+	if (enabled) {
+		glEnable(cap);
+	} else {
+		glDisable(cap);
+	}
+}
+
+static void applyState(const CaptureStreamView *stream)
+{
+	const GLStateShadow *s = stream->state;
+
+	if (!s || stream->stateVersion != GLSTATE_SHADOW_VERSION ||
+	    stream->stateSize != sizeof(GLStateShadow)) {
+		return;
+	}
+	if (s->valid & GLSTATE_VIEWPORT) {
+		glViewport(s->viewport[0], s->viewport[1], s->viewport[2],
+		           s->viewport[3]);
+	}
+	if (s->valid & GLSTATE_COLOR_MASK) {
+		glColorMask(s->colorMask[0], s->colorMask[1], s->colorMask[2],
+		            s->colorMask[3]);
+	}
+	if (s->valid & GLSTATE_DEPTH_MASK) {
+		glDepthMask(s->depthMask);
+	}
+	if (s->valid & GLSTATE_CAPABILITIES) {
+		enableCapability(GL_ALPHA_TEST, s->alphaTest);
+		enableCapability(GL_BLEND, s->blend);
+		enableCapability(GL_DEPTH_TEST, s->depthTest);
+		enableCapability(GL_SCISSOR_TEST, s->scissorTest);
+		enableCapability(GL_STENCIL_TEST, s->stencilTest);
+	}
+}
+
+/* calls that use the application's names of programs, shaders, framebuffers
+ * and vertex array objects; the program comes from the snapshot instead, the
+ * others are not recreated. The pbuffer has a single color buffer, so draw
+ * and read buffer changes are left out as well.
+ */
+static const char *skippedFunctions[] = {
+	"glUseProgram", "glCreateProgram", "glCreateShader", "glAttach",
+	"glDetach", "glShaderSource", "glCompileShader", "glLinkProgram",
+	"glValidateProgram", "glBindAttribLocation", "glBindFragDataLocation",
+	"glProgramParameteri", "glUniform", "glBindFramebuffer",
+	"glBindRenderbuffer", "glFramebuffer", "glBindVertexArray",
+	"glDrawBuffer", "glReadBuffer", NULL
+};
+
+static int isSkippedFunction(const char *fname)
+{
+	const char **s;
+
+	for (s = skippedFunctions; *s; s++) {
+		if (!strncmp(fname, *s, strlen(*s))) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* map the function ids of the capture to our replay opcodes */
+static int mapFunctionIds(const CaptureFile *f)
+{
+	Hash names;
+	int i;
+
+	if (f->header->slotSize != sizeof(ReplaySlot)) {
+		dbgPrint(DBGLVL_ERROR, "Capture uses %i byte slots, expected %i\n",
+		         f->header->slotSize, (int)sizeof(ReplaySlot));
+		return 0;
+	}
+	if (!(g.opcodes = malloc(f->numStrings*sizeof(int))) ||
+	    !(g.skip = malloc(f->numStrings))) {
+		return 0;
+	}
+	hash_create(&names, hashString, compString, replayNumFunctions, 0);
+	for (i = 0; i < replayNumFunctions; i++) {
+		if (replayFunctions[i].fname) {
+			hash_insert(&names, (void*)replayFunctions[i].fname,
+			            (void*)&replayFunctions[i]);
+		}
+	}
+	for (i = 0; i < f->numStrings; i++) {
+		const ReplayFunction *rf = hash_find(&names,
+		                                     (void*)captureFunctionName(f, i));
+		g.opcodes[i] = rf ? rf - replayFunctions : -1;
+		g.skip[i] = isSkippedFunction(captureFunctionName(f, i));
+	}
+	hash_free(&names);
+	return 1;
+}
+
+/* replayInstruction passes payload + offset on unchecked, so every array
+ * operand has to start inside the payload and be aligned like a slot
+ */
+static int checkOperands(int opcode, int count, const ReplaySlot *operands,
+                         unsigned long long payloadSize)
+{
+	const ReplayFunction *rf = &replayFunctions[opcode];
+	int i, j;
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < rf->numArguments; j++) {
+			char kind = rf->argumentKinds[j];
+			size_t offset = operands[i*rf->numArguments + j].offset;
+			if ((kind == REPLAY_ARG_PAYLOAD ||
+			     kind == REPLAY_ARG_CONST_PAYLOAD) &&
+			    (offset > payloadSize || offset % sizeof(ReplaySlot))) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/* number of GLfloat, GLint or GLuint components of a uniform snapshot */
+static int getUniformComponents(GLenum type)
+{
+	switch (type) {
+		case GL_FLOAT_VEC2:
+		case GL_INT_VEC2:
+		case GL_BOOL_VEC2:
+		case GL_UNSIGNED_INT_VEC2_EXT:
+			return 2;
+		case GL_FLOAT_VEC3:
+		case GL_INT_VEC3:
+		case GL_BOOL_VEC3:
+		case GL_UNSIGNED_INT_VEC3_EXT:
+			return 3;
+		case GL_FLOAT_VEC4:
+		case GL_INT_VEC4:
+		case GL_BOOL_VEC4:
+		case GL_UNSIGNED_INT_VEC4_EXT:
+		case GL_FLOAT_MAT2:
+			return 4;
+		case GL_FLOAT_MAT2x3:
+		case GL_FLOAT_MAT3x2:
+			return 6;
+		case GL_FLOAT_MAT2x4:
+		case GL_FLOAT_MAT4x2:
+			return 8;
+		case GL_FLOAT_MAT3:
+			return 9;
+		case GL_FLOAT_MAT3x4:
+		case GL_FLOAT_MAT4x3:
+			return 12;
+		case GL_FLOAT_MAT4:
+			return 16;
+		default:
+			/* scalars and samplers */
+			return 1;
+	}
+}
+
+/* size of the data of an image snapshot, 0 if it is not valid */
+static unsigned long long getImageSize(const CaptureObject *o)
+{
+	unsigned long long texelSize;
+
+	if (o->size[0] <= 0 || o->size[1] <= 0 || o->size[2] <= 0 ||
+	    o->size[0] > 65536 || o->size[1] > 65536 || o->size[2] > 65536) {
+		return 0;
+	}
+	texelSize = o->dataFormat == GL_DEPTH_COMPONENT ? 1 :
+	            o->dataFormat == GL_RGBA ? 4 : 0;
+	texelSize *= o->dataType == GL_FLOAT ? 4 :
+	             o->dataType == GL_UNSIGNED_BYTE ? 1 : 0;
+	return texelSize*o->size[0]*o->size[1]*o->size[2];
+}
+
+/* the data of every object has to be in the payload, names and sources have
+ * to be terminated
+ */
+static int checkObjects(const CaptureStreamView *stream,
+                        const CaptureObject *objects, int numObjects)
+{
+	int i, haveTexture = 0;
+
+	for (i = 0; i < numObjects; i++) {
+		const CaptureObject *o = &objects[i];
+		const char *data = g.payload + o->dataOffset;
+		unsigned long long imageSize, nameSize;
+
+		if (o->dataOffset > stream->payloadSize ||
+		    o->dataSize > stream->payloadSize - o->dataOffset ||
+		    o->dataOffset % sizeof(ReplaySlot)) {
+			return 0;
+		}
+		switch (o->type) {
+			case CAPTURE_OBJECT_SHADER:
+			case CAPTURE_OBJECT_ATTRIBUTE:
+			case CAPTURE_OBJECT_UNIFORM:
+				if (!o->dataSize || !memchr(data, '\0', o->dataSize)) {
+					return 0;
+				}
+				if (o->type != CAPTURE_OBJECT_UNIFORM) {
+					break;
+				}
+				nameSize = (strlen(data) + 4) & ~3ULL;
+				if (nameSize > o->dataSize || o->dataSize - nameSize <
+				    getUniformComponents(o->target)*sizeof(GLint)) {
+					return 0;
+				}
+				break;
+			case CAPTURE_OBJECT_TEXTURE:
+				haveTexture = 1;
+				break;
+			case CAPTURE_OBJECT_IMAGE:
+				imageSize = getImageSize(o);
+				if (!haveTexture || !imageSize || o->dataSize < imageSize) {
+					return 0;
+				}
+				break;
+			case CAPTURE_OBJECT_BUFFER:
+				if (o->size[0] < 0 ||
+				    (o->dataSize && o->dataSize < (unsigned long long)o->size[0])) {
+					return 0;
+				}
+				break;
+			case CAPTURE_OBJECT_ARRAY:
+				if (o->target == 0 && !o->params[0] &&
+				    o->dataSize < 4*sizeof(GLfloat)) {
+					return 0;
+				}
+				break;
+			case CAPTURE_OBJECT_MATRIX:
+				if (o->dataSize < 16*sizeof(GLfloat)) {
+					return 0;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	return 1;
+}
+
+static const CaptureObject *findObject(const CaptureObject *objects,
+                                       int numObjects, unsigned int type,
+                                       unsigned int target,
+                                       unsigned long long pointer)
+{
+	int i;
+
+	for (i = 0; i < numObjects; i++) {
+		const CaptureObject *o = &objects[i];
+		if (o->type == type && o->target == target && o->pointer == pointer) {
+			return o;
+		}
+	}
+	return NULL;
+}
+
+/* Inline pointers are addresses of the captured process. Only the index
+ * pointer of the draw call can be used: it is a buffer offset if an element
+ * buffer is bound, or it points to indices the snapshot holds. draw gets a
+ * copy of the instruction that uses our copy of the indices.
+ */
+static int resolvePointers(const ReplayFunction *rf, const ReplaySlot *pc,
+                           const CaptureObject *objects, int numObjects,
+                           ReplaySlot *draw)
+{
+	int i;
+
+	if (pc->header.count != 1 || rf->numArguments >= REPLAY_MAX_DRAW_SLOTS ||
+	    (strncmp(rf->fname, "glDrawElements", 14) &&
+	     strncmp(rf->fname, "glDrawRangeElements", 19))) {
+		return 0;
+	}
+	memcpy(draw, pc, (1 + rf->numArguments)*sizeof(ReplaySlot));
+	for (i = 0; i < rf->numArguments; i++) {
+		const CaptureObject *o;
+		const void *pointer;
+
+		if (rf->argumentKinds[i] != REPLAY_ARG_POINTER) {
+			continue;
+		}
+		pointer = *(const void* const*)&pc[1 + i];
+		o = findObject(objects, numObjects, CAPTURE_OBJECT_BINDING,
+		               GL_ELEMENT_ARRAY_BUFFER, 0);
+		if (o && o->name) {
+			continue;
+		}
+		o = findObject(objects, numObjects, CAPTURE_OBJECT_INDICES, 0,
+		               (unsigned long long)(size_t)pointer);
+		if (!o || !o->dataSize) {
+			return 0;
+		}
+		*(const void**)&draw[1 + i] = g.payload + o->dataOffset;
+	}
+	return 1;
+}
+
+/* check the bytecode before any call of the stream is executed; returns 0 if
+ * the stream is corrupt and -1 if it cannot be replayed. *drawCode is the
+ * draw call to execute.
+ */
+static int checkStream(const CaptureFile *f, const CaptureStreamView *stream,
+                       const CaptureObject *objects, ReplaySlot *draw,
+                       const ReplaySlot **drawCode)
+{
+	const ReplaySlot *code = stream->code;
+	int i, pc = 0;
+
+	*drawCode = NULL;
+	while (pc < stream->numSlots) {
+		int id = code[pc].header.opcode;
+		int count = code[pc].header.count;
+		int opcode = id >= 0 && id < f->numStrings ? g.opcodes[id] : -1;
+		const ReplayFunction *rf;
+
+		if (opcode < 0) {
+			dbgPrint(DBGLVL_ERROR, "Cannot replay %s: unknown function\n",
+			         id >= 0 && id < f->numStrings ?
+			         captureFunctionName(f, id) : "?");
+			return 0;
+		}
+		rf = &replayFunctions[opcode];
+		if (count < 0 ||
+		    count*rf->numArguments >= stream->numSlots - pc ||
+		    !checkOperands(opcode, count, &code[pc + 1],
+		                   stream->payloadSize)) {
+			dbgPrint(DBGLVL_ERROR, "Corrupt stream in frame %llu call %llu\n",
+			         stream->frame, stream->call);
+			return 0;
+		}
+		if (pc == stream->drawSlot) {
+			*drawCode = &code[pc];
+		}
+		if (strchr(rf->argumentKinds, REPLAY_ARG_POINTER) && !g.skip[id]) {
+			if (pc != stream->drawSlot ||
+			    !resolvePointers(rf, &code[pc], objects, stream->numObjects,
+			                     draw)) {
+				dbgPrint(DBGLVL_ERROR, "Cannot replay %s in frame %llu call "
+				         "%llu: it uses a client pointer\n", rf->fname,
+				         stream->frame, stream->call);
+				return -1;
+			}
+			*drawCode = draw;
+		}
+		pc += 1 + count*rf->numArguments;
+	}
+	if (stream->drawSlot < stream->numSlots && !*drawCode) {
+		dbgPrint(DBGLVL_ERROR, "Corrupt stream in frame %llu call %llu\n",
+		         stream->frame, stream->call);
+		return 0;
+	}
+
+	/* the drawn vertices of client arrays are part of the snapshot */
+	for (i = 0; *drawCode && i < stream->numObjects; i++) {
+		const CaptureObject *o = &objects[i];
+		if (o->type == CAPTURE_OBJECT_ARRAY && o->params[0] &&
+		    !o->params[3] && !o->dataSize) {
+			dbgPrint(DBGLVL_ERROR, "Cannot replay frame %llu call %llu: "
+			         "client array without data\n", stream->frame,
+			         stream->call);
+			return -1;
+		}
+	}
+	return 1;
+}
+
+static void setUniform(GLuint program, const CaptureObject *o)
+{
+	const char *name = g.payload + o->dataOffset;
+	const void *value = name + ((strlen(name) + 4) & ~(size_t)3);
+	GLint location = ORIG_GL(glGetUniformLocation)(program, name);
+
+	if (location < 0) {
+		return;
+	}
+	switch (o->target) {
+		case GL_FLOAT:
+			ORIG_GL(glUniform1fv)(location, 1, value);
+			break;
+		case GL_FLOAT_VEC2:
+			ORIG_GL(glUniform2fv)(location, 1, value);
+			break;
+		case GL_FLOAT_VEC3:
+			ORIG_GL(glUniform3fv)(location, 1, value);
+			break;
+		case GL_FLOAT_VEC4:
+			ORIG_GL(glUniform4fv)(location, 1, value);
+			break;
+		case GL_INT_VEC2:
+		case GL_BOOL_VEC2:
+			ORIG_GL(glUniform2iv)(location, 1, value);
+			break;
+		case GL_INT_VEC3:
+		case GL_BOOL_VEC3:
+			ORIG_GL(glUniform3iv)(location, 1, value);
+			break;
+		case GL_INT_VEC4:
+		case GL_BOOL_VEC4:
+			ORIG_GL(glUniform4iv)(location, 1, value);
+			break;
+		case GL_UNSIGNED_INT:
+			ORIG_GL(glUniform1uivEXT)(location, 1, value);
+			break;
+		case GL_UNSIGNED_INT_VEC2_EXT:
+			ORIG_GL(glUniform2uivEXT)(location, 1, value);
+			break;
+		case GL_UNSIGNED_INT_VEC3_EXT:
+			ORIG_GL(glUniform3uivEXT)(location, 1, value);
+			break;
+		case GL_UNSIGNED_INT_VEC4_EXT:
+			ORIG_GL(glUniform4uivEXT)(location, 1, value);
+			break;
+		case GL_FLOAT_MAT2:
+			ORIG_GL(glUniformMatrix2fv)(location, 1, GL_FALSE, value);
+			break;
+		case GL_FLOAT_MAT3:
+			ORIG_GL(glUniformMatrix3fv)(location, 1, GL_FALSE, value);
+			break;
+		case GL_FLOAT_MAT4:
+			ORIG_GL(glUniformMatrix4fv)(location, 1, GL_FALSE, value);
+			break;
+		case GL_FLOAT_MAT2x3:
+			ORIG_GL(glUniformMatrix2x3fv)(location, 1, GL_FALSE, value);
+			break;
+		case GL_FLOAT_MAT2x4:
+			ORIG_GL(glUniformMatrix2x4fv)(location, 1, GL_FALSE, value);
+			break;
+		case GL_FLOAT_MAT3x2:
+			ORIG_GL(glUniformMatrix3x2fv)(location, 1, GL_FALSE, value);
+			break;
+		case GL_FLOAT_MAT3x4:
+			ORIG_GL(glUniformMatrix3x4fv)(location, 1, GL_FALSE, value);
+			break;
+		case GL_FLOAT_MAT4x2:
+			ORIG_GL(glUniformMatrix4x2fv)(location, 1, GL_FALSE, value);
+			break;
+		case GL_FLOAT_MAT4x3:
+			ORIG_GL(glUniformMatrix4x3fv)(location, 1, GL_FALSE, value);
+			break;
+		default:
+			/* int, bool and samplers */
+			ORIG_GL(glUniform1iv)(location, 1, value);
+			break;
+	}
+}
+
+static char *appendKey(char *key, size_t *size, const void *data, size_t n)
+{
+	char *k = realloc(key, *size + n);
+
+	if (!k) {
+		free(key);
+		return NULL;
+	}
+	memcpy(k + *size, data, n);
+	*size += n;
+	return k;
+}
+
+static GLuint buildProgram(const CaptureObject *objects, int numObjects)
+{
+	GLuint program = ORIG_GL(glCreateProgram)();
+	GLint status = GL_FALSE;
+	char log[1024];
+	int i;
+
+	for (i = 0; i < numObjects; i++) {
+		const CaptureObject *o = &objects[i];
+		const GLchar *data = g.payload + o->dataOffset;
+		if (o->type == CAPTURE_OBJECT_SHADER) {
+			GLuint shader = ORIG_GL(glCreateShader)(o->target);
+			ORIG_GL(glShaderSource)(shader, 1, &data, NULL);
+			ORIG_GL(glCompileShader)(shader);
+			ORIG_GL(glAttachShader)(program, shader);
+			/* deleted with the program */
+			ORIG_GL(glDeleteShader)(shader);
+		} else if (o->type == CAPTURE_OBJECT_ATTRIBUTE) {
+			ORIG_GL(glBindAttribLocation)(program, o->index, data);
+		}
+	}
+	ORIG_GL(glLinkProgram)(program);
+	ORIG_GL(glGetProgramiv)(program, GL_LINK_STATUS, &status);
+	if (!status) {
+		ORIG_GL(glGetProgramInfoLog)(program, sizeof(log), NULL, log);
+		dbgPrint(DBGLVL_ERROR, "Cannot link program: %s\n", log);
+		ORIG_GL(glDeleteProgram)(program);
+		return 0;
+	}
+	return program;
+}
+
+/* use the program of a snapshot with its uniform values; objects starts with
+ * the program object. Returns the number of objects that belong to it, -1 if
+ * the program cannot be built.
+ */
+static int applyProgram(const CaptureObject *objects, int numObjects)
+{
+	const CaptureObject *p = &objects[0];
+	ReplayProgram *rp;
+	char *key = NULL;
+	size_t keySize = 0;
+	int i, n;
+
+	for (n = 1; n < numObjects; n++) {
+		if (objects[n].type != CAPTURE_OBJECT_SHADER &&
+		    objects[n].type != CAPTURE_OBJECT_ATTRIBUTE &&
+		    objects[n].type != CAPTURE_OBJECT_UNIFORM) {
+			break;
+		}
+	}
+	if (!p->name) {
+		ORIG_GL(glUseProgram)(0);
+		return n;
+	}
+
+	/* the application may link new shaders into the same program */
+	for (i = 1; i < n; i++) {
+		const CaptureObject *o = &objects[i];
+		if (o->type == CAPTURE_OBJECT_UNIFORM) {
+			continue;
+		}
+		if (!(key = appendKey(key, &keySize, &o->target, sizeof(o->target))) ||
+		    !(key = appendKey(key, &keySize, &o->index, sizeof(o->index))) ||
+		    !(key = appendKey(key, &keySize, g.payload + o->dataOffset,
+		                      o->dataSize))) {
+			return -1;
+		}
+	}
+
+	rp = hash_find(&g.programs, (void*)&p->name);
+	if (rp && (rp->keySize != keySize ||
+	           (keySize && memcmp(rp->key, key, keySize)))) {
+		ORIG_GL(glDeleteProgram)(rp->program);
+		free(rp->key);
+		rp->key = NULL;
+		rp->program = 0;
+	}
+	if (!rp) {
+		if (!(rp = malloc(sizeof(ReplayProgram)))) {
+			free(key);
+			return -1;
+		}
+		rp->name = p->name;
+		rp->program = 0;
+		rp->key = NULL;
+		rp->keySize = 0;
+		hash_insert(&g.programs, &rp->name, rp);
+	}
+	if (!rp->program) {
+		rp->program = buildProgram(objects + 1, n - 1);
+		free(rp->key);
+		rp->key = key;
+		rp->keySize = keySize;
+		if (!rp->program) {
+			return -1;
+		}
+	} else {
+		free(key);
+	}
+
+	ORIG_GL(glUseProgram)(rp->program);
+	for (i = 1; i < n; i++) {
+		if (objects[i].type == CAPTURE_OBJECT_UNIFORM) {
+			setUniform(rp->program, &objects[i]);
+		}
+	}
+	return n;
+}
+
+static void applyTexture(const CaptureObject *o)
+{
+	GLenum target = o->target;
+
+	ORIG_GL(glActiveTexture)(GL_TEXTURE0);
+	glBindTexture(target, o->name);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, o->params[0]);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, o->params[1]);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, o->params[2]);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, o->params[3]);
+	/* 0 if the captured GL did not have the state */
+	if (o->params[4]) {
+		glTexParameteri(target, GL_TEXTURE_WRAP_R, o->params[4]);
+	}
+	glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, o->params[5]);
+	if (o->params[6]) {
+		glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, o->params[6]);
+	}
+	glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, o->params[7]);
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, o->params[8]);
+}
+
+/* an image of the texture applyTexture bound last */
+static void applyImage(const CaptureObject *o, GLenum textureTarget)
+{
+	const GLvoid *data = g.payload + o->dataOffset;
+
+	switch (textureTarget) {
+		case GL_TEXTURE_1D:
+			glTexImage1D(o->target, o->level, o->format, o->size[0], 0,
+			             o->dataFormat, o->dataType, data);
+			break;
+		case GL_TEXTURE_3D:
+			ORIG_GL(glTexImage3D)(o->target, o->level, o->format, o->size[0],
+			                      o->size[1], o->size[2], 0, o->dataFormat,
+			                      o->dataType, data);
+			break;
+		default:
+			glTexImage2D(o->target, o->level, o->format, o->size[0],
+			             o->size[1], 0, o->dataFormat, o->dataType, data);
+			break;
+	}
+}
+
+static void applyBuffer(const CaptureObject *o)
+{
+	ORIG_GL(glBindBuffer)(GL_ARRAY_BUFFER, o->name);
+	ORIG_GL(glBufferData)(GL_ARRAY_BUFFER, o->size[0],
+	                      o->dataSize ? g.payload + o->dataOffset : NULL,
+	                      o->params[0] ? (GLenum)o->params[0] : GL_STATIC_DRAW);
+}
+
+/* vertex arrays point to the buffer or to our copy of the client data */
+static void applyArray(const CaptureObject *o)
+{
+	const GLvoid *pointer;
+	GLsizei stride = o->params[2];
+
+	if (o->target == 0 && !o->params[0]) {
+		ORIG_GL(glVertexAttrib4fv)(o->index,
+		                           (const GLfloat*)(g.payload + o->dataOffset));
+		return;
+	}
+	ORIG_GL(glBindBuffer)(GL_ARRAY_BUFFER, o->params[3]);
+	pointer = o->params[3] ? (const GLvoid*)(size_t)o->pointer :
+	                         g.payload + o->dataOffset;
+	switch (o->target) {
+		case 0:
+			ORIG_GL(glVertexAttribPointer)(o->index, o->size[0], o->dataType,
+			                               (GLboolean)o->params[1], stride,
+			                               pointer);
+			ORIG_GL(glEnableVertexAttribArray)(o->index);
+			return;
+		case GL_VERTEX_ARRAY:
+			glVertexPointer(o->size[0], o->dataType, stride, pointer);
+			break;
+		case GL_NORMAL_ARRAY:
+			glNormalPointer(o->dataType, stride, pointer);
+			break;
+		case GL_COLOR_ARRAY:
+			glColorPointer(o->size[0], o->dataType, stride, pointer);
+			break;
+		case GL_SECONDARY_COLOR_ARRAY:
+			ORIG_GL(glSecondaryColorPointer)(o->size[0], o->dataType, stride,
+			                                 pointer);
+			break;
+		case GL_FOG_COORD_ARRAY:
+			ORIG_GL(glFogCoordPointer)(o->dataType, stride, pointer);
+			break;
+		case GL_TEXTURE_COORD_ARRAY:
+			ORIG_GL(glClientActiveTexture)(GL_TEXTURE0 + o->index);
+			glTexCoordPointer(o->size[0], o->dataType, stride, pointer);
+			break;
+		default:
+			return;
+	}
+	glEnableClientState(o->target);
+}
+
+/* arrays and texture matrices the snapshot does not mention are unused */
+static void resetObjects(void)
+{
+	GLint numUnits = 1, numAttributes = 0, i;
+
+	glGetIntegerv(GL_MAX_TEXTURE_COORDS, &numUnits);
+	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &numAttributes);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_SECONDARY_COLOR_ARRAY);
+	glDisableClientState(GL_FOG_COORD_ARRAY);
+	glMatrixMode(GL_TEXTURE);
+	for (i = 0; i < numUnits; i++) {
+		ORIG_GL(glClientActiveTexture)(GL_TEXTURE0 + i);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		ORIG_GL(glActiveTexture)(GL_TEXTURE0 + i);
+		glLoadIdentity();
+	}
+	glMatrixMode(GL_MODELVIEW);
+	for (i = 0; i < numAttributes; i++) {
+		ORIG_GL(glDisableVertexAttribArray)(i);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	ORIG_GL(glBindBuffer)(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/* recreate the objects of the snapshot under the application's names and
+ * bind them; returns 0 if the program cannot be built
+ */
+static int applyObjects(const CaptureObject *objects, int numObjects)
+{
+	GLenum textureTarget = 0;
+	int i, n;
+
+	resetObjects();
+	for (i = 0; i < numObjects; i++) {
+		const CaptureObject *o = &objects[i];
+		switch (o->type) {
+			case CAPTURE_OBJECT_PROGRAM:
+				if ((n = applyProgram(o, numObjects - i)) < 0) {
+					return 0;
+				}
+				i += n - 1;
+				break;
+			case CAPTURE_OBJECT_TEXTURE:
+				applyTexture(o);
+				textureTarget = o->target;
+				break;
+			case CAPTURE_OBJECT_IMAGE:
+				applyImage(o, textureTarget);
+				break;
+			case CAPTURE_OBJECT_BUFFER:
+				applyBuffer(o);
+				break;
+			case CAPTURE_OBJECT_ARRAY:
+				applyArray(o);
+				break;
+			case CAPTURE_OBJECT_MATRIX:
+				glMatrixMode(o->target);
+				if (o->target == GL_TEXTURE) {
+					ORIG_GL(glActiveTexture)(GL_TEXTURE0 + o->index);
+				}
+				glLoadMatrixf((const GLfloat*)(g.payload + o->dataOffset));
+				break;
+			default:
+				break;
+		}
+	}
+	glMatrixMode(GL_MODELVIEW);
+
+	/* texture and buffer bindings last, the objects above rebind them */
+	ORIG_GL(glBindBuffer)(GL_ARRAY_BUFFER, 0);
+	ORIG_GL(glBindBuffer)(GL_ELEMENT_ARRAY_BUFFER, 0);
+	for (i = 0; i < numObjects; i++) {
+		const CaptureObject *o = &objects[i];
+		if (o->type != CAPTURE_OBJECT_BINDING) {
+			continue;
+		}
+		if (o->target == GL_ARRAY_BUFFER ||
+		    o->target == GL_ELEMENT_ARRAY_BUFFER) {
+			ORIG_GL(glBindBuffer)(o->target, o->name);
+		} else {
+			ORIG_GL(glActiveTexture)(GL_TEXTURE0 + o->index);
+			glBindTexture(o->target, o->name);
+		}
+	}
+	return 1;
+}
+
+/* execute the instruction at pc unless it is skipped; returns its size */
+static int replayCall(const ReplaySlot *pc)
+{
+	int id = pc->header.opcode;
+	int opcode = g.opcodes[id];
+
+	if (!g.skip[id]) {
+		replayInstruction(opcode, pc->header.count, pc + 1, g.payload, 1);
+	}
+	return 1 + pc->header.count*replayFunctions[opcode].numArguments;
+}
+
+/* replay the calls before the draw call, set up the snapshot and draw;
+ * returns 0 if the stream is corrupt and -1 if it cannot be replayed
+ */
+static int replayStream(const CaptureFile *f, const CaptureStreamView *stream)
+{
+	const ReplaySlot *code = stream->code;
+	const ReplaySlot *drawCode;
+	const CaptureObject *objects;
+	ReplaySlot draw[REPLAY_MAX_DRAW_SLOTS];
+	int pc, result;
+
+	/* replayed calls may write to their array arguments */
+	if (stream->payloadSize > g.payloadSize) {
+		free(g.payload);
+		if (!(g.payload = malloc(stream->payloadSize))) {
+			g.payloadSize = 0;
+			return 0;
+		}
+		g.payloadSize = stream->payloadSize;
+	}
+	captureReadPayload(f, stream, g.payload);
+
+	objects = (const CaptureObject*)(g.payload + stream->objectsOffset);
+	if (stream->objectsOffset % sizeof(ReplaySlot) ||
+	    !checkObjects(stream, objects, stream->numObjects)) {
+		dbgPrint(DBGLVL_ERROR, "Corrupt objects in frame %llu call %llu\n",
+		         stream->frame, stream->call);
+		return 0;
+	}
+	if ((result = checkStream(f, stream, objects, draw, &drawCode)) <= 0) {
+		return result;
+	}
+
+	for (pc = 0; pc < stream->drawSlot; pc += replayCall(&code[pc])) {
+	}
+	if (!drawCode) {
+		return 1;
+	}
+	applyState(stream);
+	if (!applyObjects(objects, stream->numObjects)) {
+		return -1;
+	}
+	for (pc += replayCall(drawCode); pc < stream->numSlots;
+	     pc += replayCall(&code[pc])) {
+	}
+	return 1;
+}
+
+static void freePrograms(void)
+{
+	HashIterator it;
+	ReplayProgram *rp;
+
+	hash_iterator_init(&g.programs, &it);
+	while (hash_next(&g.programs, &it, NULL, (void**)&rp)) {
+		free(rp->key);
+	}
+	hash_free(&g.programs);
+}
+
+static int writeImage(const char *filename)
+{
+	PFMFile image;
+	int error;
+
+	image.width = g.width;
+	image.height = g.height;
+	image.components = 3;
+	image.scale = 1.0f;
+	if (!(image.data = malloc(3*g.width*g.height*sizeof(float)))) {
+		return 0;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, g.width, g.height, GL_RGB, GL_FLOAT, image.data);
+	error = pfmWrite(filename, &image);
+	free(image.data);
+	return error == 0;
+}
+
+static void listStreams(const CaptureFile *f)
+{
+	CaptureStreamView stream;
+	int i;
+
+	printf("frame\tcall\tcalls\tfirst function\n");
+	for (i = 0; i < f->numIndexEntries; i++) {
+		if (captureGetStream(f, i, &stream)) {
+			continue;
+		}
+		printf("%llu\t%llu\t%i\t%s\n", stream.frame, stream.call,
+		       stream.numCalls, stream.numSlots > 0 ?
+		       captureFunctionName(f, ((const ReplaySlot*)stream.code)->header.opcode) :
+		       "");
+	}
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+	        "Usage: %s [options] capture\n"
+	        "  -l           list the captured streams and exit\n"
+	        "  -f frame     replay up to this frame (default: all)\n"
+	        "  -c call      replay up to this call of the last frame\n"
+	        "  -s w h       size of the offscreen buffer\n"
+	        "  -o file.pfm  write the color buffer after the replay\n"
+	        "Set LIBGL_ALWAYS_SOFTWARE=1 to replay with llvmpipe.\n",
+	        name);
+}
+
+int main(int argc, char **argv)
+{
+	CaptureFile f;
+	CaptureStreamView stream;
+	unsigned long long lastFrame = ~0ULL, lastCall = ~0ULL;
+	const char *imageFile = NULL;
+	int list = 0, width = 0, height = 0;
+	int i, opt, error, result, numReplayed = 0, numRejected = 0, failed = 0;
+	long long frame = -1;
+
+	while ((opt = getopt(argc, argv, "lf:c:s:o:h")) != -1) {
+		switch (opt) {
+			case 'l':
+				list = 1;
+				break;
+			case 'f':
+				lastFrame = strtoull(optarg, NULL, 10);
+				break;
+			case 'c':
+				lastCall = strtoull(optarg, NULL, 10);
+				break;
+			case 's':
+				if (optind >= argc) {
+					usage(argv[0]);
+					return 1;
+				}
+				width = atoi(optarg);
+				height = atoi(argv[optind++]);
+				break;
+			case 'o':
+				imageFile = optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if ((error = captureOpen(&f, argv[optind]))) {
+		fprintf(stderr, "Cannot open %s: %s\n", argv[optind], strerror(error));
+		return 1;
+	}
+	if (list) {
+		listStreams(&f);
+		captureRelease(&f);
+		return 0;
+	}
+
+	/* default to the viewport the application used first */
+	if (width <= 0 || height <= 0) {
+		width = height = DEFAULT_SIZE;
+		if (!captureGetStream(&f, 0, &stream) && stream.state &&
+		    stream.stateSize == sizeof(GLStateShadow)) {
+			const GLStateShadow *s = stream.state;
+			if ((s->valid & GLSTATE_VIEWPORT) && s->viewport[2] > 0 &&
+			    s->viewport[3] > 0) {
+				width = s->viewport[0] + s->viewport[2];
+				height = s->viewport[1] + s->viewport[3];
+			}
+		}
+	}
+
+	hash_create(&g.procs, hashString, compString, 512, 0);
+	hash_create(&g.programs, hashInt, compInt, 16, 1);
+	if (!mapFunctionIds(&f) || !createContext(width, height)) {
+		captureRelease(&f);
+		return 1;
+	}
+
+	for (i = 0; i < f.numIndexEntries; i++) {
+		if (captureGetStream(&f, i, &stream)) {
+			failed = 1;
+			break;
+		}
+		if (stream.frame > lastFrame ||
+		    (stream.frame == lastFrame && stream.call > lastCall)) {
+			break;
+		}
+		/* keep the frame count of a debugger in sync with the capture */
+		if (frame >= 0 && (long long)stream.frame != frame) {
+			glXSwapBuffers(g.dpy, g.pbuffer);
+		}
+		frame = stream.frame;
+
+		result = replayStream(&f, &stream);
+		if (result < 0) {
+			/* rejected, the following streams may still work */
+			failed = 1;
+			numRejected++;
+			continue;
+		}
+		if (!result) {
+			failed = 1;
+			break;
+		}
+		if ((error = glGetError()) != GL_NO_ERROR) {
+			fprintf(stderr, "GL error 0x%x in frame %llu call %llu\n", error,
+			        stream.frame, stream.call);
+			failed = 1;
+		}
+		numReplayed++;
+	}
+	glFinish();
+	printf("replayed %i of %i streams, %i rejected\n", numReplayed,
+	       f.numIndexEntries, numRejected);
+
+	if (imageFile && !writeImage(imageFile)) {
+		fprintf(stderr, "Cannot write %s\n", imageFile);
+		failed = 1;
+	}
+
+	destroyContext();
+	free(g.opcodes);
+	free(g.skip);
+	free(g.payload);
+	hash_free(&g.procs);
+	freePrograms();
+	captureRelease(&f);
+	return failed;
+}
@@ -0,0 +1,515 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "debuglibInternal.h"
+#include "roiReplay.h"
+#include "readback.h"
+#include "glstate.h"
+#include "shader.h"
+#include "../glenumerants/glenumerants.h"
+#include "dbgprint.h"
+
+#ifdef _WIN32
+#include "trampolines.h"
+#endif /* _WIN32 */
+
+/* the recorded draw call the primitive subset is built from */
+typedef struct {
+	int opcode;
+	GLenum mode;
+	GLint first;
+	GLsizei count;
+	GLenum type;
+	const GLvoid *indices;
+} DrawCall;
+
+/* FIXME: not thread-safe! */
+static struct {
+	int haveOpcodes;
+	int drawArrays;
+	int drawElements;
+
+	/* subset of the last prepared draw call and region */
+	int valid;
+	DrawCall draw;
+	int roi[4];
+	GLint viewport[4];
+	/* draw everything, no useful subset could be built */
+	int replayAll;
+	GLenum mode;
+	GLuint *indices;
+	int numIndices;
+} r;
+
+static int isRegionOfInterest(const int roi[4])
+{
+	return roi && roi[2] > 0 && roi[3] > 0;
+}
+
+/* the stream must consist of exactly one glDrawArrays or glDrawElements */
+static int findDrawCall(StreamRecorder *rec, DrawCall *draw)
+{
+	const ReplaySlot *s;
+
+	if (!r.haveOpcodes) {
+		r.drawArrays = lookupReplayOpcode("glDrawArrays");
+		r.drawElements = lookupReplayOpcode("glDrawElements");
+		r.haveOpcodes = 1;
+	}
+	if (rec->numCalls != 1 || rec->codeSize < 1) {
+		return 0;
+	}
+	s = rec->code + 1;
+	draw->opcode = rec->code[0].header.opcode;
+	if (draw->opcode < 0) {
+		return 0;
+	} else if (draw->opcode == r.drawArrays) {
+		draw->mode = *(GLenum*)&s[0];
+		draw->first = *(GLint*)&s[1];
+		draw->count = *(GLsizei*)&s[2];
+		draw->type = GL_NONE;
+		draw->indices = NULL;
+	} else if (draw->opcode == r.drawElements) {
+		draw->mode = *(GLenum*)&s[0];
+		draw->first = 0;
+		draw->count = *(GLsizei*)&s[1];
+		draw->type = *(GLenum*)&s[2];
+		draw->indices = *(const GLvoid**)&s[3];
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+static int isSameDrawCall(const DrawCall *a, const DrawCall *b)
+{
+	return a->opcode == b->opcode && a->mode == b->mode &&
+	       a->first == b->first && a->count == b->count &&
+	       a->type == b->type && a->indices == b->indices;
+}
+
+/* primitive type written by transform feedback for mode, 0 for modes whose
+ * decomposition into primitives is not defined
+ */
+static GLenum getFeedbackMode(GLenum mode, int *verticesPerPrimitive)
+{
+	switch (mode) {
+		case GL_POINTS:
+			*verticesPerPrimitive = 1;
+			return GL_POINTS;
+		case GL_LINES:
+		case GL_LINE_STRIP:
+		case GL_LINE_LOOP:
+			*verticesPerPrimitive = 2;
+			return GL_LINES;
+		case GL_TRIANGLES:
+		case GL_TRIANGLE_STRIP:
+		case GL_TRIANGLE_FAN:
+			*verticesPerPrimitive = 3;
+			return GL_TRIANGLES;
+		default:
+			return 0;
+	}
+}
+
+static int getNumPrimitives(GLenum mode, int count)
+{
+	switch (mode) {
+		case GL_POINTS:
+			return count;
+		case GL_LINES:
+			return count/2;
+		case GL_LINE_STRIP:
+			return count > 1 ? count - 1 : 0;
+		case GL_LINE_LOOP:
+			return count > 1 ? count : 0;
+		case GL_TRIANGLES:
+			return count/3;
+		case GL_TRIANGLE_STRIP:
+		case GL_TRIANGLE_FAN:
+			return count > 2 ? count - 2 : 0;
+		default:
+			return 0;
+	}
+}
+
+/* vertices of primitive p in draw order; odd strip triangles swap their
+ * first two vertices to keep the winding and the provoking vertex
+ */
+static void getPrimitiveVertices(GLenum mode, int count, int p, int v[3])
+{
+	switch (mode) {
+		case GL_POINTS:
+			v[0] = p;
+			break;
+		case GL_LINES:
+			v[0] = 2*p;
+			v[1] = 2*p + 1;
+			break;
+		case GL_LINE_STRIP:
+			v[0] = p;
+			v[1] = p + 1;
+			break;
+		case GL_LINE_LOOP:
+			v[0] = p;
+			v[1] = p + 1 < count ? p + 1 : 0;
+			break;
+		case GL_TRIANGLES:
+			v[0] = 3*p;
+			v[1] = 3*p + 1;
+			v[2] = 3*p + 2;
+			break;
+		case GL_TRIANGLE_STRIP:
+			v[0] = p & 1 ? p + 1 : p;
+			v[1] = p & 1 ? p : p + 1;
+			v[2] = p + 2;
+			break;
+		case GL_TRIANGLE_FAN:
+			v[0] = 0;
+			v[1] = p + 1;
+			v[2] = p + 2;
+			break;
+	}
+}
+
+/* vertex indices of the draw call in draw order */
+static GLuint *getElements(const DrawCall *draw)
+{
+	GLuint *elements;
+	GLint elementBuffer = 0;
+	const GLvoid *indices = draw->indices;
+	void *buffer = NULL;
+	size_t size;
+	int i;
+
+	if (!(elements = malloc(draw->count*sizeof(GLuint)))) {
+		return NULL;
+	}
+	if (draw->opcode == r.drawArrays) {
+		for (i = 0; i < draw->count; i++) {
+			elements[i] = draw->first + i;
+		}
+		return elements;
+	}
+
+	switch (draw->type) {
+		case GL_UNSIGNED_BYTE:
+			size = sizeof(GLubyte);
+			break;
+		case GL_UNSIGNED_SHORT:
+			size = sizeof(GLushort);
+			break;
+		case GL_UNSIGNED_INT:
+			size = sizeof(GLuint);
+			break;
+		default:
+			free(elements);
+			return NULL;
+	}
+	/* indices is an offset into the element buffer if one is bound */
+	ORIG_GL(glGetIntegerv)(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+	if (elementBuffer) {
+		if (!(buffer = malloc(draw->count*size))) {
+			free(elements);
+			return NULL;
+		}
+		ORIG_GL(glGetBufferSubData)(GL_ELEMENT_ARRAY_BUFFER,
+		                            (GLintptr)indices, draw->count*size,
+		                            buffer);
+		if (glError()) {
+			free(buffer);
+			free(elements);
+			return NULL;
+		}
+		indices = buffer;
+	}
+	for (i = 0; i < draw->count; i++) {
+		switch (draw->type) {
+			case GL_UNSIGNED_BYTE:
+				elements[i] = ((const GLubyte*)indices)[i];
+				break;
+			case GL_UNSIGNED_SHORT:
+				elements[i] = ((const GLushort*)indices)[i];
+				break;
+			default:
+				elements[i] = ((const GLuint*)indices)[i];
+		}
+	}
+	free(buffer);
+	return elements;
+}
+
+/* primitive restart breaks the decomposition into primitives */
+static int isPrimitiveRestartEnabled(void)
+{
+	int enabled = 0;
+
+	if (checkGLVersionSupported(3, 1)) {
+		enabled = ORIG_GL(glIsEnabled)(GL_PRIMITIVE_RESTART);
+	}
+	if (!enabled && checkGLExtensionSupported("GL_NV_primitive_restart")) {
+		enabled = ORIG_GL(glIsEnabled)(GL_PRIMITIVE_RESTART_NV);
+	}
+	return enabled;
+}
+
+/* region of interest in window coordinates: x0, y0, x1, y1 */
+static void getWindowRegion(const int roi[4], const GLint viewport[4],
+                            float region[4])
+{
+	region[0] = (float)(viewport[0] + roi[0]);
+	region[1] = (float)(viewport[1] + viewport[3] - roi[1] - roi[3]);
+	region[2] = region[0] + roi[2];
+	region[3] = region[1] + roi[3];
+}
+
+/* conservative: primitives crossing the w = 0 plane are always kept */
+static int intersectsRegion(const float *positions, int numVertices,
+                            const GLint viewport[4], const float region[4],
+                            float margin)
+{
+	float min[2], max[2];
+	int i, j;
+
+	for (i = 0; i < numVertices; i++) {
+		const float *p = positions + 4*i;
+		float w[2];
+		if (p[3] <= 0.0f) {
+			return 1;
+		}
+		for (j = 0; j < 2; j++) {
+			w[j] = viewport[j] + (p[j]/p[3]*0.5f + 0.5f)*viewport[j + 2];
+			if (i == 0 || w[j] < min[j]) {
+				min[j] = w[j];
+			}
+			if (i == 0 || w[j] > max[j]) {
+				max[j] = w[j];
+			}
+		}
+	}
+	return min[0] - margin <= region[2] && max[0] + margin >= region[0] &&
+	       min[1] - margin <= region[3] && max[1] + margin >= region[1];
+}
+
+/* positions of the feedback pass -> indices of the primitives to draw */
+static int buildSubset(const DrawCall *draw, const float *positions,
+                       int numPrimitives, int verticesPerPrimitive)
+{
+	GLuint *elements;
+	float region[4], margin;
+	GLfloat size;
+	int p, k;
+
+	if (!(elements = getElements(draw))) {
+		return DBG_ERROR_MEMORY_ALLOCATION_FAILED;
+	}
+	if (!(r.indices = malloc(numPrimitives*verticesPerPrimitive*sizeof(GLuint)))) {
+		free(elements);
+		return DBG_ERROR_MEMORY_ALLOCATION_FAILED;
+	}
+
+	/* wide lines and large points reach beyond their vertices */
+	margin = 1.0f;
+	if (verticesPerPrimitive == 1) {
+		ORIG_GL(glGetFloatv)(GL_POINT_SIZE, &size);
+		margin += 0.5f*size;
+	} else if (verticesPerPrimitive == 2) {
+		ORIG_GL(glGetFloatv)(GL_LINE_WIDTH, &size);
+		margin += 0.5f*size;
+	}
+	getWindowRegion(r.roi, r.viewport, region);
+
+	r.numIndices = 0;
+	for (p = 0; p < numPrimitives; p++) {
+		const float *pos = positions + 4*verticesPerPrimitive*p;
+		int v[3];
+		if (!intersectsRegion(pos, verticesPerPrimitive, r.viewport, region,
+		                      margin)) {
+			continue;
+		}
+		getPrimitiveVertices(draw->mode, draw->count, p, v);
+		for (k = 0; k < verticesPerPrimitive; k++) {
+			r.indices[r.numIndices++] = elements[v[k]];
+		}
+	}
+	free(elements);
+	return DBG_NO_ERROR;
+}
+
+void invalidateRegionOfInterest(void)
+{
+	free(r.indices);
+	r.indices = NULL;
+	r.numIndices = 0;
+	r.valid = 0;
+}
+
+void prepareRegionOfInterest(StreamRecorder *rec, const char *vshader,
+                             const char *gshader, const int roi[4])
+{
+	DrawCall draw;
+	GLint viewport[4];
+	float *positions = NULL;
+	int verticesPerPrimitive, numPrimitives, numWritten, numVertices;
+	int error;
+
+	if (!isRegionOfInterest(roi)) {
+		return;
+	}
+	error = setSavedGLState(DBG_TARGET_FRAGMENT_SHADER);
+	if (error) {
+		/* the debug step itself will report this */
+		return;
+	}
+	memcpy(viewport, getGLStateShadow(GLSTATE_VIEWPORT)->viewport,
+	       sizeof(viewport));
+	if (!findDrawCall(rec, &draw)) {
+		/* immediate mode and other draw calls are scissored only */
+		invalidateRegionOfInterest();
+		r.valid = 1;
+		r.replayAll = 1;
+		return;
+	}
+	if (r.valid && isSameDrawCall(&r.draw, &draw) &&
+	    !memcmp(r.roi, roi, sizeof(r.roi)) &&
+	    !memcmp(r.viewport, viewport, sizeof(r.viewport))) {
+		return;
+	}
+
+	invalidateRegionOfInterest();
+	r.valid = 1;
+	r.draw = draw;
+	memcpy(r.roi, roi, sizeof(r.roi));
+	memcpy(r.viewport, viewport, sizeof(r.viewport));
+	r.replayAll = 1;
+	r.mode = getFeedbackMode(draw.mode, &verticesPerPrimitive);
+	numPrimitives = getNumPrimitives(draw.mode, draw.count);
+
+	/* feedback records geometry shader output, which cannot be mapped back
+	 * to the primitives of the draw call
+	 */
+	if (!r.mode || gshader || numPrimitives == 0 ||
+	    isPrimitiveRestartEnabled() ||
+	    (r.mode == GL_POINTS &&
+	     ORIG_GL(glIsEnabled)(GL_VERTEX_PROGRAM_POINT_SIZE))) {
+		dbgPrint(DBGLVL_INFO, "ROI: no primitive subset for %s\n",
+		         lookupEnum(draw.mode));
+		return;
+	}
+
+	/* feedback pass with the original vertex shader */
+	error = loadPositionCaptureShader(vshader);
+	if (!error) {
+		error = beginPositionFeedback(r.mode,
+		                              numPrimitives*verticesPerPrimitive);
+	}
+	if (!error) {
+		replayFunctionCalls(rec, 0);
+		error = glError();
+		if (!endPositionFeedback(r.mode, &positions, &numWritten,
+		                         &numVertices) && !error &&
+		    numWritten != numPrimitives) {
+			dbgPrint(DBGLVL_WARNING, "ROI: expected %i primitives, got %i\n",
+			         numPrimitives, numWritten);
+			error = DBG_ERROR_INVALID_OPERATION;
+		}
+	}
+	if (!error && positions) {
+		error = buildSubset(&draw, positions, numPrimitives,
+		                    verticesPerPrimitive);
+	}
+	free(positions);
+	if (error) {
+		dbgPrint(DBGLVL_WARNING, "ROI: feedback pass failed (%i), replaying "
+		         "all primitives\n", error);
+		free(r.indices);
+		r.indices = NULL;
+		r.numIndices = 0;
+		return;
+	}
+	r.replayAll = 0;
+	dbgPrint(DBGLVL_INFO, "ROI: %i of %i primitives\n",
+	         r.numIndices/verticesPerPrimitive, numPrimitives);
+}
+
+void replayRegionOfInterest(StreamRecorder *rec, const int roi[4])
+{
+	const GLStateShadow *state;
+	GLboolean scissorTest;
+	GLint scissorBox[4], box[4];
+	GLint elementBuffer = 0;
+
+	if (!isRegionOfInterest(roi) || !r.valid) {
+		replayFunctionCalls(rec, 0);
+		return;
+	}
+
+	/* primitives of the subset may cover pixels outside of the region */
+	state = getGLStateShadow(GLSTATE_CAPABILITIES | GLSTATE_SCISSOR);
+	scissorTest = state->scissorTest;
+	memcpy(scissorBox, state->scissorBox, sizeof(scissorBox));
+	box[0] = r.viewport[0] + roi[0];
+	box[1] = r.viewport[1] + r.viewport[3] - roi[1] - roi[3];
+	box[2] = box[0] + roi[2];
+	box[3] = box[1] + roi[3];
+	if (scissorTest) {
+		box[0] = box[0] > scissorBox[0] ? box[0] : scissorBox[0];
+		box[1] = box[1] > scissorBox[1] ? box[1] : scissorBox[1];
+		if (box[2] > scissorBox[0] + scissorBox[2]) {
+			box[2] = scissorBox[0] + scissorBox[2];
+		}
+		if (box[3] > scissorBox[1] + scissorBox[3]) {
+			box[3] = scissorBox[1] + scissorBox[3];
+		}
+	}
+	setCapability(GL_SCISSOR_TEST, GL_TRUE);
+	setScissor(box[0], box[1], box[2] > box[0] ? box[2] - box[0] : 0,
+	           box[3] > box[1] ? box[3] - box[1] : 0);
+
+	if (r.replayAll) {
+		replayFunctionCalls(rec, 0);
+	} else if (r.numIndices > 0) {
+		/* the subset lives in client memory */
+		ORIG_GL(glGetIntegerv)(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+		ORIG_GL(glBindBuffer)(GL_ELEMENT_ARRAY_BUFFER, 0);
+		ORIG_GL(glDrawElements)(r.mode, r.numIndices, GL_UNSIGNED_INT,
+		                        r.indices);
+		ORIG_GL(glBindBuffer)(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+	}
+
+	setScissor(scissorBox[0], scissorBox[1], scissorBox[2], scissorBox[3]);
+	setCapability(GL_SCISSOR_TEST, scissorTest);
+}
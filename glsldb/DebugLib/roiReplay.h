@@ -0,0 +1,63 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef ROI_REPLAY_H
+#define ROI_REPLAY_H
+
+#include "debuglibExport.h"
+#include "streamRecorder.h"
+
+/* Fragment debugging restricted to a region of interest of the debug image:
+ * roi holds x, y, width and height in image coordinates with the origin at
+ * the top left, a width or height of 0 means the whole image.
+ *
+ * prepareRegionOfInterest finds the primitives of the recorded draw call that
+ * may touch the region, using the clip space positions of a transform
+ * feedback pass. The result is kept until the recorded call changes, so only
+ * the first step of a draw call pays for the pass. It leaves the position
+ * capture program active, the debug shader has to be loaded afterwards.
+ */
+DBGLIBLOCAL void prepareRegionOfInterest(StreamRecorder *rec,
+                                         const char *vshader,
+                                         const char *gshader,
+                                         const int roi[4]);
+
+/* replays the recorded calls with rasterization limited to the region, only
+ * the primitives found by prepareRegionOfInterest are drawn
+ */
+DBGLIBLOCAL void replayRegionOfInterest(StreamRecorder *rec, const int roi[4]);
+
+/* drop the primitive subset, to be called whenever the recording changes */
+DBGLIBLOCAL void invalidateRegionOfInterest(void);
+
+#endif
@@ -48,7 +48,10 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "debuglibInternal.h"
 #include "../glenumerants/glenumerants.h"
 #include "shader.h"
+#include "glstate.h"
+#include "../utils/hash.h"
 #include "../utils/dbgprint.h"
+#include "../utils/timer.h"
 #include "../../GLSLCompiler/glslang/Public/ResourceLimits.h"
 
 #ifdef _WIN32
@@ -94,10 +97,29 @@ typedef struct {
 	GLint geoOutputType;
 } ShaderProgram;
 
+/* Snapshot of the uniforms of a program. The layout (names, types and
+ * locations) is valid until the program is relinked or deleted, the values
+ * until the program is marked dirty by a uniform write.
+ */
+typedef struct {
+	GLuint programHandle;
+	int dirty;
+	GLint numUniforms;
+	ActiveUniform *uniforms;
+} UniformCache;
+
 /* FIXME: not thread-safe! */
 static struct {
 	ShaderProgram storedShader;
 	GLint dbgShaderHandle;
+	/* program handle -> UniformCache */
+	Hash uniformCache;
+	/* context the cached program handles belong to */
+	const void *uniformCacheContext;
+	int haveUniformCache;
+	/* driver time of the last loadProgram in ns */
+	long long compileTime;
+	long long linkTime;
 } g = {{0, 0, NULL, 0, NULL, 0, NULL}, -1};
 
 /* TODO TODO TODO Geometry Shader!!!!!!!!!!!!!! */
@@ -869,7 +891,7 @@ static int setUniform(int haveOpenGL_2_0_GLSL, GLint progHandle, ActiveUniform *
 	}
 }
 
-static int getActiveUniforms(int haveOpenGL_2_0_GLSL, ShaderProgram *shader)
+static int readActiveUniforms(int haveOpenGL_2_0_GLSL, ShaderProgram *shader)
 {
 	GLint maxLength;
 	char *name = NULL;
@@ -1042,6 +1064,177 @@ static int getActiveUniforms(int haveOpenGL_2_0_GLSL, ShaderProgram *shader)
 	return DBG_NO_ERROR;
 }
 
+static void freeUniforms(GLint numUniforms, ActiveUniform *uniforms)
+{
+	int i;
+
+	for (i = 0; i < numUniforms; i++) {
+		free(uniforms[i].name);
+		free(uniforms[i].value);
+	}
+	free(uniforms);
+}
+
+static int copyUniforms(GLint numUniforms, const ActiveUniform *src,
+                        ActiveUniform **dst)
+{
+	int i;
+
+	if (!(*dst = (ActiveUniform*)malloc(numUniforms*sizeof(ActiveUniform)))) {
+		return DBG_ERROR_MEMORY_ALLOCATION_FAILED;
+	}
+	for (i = 0; i < numUniforms; i++) {
+		ActiveUniform *u = &(*dst)[i];
+		int valueSize = src[i].size*shaderTypeSize(src[i].type);
+		*u = src[i];
+		u->name = strdup(src[i].name);
+		u->value = malloc(valueSize);
+		if (!u->name || !u->value) {
+			free(u->name);
+			free(u->value);
+			freeUniforms(i, *dst);
+			*dst = NULL;
+			return DBG_ERROR_MEMORY_ALLOCATION_FAILED;
+		}
+		memcpy(u->value, src[i].value, valueSize);
+	}
+	return DBG_NO_ERROR;
+}
+
+static UniformCache *findUniformCache(GLuint programHandle)
+{
+	if (!g.haveUniformCache) {
+		return NULL;
+	}
+	return (UniformCache*)hash_find(&g.uniformCache, &programHandle);
+}
+
+static void freeUniformCache(UniformCache *c)
+{
+	freeUniforms(c->numUniforms, c->uniforms);
+	free(c);
+}
+
+/* re-read the values of a dirty snapshot, the layout is kept */
+static int refreshUniformCache(int haveOpenGL_2_0_GLSL, UniformCache *c)
+{
+	int i, error;
+
+	dbgPrint(DBGLVL_INFO, "REFRESH UNIFORMS: program %i\n", c->programHandle);
+	for (i = 0; i < c->numUniforms; i++) {
+		ActiveUniform *u = &c->uniforms[i];
+		free(u->value);
+		u->value = NULL;
+		error = getUniform(haveOpenGL_2_0_GLSL, c->programHandle, u);
+		if (error) {
+			u->value = NULL;
+			return error;
+		}
+	}
+	c->dirty = 0;
+	return DBG_NO_ERROR;
+}
+
+/* Fill shader->uniforms from the snapshot of its program. Only programs that
+ * were never seen or that are dirty cause GL queries.
+ */
+static int getActiveUniforms(int haveOpenGL_2_0_GLSL, ShaderProgram *shader)
+{
+	UniformCache *c = findUniformCache(shader->programHandle);
+	int error;
+
+	if (c && c->dirty) {
+		error = refreshUniformCache(haveOpenGL_2_0_GLSL, c);
+		if (error) {
+			uniformCacheInvalidate(shader->programHandle);
+			c = NULL;
+		}
+	}
+	if (!c) {
+		error = readActiveUniforms(haveOpenGL_2_0_GLSL, shader);
+		if (error) {
+			return error;
+		}
+		if (!(c = (UniformCache*)malloc(sizeof(UniformCache)))) {
+			/* the uniforms are still valid, just not cached */
+			return DBG_NO_ERROR;
+		}
+		c->programHandle = shader->programHandle;
+		c->dirty = 0;
+		c->numUniforms = shader->numUniforms;
+		if (copyUniforms(shader->numUniforms, shader->uniforms,
+		                 &c->uniforms) != DBG_NO_ERROR) {
+			free(c);
+			return DBG_NO_ERROR;
+		}
+		if (!g.haveUniformCache) {
+			hash_create(&g.uniformCache, hashInt, compInt, 16, 0);
+			g.haveUniformCache = 1;
+		}
+		hash_insert(&g.uniformCache, &c->programHandle, c);
+		return DBG_NO_ERROR;
+	}
+
+	shader->numUniforms = c->numUniforms;
+	error = copyUniforms(c->numUniforms, c->uniforms, &shader->uniforms);
+	if (error) {
+		shader->numUniforms = 0;
+	}
+	return error;
+}
+
+void uniformCacheMarkDirty(GLuint programHandle)
+{
+	UniformCache *c = findUniformCache(programHandle);
+
+	if (c) {
+		c->dirty = 1;
+	}
+}
+
+void uniformCacheMarkCurrentDirty(void)
+{
+	/* nothing cached yet, keep the uniform calls cheap */
+	if (!g.haveUniformCache || hash_count(&g.uniformCache) == 0) {
+		return;
+	}
+	uniformCacheMarkDirty(getGLStateShadow(GLSTATE_PROGRAM)->program);
+}
+
+void uniformCacheInvalidate(GLuint programHandle)
+{
+	UniformCache *c = findUniformCache(programHandle);
+
+	if (c) {
+		hash_remove(&g.uniformCache, &programHandle);
+		freeUniformCache(c);
+	}
+}
+
+void uniformCacheSetContext(const void *context)
+{
+	if (context && context != g.uniformCacheContext) {
+		cleanupUniformCache();
+		g.uniformCacheContext = context;
+	}
+}
+
+void cleanupUniformCache(void)
+{
+	HashIterator it;
+	void *c;
+
+	if (!g.haveUniformCache) {
+		return;
+	}
+	hash_iterator_init(&g.uniformCache, &it);
+	while (hash_next(&g.uniformCache, &it, NULL, &c)) {
+		freeUniformCache((UniformCache*)c);
+	}
+	hash_free(&g.uniformCache);
+	g.haveUniformCache = 0;
+}
+
 static int getActiveAttributes(int haveOpenGL_2_0_GLSL, ShaderProgram *shader)
 {
 	GLint maxLength;
@@ -1265,11 +1458,7 @@ static int getCurrentShader(ShaderProgram *shader)
 	int error;
 
 	/* get handle of currently active GLSL shader program */
-	if (haveOpenGL_2_0_GLSL) {
-		ORIG_GL(glGetIntegerv)(GL_CURRENT_PROGRAM, (GLint*)&shader->programHandle);
-	} else {
-		shader->programHandle = ORIG_GL(glGetHandleARB)(GL_PROGRAM_OBJECT_ARB);
-	}
+	shader->programHandle = getGLStateShadow(GLSTATE_PROGRAM)->program;
 	error = glError();
 	if (error) {
 		return error;
@@ -1336,6 +1525,89 @@ static void freeShaderProgram(ShaderProgram *shader)
 	shader->programHandle = 0;
 }
 
+int snapshotCurrentProgram(ObjectSnapshot *s, unsigned int *samplerUnits)
+{
+	int haveOpenGL_2_0_GLSL = checkGLVersionSupported(2, 0);
+	ShaderProgram shader;
+	CaptureObject *o;
+	int i, error;
+
+	memset(&shader, 0, sizeof(ShaderProgram));
+	*samplerUnits = 0;
+	error = getCurrentShader(&shader);
+	if (error) {
+		freeShaderProgram(&shader);
+		return error;
+	}
+
+	o = addCaptureObject(s, CAPTURE_OBJECT_PROGRAM, NULL, 0);
+	o->name = shader.programHandle;
+	for (i = 0; i < shader.numObjects; i++) {
+		ShaderObject *so = &shader.objects[i];
+		o = addCaptureObject(s, CAPTURE_OBJECT_SHADER, so->src,
+		                     strlen(so->src) + 1);
+		o->name = so->handle;
+		o->target = so->type;
+	}
+	for (i = 0; i < shader.numAttributes; i++) {
+		ActiveAttribute *a = &shader.attributes[i];
+		if (a->builtin) {
+			continue;
+		}
+		o = addCaptureObject(s, CAPTURE_OBJECT_ATTRIBUTE, a->name,
+		                     strlen(a->name) + 1);
+		o->index = a->location;
+	}
+	for (i = 0; i < shader.numUniforms; i++) {
+		ActiveUniform *u = &shader.uniforms[i];
+		int numElements = uniformNumElements(u);
+		/* the name keeps the values aligned */
+		size_t nameSize = (strlen(u->name) + 4) & ~(size_t)3;
+		GLint value[16];
+		char *data;
+
+		if (u->builtin || numElements <= 0 || numElements > 16) {
+			continue;
+		}
+		/* the cached values of bool uniforms are too small, query again */
+		if (isIntType(u->type)) {
+			if (haveOpenGL_2_0_GLSL) {
+				ORIG_GL(glGetUniformiv)(shader.programHandle, u->location,
+				                        value);
+			} else {
+				ORIG_GL(glGetUniformivARB)(shader.programHandle, u->location,
+				                           value);
+			}
+		} else if (isUIntType(u->type)) {
+			ORIG_GL(glGetUniformuivEXT)(shader.programHandle, u->location,
+			                            (GLuint*)value);
+		} else if (haveOpenGL_2_0_GLSL) {
+			ORIG_GL(glGetUniformfv)(shader.programHandle, u->location,
+			                        (GLfloat*)value);
+		} else {
+			ORIG_GL(glGetUniformfvARB)(shader.programHandle, u->location,
+			                           (GLfloat*)value);
+		}
+		if (!(data = (char*)calloc(1, nameSize + numElements*sizeof(GLint)))) {
+			dbgPrint(DBGLVL_ERROR, "Allocation failed: uniform snapshot\n");
+			freeShaderProgram(&shader);
+			return DBG_ERROR_MEMORY_ALLOCATION_FAILED;
+		}
+		strcpy(data, u->name);
+		memcpy(data + nameSize, value, numElements*sizeof(GLint));
+		o = addCaptureObject(s, CAPTURE_OBJECT_UNIFORM, data,
+		                     nameSize + numElements*sizeof(GLint));
+		o->target = u->type;
+		o->index = u->location;
+		free(data);
+		if (isSamplerType(u->type) && value[0] >= 0 && value[0] < 32) {
+			*samplerUnits |= 1u << value[0];
+		}
+	}
+	freeShaderProgram(&shader);
+	return DBG_NO_ERROR;
+}
+
 static int getShaderResources(ShaderProgram *shader, struct TBuiltInResource *resources)
 {
 	ORIG_GL(glGetIntegerv)(GL_MAX_LIGHTS, &resources->maxLights);
@@ -1616,14 +1888,9 @@ void storeActiveShader(void)
 */
 void restoreActiveShader(void)
 {
-	int haveOpenGL_2_0_GLSL = checkGLVersionSupported(2, 0);
 	int error;
 	
-	if (haveOpenGL_2_0_GLSL) {
-		ORIG_GL(glUseProgram)(g.storedShader.programHandle);
-	} else {
-		ORIG_GL(glUseProgramObjectARB)(g.storedShader.programHandle);
-	}
+	setProgram(g.storedShader.programHandle);
 	error = glError();
 	if (error) {
 		setErrorCode(error);
@@ -1693,11 +1960,13 @@ static int attachShaderObject(GLint programHandle, GLenum type, const char *src)
 	int haveOpenGL_2_0_GLSL = checkGLVersionSupported(2, 0);
 	GLint shader, status;
 	int error;
+	long long t;
 
 	dbgPrint(DBGLVL_COMPILERINFO,
 	         "ATTACH SHADER: %s\n-----------------\n%s\n--------------\n",
 	         lookupEnum(type), src);
 
+	t = getMonotonicTimeNs();
 	if (haveOpenGL_2_0_GLSL) {
 		shader = ORIG_GL(glCreateShader)(type);
 		error = glError();
@@ -1741,6 +2010,8 @@ static int attachShaderObject(GLint programHandle, GLenum type, const char *src)
 			return error;
 		}
 	}
+	/* the status query waits for drivers that compile in the background */
+	g.compileTime += getMonotonicTimeNs() - t;
 	printShaderInfoLog(shader);
 	error = glError();
 	if (error) {
@@ -1792,15 +2063,22 @@ static void freeDbgShader(void)
 	}
 }
 
-int loadDbgShader(const char* vshader, const char *gshader, const char *fshader,
-                  int target, int forcePointPrimitiveMode) 
+/* links and activates the debug program; tfbVarying names the varying that
+ * is recorded by transform feedback, if any
+ */
+static int loadProgram(const char* vshader, const char *gshader,
+                       const char *fshader, int target,
+                       int forcePointPrimitiveMode, const char *tfbVarying)
 {
 	int haveOpenGL_2_0_GLSL = checkGLVersionSupported(2, 0);
 	int haveGeometryShader =  checkGLExtensionSupported("EXT_geometry_shader4");
 	GLint status;
 	int i, error;
+	long long t;
 
 	freeDbgShader();
+	g.compileTime = 0;
+	g.linkTime = 0;
 	
 	if (haveOpenGL_2_0_GLSL) {
 		g.dbgShaderHandle = ORIG_GL(glCreateProgram)();
@@ -1919,14 +2197,11 @@ int loadDbgShader(const char* vshader, const char *gshader, const char *fshader,
 	
 	/* TODO: other state (point size, geometry shader, etc.) !!! */
 
-	/* if debug target is vertex or geometry shader, force varyings active that
-	 * are used in transform feedback
-	*/
-	if (target == DBG_TARGET_GEOMETRY_SHADER ||
-	    target == DBG_TARGET_VERTEX_SHADER) {
+	/* force varyings active that are used in transform feedback */
+	if (tfbVarying) {
 		switch (getTFBVersion()) {
 			case TFBVersion_NV:
-				ORIG_GL(glActiveVaryingNV)(g.dbgShaderHandle, "dbgResult"/*TODO*/);
+				ORIG_GL(glActiveVaryingNV)(g.dbgShaderHandle, tfbVarying);
 				error = glError();
 				if (error) {
 					freeDbgShader();
@@ -1935,7 +2210,7 @@ int loadDbgShader(const char* vshader, const char *gshader, const char *fshader,
 				break;
 			case TFBVersion_EXT:
 				{
-					const char* dbgTFBVaryings[] = {"dbgResult"};
+					const char* dbgTFBVaryings[] = {tfbVarying};
 					ORIG_GL(glTransformFeedbackVaryingsEXT)(g.dbgShaderHandle, 1, dbgTFBVaryings, GL_SEPARATE_ATTRIBS_EXT);
 					error = glError();
 					if (error) {
@@ -1951,6 +2226,7 @@ int loadDbgShader(const char* vshader, const char *gshader, const char *fshader,
 	}
 	
 	/* link debug shader */
+	t = getMonotonicTimeNs();
 	if (haveOpenGL_2_0_GLSL) {
 		ORIG_GL(glLinkProgram)(g.dbgShaderHandle);
 		ORIG_GL(glGetProgramiv)(g.dbgShaderHandle, GL_LINK_STATUS, &status);
@@ -1958,6 +2234,7 @@ int loadDbgShader(const char* vshader, const char *gshader, const char *fshader,
 		ORIG_GL(glLinkProgramARB)(g.dbgShaderHandle);
 		ORIG_GL(glGetObjectParameterivARB)(g.dbgShaderHandle, GL_OBJECT_LINK_STATUS_ARB, &status);
 	}
+	g.linkTime = getMonotonicTimeNs() - t;
 	error = glError();
 	if (error) {
 		freeDbgShader();
@@ -1971,19 +2248,17 @@ int loadDbgShader(const char* vshader, const char *gshader, const char *fshader,
 		return DBG_ERROR_DBG_SHADER_LINK_FAILED;
 	}
 	
-	/* if debug target is vertex or geometry shader, specify varyings that
-	 * are used in transform feedback
-	*/
-	if (target == DBG_TARGET_GEOMETRY_SHADER ||
-	    target == DBG_TARGET_VERTEX_SHADER) {
+	/* specify varyings that are used in transform feedback */
+	if (tfbVarying) {
 		GLint location;
 
 		switch (getTFBVersion()) {
 			case TFBVersion_NV:
 				{
-					location = ORIG_GL(glGetVaryingLocationNV)(g.dbgShaderHandle, "dbgResult"/*TODO*/);
+					location = ORIG_GL(glGetVaryingLocationNV)(g.dbgShaderHandle, tfbVarying);
 					if (location < 0) {
-						dbgPrint(DBGLVL_ERROR, "dbgResult NOT ACTIVE VARYING\n");
+						dbgPrint(DBGLVL_ERROR, "%s NOT ACTIVE VARYING\n",
+						         tfbVarying);
 						freeDbgShader();
 						return DBG_ERROR_VARYING_INACTIVE;
 					}
@@ -2006,11 +2281,7 @@ int loadDbgShader(const char* vshader, const char *gshader, const char *fshader,
 	}
 	
 	/* activate debug shader */
-	if (haveOpenGL_2_0_GLSL) {
-		ORIG_GL(glUseProgram)(g.dbgShaderHandle);
-	} else {
-		ORIG_GL(glUseProgramObjectARB)(g.dbgShaderHandle);
-	}
+	setProgram(g.dbgShaderHandle);
 	error = glError();
 	if (error) {
 		freeDbgShader();
@@ -2035,6 +2306,32 @@ int loadDbgShader(const char* vshader, const char *gshader, const char *fshader,
 	return DBG_NO_ERROR;	
 }
 
+int loadDbgShader(const char* vshader, const char *gshader, const char *fshader,
+                  int target, int forcePointPrimitiveMode) 
+{
+	const char *tfbVarying = NULL;
+
+	/* vertex and geometry results are read back by transform feedback */
+	if (target == DBG_TARGET_GEOMETRY_SHADER ||
+	    target == DBG_TARGET_VERTEX_SHADER) {
+		tfbVarying = "dbgResult"/*TODO*/;
+	}
+	return loadProgram(vshader, gshader, fshader, target,
+	                   forcePointPrimitiveMode, tfbVarying);
+}
+
+int loadPositionCaptureShader(const char *vshader)
+{
+	return loadProgram(vshader, NULL, NULL, DBG_TARGET_VERTEX_SHADER, 0,
+	                   "gl_Position");
+}
+
+void getDbgShaderLoadTime(long long *compileTime, long long *linkTime)
+{
+	*compileTime = g.compileTime;
+	*linkTime = g.linkTime;
+}
+
 /*
 	SHM IN:
 		fname    : *
@@ -35,6 +35,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define SHADER_H
 
 #include "debuglibExport.h"
+#include "frameCapture.h"
 
 DBGLIBLOCAL void getShaderCode(void);
 
@@ -48,6 +49,40 @@ DBGLIBLOCAL int loadDbgShader(const char* vshader, const char *gshader,
                               const char *fshader, int target,
                               int forcePointPrimitiveMode);
 
+/* activate vshader with its clip space positions recorded by transform
+ * feedback
+ */
+DBGLIBLOCAL int loadPositionCaptureShader(const char *vshader);
+
+/* driver time in ns spent compiling and linking by the last of the two
+ * functions above
+ */
+DBGLIBLOCAL void getDbgShaderLoadTime(long long *compileTime,
+                                      long long *linkTime);
+
 DBGLIBLOCAL int getShaderPrimitiveMode(void);
 
+/* add the current program with its shaders, attribute locations and uniform
+ * values to a capture snapshot; samplerUnits gets a bit for each texture unit
+ * a sampler uses
+ */
+DBGLIBLOCAL int snapshotCurrentProgram(ObjectSnapshot *s,
+                                       unsigned int *samplerUnits);
+
+/* Per-program uniform snapshots; the pre-execution hooks keep them up to date
+ * so that a debug step only queries programs whose uniforms changed.
+ */
+DBGLIBLOCAL void uniformCacheMarkDirty(GLuint programHandle);
+
+DBGLIBLOCAL void uniformCacheMarkCurrentDirty(void);
+
+DBGLIBLOCAL void uniformCacheInvalidate(GLuint programHandle);
+
+/* program handles are only unique per context (or share group), so the cache
+ * is dropped when a different context is made current; NULL is ignored
+ */
+DBGLIBLOCAL void uniformCacheSetContext(const void *context);
+
+DBGLIBLOCAL void cleanupUniformCache(void);
+
 #endif
@@ -35,88 +35,250 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
+#include <errno.h>
 
 #include "streamRecorder.h"
 #include "replayFunction.h"
 #include "../utils/dbgprint.h"
+#include "../utils/hash.h"
+
+/* FIXME: not thread-safe! */
+static struct {
+	/* function name -> ReplayFunction */
+	Hash opcodes;
+	int haveOpcodes;
+} g;
+
+int lookupReplayOpcode(const char *fname)
+{
+	const ReplayFunction *f;
+	int i;
+
+	if (!g.haveOpcodes) {
+		hash_create(&g.opcodes, hashString, compString, replayNumFunctions, 0);
+		for (i = 0; i < replayNumFunctions; i++) {
+			if (replayFunctions[i].fname) {
+				hash_insert(&g.opcodes, (void*)replayFunctions[i].fname,
+				            (void*)&replayFunctions[i]);
+			}
+		}
+		g.haveOpcodes = 1;
+	}
+	f = hash_find(&g.opcodes, (void*)fname);
+	if (!f) {
+		return -1;
+	}
+	return f - replayFunctions;
+}
+
+static ReplaySlot *allocSlots(StreamRecorder *rec, int n)
+{
+	ReplaySlot *slots;
+
+	if (rec->codeSize + n > rec->codeCapacity) {
+		int capacity = rec->codeCapacity ? 2*rec->codeCapacity : 1024;
+		while (capacity < rec->codeSize + n) {
+			capacity *= 2;
+		}
+		rec->code = realloc(rec->code, capacity*sizeof(ReplaySlot));
+		if (!rec->code) {
+			dbgPrint(DBGLVL_ERROR, "Allocation of recorded call failed\n");
+			exit(1); /* TODO: proper error handling */
+		}
+		rec->codeCapacity = capacity;
+	}
+	slots = &rec->code[rec->codeSize];
+	rec->codeSize += n;
+	return slots;
+}
+
+/* copy size bytes to the payload and return their offset */
+static size_t appendPayload(StreamRecorder *rec, const void *data, size_t size)
+{
+	size_t offset = rec->payloadSize;
+	/* keep every array aligned like a slot */
+	size_t alignedSize = (size + sizeof(ReplaySlot) - 1) & ~(sizeof(ReplaySlot) - 1);
+
+	if (offset + alignedSize > rec->payloadCapacity) {
+		size_t capacity = rec->payloadCapacity ? 2*rec->payloadCapacity : 4096;
+		while (capacity < offset + alignedSize) {
+			capacity *= 2;
+		}
+		rec->payload = realloc(rec->payload, capacity);
+		if (!rec->payload) {
+			dbgPrint(DBGLVL_ERROR, "Allocation of recorded call failed\n");
+			exit(1); /* TODO: proper error handling */
+		}
+		rec->payloadCapacity = capacity;
+	}
+	memcpy(rec->payload + offset, data, size);
+	memset(rec->payload + offset + size, 0, alignedSize - size);
+	rec->payloadSize += alignedSize;
+	return offset;
+}
+
+/* like appendPayload, large arrays are remembered for sharing in captures */
+static size_t appendSharedPayload(StreamRecorder *rec, const void *data,
+                                  size_t size)
+{
+	size_t offset = appendPayload(rec, data, size);
+	CapturePayloadRange *range;
+
+	if (size < REPLAY_SHARED_PAYLOAD_MIN_SIZE) {
+		return offset;
+	}
+	if (rec->numShared == rec->maxShared) {
+		int maxShared = rec->maxShared ? 2*rec->maxShared : 64;
+		range = realloc(rec->shared, maxShared*sizeof(CapturePayloadRange));
+		if (!range) {
+			dbgPrint(DBGLVL_ERROR, "Allocation of recorded call failed\n");
+			exit(1); /* TODO: proper error handling */
+		}
+		rec->shared = range;
+		rec->maxShared = maxShared;
+	}
+	range = &rec->shared[rec->numShared++];
+	range->offset = offset;
+	/* with the zeroed padding, equal arrays have equal ranges */
+	range->size = rec->payloadSize - offset;
+	return offset;
+}
 
 void initStreamRecorder(StreamRecorder *rec)
 {
 	rec->numCalls = 0;
-	rec->calls = NULL;
-	rec->lastCall = NULL;
+	rec->code = NULL;
+	rec->codeSize = 0;
+	rec->codeCapacity = 0;
+	rec->lastInstruction = -1;
+	rec->payload = NULL;
+	rec->payloadSize = 0;
+	rec->payloadCapacity = 0;
+	rec->shared = NULL;
+	rec->numShared = 0;
+	rec->maxShared = 0;
+	rec->lastFname = NULL;
+	rec->lastOpcode = -1;
 }
 
 void recordFunctionCall(StreamRecorder *rec, const char *fname, int numArgs, ...)
 {
-	int i;
 	va_list argp;
-	StoredCall *newCall;
+
+	va_start(argp, numArgs);
+	vrecordFunctionCall(rec, fname, numArgs, argp);
+	va_end(argp);
+}
+
+void vrecordFunctionCall(StreamRecorder *rec, const char *fname, int numArgs,
+                         va_list argp)
+{
+	int i, opcode;
+	const ReplayFunction *f;
+	ReplaySlot *operands;
 	
 	dbgPrint(DBGLVL_INFO, "RECORD CALL: %s\n", fname);
 
-	rec->numCalls++;
-	newCall =  malloc(sizeof(StoredCall));
-	if (!newCall) {
-		dbgPrint(DBGLVL_ERROR, "Allocation of recorded call failed\n");
-		exit(1); /* TODO: proper error handling */
+	/* hooks pass string literals, so runs of one function compare equal */
+	if (fname == rec->lastFname) {
+		opcode = rec->lastOpcode;
+	} else {
+		opcode = lookupReplayOpcode(fname);
+		rec->lastFname = fname;
+		rec->lastOpcode = opcode;
 	}
-	newCall->fname = strdup(fname);
-	newCall->numArguments = numArgs;
-	newCall->arguments = malloc(numArgs*sizeof(sizeof(void*)));
-	if (!newCall->fname || !newCall->arguments) {
-		dbgPrint(DBGLVL_ERROR, "Allocation of recorded call failed\n");
-		exit(1); /* TODO: proper error handling */
+	if (opcode < 0) {
+		dbgPrint(DBGLVL_ERROR, "Cannot replay %s: unknown function\n", fname);
+		return;
 	}
-	va_start(argp, numArgs);
+	f = &replayFunctions[opcode];
+	if (numArgs != f->numArguments) {
+		dbgPrint(DBGLVL_ERROR, "Cannot record %s: got %i arguments, "
+		         "expected %i\n", fname, numArgs, f->numArguments);
+		return;
+	}
+
+	rec->numCalls++;
+	if (rec->lastInstruction >= 0 &&
+	    rec->code[rec->lastInstruction].header.opcode == opcode) {
+		/* coalesce with the previous call, its operands end the code */
+		rec->code[rec->lastInstruction].header.count++;
+	} else {
+		ReplaySlot *header = allocSlots(rec, 1);
+		header->header.opcode = opcode;
+		header->header.count = 1;
+		rec->lastInstruction = rec->codeSize - 1;
+	}
+	operands = allocSlots(rec, numArgs);
+	
 	for (i = 0; i < numArgs; i++) {
 		void *ptr = (void*)va_arg(argp, void*);
 		int size = (int)va_arg(argp, int);
-		newCall->arguments[i] = malloc(size);
-		if (!newCall->arguments[i]) {
-			dbgPrint(DBGLVL_ERROR, "Allocation of recorded call failed\n");
+		if (f->argumentKinds[i] == REPLAY_ARG_CONST_PAYLOAD) {
+			operands[i].offset = appendSharedPayload(rec, ptr, size);
+		} else if (f->argumentKinds[i] == REPLAY_ARG_PAYLOAD) {
+			operands[i].offset = appendPayload(rec, ptr, size);
+		} else if (size <= (int)sizeof(ReplaySlot)) {
+			memcpy(&operands[i], ptr, size);
+		} else {
+			dbgPrint(DBGLVL_ERROR, "Cannot record %s: argument %i too "
+			         "large\n", fname, i);
 			exit(1); /* TODO: proper error handling */
 		}
-		memcpy(newCall->arguments[i], ptr, size);
 	}	
-	va_end(argp);
-	if (rec->calls) {
-		rec->lastCall->nextCall = newCall;
-	} else {
-		rec->calls = newCall;
-	}
-	rec->lastCall = newCall;
 }
 
 
 void replayFunctionCalls(StreamRecorder *rec, int final)
 {
-	int i;
-	StoredCall *call = rec->calls;
+	const ReplaySlot *pc = rec->code;
+	const ReplaySlot *end = rec->code + rec->codeSize;
 
-	for (i = 0; i < rec->numCalls; i++) {
-		replayFunctionCall(call, final);
-		call = call->nextCall;
+	while (pc < end) {
+		int opcode = pc->header.opcode;
+		int count = pc->header.count;
+		replayInstruction(opcode, count, pc + 1, rec->payload, final);
+		pc += 1 + count*replayFunctions[opcode].numArguments;
 	}
 }
 
 void clearRecordedCalls(StreamRecorder *rec)
 {
-	int i, j;
-	
-	StoredCall *sc =  rec->calls;
-	for (i = 0; i < rec->numCalls; i++) {
-		StoredCall *current = sc;
-		free(current->fname);
-		for (j = 0; j < current->numArguments; j++) {
-			free(current->arguments[j]);
-		}
-		free(current->arguments);
-		sc = current->nextCall;
-		free(current);
+	free(rec->code);
+	free(rec->payload);
+	free(rec->shared);
+	initStreamRecorder(rec);
+}
+
+int openStreamCapture(CaptureWriter *w, const char *filename)
+{
+	const char **names;
+	int i, error;
+
+	names = malloc(replayNumFunctions*sizeof(const char*));
+	if (!names) {
+		return ENOMEM;
 	}
-	rec->numCalls = 0;
-	rec->calls = NULL;
-	rec->lastCall = NULL;
+	for (i = 0; i < replayNumFunctions; i++) {
+		names[i] = replayFunctions[i].fname;
+	}
+	error = captureCreate(w, filename, sizeof(ReplaySlot), replayNumFunctions,
+	                      names);
+	free(names);
+	return error;
+}
+
+size_t recordPayloadData(StreamRecorder *rec, const void *data, size_t size)
+{
+	return appendSharedPayload(rec, data, size);
 }
 
+int captureRecordedCalls(StreamRecorder *rec, CaptureWriter *w,
+                         CaptureStream *head)
+{
+	head->numCalls = rec->numCalls;
+	head->numSlots = rec->codeSize;
+	head->payloadSize = rec->payloadSize;
+	return captureWriteStream(w, head, rec->code, rec->payload, rec->shared,
+	                          rec->numShared);
+}
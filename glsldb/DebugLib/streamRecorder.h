@@ -34,32 +34,99 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _STREAMRECORDER_H
 #define _STREAMRECORDER_H
 
+#include <stddef.h>
+#include <stdarg.h>
+
 #include "debuglibExport.h"
+#include "../utils/capture.h"
 
 #define DBG_RECORD_AND_REPLAY 1
 #define DBG_NO_RECORD         2
 #define DBG_RECORD_AND_FINAL  3
 
-typedef struct StoredCall_t {
-	char *fname;
+/* Recorded calls are compiled into replay bytecode while they are recorded.
+ * An instruction is a header slot followed by count*numArguments operand
+ * slots; consecutive calls of the same function are coalesced into one
+ * instruction. Scalar arguments are stored inline in their slot, arrays are
+ * copied into the payload and their slot holds the offset.
+ */
+typedef union {
+	struct {
+		int opcode;
+		int count;
+	} header;
+	size_t offset;
+	double alignDouble;
+	long long alignLongLong;
+	void *alignPointer;
+} ReplaySlot;
+
+/* argument kinds of a replayable function, see replayFunction.c */
+#define REPLAY_ARG_INLINE        's'
+#define REPLAY_ARG_PAYLOAD       'p'
+/* array the function only reads */
+#define REPLAY_ARG_CONST_PAYLOAD 'c'
+/* pointer stored inline, e.g. client indices; only valid in the recording
+ * process unless it is a buffer offset
+ */
+#define REPLAY_ARG_POINTER       'a'
+
+/* read-only arrays of at least this size are stored once per capture */
+#define REPLAY_SHARED_PAYLOAD_MIN_SIZE 256
+
+typedef struct {
+	const char *fname;
 	int numArguments;
-	void **arguments;
-	struct StoredCall_t *nextCall;
-} StoredCall;
+	const char *argumentKinds;
+} ReplayFunction;
 
 typedef struct {
 	int numCalls;
-	StoredCall *calls;
-	StoredCall *lastCall;
+	ReplaySlot *code;
+	int codeSize;
+	int codeCapacity;
+	/* slot of the last instruction header, -1 if there is none */
+	int lastInstruction;
+	char *payload;
+	size_t payloadSize;
+	size_t payloadCapacity;
+	/* read-only arrays in the payload a capture may share between streams */
+	CapturePayloadRange *shared;
+	int numShared;
+	int maxShared;
+	/* opcode of the last recorded function name, saves the lookup in runs */
+	const char *lastFname;
+	int lastOpcode;
 } StreamRecorder;
 
 DBGLIBLOCAL void initStreamRecorder(StreamRecorder *rec);
 
+/* opcode of a replayable function, -1 if it cannot be replayed */
+DBGLIBLOCAL int lookupReplayOpcode(const char *fname);
+
 DBGLIBLOCAL void recordFunctionCall(StreamRecorder *rec, const char *fname, int numArgs, ...);
 
+DBGLIBLOCAL void vrecordFunctionCall(StreamRecorder *rec, const char *fname,
+                                     int numArgs, va_list argp);
+
 DBGLIBLOCAL void replayFunctionCalls(StreamRecorder *rec, int final);
 
 DBGLIBLOCAL void clearRecordedCalls(StreamRecorder *rec);
 
+/* create a capture whose function ids are the replay opcodes */
+DBGLIBLOCAL int openStreamCapture(CaptureWriter *w, const char *filename);
+
+/* copy data that is not an argument to the payload, e.g. object contents for
+ * a capture; returns its offset
+ */
+DBGLIBLOCAL size_t recordPayloadData(StreamRecorder *rec, const void *data,
+                                     size_t size);
+
+/* append the recorded calls to a capture; head gives position, draw slot
+ * and objects, the sizes are filled in. Returns 0 or an errno value.
+ */
+DBGLIBLOCAL int captureRecordedCalls(StreamRecorder *rec, CaptureWriter *w,
+                                     CaptureStream *head);
+
 #endif
 
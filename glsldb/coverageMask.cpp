@@ -0,0 +1,165 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#include <string.h>
+
+#include "coverageMask.h"
+
+static int popCount(unsigned int v)
+{
+	v = v - ((v >> 1) & 0x55555555u);
+	v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+	v = (v + (v >> 4)) & 0x0f0f0f0fu;
+	return (int)((v * 0x01010101u) >> 24);
+}
+
+CoverageMask::CoverageMask(int width, int height, const unsigned char *bits)
+{
+	int i, n;
+
+	m_nWidth = width;
+	m_nHeight = height;
+	m_pWords = new unsigned int[numWords()];
+	memset(m_pWords, 0, numWords()*sizeof(unsigned int));
+
+	if (bits) {
+		/* assemble the words bytewise, independent of the byte order */
+		n = (width*height + 7)/8;
+		for (i = 0; i < n; i++) {
+			m_pWords[i/4] |= (unsigned int)bits[i] << (8*(i%4));
+		}
+		/* ignore padding bits past the last pixel */
+		if ((width*height) & 31) {
+			m_pWords[numWords() - 1] &= (1u << ((width*height) & 31)) - 1;
+		}
+	}
+	countCovered();
+}
+
+CoverageMask::CoverageMask(const CoverageMask &src)
+{
+	m_nWidth = src.m_nWidth;
+	m_nHeight = src.m_nHeight;
+	m_nCovered = src.m_nCovered;
+	m_pWords = new unsigned int[numWords()];
+	memcpy(m_pWords, src.m_pWords, numWords()*sizeof(unsigned int));
+}
+
+CoverageMask::~CoverageMask()
+{
+	delete[] m_pWords;
+}
+
+void CoverageMask::setCovered(int i, bool covered)
+{
+	unsigned int bit = 1u << (i & 31);
+
+	if (isCovered(i) == covered) {
+		return;
+	}
+	if (covered) {
+		m_pWords[i >> 5] |= bit;
+		m_nCovered++;
+	} else {
+		m_pWords[i >> 5] &= ~bit;
+		m_nCovered--;
+	}
+}
+
+int CoverageMask::nextCovered(int i) const
+{
+	int w, n = numWords();
+	unsigned int bits;
+
+	if (i < 0 || i >= m_nWidth*m_nHeight) {
+		return -1;
+	}
+	w = i >> 5;
+	bits = m_pWords[w] & (~0u << (i & 31));
+	/* skip uncovered areas a word at a time */
+	while (!bits) {
+		if (++w >= n) {
+			return -1;
+		}
+		bits = m_pWords[w];
+	}
+	i = w << 5;
+	while (!(bits & 1)) {
+		bits >>= 1;
+		i++;
+	}
+	return i;
+}
+
+int CoverageMask::rank(int i) const
+{
+	int w, count = 0;
+
+	for (w = 0; w < (i >> 5); w++) {
+		count += popCount(m_pWords[w]);
+	}
+	if (i & 31) {
+		count += popCount(m_pWords[w] & ((1u << (i & 31)) - 1));
+	}
+	return count;
+}
+
+bool CoverageMask::differs(const CoverageMask *mask) const
+{
+	if (!mask || mask->m_nWidth != m_nWidth || mask->m_nHeight != m_nHeight) {
+		return true;
+	}
+	return memcmp(m_pWords, mask->m_pWords,
+	              numWords()*sizeof(unsigned int)) != 0;
+}
+
+bool* CoverageMask::toBoolArray(void) const
+{
+	int i, n = m_nWidth*m_nHeight;
+	bool *coverage = new bool[n];
+
+	for (i = 0; i < n; i++) {
+		coverage[i] = isCovered(i);
+	}
+	return coverage;
+}
+
+void CoverageMask::countCovered(void)
+{
+	int i, n = numWords();
+
+	m_nCovered = 0;
+	for (i = 0; i < n; i++) {
+		m_nCovered += popCount(m_pWords[i]);
+	}
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef COVERAGE_MASK_H
+#define COVERAGE_MASK_H
+
+/* Fragment coverage as one bit per pixel, in the layout of a GL_BITMAP
+ * readback: rows without padding, least significant bit first.
+ */
+class CoverageMask
+{
+public:
+	CoverageMask(int width, int height, const unsigned char *bits = 0);
+	CoverageMask(const CoverageMask &src);
+	~CoverageMask();
+
+	int getWidth(void) const  { return m_nWidth; }
+	int getHeight(void) const { return m_nHeight; }
+
+	bool isCovered(int i) const
+	{
+		return (m_pWords[i >> 5] >> (i & 31)) & 1;
+	}
+	bool isCovered(int x, int y) const { return isCovered(y*m_nWidth + x); }
+
+	void setCovered(int i, bool covered);
+
+	/* number of covered pixels, counted when the mask changes */
+	int getNumCovered(void) const { return m_nCovered; }
+
+	/* first covered pixel at or after i, -1 if there is none */
+	int nextCovered(int i) const;
+
+	/* number of covered pixels before i, i.e. the position of pixel i in
+	 * data that holds covered pixels only
+	 */
+	int rank(int i) const;
+
+	/* true if the pixels covered differ from those of mask */
+	bool differs(const CoverageMask *mask) const;
+
+	/* expanded copy for code working on bool maps; use delete[] */
+	bool* toBoolArray(void) const;
+
+private:
+	CoverageMask &operator=(const CoverageMask &);
+
+	int numWords(void) const { return (m_nWidth*m_nHeight + 31)/32; }
+	void countCovered(void);
+
+	int m_nWidth;
+	int m_nHeight;
+	int m_nCovered;
+	unsigned int *m_pWords;
+};
+
+#endif
@@ -70,6 +70,11 @@ enum DBG_RETURNS {
 	/*
 		Returned when a new call is reached and the command loop has been
 		entered.
+		numItems : number of arguments n
+		items[2*i]   : address of argument i
+		items[2*i+1] : DBG_TYPE of argument i
+		items[DBG_ARG_VALUE_ITEM(n, i)] : value of argument i at the call,
+		           so that the caller needs no copy from the process
 	*/
 	
 	DBG_ERROR_CODE,
@@ -349,6 +354,19 @@ enum DBG_OPERATIONS {
 			items[3] : debug target, see DBG_TARGETS below
 			if target == DBG_TARGET_FRAGMENT_SHADER:
 				items[4] : number of components to read (1:R, 3:RGB, 4:RGBA)
+				items[5] : data type to read: GL_FLOAT, GL_HALF_FLOAT_ARB,
+				           GL_INT, GL_UNSIGNED_INT, GL_UNSIGNED_BYTE for
+				           values in [0, 255] such as booleans, or GL_BITMAP
+				           for one bit per pixel (1 component only), rows
+				           packed without padding, least significant bit
+				           first
+				items[6] : if nonzero, return only the pixels covered in the
+				           last GL_BITMAP readback of the same size
+				items[7..10] : region of interest x, y, width, height with
+				           the origin at the top left of the image; pixels
+				           outside are not drawn and only primitives that
+				           may touch it are replayed; a width or height of
+				           0 selects the whole image
 			if target == DBG_TARGET_VERTEX_SHADER or DBG_TARGET_GEOMETRY_SHADER:
 				items[4] : primitive mode
 				items[5] : force primitive mode even for geometry shader target
@@ -360,12 +378,16 @@ enum DBG_OPERATIONS {
 				items[0] : buffer address
 				items[1] : image width
 				items[2] : image height
+				items[3] : number of pixels in the buffer; less than
+				           width*height if only covered pixels are returned
 			if target == DBG_TARGET_VERTEX_SHADER or DBG_TARGET_GEOMETRY_SHADER:
 				result   : DBG_READBACK_RESULT_VERTEX_DATA or DBG_ERROR_CODE on
 				           error
 				items[0] : buffer address
 				items[1] : number of vertices
 				items[2] : number of primitives
+			for all targets:
+				items[DBG_STEP_TIMING_ITEM...] : DbgStepTiming of this step
 	*/
 
 	DBG_SAVE_AND_INTERRUPT_QUERIES,
@@ -432,7 +454,18 @@ enum DBG_EXECUTE_MODES {
 	DBG_EXECUTE_RUN,
 	DBG_JUMP_TO_SHADER_SWITCH,
 	DBG_JUMP_TO_DRAW_CALL,
-	DBG_JUMP_TO_USER_DEFINED
+	DBG_JUMP_TO_USER_DEFINED,
+	DBG_JUMP_TO_BREAKPOINT
+};
+
+enum DBG_BREAKPOINT_OPS {
+	DBG_BP_EQUAL,
+	DBG_BP_NOT_EQUAL,
+	DBG_BP_LESS,
+	DBG_BP_LESS_EQUAL,
+	DBG_BP_GREATER,
+	DBG_BP_GREATER_EQUAL,
+	DBG_BP_MASK              /* (argument & value) != 0 */
 };
 
 enum DBG_PFT_OPTIONS {
@@ -457,6 +490,14 @@ typedef intptr_t ALIGNED_DATA;
 #endif /* _WIN32 */
 
 
+/* argument values of a DBG_FUNCTION_CALL follow the address and type pairs,
+   each in DBG_ARG_VALUE_NUM_ITEMS items, enough for the scalar DBG_TYPEs
+*/
+#define DBG_ARG_VALUE_NUM_ITEMS \
+	((sizeof(double) + sizeof(ALIGNED_DATA) - 1)/sizeof(ALIGNED_DATA))
+#define DBG_ARG_VALUE_ITEM(numArgs, i) \
+	(2*(numArgs) + (i)*DBG_ARG_VALUE_NUM_ITEMS)
+
 typedef struct {
 	ALIGNED_DATA threadId;
 	ALIGNED_DATA operation;
@@ -469,6 +510,125 @@ typedef struct {
 #endif /* _WIN32 */
 } DbgRec;
 
+/*
+	Where the debuggee spent the time of a DBG_SHADER_STEP, measured with a
+	monotonic clock and returned in the items of the result from
+	DBG_STEP_TIMING_ITEM on.
+*/
+enum DBG_STEP_PHASES {
+	DBG_STEP_PHASE_REGION,       /* region of interest pre-pass */
+	DBG_STEP_PHASE_COMPILE,      /* driver compile of the debug shaders */
+	DBG_STEP_PHASE_LINK,         /* driver link of the debug program */
+	DBG_STEP_PHASE_PROGRAM,      /* rest of loading, e.g. copying uniforms */
+	DBG_STEP_PHASE_STATE,        /* restoring the saved GL state */
+	DBG_STEP_PHASE_REPLAY,       /* replay of the recorded draw call */
+	DBG_STEP_PHASE_READBACK,     /* reading back and packing the result */
+	DBG_STEP_NUM_PHASES
+};
+
+typedef struct {
+	ALIGNED_DATA phaseTime[DBG_STEP_NUM_PHASES];  /* ns */
+	ALIGNED_DATA sourceSize[3];  /* bytes of the vertex, geometry, fragment
+	                                shader received, 0 if none */
+} DbgStepTiming;
+
+#define DBG_STEP_TIMING_ITEM 8
+#define DBG_STEP_TIMING_NUM_ITEMS (sizeof(DbgStepTiming)/sizeof(ALIGNED_DATA))
+
+/*
+	Breakpoint predicates evaluated by the debuggee itself while executing
+	with DBG_JUMP_TO_BREAKPOINT. The table lives behind the DbgRec array in
+	the shared memory segment, see SHM_BREAKPOINTS_OFFSET.
+*/
+#define DBG_MAX_BREAKPOINTS 16
+#define DBG_MAX_BREAKPOINT_CONDITIONS 4
+
+/* argument index of a condition that compares the bound GLSL program */
+#define DBG_BP_ARG_PROGRAM -1
+
+typedef struct {
+	ALIGNED_DATA argument;       /* index of the argument or DBG_BP_ARG_PROGRAM */
+	ALIGNED_DATA op;             /* one of DBG_BREAKPOINT_OPS */
+	ALIGNED_DATA value;          /* value integer arguments are compared to */
+	double fvalue;               /* value float and double arguments are
+	                                compared to */
+} DbgBreakpointCondition;
+
+typedef struct {
+	ALIGNED_DATA enabled;
+	ALIGNED_DATA function;       /* index into glFunctions, -1 for any call */
+	ALIGNED_DATA numConditions;
+	DbgBreakpointCondition conditions[DBG_MAX_BREAKPOINT_CONDITIONS];
+	ALIGNED_DATA hitCount;       /* stop at the n-th match, 0 or 1 stop at first */
+	ALIGNED_DATA firstFrame;     /* frame window, -1 for no limit */
+	ALIGNED_DATA lastFrame;
+	ALIGNED_DATA hits;           /* matches so far, maintained by the debuggee */
+} DbgBreakpoint;
+
+typedef struct {
+	ALIGNED_DATA numBreakpoints;
+	DbgBreakpoint breakpoints[DBG_MAX_BREAKPOINTS];
+	ALIGNED_DATA frame;          /* current frame, maintained by the debuggee */
+	ALIGNED_DATA hitBreakpoint;  /* breakpoint causing the last stop or -1 */
+} DbgBreakpointTable;
+
+/*
+	Per-function statistics of all calls executed without trace, i.e. during
+	DBG_EXECUTE. Counters are indexed like glFunctions and written by the
+	debuggee without synchronization; the debugger may poll them any time.
+*/
+#define DBG_MAX_PROFILED_FUNCTIONS 4096
+#define DBG_CALL_TIME_BUCKETS 32
+
+enum DBG_CALL_STATISTICS_MODES {
+	DBG_CALL_STATISTICS_OFF,
+	DBG_CALL_STATISTICS_COUNT,
+	DBG_CALL_STATISTICS_TIME      /* count and measure CPU time */
+};
+
+typedef struct {
+	ALIGNED_DATA calls;
+	ALIGNED_DATA totalTime;      /* ns spent in the original function */
+	/* histogram[i]: number of calls that took [2^i, 2^(i+1)) ns */
+	ALIGNED_DATA histogram[DBG_CALL_TIME_BUCKETS];
+} DbgCallCounter;
+
+typedef struct {
+	ALIGNED_DATA mode;           /* one of DBG_CALL_STATISTICS_MODES */
+	DbgCallCounter counters[DBG_MAX_PROFILED_FUNCTIONS];
+} DbgCallStatisticsTable;
+
+/*
+	GPU time of debuggable draw calls executed without trace, measured with
+	GL_TIME_ELAPSED queries. Results are resolved asynchronously and appended
+	to a ring buffer: entry i is timings[i % DBG_MAX_DRAW_TIMINGS] and valid
+	for i < numWritten.
+*/
+#define DBG_MAX_DRAW_TIMINGS 4096
+
+typedef struct {
+	ALIGNED_DATA frame;
+	ALIGNED_DATA call;           /* index of the call within its frame */
+	ALIGNED_DATA function;       /* index into glFunctions */
+	ALIGNED_DATA program;        /* GLSL program bound at the draw call */
+	ALIGNED_DATA gpuTime;        /* ns */
+} DbgDrawTiming;
+
+typedef struct {
+	ALIGNED_DATA enabled;
+	ALIGNED_DATA numWritten;
+	ALIGNED_DATA numSkipped;     /* draws not timed, e.g. query pool exhausted */
+	DbgDrawTiming timings[DBG_MAX_DRAW_TIMINGS];
+} DbgDrawTimingTable;
+
+#define SHM_BREAKPOINTS_OFFSET SHM_SIZE
+#define SHM_CALL_STATISTICS_OFFSET \
+	(SHM_BREAKPOINTS_OFFSET + sizeof(DbgBreakpointTable))
+#define SHM_DRAW_TIMINGS_OFFSET \
+	(SHM_CALL_STATISTICS_OFFSET + sizeof(DbgCallStatisticsTable))
+#define SHM_TOTAL_SIZE \
+	(SHM_DRAW_TIMINGS_OFFSET + sizeof(DbgDrawTimingTable))
+
 typedef struct {
 	const char *prefix;
 	const char *extname;
@@ -48,6 +48,7 @@ bool isErrorCritical(pcErrorCode error)
 		case PCE_GL_INVALID_FRAMEBUFFER_OPERATION_EXT:
 		/* other non-critical errors */
 		case PCE_DBG_READBACK_NOT_ALLOWED:
+		case PCE_CANCELLED:
             return false;
         default:
             return true;
@@ -88,6 +89,8 @@ const char* getErrorDescription(pcErrorCode error)
             return "Internal debugger error";
 		case PCE_MEMORY_ALLOCATION_FAILED:
 			return "Memory allocation failed";
+		case PCE_CANCELLED:
+			return "Cancelled by the user";
 		/* debuglib errors */
 		case PCE_DBG_NO_ACTIVE_SHADER:
 		case PCE_DBG_NO_SUCH_DBG_FUNC:
@@ -138,6 +141,8 @@ const char* getErrorInfo(pcErrorCode error)
             return "CHILD_EXIT";
         case PCE_UNKNOWN_ERROR:
             return "PROGRAM_ERROR";
+		case PCE_CANCELLED:
+			return "CANCELLED";
 		/* debuglib errors */
 		case PCE_MEMORY_ALLOCATION_FAILED:
 		case PCE_DBG_NO_ACTIVE_SHADER:
@@ -43,6 +43,7 @@ typedef enum {
     PCE_EXIT,
 	PCE_UNKNOWN_ERROR,
 	PCE_MEMORY_ALLOCATION_FAILED,
+	PCE_CANCELLED,
 
 	/* debuglib errors */
 	PCE_DBG_NO_ACTIVE_SHADER,
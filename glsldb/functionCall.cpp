@@ -49,14 +49,57 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 extern "C" {
 #include "glenumerants/glenumerants.h"
+#include "utils/hash.h"
 }
 
 extern "C" GLFunctionList glFunctions[];
 
+enum {
+	FUNC_PREFIX_OTHER,
+	FUNC_PREFIX_GL,
+	FUNC_PREFIX_GLX,
+	FUNC_PREFIX_WGL
+};
+
+/* glFunctions indexed by name and the prefix of each as FUNC_PREFIX_*,
+ * built on first use
+ */
+static Hash functionIds;
+static unsigned char *functionPrefixes = NULL;
+
+static int lookupFunctionId(const char *name)
+{
+	if (!functionPrefixes) {
+		int i, n = 0;
+		while (glFunctions[n].fname != NULL) {
+			n++;
+		}
+		functionPrefixes = (unsigned char*)malloc(n);
+		hash_create(&functionIds, hashString, compString, n, 0);
+		for (i = 0; i < n; i++) {
+			const char *prefix = glFunctions[i].prefix;
+			/* store i + 1, NULL means not found */
+			hash_insert(&functionIds, (void*)glFunctions[i].fname,
+			            (void*)(size_t)(i + 1));
+			if (!strcmp(prefix, "GL")) {
+				functionPrefixes[i] = FUNC_PREFIX_GL;
+			} else if (!strcmp(prefix, "GLX")) {
+				functionPrefixes[i] = FUNC_PREFIX_GLX;
+			} else if (!strcmp(prefix, "WGL")) {
+				functionPrefixes[i] = FUNC_PREFIX_WGL;
+			} else {
+				functionPrefixes[i] = FUNC_PREFIX_OTHER;
+			}
+		}
+	}
+	return (int)(size_t)hash_find(&functionIds, (void*)name) - 1;
+}
+
 
 FunctionCall::FunctionCall()
 {
     m_pName = NULL;
+    m_iFunction = -1;
     m_iNumArgs = 0;
     m_pArguments = NULL;
 }
@@ -64,7 +107,12 @@ FunctionCall::FunctionCall()
 FunctionCall::FunctionCall(const FunctionCall *copyOf)
 {
     int i;
-    m_pName = strdup(copyOf->getName());
+    m_iFunction = copyOf->getFunctionId();
+    if (m_iFunction >= 0) {
+        m_pName = glFunctions[m_iFunction].fname;
+    } else {
+        m_pName = strdup(copyOf->getName());
+    }
     m_iNumArgs = 0;
     m_pArguments = NULL;
     for (i=0; i<copyOf->getNumArguments(); i++) {
@@ -81,7 +129,9 @@ FunctionCall::~FunctionCall()
         free(m_pArguments[i].pData);
     }
     free(m_pArguments);
-    free(m_pName);
+    if (m_iFunction < 0) {
+        free((void*)m_pName);
+    }
 }
 
 const char* FunctionCall::getName(void) const
@@ -91,22 +141,28 @@ const char* FunctionCall::getName(void) const
 
 void FunctionCall::setName(const char *i_pName)
 {
-    if (m_pName) {
-        free(m_pName);
+    if (m_iFunction < 0) {
+        free((void*)m_pName);
+    }
+    m_iFunction = lookupFunctionId(i_pName);
+    if (m_iFunction >= 0) {
+        m_pName = glFunctions[m_iFunction].fname;
+    } else {
+        m_pName = strdup(i_pName);
     }
-    m_pName = strdup(i_pName);
 }
 
 const char* FunctionCall::getExtension(void) const
 {
-    int i = 0;
-    while (glFunctions[i].fname != NULL) {
-        if (!strcmp(m_pName, glFunctions[i].fname)) {
-            return glFunctions[i].extname;
-        }
-        i++;
+    if (m_iFunction < 0) {
+        return NULL;
     }
-    return NULL;
+    return glFunctions[m_iFunction].extname;
+}
+
+int FunctionCall::getFunctionId(void) const
+{
+    return m_iFunction;
 }
 
 int FunctionCall::getNumArguments(void) const
@@ -233,7 +289,11 @@ bool FunctionCall::operator==(const FunctionCall &right)
 {
     int i;
     
-    if (strcmp(m_pName, right.getName()) != 0) {
+    if (m_iFunction >= 0 || right.getFunctionId() >= 0) {
+        if (m_iFunction != right.getFunctionId()) {
+            return false;
+        }
+    } else if (strcmp(m_pName, right.getName()) != 0) {
         return false;
     }
     if (m_iNumArgs != right.getNumArguments()) {
@@ -443,37 +503,17 @@ bool FunctionCall::isDebuggable(int *primitiveMode) const
 
 bool FunctionCall::isDebuggableDrawCall(void) const
 {
-    int i = 0;
-    while (glFunctions[i].fname != NULL) {
-        if (!strcmp(m_pName, glFunctions[i].fname)) {
-            if (glFunctions[i].isDebuggableDrawCall) {
-                return true;
-            } else {
-                return false;
-            }
-        }
-        i++;
-    }
-    return false;
+    return m_iFunction >= 0 && glFunctions[m_iFunction].isDebuggableDrawCall;
 }
 
 bool FunctionCall::isDebuggableDrawCall(int *primitiveMode) const
 {
-    int i = 0;
-    while (glFunctions[i].fname != NULL) {
-        if (!strcmp(m_pName, glFunctions[i].fname)) {
-            if (glFunctions[i].isDebuggableDrawCall) {
-				int idx = glFunctions[i].primitiveModeIndex;
-				*primitiveMode = *(GLenum*)m_pArguments[idx].pData;
-                return true;
-            } else {
-				*primitiveMode = GL_NONE;
-                return false;
-            }
-        }
-        i++;
+    if (isDebuggableDrawCall()) {
+        int idx = glFunctions[m_iFunction].primitiveModeIndex;
+        *primitiveMode = *(GLenum*)m_pArguments[idx].pData;
+        return true;
     }
-	*primitiveMode = GL_NONE;
+    *primitiveMode = GL_NONE;
     return false;
 }
 
@@ -484,98 +524,30 @@ bool FunctionCall::isEditable(void) const
 
 bool FunctionCall::isShaderSwitch(void) const
 {
-    int i = 0;
-    while (glFunctions[i].fname != NULL) {
-        if (!strcmp(m_pName, glFunctions[i].fname)) {
-            if (glFunctions[i].isShaderSwitch) {
-                return true;
-            } else {
-                return false;
-            }
-        }
-        i++;
-    }
-    return false;
+    return m_iFunction >= 0 && glFunctions[m_iFunction].isShaderSwitch;
 }
 
 bool FunctionCall::isGlFunc(void) const
 {
-    int i = 0;
-    while (glFunctions[i].fname != NULL) {
-        if (!strcmp(m_pName, glFunctions[i].fname)) {
-            if (!strcmp("GL", glFunctions[i].prefix)) {
-                return true;
-            } else {
-                return false;
-            }
-        }
-        i++;
-    }
-    return false;
+    return m_iFunction >= 0 && functionPrefixes[m_iFunction] == FUNC_PREFIX_GL;
 }
 
-
 bool FunctionCall::isGlxFunc(void) const
 {
-    int i = 0;
-    while (glFunctions[i].fname != NULL) {
-        if (!strcmp(m_pName, glFunctions[i].fname)) {
-            if (!strcmp("GLX", glFunctions[i].prefix)) {
-                return true;
-            } else {
-                return false;
-            }
-        }
-        i++;
-    }
-    return false;
+    return m_iFunction >= 0 && functionPrefixes[m_iFunction] == FUNC_PREFIX_GLX;
 }
 
 bool FunctionCall::isWglFunc(void) const
 {
-    int i = 0;
-    while (glFunctions[i].fname != NULL) {
-        if (!strcmp(m_pName, glFunctions[i].fname)) {
-            if (!strcmp("WGL", glFunctions[i].prefix)) {
-                return true;
-            } else {
-                return false;
-            }
-        }
-        i++;
-    }
-    return false;
+    return m_iFunction >= 0 && functionPrefixes[m_iFunction] == FUNC_PREFIX_WGL;
 }
 
 bool FunctionCall::isFrameEnd(void) const
 {
-    int i = 0;
-    while (glFunctions[i].fname != NULL) {
-        if (!strcmp(m_pName, glFunctions[i].fname)) {
-            if (glFunctions[i].isFrameEnd) {
-                return true;
-            } else {
-                return false;
-            }
-        }
-        i++;
-    }
-    return false;
+    return m_iFunction >= 0 && glFunctions[m_iFunction].isFrameEnd;
 }
 
 bool FunctionCall::isFramebufferChange(void) const
 {
-    int i = 0;
-    while (glFunctions[i].fname != NULL) {
-        if (!strcmp(m_pName, glFunctions[i].fname)) {
-            if (glFunctions[i].isFramebufferChange) {
-                return true;
-            } else {
-                return false;
-            }
-        }
-        i++;
-    }
-    return false;
+    return m_iFunction >= 0 && glFunctions[m_iFunction].isFramebufferChange;
 }
-
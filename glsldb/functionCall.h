@@ -50,6 +50,11 @@ public:
     void setName(const char*);
 
     const char* getExtension(void) const;
+
+    /* index of the function in glFunctions, resolved once by setName; -1 if
+     * the name is not known
+     */
+    int getFunctionId(void) const;
     
     int getNumArguments(void) const;
     const Argument* getArgument(int) const;
@@ -77,8 +82,9 @@ private:
     char* getArgumentString(Argument arg) const;
     void* copyArgument(int type, void *addr);
 
-    char     *m_pName;
-    char     *m_pExtension;
+    /* names of known functions are shared with glFunctions */
+    const char *m_pName;
+    int       m_iFunction;
     int       m_iNumArgs;
     Argument *m_pArguments;
 
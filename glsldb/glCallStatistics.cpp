@@ -35,15 +35,144 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "textPercentDelegate.qt.h"
 
 #include <QtCore/QAbstractItemModel>
+#include <QtCore/QTimer>
 #include <QtGui/QHeaderView>
-#include <QtCore/QList>
+
+#define REFRESH_INTERVAL 200
+
+GlCallStatisticsModel::GlCallStatisticsModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    m_nNumCalls = 0;
+    m_nVisibleRows = 0;
+    m_pRefreshTimer = new QTimer(this);
+    m_pRefreshTimer->setSingleShot(true);
+    m_pRefreshTimer->setInterval(REFRESH_INTERVAL);
+    connect(m_pRefreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+}
+
+void GlCallStatisticsModel::clear(void)
+{
+    m_pRefreshTimer->stop();
+    m_entries.clear();
+    m_rows.clear();
+    m_rowsByName.clear();
+    m_nNumCalls = 0;
+    m_nVisibleRows = 0;
+    reset();
+}
+
+void GlCallStatisticsModel::addCalls(const char *i_pName, int i_nCount,
+                                     const QString &i_qToolTip)
+{
+    QHash<const char*, int>::const_iterator it = m_rows.constFind(i_pName);
+    int row;
+
+    if (it == m_rows.constEnd()) {
+        /* equal strings need not share an address, e.g. extension names */
+        QString name(i_pName);
+        QHash<QString, int>::const_iterator n = m_rowsByName.constFind(name);
+        if (n == m_rowsByName.constEnd()) {
+            Entry e;
+            e.name = name;
+            e.count = 0;
+            row = m_entries.size();
+            m_entries.append(e);
+            m_rowsByName.insert(name, row);
+        } else {
+            row = n.value();
+        }
+        m_rows.insert(i_pName, row);
+    } else {
+        row = it.value();
+    }
+    m_entries[row].count += i_nCount;
+    if (!i_qToolTip.isEmpty()) {
+        m_entries[row].toolTip = i_qToolTip;
+    }
+    m_nNumCalls += i_nCount;
+
+    if (!m_pRefreshTimer->isActive()) {
+        m_pRefreshTimer->start();
+    }
+}
+
+void GlCallStatisticsModel::refresh(void)
+{
+    /* every percentage changes with the total, so refresh all rows */
+    if (m_nVisibleRows > 0) {
+        emit dataChanged(index(0, 0), index(m_nVisibleRows - 1, 1));
+    }
+    if (m_nVisibleRows < m_entries.size()) {
+        beginInsertRows(QModelIndex(), m_nVisibleRows, m_entries.size() - 1);
+        m_nVisibleRows = m_entries.size();
+        endInsertRows();
+    }
+}
+
+int GlCallStatisticsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_nVisibleRows;
+}
+
+int GlCallStatisticsModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 2;
+}
+
+QVariant GlCallStatisticsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_nVisibleRows) {
+        return QVariant();
+    }
+    const Entry &e = m_entries[index.row()];
+
+    if (index.column() == 0) {
+        switch (role) {
+            case Qt::DisplayRole:
+                return e.count;
+            case Qt::TextAlignmentRole:
+                return QVariant(Qt::AlignRight|Qt::AlignVCenter);
+        }
+    } else {
+        switch (role) {
+            case Qt::DisplayRole:
+                return e.name;
+            case Qt::ToolTipRole:
+                if (!e.toolTip.isEmpty()) {
+                    return e.toolTip;
+                }
+                break;
+            case Qt::UserRole:
+                return m_nNumCalls ? e.count/(float)m_nNumCalls : 0.0f;
+        }
+    }
+    return QVariant();
+}
+
+QVariant GlCallStatisticsModel::headerData(int section,
+                                           Qt::Orientation orientation,
+                                           int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        return section == 0 ? QString("#") : QString("Function Call");
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags GlCallStatisticsModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return 0;
+    }
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
 
 GlCallStatistics::GlCallStatistics(QTableView *parent)
 {
     m_pTableView = parent;
-    
 
-    m_pModel = new QStandardItemModel(m_pTableView);
+    m_pModel = new GlCallStatisticsModel(m_pTableView);
     m_pProxyModel = new QSortFilterProxyModel(parent);
     m_pProxyModel->setSourceModel(m_pModel);
     m_pProxyModel->setDynamicSortFilter(true);
@@ -53,9 +182,13 @@ GlCallStatistics::GlCallStatistics(QTableView *parent)
     m_pTableView->setSortingEnabled(true);
     m_pTableView->sortByColumn(0, Qt::DescendingOrder);
 
-    resetStatistic();
+    m_pTableView->setColumnWidth(0, 50);
+    m_pTableView->setColumnWidth(1, 250);
     
-    m_nNumCalls = 0;
+    TextPercentDelegate *delegate = new TextPercentDelegate(m_pTableView);
+    m_pTableView->setItemDelegateForColumn(1, delegate);
+    m_pTableView->verticalHeader()->hide();
+    m_pTableView->verticalHeader()->setDefaultSectionSize(22);
 }
 
 GlCallStatistics::~GlCallStatistics()
@@ -65,61 +198,15 @@ GlCallStatistics::~GlCallStatistics()
 void GlCallStatistics::resetStatistic(void)
 {
     m_pModel->clear();
-    m_pModel->setColumnCount(2);
-    m_pModel->setRowCount(0);
-    m_pModel->setHeaderData(0, Qt::Horizontal, "#");
-    m_pModel->setHeaderData(1, Qt::Horizontal, "Function Call");
-    
-    m_pTableView->setColumnWidth(0, 50);
-    m_pTableView->setColumnWidth(1, 250);
-    
-    TextPercentDelegate *delegate = new TextPercentDelegate(m_pTableView);
-    m_pTableView->setItemDelegateForColumn(1, delegate);
-    m_pTableView->verticalHeader()->hide();
-    
-    m_nNumCalls = 0;
 }
 
-void GlCallStatistics::incCallStatistic(QString i_qFName)
+void GlCallStatistics::incCallStatistic(const char *i_pName)
 {
-    m_nNumCalls++;
-
-    /* Search for entry */
-    QList<QStandardItem*> resultList;
-    int row = 0;
-    int i;
-
-    resultList = m_pModel->findItems(i_qFName, Qt::MatchExactly, 1);
-
-    if (resultList.count() == 0) {
-        /* Add item to list */
-        m_pModel->setRowCount(m_pModel->rowCount()+1);
-        row = m_pModel->rowCount()-1;
-        m_pModel->setData(m_pModel->index(row, 0), 
-                          QVariant(Qt::AlignRight|Qt::AlignVCenter), 
-                          Qt::TextAlignmentRole);
-        m_pModel->setData(m_pModel->index(row, 0), 1);
-        m_pModel->item(row, 0)->setEditable(false);
-        m_pModel->setData(m_pModel->index(row, 1), i_qFName);
-        m_pModel->item(row, 1)->setEditable(false);
-
-        /* set row height of view */
-        m_pTableView->setRowHeight(
-                m_pProxyModel->mapFromSource(m_pModel->index(row, 0)).row(), 22);
-    } else if (resultList.count() == 1) {
-        /* Exiting item */
-        row = resultList[0]->row();
-        int count = m_pModel->data(m_pModel->index(row, 0)).toInt();
-        m_pModel->setData(m_pModel->index(row, 0), count + 1);
-    } else {
-        fprintf(stderr, "E! multiple entries for single call\n");
-        exit(1);
-    }
+    m_pModel->addCalls(i_pName, 1);
+}
 
-    /* Adapt percentages */
-    for (i=0; i<m_pModel->rowCount(); i++) {
-        QModelIndex iCount = m_pModel->index(i, 0);
-        int count = m_pModel->data(iCount).toInt();
-        m_pModel->setData(m_pModel->index(i, 1), count/(float)m_nNumCalls, Qt::UserRole);
-    }
+void GlCallStatistics::addCallStatistic(const char *i_pName, int i_nCount,
+                                        const QString &i_qToolTip)
+{
+    m_pModel->addCalls(i_pName, i_nCount, i_qToolTip);
 }
@@ -35,9 +35,55 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _GL_CALL_STATISTICS_QT_H_
 
 #include <QtGui/QTableView>
-#include <QtGui/QStandardItemModel>
 #include <QtGui/QSortFilterProxyModel>
+#include <QtCore/QAbstractTableModel>
 #include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtCore/QHash>
+
+class QTimer;
+
+/* Call counts keyed by the address of a function or extension name, so
+ * counting is a hash lookup on a pointer once a name was seen. Changes reach
+ * the view at most every REFRESH_INTERVAL ms as one insert and one
+ * dataChanged.
+ */
+class GlCallStatisticsModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    GlCallStatisticsModel(QObject *parent = 0);
+
+    void clear(void);
+    void addCalls(const char *i_pName, int i_nCount,
+                  const QString &i_qToolTip = QString());
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+
+private slots:
+    void refresh(void);
+
+private:
+    struct Entry {
+        QString name;
+        int count;
+        QString toolTip;
+    };
+
+    QVector<Entry> m_entries;
+    QHash<const char*, int> m_rows;
+    QHash<QString, int> m_rowsByName;
+    int m_nNumCalls;
+    /* rows and counts the view knows of */
+    int m_nVisibleRows;
+    QTimer *m_pRefreshTimer;
+};
 
 class GlCallStatistics
 {
@@ -46,14 +92,18 @@ public:
     ~GlCallStatistics();
 
     void resetStatistic(void);
-    void incCallStatistic(QString i_qFName);
+
+    /* i_pName must stay valid until the next reset, e.g. a name from
+     * glFunctions as returned by FunctionCall::getName or getExtension
+     */
+    void incCallStatistic(const char *i_pName);
+    void addCallStatistic(const char *i_pName, int i_nCount,
+                          const QString &i_qToolTip = QString());
     
 private:
-    QStandardItemModel *m_pModel;
+    GlCallStatisticsModel *m_pModel;
     QSortFilterProxyModel * m_pProxyModel;
     QTableView         *m_pTableView;
-    int m_nNumCalls;
-    
 };
 
 #endif
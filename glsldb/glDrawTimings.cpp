@@ -0,0 +1,108 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#include "glDrawTimings.qt.h"
+
+#include <QtGui/QHeaderView>
+#include <QtCore/QList>
+
+extern "C" GLFunctionList glFunctions[];
+
+GlDrawTimings::GlDrawTimings(QTableView *parent, int maxEntries)
+{
+    m_pTableView = parent;
+    m_nMaxEntries = maxEntries;
+
+    m_pModel = new QStandardItemModel(m_pTableView);
+    m_pProxyModel = new QSortFilterProxyModel(parent);
+    m_pProxyModel->setSourceModel(m_pModel);
+    m_pProxyModel->setDynamicSortFilter(true);
+
+    m_pTableView->setModel(m_pProxyModel);
+
+    m_pTableView->setSortingEnabled(true);
+    m_pTableView->sortByColumn(COL_GPU_TIME, Qt::DescendingOrder);
+
+    resetStatistic();
+}
+
+GlDrawTimings::~GlDrawTimings()
+{
+}
+
+void GlDrawTimings::resetStatistic(void)
+{
+    m_pModel->clear();
+    m_pModel->setColumnCount(NUM_COLUMNS);
+    m_pModel->setRowCount(0);
+    m_pModel->setHeaderData(COL_FRAME, Qt::Horizontal, "Frame");
+    m_pModel->setHeaderData(COL_CALL, Qt::Horizontal, "Call");
+    m_pModel->setHeaderData(COL_FUNCTION, Qt::Horizontal, "Function Call");
+    m_pModel->setHeaderData(COL_PROGRAM, Qt::Horizontal, "Program");
+    m_pModel->setHeaderData(COL_GPU_TIME, Qt::Horizontal, "GPU Time [us]");
+
+    m_pTableView->setColumnWidth(COL_FRAME, 50);
+    m_pTableView->setColumnWidth(COL_CALL, 50);
+    m_pTableView->setColumnWidth(COL_FUNCTION, 200);
+    m_pTableView->setColumnWidth(COL_PROGRAM, 50);
+    m_pTableView->setColumnWidth(COL_GPU_TIME, 80);
+    m_pTableView->verticalHeader()->hide();
+}
+
+void GlDrawTimings::addDrawTiming(const DbgDrawTiming *timing)
+{
+    QList<QStandardItem*> row;
+
+    /* keep the newest entries only; rows are appended in arrival order */
+    if (m_pModel->rowCount() >= m_nMaxEntries) {
+        m_pModel->removeRows(0, m_pModel->rowCount() - m_nMaxEntries + 1);
+    }
+
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        QStandardItem *item = new QStandardItem();
+        item->setEditable(false);
+        if (i != COL_FUNCTION) {
+            item->setData(QVariant(Qt::AlignRight|Qt::AlignVCenter),
+                          Qt::TextAlignmentRole);
+        }
+        row.append(item);
+    }
+    row[COL_FRAME]->setData((qlonglong)timing->frame, Qt::DisplayRole);
+    row[COL_CALL]->setData((qlonglong)timing->call, Qt::DisplayRole);
+    row[COL_FUNCTION]->setData(QString(glFunctions[timing->function].fname),
+                               Qt::DisplayRole);
+    row[COL_PROGRAM]->setData((qlonglong)timing->program, Qt::DisplayRole);
+    row[COL_GPU_TIME]->setData(timing->gpuTime / 1000.0, Qt::DisplayRole);
+
+    m_pModel->appendRow(row);
+}
@@ -0,0 +1,67 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef _GL_DRAW_TIMINGS_QT_H_
+#define _GL_DRAW_TIMINGS_QT_H_
+
+#include <QtGui/QTableView>
+#include <QtGui/QStandardItemModel>
+#include <QtGui/QSortFilterProxyModel>
+
+extern "C" {
+  #include "GL/gl.h"
+  #include "GL/glext.h"
+  #include "debuglib.h"
+}
+
+/* sortable table of the GPU time of single draw calls */
+class GlDrawTimings
+{
+public:
+    GlDrawTimings(QTableView *parent, int maxEntries);
+    ~GlDrawTimings();
+
+    void resetStatistic(void);
+    void addDrawTiming(const DbgDrawTiming *timing);
+
+    enum columnName {COL_FRAME, COL_CALL, COL_FUNCTION, COL_PROGRAM,
+                     COL_GPU_TIME, NUM_COLUMNS};
+
+private:
+    QStandardItemModel *m_pModel;
+    QSortFilterProxyModel * m_pProxyModel;
+    QTableView         *m_pTableView;
+    int m_nMaxEntries;
+};
+
+#endif
@@ -36,6 +36,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #undef CursorShape
 #include <QtGui/QCursor>
 #include <QtCore/QStringList>
+#include <QtCore/QHash>
 #include <QtGui/QIcon>
 #include <QtOpenGL/QGLWidget>
 #include <QtOpenGL/QGLContext>
@@ -167,7 +168,7 @@ GlTraceFilterModel::GlTraceFilterModel(GLFunctionList *functions, QObject *paren
 	}
 
 	this->checkExtensions();
-	this->constructHashMap();
+	this->constructFunctionMap(functions, i);
 
     load();
 }
@@ -181,6 +182,7 @@ void GlTraceFilterModel::resetToDefaults(void)
     if (rootItem) {
     	layoutAboutToBeChanged();
         rootItem->setChildsToggleStateRecursive(Qt::Checked);
+        updateVisibleFunctions();
         layoutChanged();
     }
 }
@@ -277,7 +279,8 @@ void GlTraceFilterModel::load(void)
     }
 
     settings.endGroup();
-        
+
+    updateVisibleFunctions();
     layoutChanged();
 }
 
@@ -442,10 +445,12 @@ bool GlTraceFilterModel::setData (const QModelIndex & index, const QVariant & va
 
 				if (index.parent().isValid()) {
 					(static_cast<GlTraceFilterItem*>(index.parent().internalPointer()))->checkChildsToggleState();
+					updateVisibleFunctions();
 					emit dataChanged(index.parent(),index.parent());
 				} else {
 				    layoutAboutToBeChanged();
 					(static_cast<GlTraceFilterItem*>(index.internalPointer()))->setChildsToggleState(value.toInt());
+					updateVisibleFunctions();
                     layoutChanged();
 				}
 				return true;
@@ -539,7 +544,13 @@ void GlTraceFilterModel::checkExtensions() {
 	}
 }
 
-void GlTraceFilterModel::constructHashMap() {
+void GlTraceFilterModel::constructFunctionMap(GLFunctionList *functions,
+                                              int numFunctions) {
+	QHash<QString, GlTraceFilterItem *> functionHash;
+
+	/* functions listed in several extensions share the filter item of their
+	 * last occurrence
+	 */
 	for(int i = 0; i < this->rootItem->childCount(); i++) {
 		GlTraceFilterItem *item = this->rootItem->child(i);
 		for(int j = 0; j < item->childCount(); j++) {
@@ -547,13 +558,19 @@ void GlTraceFilterModel::constructHashMap() {
 			functionHash[QString(subItem->function->fname)] = subItem;
 		}
 	}
+
+	functionItems.resize(numFunctions);
+	for(int i = 0; i < numFunctions; i++) {
+		functionItems[i] = functionHash.value(QString(functions[i].fname));
+	}
+	visibleFunctions.fill(true, numFunctions);
 }
 
-bool GlTraceFilterModel::isFunctionVisible(const QString &fname) {
-	if (functionHash[fname] != NULL) {
-		return (functionHash[fname]->showInTrace == Qt::Checked);
+void GlTraceFilterModel::updateVisibleFunctions() {
+	for(int i = 0; i < functionItems.size(); i++) {
+		visibleFunctions.setBit(i, !functionItems[i] ||
+		                        functionItems[i]->showInTrace == Qt::Checked);
 	}
-	return true;
 }
 
 //bool GlTraceFilterModel::hasChildren (const QModelIndex &parent) const {
@@ -39,7 +39,8 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QtCore/QVariant>
 #include <QtCore/QSettings>
 #include <QtCore/QList>
-#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtCore/QBitArray>
 
 #include "debuglib.h"
 
@@ -56,7 +57,14 @@ public:
 	QVariant headerData(int section, Qt::Orientation orientation, int role) const;
 	Qt::ItemFlags flags (const QModelIndex &index) const;
 	bool setData (const QModelIndex & index, const QVariant & value, int role = Qt::EditRole);
-	bool isFunctionVisible(const QString &fname);
+	/* function is the index in the GLFunctionList, unknown functions are
+	 * always visible
+	 */
+	bool isFunctionVisible(int function) const {
+		return function < 0 || function >= visibleFunctions.size() ||
+		       visibleFunctions.testBit(function);
+	}
+	const QBitArray &getVisibleFunctions(void) const { return visibleFunctions; }
 	//bool hasChildren (const QModelIndex &parent = QModelIndex()) const;
 
 	enum columnName {FUNCTION_NAME, NUM_COLUMNS};
@@ -104,10 +112,13 @@ private:
 	};
 
 	void checkExtensions();
-	void constructHashMap();
+	void constructFunctionMap(GLFunctionList *functions, int numFunctions);
+	void updateVisibleFunctions();
 
 	GlTraceFilterItem *rootItem;
-	QHash<QString, GlTraceFilterItem *> functionHash;
+	/* filter item deciding the visibility of each function */
+	QVector<GlTraceFilterItem *> functionItems;
+	QBitArray visibleFunctions;
 };
 
 #endif
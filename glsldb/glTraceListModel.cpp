@@ -32,71 +32,57 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 *******************************************************************************/
 
 #include "glTraceListModel.qt.h"
+#include "functionCall.h"
 
 #include <QtGui/QColor>
 #include <QtGui/QBrush>
 #include <QtGui/QFont>
 
-GlTraceListItem::GlTraceListItem()
-{
+#include <stdlib.h>
+#include <string.h>
 
-}
+extern "C" GLFunctionList glFunctions[];
 
-GlTraceListItem::~GlTraceListItem()
-{
+/* the text store is compacted once this many bytes belong to dropped items */
+#define TEXT_COMPACT_SIZE (1<<16)
 
+GlTraceListItem::GlTraceListItem()
+{
+    m_iIconType = IT_EMPTY;
+    m_iFunction = -1;
+    m_iText = 0;
 }
 
-void GlTraceListItem::setIconType(IconType type)
+GlTraceListItem::GlTraceListItem(int iconType, int function, int text)
 {
-    m_eIconType = type;
-
-    switch(type) {
-        case IT_EMPTY:
-            m_qItem = QIcon(QString::fromUtf8(":/icons/icons/empty_32.png"));
-            break;
-        case IT_ACTUAL:
-            m_qItem = QIcon(QString::fromUtf8(":/icons/icons/go-actual_32.png"));
-            break;
-        case IT_OK:
-            m_qItem = QIcon(QString::fromUtf8(":/icons/icons/dialog-ok_32.png"));
-            break;
-        case IT_ERROR:
-            m_qItem = QIcon(QString::fromUtf8(":/icons/icons/dialog-error_32.png"));
-            break;
-        case IT_WARNING:
-            m_qItem = QIcon(QString::fromUtf8(":/icons/icons/dialog-warning_32.png"));
-            break;
-        case IT_IMPORTANT:
-            m_qItem = QIcon(QString::fromUtf8(":/icons/icons/emblem-important_32.png"));
-            break;
-        case IT_RECORD:
-            m_qItem = QIcon(QString::fromUtf8(":/icons/icons/media-record_32.png"));
-            break;
-        default:
-            m_qItem = QIcon(QString::fromUtf8(":/icons/icons/empty_32.png"));
-    }
+    m_iIconType = iconType;
+    m_iFunction = function;
+    m_iText = text;
 }
 
 GlTraceListFilterModel::GlTraceListFilterModel(GlTraceFilterModel *traceFilter, QObject *parent)
     : QSortFilterProxyModel(parent)
 {
 	m_GlTraceFilterModel = traceFilter;
+	m_qFilteredFunctions = traceFilter->getVisibleFunctions();
 	currentShown = false;
 }
 
 bool GlTraceListFilterModel::filterAcceptsRow(int sourceRow, const
                                                  QModelIndex &sourceParent) const
 {
-    QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
-    QString text = sourceModel()->data(index, Qt::DisplayRole).toString();
-
-    /*
-    return (!(text.startsWith(QString("glXGetProcAddressARB("))));
-    */
-    //return true;
-	return m_GlTraceFilterModel->isFunctionVisible(text.left(text.indexOf("(")))
-		|| dynamic_cast<GlTraceListModel*>(sourceModel())->isCurrentCall(index);
+    GlTraceListModel *model = static_cast<GlTraceListModel*>(sourceModel());
+
+	return m_GlTraceFilterModel->isFunctionVisible(model->getFunctionId(sourceRow))
+		|| model->isCurrentCall(model->index(sourceRow, 0, sourceParent));
+}
+
+void GlTraceListFilterModel::updateFilter(void)
+{
+	if (m_qFilteredFunctions != m_GlTraceFilterModel->getVisibleFunctions()) {
+		m_qFilteredFunctions = m_GlTraceFilterModel->getVisibleFunctions();
+		invalidateFilter();
+	}
 }
 
 void GlTraceListFilterModel::showCurrentItemAnyway(bool show) {
@@ -107,133 +93,264 @@ GlTraceListModel::GlTraceListModel(int maxListEntries, GlTraceFilterModel *trace
     : QAbstractListModel(parent)
 {
     m_iMax = maxListEntries;
-    m_pData = new GlTraceListItem[maxListEntries];
     m_iFirst = 0;
     m_iNum   = 0;
 	m_pTraceFilterModel = traceFilter;
+
+    m_qFlushTimer.setSingleShot(true);
+    m_qFlushTimer.setInterval(0);
+    connect(&m_qFlushTimer, SIGNAL(timeout()), this, SLOT(flushPendingItems()));
+
+    m_qIcons[GlTraceListItem::IT_EMPTY] =
+        QIcon(QString::fromUtf8(":/icons/icons/empty_32.png"));
+    m_qIcons[GlTraceListItem::IT_ACTUAL] =
+        QIcon(QString::fromUtf8(":/icons/icons/go-actual_32.png"));
+    m_qIcons[GlTraceListItem::IT_OK] =
+        QIcon(QString::fromUtf8(":/icons/icons/dialog-ok_32.png"));
+    m_qIcons[GlTraceListItem::IT_ERROR] =
+        QIcon(QString::fromUtf8(":/icons/icons/dialog-error_32.png"));
+    m_qIcons[GlTraceListItem::IT_WARNING] =
+        QIcon(QString::fromUtf8(":/icons/icons/dialog-warning_32.png"));
+    m_qIcons[GlTraceListItem::IT_IMPORTANT] =
+        QIcon(QString::fromUtf8(":/icons/icons/emblem-important_32.png"));
+    m_qIcons[GlTraceListItem::IT_RECORD] =
+        QIcon(QString::fromUtf8(":/icons/icons/media-record_32.png"));
 }
 
 GlTraceListModel::~GlTraceListModel()
 {
-    delete[] m_pData;
 }
     
 void GlTraceListModel::clear(void)
 {
-    layoutAboutToBeChanged();
+    m_qFlushTimer.stop();
+    m_qPending.clear();
+    m_qData.clear();
+    m_qText.clear();
     m_iFirst = 0;
     m_iNum   = 0;
-    layoutChanged();
+    reset();
 }
 
-int  GlTraceListModel::getNextIndex(void)
+GlTraceListItem *GlTraceListModel::getItem(int row)
 {
     int idx;
 
-    m_iNum++;
-    if (m_iNum > m_iMax) {
-        m_iNum = m_iMax;
+    if (row < 0) {
+        return NULL;
+    } else if (row >= m_iNum) {
+        row -= m_iNum;
+        return row < m_qPending.size() ? &m_qPending[row] : NULL;
+    }
 
-        m_iFirst++;
-        if (m_iFirst >= m_iMax) {
-            m_iFirst = 0;
-        }
+    idx = m_iFirst + row;
+    if (idx >= m_qData.size()) {
+        idx -= m_qData.size();
+    }
+    return &m_qData[idx];
+}
+
+const GlTraceListItem *GlTraceListModel::getItem(int row) const
+{
+    return const_cast<GlTraceListModel*>(this)->getItem(row);
+}
+
+QString GlTraceListModel::getItemText(const GlTraceListItem &item) const
+{
+    QString text = QString::fromUtf8(m_qText.constData() + item.getText());
+
+    if (item.getFunction() >= 0) {
+        return QString::fromAscii(glFunctions[item.getFunction()].fname) + text;
+    }
+    return text;
+}
+
+void GlTraceListModel::addItem(GlTraceListItem::IconType type, int function,
+                               const QByteArray &text)
+{
+    int offset = m_qText.size();
+
+    m_qText.append(text);
+    m_qText.append('\0');
+    m_qPending.append(GlTraceListItem(type, function, offset));
+
+    if (m_qPending.size() >= m_iMax) {
+        flushPendingItems();
+    } else if (!m_qFlushTimer.isActive()) {
+        m_qFlushTimer.start();
+    }
+}
+
+void GlTraceListModel::flushPendingItems(void)
+{
+    int i, numNew, skip, drop, needed, last;
 
-        idx = m_iFirst - 1;
-        if (idx < 0) {
-            idx = m_iMax - 1;
+    m_qFlushTimer.stop();
+    numNew = m_qPending.size();
+    if (numNew == 0) {
+        return;
+    }
+
+    /* pending items that would be dropped right away are never shown */
+    skip = qMax(0, numNew - m_iMax);
+    numNew -= skip;
+
+    needed = qMin(m_iMax, m_iNum + numNew);
+    if (m_qData.size() < needed) {
+        m_qData.resize(qMin(m_iMax, qMax(needed, 2*m_qData.size())));
+    }
+
+    drop = m_iNum + numNew - m_iMax;
+    if (drop > 0) {
+        beginRemoveRows(QModelIndex(), 0, drop - 1);
+        m_iFirst += drop;
+        if (m_iFirst >= m_qData.size()) {
+            m_iFirst -= m_qData.size();
         }
+        m_iNum -= drop;
+        endRemoveRows();
+    }
+
+    last = m_iNum - 1;
+    beginInsertRows(QModelIndex(), m_iNum, m_iNum + numNew - 1);
+    for (i = 0; i < numNew; i++) {
+        GlTraceListItem item = m_qPending[skip + i];
+        m_iNum++;
+        *getItem(m_iNum - 1) = item;
+    }
+    m_qPending.clear();
+    endInsertRows();
+
+    /* the former current call may be filtered now */
+    if (last >= 0) {
+        emit dataChanged(index(last), index(last));
+    }
+
+    compactText();
+}
+
+void GlTraceListModel::compactText(void)
+{
+    int i, base;
+
+    if (m_iNum == 0) {
+        m_qText.clear();
+        return;
+    }
+
+    base = getItem(0)->getText();
+    if (base < TEXT_COMPACT_SIZE || base < m_qText.size()/2) {
+        return;
+    }
+
+    /* texts replaced by setCurrentGlTraceCall may be stored out of order */
+    for (i = 1; i < m_iNum; i++) {
+        base = qMin(base, getItem(i)->getText());
+    }
+    m_qText.remove(0, base);
+    for (i = 0; i < m_iNum; i++) {
+        getItem(i)->moveText(base);
+    }
+}
+
+/* text stored for a call, without the name when it is taken from glFunctions */
+static QByteArray getCallText(const FunctionCall *call)
+{
+    char *callString = call->getCallString();
+    QByteArray text;
 
+    if (call->getFunctionId() >= 0) {
+        text = QByteArray(callString + strlen(call->getName()));
     } else {
-        idx = m_iNum - 1;
+        text = QByteArray(callString);
     }
+    free(callString);
+    return text;
+}
 
-    return idx;
+void GlTraceListModel::addGlTraceItem(const GlTraceListItem::IconType type, const FunctionCall *call)
+{
+    addItem(type, call->getFunctionId(), getCallText(call));
 }
 
 void GlTraceListModel::addGlTraceItem(const  GlTraceListItem::IconType type, const QString & text)
 {
-    layoutAboutToBeChanged();
-    int idx = getNextIndex();
-    m_pData[idx].setIconType(type);
-    m_pData[idx].setText(text);
-    layoutChanged();
+    addItem(type, -1, text.toUtf8());
 }
 
 void GlTraceListModel::addGlTraceWarningItem(const QString & text)
 {
-    layoutAboutToBeChanged();
-    int idx = getNextIndex();
-    m_pData[idx].setIconType(GlTraceListItem::IT_WARNING);
-    layoutChanged();
+    addItem(GlTraceListItem::IT_WARNING, -1, text.toUtf8());
 }
 
 void GlTraceListModel::addGlTraceErrorItem(const QString & text)
 {
-    layoutAboutToBeChanged();
-    int idx = getNextIndex();
-    m_pData[idx].setIconType(GlTraceListItem::IT_ERROR);
-    layoutChanged();
+    addItem(GlTraceListItem::IT_ERROR, -1, text.toUtf8());
 }
 
 void GlTraceListModel::setCurrentGlTraceIconType(const GlTraceListItem::IconType type, int offset)
 {
-    int idx;
+    int row = m_iNum + m_qPending.size() + offset;
+    GlTraceListItem *item = getItem(row);
 
-    idx = m_iFirst + m_iNum + offset;
-    if (idx >= m_iMax) {
-        idx -= m_iMax;
+    if (item) {
+        item->setIconType(type);
+        if (row < m_iNum) {
+            emit dataChanged(index(row), index(row));
+        }
     }
+}
 
-    if ( 0 <= idx && idx < m_iMax) {
-        layoutAboutToBeChanged();
-        m_pData[idx].setIconType(type);
-        layoutChanged();
+void GlTraceListModel::setCurrentGlTraceCall(const FunctionCall *call, int offset)
+{
+    int row = m_iNum + m_qPending.size() + offset;
+    GlTraceListItem *item = getItem(row);
+
+    if (item) {
+        item->setText(call->getFunctionId(), m_qText.size());
+        m_qText.append(getCallText(call));
+        m_qText.append('\0');
+        if (row < m_iNum) {
+            emit dataChanged(index(row), index(row));
+        }
     }
 }
 
-void GlTraceListModel::setCurrentGlTraceText(const QString &text, int offset)
+int GlTraceListModel::rowCount(const QModelIndex &parent) const
 {
-    int idx;
-
-    idx = m_iFirst + m_iNum + offset;
-    if (idx >= m_iMax) {
-        idx -= m_iMax;
+    if (parent.isValid()) {
+        return 0;
     }
+    return m_iNum;
+}
 
-    if ( 0 <= idx && idx < m_iMax) {
-        layoutAboutToBeChanged();
-        m_pData[idx].setText(text);
-        layoutChanged();
-    }
+int GlTraceListModel::getFunctionId(int row) const
+{
+    const GlTraceListItem *item = getItem(row);
+
+    return item ? item->getFunction() : -1;
 }
 
-int GlTraceListModel::rowCount(const QModelIndex &parent) const
+bool GlTraceListModel::isFunctionVisible(int row) const
 {
-    return m_iNum;
+    return m_pTraceFilterModel->isFunctionVisible(getFunctionId(row));
 }
 
 QVariant GlTraceListModel::data(const QModelIndex &index, int role) const
 {
-    int idx;
-
-    if (!index.isValid()) {
+    if (!index.isValid() || index.row() >= m_iNum) {
         return QVariant();
     }
 
-    idx = m_iFirst + index.row();
-    if (idx >= m_iMax) {
-        idx -= m_iMax;
-    }
     switch (role) {
 		case Qt::ForegroundRole:
-			if (m_pTraceFilterModel->isFunctionVisible(m_pData[idx].getText().left(m_pData[idx].getText().indexOf("(")))) {
+			if (isFunctionVisible(index.row())) {
 				return QVariant();
 			} else {
 				return QBrush(QColor(128,128,128));
 			}
 		case Qt::FontRole:
-			if (m_pTraceFilterModel->isFunctionVisible(m_pData[idx].getText().left(m_pData[idx].getText().indexOf("(")))) {
+			if (isFunctionVisible(index.row())) {
 				return QVariant();
 			} else {
 				QFont f;
@@ -241,25 +358,21 @@ QVariant GlTraceListModel::data(const QModelIndex &index, int role) const
 				return f;
 			}
         case Qt::DisplayRole:
-            return m_pData[idx].getText();
+            return getItemText(*getItem(index.row()));
         case Qt::DecorationRole:
-            return m_pData[idx].getIcon();
+            return m_qIcons[getItem(index.row())->getIconType()];
         default:
             return QVariant();
     }
 }
 
 bool GlTraceListModel::isCurrentCall(const QModelIndex &index) {
-	if ((m_iFirst + index.row()) % m_iMax == (m_iFirst + m_iNum - 1 + m_iMax) % m_iMax) {
-		return true;
-	} else {
-		return false;
-	}
+	return index.row() == m_iNum - 1;
 }
 
-void GlTraceListItem::outputTXT(QTextStream &out) const
+void GlTraceListItem::outputTXT(QTextStream &out, const QString &text) const
 {
-    switch(m_eIconType) {
+    switch(m_iIconType) {
         case IT_EMPTY:
             out << QString("  ");
             break;
@@ -284,20 +397,16 @@ void GlTraceListItem::outputTXT(QTextStream &out) const
         default:
             out << QString("? ");
     }
-    out << " " << getText() << endl;
+    out << " " << text << endl;
 }
 
-void GlTraceListModel::traverse(QTextStream &out, void (GlTraceListItem::*pt2Member)(QTextStream&) const)
+void GlTraceListModel::outputTXT(QTextStream &out)
 {
-    int i, idx;
+    int i;
 
-    for (i = 0, idx=m_iFirst; i < m_iNum; i++, idx++) {
-        if (idx >= m_iMax) {
-            idx -= m_iMax;
-        }
-        if ( 0 <= idx && idx < m_iMax) {
-            (m_pData[idx].*pt2Member)(out);
-        }
+    flushPendingItems();
+    for (i = 0; i < m_iNum; i++) {
+        const GlTraceListItem *item = getItem(i);
+        item->outputTXT(out, getItemText(*item));
     }
 }
-
@@ -37,31 +37,42 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QtCore/QTextStream>
 #include <QtGui/QSortFilterProxyModel>
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
 #include <QtCore/QString>
+#include <QtCore/QTimer>
 #include <QtGui/QIcon>
 
 #include "glTraceFilterModel.qt.h"
 
+class FunctionCall;
+
+/* compact trace entry, the text is formatted on demand by GlTraceListModel */
 class GlTraceListItem
 {
  public:
      GlTraceListItem();
-     ~GlTraceListItem();
+     GlTraceListItem(int iconType, int function, int text);
+
+     enum IconType {IT_EMPTY, IT_ACTUAL, IT_OK, IT_ERROR, IT_WARNING, IT_IMPORTANT, IT_RECORD, IT_COUNT};
 
-     enum IconType {IT_EMPTY, IT_ACTUAL, IT_OK, IT_ERROR, IT_WARNING, IT_IMPORTANT, IT_RECORD};
+     void     setIconType(IconType type) { m_iIconType = type; }
+     void     setText(int function, int text) { m_iFunction = function; m_iText = text; }
 
-     void    setIconType(IconType type);
-     void    setText(const QString &text) { m_qText = text; }
+     IconType getIconType(void) const { return (IconType)m_iIconType; }
+     /* index in glFunctions or -1 if the whole text is stored */
+     int      getFunction(void) const { return m_iFunction; }
+     /* offset of the text in the text store of the model */
+     int      getText(void) const { return m_iText; }
 
-     QIcon   getIcon(void) const { return m_qItem; }
-     QString getText(void) const { return m_qText; }
+     void     moveText(int offset) { m_iText -= offset; }
 
-     void outputTXT(QTextStream &out) const;
+     void outputTXT(QTextStream &out, const QString &text) const;
 
  private:
-     QIcon    m_qItem;
-     QString  m_qText;
-     IconType m_eIconType;
+     int m_iIconType;
+     int m_iFunction;
+     int m_iText;
 };
 
 class GlTraceListFilterModel : public QSortFilterProxyModel
@@ -73,14 +84,23 @@ class GlTraceListFilterModel : public QSortFilterProxyModel
      virtual bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
  	 void showCurrentItemAnyway(bool show);
 
+ public:
+     /* re-evaluates all rows if the visible functions changed since the
+      * last pass, appended rows are filtered on insertion
+      */
+     void updateFilter(void);
+
  private:
 	 GlTraceFilterModel *m_GlTraceFilterModel;
+	 QBitArray m_qFilteredFunctions;
 	 bool currentShown;
 };
 
 
 class GlTraceListModel : public QAbstractListModel
 {
+    Q_OBJECT
+
  public:
      GlTraceListModel(int maxListEntries, GlTraceFilterModel *traceFilter, QObject *parent = 0);
      ~GlTraceListModel();
@@ -88,29 +108,49 @@ class GlTraceListModel : public QAbstractListModel
      void    clear(void);
      void    resetLayout(void) { layoutAboutToBeChanged(); layoutChanged(); }
 
+     void addGlTraceItem(const GlTraceListItem::IconType type, const FunctionCall *call);
      void addGlTraceItem(const GlTraceListItem::IconType type, const QString & text);
      void addGlTraceWarningItem(const QString & text);
      void addGlTraceErrorItem(const QString & text);
 
      void setCurrentGlTraceIconType(const  GlTraceListItem::IconType type, int offset = 0);
-     void setCurrentGlTraceText(const QString &text, int offset = 0);
+     void setCurrentGlTraceCall(const FunctionCall *call, int offset = 0);
 
      int rowCount(const QModelIndex &parent = QModelIndex()) const;
      QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
 	 
 	 bool isCurrentCall(const QModelIndex &index);
+	 bool isFunctionVisible(int row) const;
+	 int  getFunctionId(int row) const;
 
-     void traverse(QTextStream &out, void (GlTraceListItem::*outFunc)(QTextStream&) const);
+     void outputTXT(QTextStream &out);
+
+ private slots:
+     /* makes the items added since the last event loop turn visible */
+     void flushPendingItems(void);
 
  private:
-     int  getNextIndex(void);
-     
-     GlTraceListItem *m_pData;
+     void addItem(GlTraceListItem::IconType type, int function, const QByteArray &text);
+     GlTraceListItem *getItem(int row);
+     const GlTraceListItem *getItem(int row) const;
+     QString getItemText(const GlTraceListItem &item) const;
+     void compactText(void);
+
+     /* ring buffer of the shown items, grows up to m_iMax entries */
+     QVector<GlTraceListItem> m_qData;
      int              m_iMax;
      int              m_iFirst;
      int              m_iNum;
+
+     /* items not yet announced to the views */
+     QVector<GlTraceListItem> m_qPending;
+     QTimer           m_qFlushTimer;
+
+     /* zero terminated utf8 texts of all items, in order of the items */
+     QByteArray       m_qText;
+
+     QIcon            m_qIcons[GlTraceListItem::IT_COUNT];
 	 GlTraceFilterModel *m_pTraceFilterModel;
 };
 
 #endif
-
@@ -36,6 +36,8 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define MAIN_WINDOW_TITLE "glslDevil"
 
-#define MAX_GLTRACE_ENTRIES 500
+#define MAX_GLTRACE_ENTRIES (1<<20)
+
+#define MAX_GPU_DRAW_TIMINGS 10000
 
 #endif
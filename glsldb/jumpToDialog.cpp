@@ -38,6 +38,8 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "jumpToDialog.qt.h"
 #include "debuglib.h"
 
+#include <string.h>
+
 extern "C" GLFunctionList glFunctions[];
 
 class GlFuncValidator : public QValidator
@@ -83,6 +85,8 @@ JumpToDialog::JumpToDialog(void)
         i++;
     }
     connect(cbFunctions, SIGNAL(editTextChanged(QString)), this, SLOT(checkValidity()));
+    connect(gbCondition, SIGNAL(toggled(bool)), this, SLOT(checkValidity()));
+    connect(leValue, SIGNAL(textChanged(QString)), this, SLOT(checkValidity()));
 }
 
 JumpToDialog::JumpToDialog(QString i_qInitName)
@@ -101,6 +105,8 @@ JumpToDialog::JumpToDialog(QString i_qInitName)
         i++;
     }
     connect(cbFunctions, SIGNAL(editTextChanged(QString)), this, SLOT(checkValidity()));
+    connect(gbCondition, SIGNAL(toggled(bool)), this, SLOT(checkValidity()));
+    connect(leValue, SIGNAL(textChanged(QString)), this, SLOT(checkValidity()));
 }
 
 JumpToDialog::~JumpToDialog()
@@ -119,6 +125,16 @@ void JumpToDialog::checkValidity(void)
     if (vldr->validate(s, pos) != QValidator::Acceptable) {
         state = QValidator::Invalid;
     }
+    if (hasConditions()) {
+        bool ok;
+        leValue->text().toLongLong(&ok, 0);
+        if (!ok) {
+            leValue->text().toDouble(&ok);
+        }
+        if (!ok) {
+            state = QValidator::Invalid;
+        }
+    }
 
     /* Find OK button */
     QAbstractButton *okButton = NULL;
@@ -147,3 +163,59 @@ QString JumpToDialog::getTargetFuncName()
     return cbFunctions->currentText();
 }
 
+void JumpToDialog::setConditionsEnabled(bool enabled)
+{
+    gbCondition->setEnabled(enabled);
+    if (!enabled) {
+        gbCondition->setChecked(false);
+        gbCondition->setToolTip(QString("Conditions are only evaluated in "
+                                        "runs without call tracing"));
+    } else {
+        gbCondition->setToolTip(QString());
+    }
+}
+
+bool JumpToDialog::hasConditions(void)
+{
+    return gbCondition->isEnabled() && gbCondition->isChecked();
+}
+
+void JumpToDialog::getBreakpoint(DbgBreakpoint *bp)
+{
+    int i = 0;
+    QString name = getTargetFuncName();
+
+    memset(bp, 0, sizeof(DbgBreakpoint));
+    bp->enabled = 1;
+    bp->function = -1;
+    while (glFunctions[i].fname != NULL) {
+        if (name.compare(QString(glFunctions[i].fname)) == 0) {
+            bp->function = i;
+            break;
+        }
+        i++;
+    }
+    bp->hitCount = 1;
+    bp->firstFrame = -1;
+    bp->lastFrame = -1;
+
+    if (hasConditions()) {
+        /* the operator combo box lists DBG_BREAKPOINT_OPS in order */
+        bp->numConditions = 1;
+        bp->conditions[0].argument = sbArgument->value();
+        bp->conditions[0].op = cbOperator->currentIndex();
+        bool isInteger;
+        qlonglong value = leValue->text().toLongLong(&isInteger, 0);
+        if (isInteger) {
+            bp->conditions[0].value = value;
+            bp->conditions[0].fvalue = (double)value;
+        } else {
+            bp->conditions[0].fvalue = leValue->text().toDouble();
+            bp->conditions[0].value = (ALIGNED_DATA)bp->conditions[0].fvalue;
+        }
+        bp->hitCount = sbHitCount->value();
+        bp->firstFrame = sbFirstFrame->value();
+        bp->lastFrame = sbLastFrame->value();
+    }
+}
+
@@ -42,6 +42,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QtCore/QString>
 
 #include "ui_jumpToDialog.h"
+#include "debuglib.h"
 
 class JumpToDialog : public QDialog, public Ui::dJumpTo {
     Q_OBJECT
@@ -53,6 +54,13 @@ public:
 
     QString getTargetFuncName(void);
 
+    /* conditions are evaluated by the debuggee and thus only available for
+     * runs without call tracing
+     */
+    void setConditionsEnabled(bool enabled);
+    bool hasConditions(void);
+    void getBreakpoint(DbgBreakpoint *bp);
+
 private slots:
     void checkValidity(void);
     
@@ -42,7 +42,9 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QtGui/QTabWidget>
 #include <QtGui/QTabBar>
 #include <QtGui/QColor>
+#include <QtGui/QProgressDialog>
 #include <QtCore/QUrl>
+#include <QtCore/QTimer>
 #include <stdio.h>
 #include <string.h>
 
@@ -66,10 +68,17 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "debuglib.h"
 #include "utils/dbgprint.h"
 #include "utils/notify.h"
+#include "utils/timer.h"
 
 #define MAX(a,b) ( a < b ? b : a )
 #define MIN(a,b) ( a > b ? b : a )
 
+/* edge length of the region debugged around the selected pixel */
+#define REGION_OF_INTEREST_SIZE 32
+
+/* ms until a running shader step offers to cancel it */
+#define STEP_PROGRESS_DELAY 500
+
 #ifdef _WIN32
 #define REGISTRY_KEY "Software\\VIS\\glslDevil"
 #endif /* _WIN32 */
@@ -118,10 +127,13 @@ MainWindow::MainWindow(char *pname, const QStringList& args)
 	m_pgtDialog = new GlTraceSettingsDialog(m_pGlTraceFilterModel, this);
 
     /*   GLTrace View   */
-	GlTraceListFilterModel *lvGlTraceFilter = new GlTraceListFilterModel(m_pGlTraceFilterModel, this);
+	m_pGlTraceListFilter = new GlTraceListFilterModel(m_pGlTraceFilterModel, this);
     m_pGlTraceModel = new GlTraceListModel(MAX_GLTRACE_ENTRIES, m_pGlTraceFilterModel, this);
-    lvGlTraceFilter->setSourceModel(m_pGlTraceModel);
-    lvGlTrace->setModel(lvGlTraceFilter);
+    m_pGlTraceListFilter->setSourceModel(m_pGlTraceModel);
+    m_pGlTraceListFilter->setDynamicSortFilter(true);
+    lvGlTrace->setModel(m_pGlTraceListFilter);
+    connect(m_pGlTraceListFilter, SIGNAL(rowsInserted(const QModelIndex&, int, int)),
+            lvGlTrace, SLOT(scrollToBottom()));
 
     /* Action Group for watch window controls */
 	agWatchControl = new QActionGroup(this);
@@ -134,6 +146,20 @@ MainWindow::MainWindow(char *pname, const QStringList& args)
 	m_pftDialog = new FragmentTestDialog(this);
 	
     pc = new ProgramControl(pname);
+	connect(pc, SIGNAL(debuggeeStateChanged()),
+	        this, SLOT(checkEndOfExecution()));
+	m_pStepCommand = NULL;
+	m_pStepLoop = NULL;
+	connect(pc, SIGNAL(commandFinished(PcCommand*)),
+	        this, SLOT(stepCommandFinished(PcCommand*)));
+
+	/* show calls executed by the debuggee while it runs without trace */
+	m_bWaitingForExecution = false;
+	m_bBreakpointRun = false;
+	m_pExecutionStatisticsTimer = new QTimer(this);
+	m_pExecutionStatisticsTimer->setInterval(100);
+	connect(m_pExecutionStatisticsTimer, SIGNAL(timeout()),
+	        this, SLOT(pollExecutionStatistics()));
 
     m_pCurrentCall = NULL;
     m_pShVarModel  = NULL;
@@ -157,6 +183,8 @@ MainWindow::MainWindow(char *pname, const QStringList& args)
 	m_pWglExtSt = new GlCallStatistics(tvWglExt);
 	m_pWglCallPfst = new GlCallStatistics(tvWglCallsPf);
 	m_pWglExtPfst = new GlCallStatistics(tvWglExtPf);
+	m_pGpuDrawSt = new GlDrawTimings(tvGpuDraws, MAX_GPU_DRAW_TIMINGS);
+	m_nDrawTimingsRead = 0;
 
     /* Prepare debugging */
     ShInitialize();
@@ -183,6 +211,8 @@ MainWindow::MainWindow(char *pname, const QStringList& args)
 	//m_pGeoDataModel = NULL;
 	
     m_pCoverage = NULL;
+    m_pCoverageMask = NULL;
+	memset(m_regionOfInterest, 0, sizeof(m_regionOfInterest));
 
 	m_selectedPixel[0] = -1;
 	m_selectedPixel[1] = -1;
@@ -197,6 +227,10 @@ MainWindow::MainWindow(char *pname, const QStringList& args)
 	if(settings.contains("MainWinState")) {
 		this->restoreState(settings.value("MainWinState").toByteArray());
 	}
+	aReducedPrecision->setChecked(
+		settings.value("Readback/ReducedPrecision", false).toBool());
+	aRegionOfInterest->setChecked(
+		settings.value("Readback/RegionOfInterest", false).toBool());
 }
 
 MainWindow::~MainWindow()
@@ -220,8 +254,10 @@ MainWindow::~MainWindow()
 	delete m_pWglExtSt;
 	delete m_pWglCallPfst;
 	delete m_pWglExtPfst;
+	delete m_pGpuDrawSt;
 
     delete[] m_pCoverage;
+    delete m_pCoverageMask;
 	delete m_pGeometryMap;
 	delete m_pVertexCount;
 	//delete m_pGeoDataModel;
@@ -264,6 +300,10 @@ void MainWindow::closeEvent(QCloseEvent *event)
 {
 	QSettings settings;
 	settings.setValue("MainWinState", this->saveState());
+	settings.setValue("Readback/ReducedPrecision",
+	                  aReducedPrecision->isChecked());
+	settings.setValue("Readback/RegionOfInterest",
+	                  aRegionOfInterest->isChecked());
     killProgram(1);
     //qApp->quit();
     event->accept();
@@ -433,6 +473,9 @@ void MainWindow::setGlStatisticTabs(int n, int m)
                     break;
             }
             break;
+        case 3:
+            twGlStatistics->insertTab(0, taGpuDraws, QString("GPU Draw Times"));
+            break;
         default:
             break;
     }
@@ -643,9 +686,6 @@ void MainWindow::addGlTraceItem()
 {
     if (!m_pCurrentCall) return;
 
-    char *callString = m_pCurrentCall->getCallString();
-    QIcon icon;
-    QString iconText;
     GlTraceListItem::IconType iconType;
     
     if (currentRunLevel == RL_TRACE_EXECUTE_NO_DEBUGABLE ||
@@ -658,20 +698,20 @@ void MainWindow::addGlTraceItem()
     }
 
     if (m_pCurrentCall->isGlFunc()) {
-        m_pGlCallSt->incCallStatistic(QString(m_pCurrentCall->getName()));
-        m_pGlExtSt->incCallStatistic(QString(m_pCurrentCall->getExtension()));
-        m_pGlCallPfst->incCallStatistic(QString(m_pCurrentCall->getName()));
-        m_pGlExtPfst->incCallStatistic(QString(m_pCurrentCall->getExtension()));
+        m_pGlCallSt->incCallStatistic(m_pCurrentCall->getName());
+        m_pGlExtSt->incCallStatistic(m_pCurrentCall->getExtension());
+        m_pGlCallPfst->incCallStatistic(m_pCurrentCall->getName());
+        m_pGlExtPfst->incCallStatistic(m_pCurrentCall->getExtension());
     } else if (m_pCurrentCall->isGlxFunc()) {
-        m_pGlxCallSt->incCallStatistic(QString(m_pCurrentCall->getName()));
-        m_pGlxExtSt->incCallStatistic(QString(m_pCurrentCall->getExtension()));
-        m_pGlxCallPfst->incCallStatistic(QString(m_pCurrentCall->getName()));
-        m_pGlxExtPfst->incCallStatistic(QString(m_pCurrentCall->getExtension()));
+        m_pGlxCallSt->incCallStatistic(m_pCurrentCall->getName());
+        m_pGlxExtSt->incCallStatistic(m_pCurrentCall->getExtension());
+        m_pGlxCallPfst->incCallStatistic(m_pCurrentCall->getName());
+        m_pGlxExtPfst->incCallStatistic(m_pCurrentCall->getExtension());
 	} else if (m_pCurrentCall->isWglFunc()) {
-		m_pWglCallSt->incCallStatistic(QString(m_pCurrentCall->getName()));
-		m_pWglExtSt->incCallStatistic(QString(m_pCurrentCall->getExtension()));
-		m_pWglCallPfst->incCallStatistic(QString(m_pCurrentCall->getName()));
-		m_pWglExtPfst->incCallStatistic(QString(m_pCurrentCall->getExtension()));
+		m_pWglCallSt->incCallStatistic(m_pCurrentCall->getName());
+		m_pWglExtSt->incCallStatistic(m_pCurrentCall->getExtension());
+		m_pWglCallPfst->incCallStatistic(m_pCurrentCall->getName());
+		m_pWglExtPfst->incCallStatistic(m_pCurrentCall->getExtension());
 	}
 
     /* Check what options are valid depending on the command */
@@ -680,26 +720,22 @@ void MainWindow::addGlTraceItem()
     }
     
     if (m_pGlTraceModel) {
-        m_pGlTraceModel->addGlTraceItem(iconType, callString);
+        m_pGlTraceModel->addGlTraceItem(iconType, m_pCurrentCall);
     }
-    lvGlTrace->scrollToBottom();
-    free(callString);
 }
 
 void MainWindow::addGlTraceErrorItem(const char *text)
 {
     if (m_pGlTraceModel) {
-        m_pGlTraceModel->addGlTraceItem(GlTraceListItem::IT_ERROR, text);
+        m_pGlTraceModel->addGlTraceErrorItem(text);
     }
-    lvGlTrace->scrollToBottom();
 }
 
 void MainWindow::addGlTraceWarningItem(const char *text)
 {
     if (m_pGlTraceModel) {
-        m_pGlTraceModel->addGlTraceItem(GlTraceListItem::IT_WARNING, text);
+        m_pGlTraceModel->addGlTraceWarningItem(text);
     }
-    lvGlTrace->scrollToBottom();
 }
 
 void MainWindow::setGlTraceItemIconType(const GlTraceListItem::IconType type)
@@ -709,10 +745,10 @@ void MainWindow::setGlTraceItemIconType(const GlTraceListItem::IconType type)
     }
 }
 
-void MainWindow::setGlTraceItemText(const char *text)
+void MainWindow::setGlTraceItemCall(const FunctionCall *call)
 {
     if (m_pGlTraceModel) {
-        m_pGlTraceModel->setCurrentGlTraceText(text, -1);
+        m_pGlTraceModel->setCurrentGlTraceCall(call, -1);
     }
 }
     
@@ -836,6 +872,7 @@ void MainWindow::on_tbStep_clicked()
 	leaveDBGState();
 
 	setRunLevel(RL_TRACE_EXECUTE_RUN);
+	startRunStatistics(false);
 
 	singleStep();
 
@@ -845,7 +882,7 @@ void MainWindow::on_tbStep_clicked()
 	}
 
 	while (currentRunLevel == RL_TRACE_EXECUTE_RUN &&
-	       !m_pGlTraceFilterModel->isFunctionVisible(m_pCurrentCall->getName())) {
+	       !m_pGlTraceFilterModel->isFunctionVisible(m_pCurrentCall->getFunctionId())) {
 		singleStep();
 		qApp->processEvents(QEventLoop::AllEvents);
 		if (currentRunLevel == RL_SETUP) {
@@ -943,10 +980,8 @@ void MainWindow::on_tbEdit_clicked()
         
         if ((*(FunctionCall*)editCall) != *m_pCurrentCall) {
 
-			char *callString = editCall->getCallString();
-            setGlTraceItemText(callString);
+            setGlTraceItemCall(editCall);
             setGlTraceItemIconType(GlTraceListItem::IT_IMPORTANT);
-			free(callString);
 
             /* Send data to debug library */
             pc->overwriteFuncArguments(editCall);
@@ -968,64 +1003,126 @@ void MainWindow::on_tbEdit_clicked()
     delete dialog;
 }
 
+/* the debuggee only counts calls executed without trace, in runs without
+ * trace it measures their CPU time and the GPU time of draw calls as well
+ */
+void MainWindow::startRunStatistics(bool noTrace)
+{
+	pc->setCallStatisticsMode(noTrace ? DBG_CALL_STATISTICS_TIME
+	                                  : DBG_CALL_STATISTICS_COUNT);
+	pc->setDrawTimingEnabled(noTrace);
+}
+
+/* returns at once, checkEndOfExecution finishes the run when the debuggee
+ * stops or terminates
+ */
 void MainWindow::waitForEndOfExecution()
+{
+	updateExecutionStatistics(false);
+	m_bWaitingForExecution = true;
+	pc->watchDebuggee(true);
+	m_pExecutionStatisticsTimer->start();
+
+	/* the debuggee may be done already */
+	checkEndOfExecution();
+}
+
+void MainWindow::stopWaitingForExecution()
+{
+	m_bWaitingForExecution = false;
+	pc->watchDebuggee(false);
+	pc->setDrawTimingEnabled(false);
+	m_pExecutionStatisticsTimer->stop();
+}
+
+void MainWindow::pollExecutionStatistics()
+{
+	if (m_bWaitingForExecution && currentRunLevel == RL_TRACE_EXECUTE_RUN) {
+		updateExecutionStatistics(true);
+	} else {
+		checkEndOfExecution();
+	}
+}
+
+void MainWindow::checkEndOfExecution()
 {
 	pcErrorCode error;
-	while (currentRunLevel == RL_TRACE_EXECUTE_RUN) {
-		qApp->processEvents(QEventLoop::AllEvents);
-#ifndef _WIN32
-		usleep(1000);
-#else /* !_WIN32 */
-		Sleep(1);
-#endif /* !_WIN32 */
-		int state;
-		error = pc->checkExecuteState(&state);
+	int state;
+
+	if (!m_bWaitingForExecution) {
+		return;
+	}
+	if (currentRunLevel != RL_TRACE_EXECUTE_RUN) {
+		stopWaitingForExecution();
+		updateExecutionStatistics(true);
+		return;
+	}
+
+	error = pc->checkExecuteState(&state);
+	if (isErrorCritical(error)) {
+		stopWaitingForExecution();
+		killProgram(1);
+		setRunLevel(RL_SETUP);
+		return;
+	} else if (isOpenGLError(error)) {
+		stopWaitingForExecution();
+		/* TODO: error check */
+		pc->executeContinueOnError();	
+		pc->checkChildStatus();	
+		m_pCurrentCall = pc->getCurrentCall();
+		addGlTraceItem();
+		setErrorStatus(error);
+		pc->callDone();	
+		error = getNextCall();
+		setErrorStatus(error);
 		if (isErrorCritical(error)) {
 			killProgram(1);
 			setRunLevel(RL_SETUP);
-			return;
-		} else if (isOpenGLError(error)) {
-			/* TODO: error check */
-			pc->executeContinueOnError();	
-			pc->checkChildStatus();	
-			m_pCurrentCall = pc->getCurrentCall();
+		} else {
+			setRunLevel(RL_TRACE_EXECUTE);
 			addGlTraceItem();
-			setErrorStatus(error);
-			pc->callDone();	
-			error = getNextCall();
-			setErrorStatus(error);
-			if (isErrorCritical(error)) {
-				killProgram(1);
-				setRunLevel(RL_SETUP);
-				return;
-			} else {
-				setRunLevel(RL_TRACE_EXECUTE);
-				addGlTraceItem();
-			}
-			break;
-		}
-		if (state) {
-			break;
+			updateExecutionStatistics(true);
 		}
+		return;
+	}
+	if (!state) {
 		if (!pc->childAlive()) {
+			stopWaitingForExecution();
 			UT_NOTIFY(LV_INFO, "Debugee terminated!");
 			killProgram(0);
 			setRunLevel(RL_SETUP);
-			return;
 		}
+		return;
 	}
-	if (currentRunLevel == RL_TRACE_EXECUTE_RUN) {
-		pc->checkChildStatus();	
-		error = getNextCall();
-		setRunLevel(RL_TRACE_EXECUTE);
-		setErrorStatus(error);
-		if (isErrorCritical(error)) {
-			killProgram(1);
-			setRunLevel(RL_SETUP);
-			return;
-		} else {
-			addGlTraceItem();
-		}
+
+	stopWaitingForExecution();
+	updateExecutionStatistics(true);
+	pc->checkChildStatus();	
+	error = getNextCall();
+	setRunLevel(RL_TRACE_EXECUTE);
+	setErrorStatus(error);
+	if (isErrorCritical(error)) {
+		killProgram(1);
+		setRunLevel(RL_SETUP);
+	} else {
+		addGlTraceItem();
+		reportBreakpointHit();
+	}
+}
+
+void MainWindow::reportBreakpointHit()
+{
+	int bp, hits;
+
+	if (!m_bBreakpointRun) {
+		return;
+	}
+	m_bBreakpointRun = false;
+
+	bp = pc->getBreakpointHit(&hits);
+	if (bp >= 0) {
+		setStatusBarText(QString("Breakpoint hit in frame %1 (match %2)")
+		                 .arg(pc->getFrameNumber()).arg(hits));
 	}
 }
 
@@ -1035,6 +1132,7 @@ void MainWindow::on_tbJumpToDrawCall_clicked()
 	leaveDBGState();
 
 	setRunLevel(RL_TRACE_EXECUTE_RUN);
+	startRunStatistics(tbToggleNoTrace->isChecked());
 		
 	if (tbToggleNoTrace->isChecked()) {
     	delete m_pCurrentCall;
@@ -1049,7 +1147,7 @@ void MainWindow::on_tbJumpToDrawCall_clicked()
         qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
 
 		m_bHaveValidShaderCode = false;
-		
+
 		pcErrorCode error = pc->executeToDrawCall(tbToggleHaltOnError->isChecked());
 		setErrorStatus(error);
         if (error != PCE_NONE) {
@@ -1088,6 +1186,7 @@ void MainWindow::on_tbJumpToShader_clicked()
 	leaveDBGState();
 
     setRunLevel(RL_TRACE_EXECUTE_RUN);
+    startRunStatistics(tbToggleNoTrace->isChecked());
 
 	if (tbToggleNoTrace->isChecked()) {
     	delete m_pCurrentCall;
@@ -1140,6 +1239,7 @@ void MainWindow::on_tbJumpToUserDef_clicked()
     static QString targetName;
     JumpToDialog *pJumpToDialog = new JumpToDialog(targetName);
     
+    pJumpToDialog->setConditionsEnabled(tbToggleNoTrace->isChecked());
     pJumpToDialog->exec();
     
     if (pJumpToDialog->result() == QDialog::Accepted) {
@@ -1147,6 +1247,7 @@ void MainWindow::on_tbJumpToUserDef_clicked()
 		leaveDBGState();
 
         setRunLevel(RL_TRACE_EXECUTE_RUN);
+        startRunStatistics(tbToggleNoTrace->isChecked());
         targetName = pJumpToDialog->getTargetFuncName();
    
 
@@ -1164,8 +1265,18 @@ void MainWindow::on_tbJumpToUserDef_clicked()
 
 			m_bHaveValidShaderCode = false;
 
-			pcErrorCode error = pc->executeToUserDefined(targetName.toAscii().data(),
-			                                             tbToggleHaltOnError->isChecked());
+			pcErrorCode error;
+			if (pJumpToDialog->hasConditions()) {
+				DbgBreakpoint bp;
+				pJumpToDialog->getBreakpoint(&bp);
+				pc->setBreakpoints(&bp, 1);
+				m_bBreakpointRun = true;
+				error = pc->executeToBreakpoint(tbToggleHaltOnError->isChecked());
+			} else {
+				m_bBreakpointRun = false;
+				error = pc->executeToUserDefined(targetName.toAscii().data(),
+				                                 tbToggleHaltOnError->isChecked());
+			}
 			setErrorStatus(error);
 			if (error != PCE_NONE) {
 				killProgram(1);
@@ -1206,6 +1317,7 @@ void MainWindow::on_tbRun_clicked()
 	leaveDBGState();
 
    	setRunLevel(RL_TRACE_EXECUTE_RUN);
+	startRunStatistics(tbToggleNoTrace->isChecked());
 	if (tbToggleNoTrace->isChecked()) {
 		delete m_pCurrentCall;
 		m_pCurrentCall = NULL;
@@ -1269,6 +1381,7 @@ void MainWindow::setGuiUpdates(bool b)
 		tvWglCallsPf->setUpdatesEnabled(true);
 		tvWglExt->setUpdatesEnabled(true);
 		tvWglExtPf->setUpdatesEnabled(true);
+		tvGpuDraws->setUpdatesEnabled(true);
 	} else {
         lvGlTrace->setUpdatesEnabled(false);
         teFragmentShader->setUpdatesEnabled(false);
@@ -1286,6 +1399,7 @@ void MainWindow::setGuiUpdates(bool b)
 		tvWglCallsPf->setUpdatesEnabled(false);
 		tvWglExt->setUpdatesEnabled(false);
 		tvWglExtPf->setUpdatesEnabled(false);
+		tvGpuDraws->setUpdatesEnabled(false);
     }
 }
 
@@ -1305,7 +1419,7 @@ void MainWindow::on_tbToggleHaltOnError_clicked(bool)
 void MainWindow::on_tbGlTraceSettings_clicked()
 {
     m_pgtDialog->exec();
-    m_pGlTraceModel->resetLayout();
+    m_pGlTraceListFilter->updateFilter();
 }
 
 void MainWindow::on_tbSave_clicked()
@@ -1338,7 +1452,7 @@ void MainWindow::on_tbSave_clicked()
                 if (file.open(QIODevice::WriteOnly)) {
 
                     QTextStream out(&file);
-                    m_pGlTraceModel->traverse(out, &GlTraceListItem::outputTXT);
+                    m_pGlTraceModel->outputTXT(out);
                 }
             }
         }
@@ -1365,8 +1479,10 @@ bool MainWindow::getDebugVertexData(DbgCgOptions option, ShChangeableList *cl,
     };
 
     char *debugCode = NULL;
+    long long codegenTime = getMonotonicTimeNs();
     debugCode = ShDebugGetProg(m_dShCompiler, cl, &m_dShVariableList,
 	                           option);
+    codegenTime = getMonotonicTimeNs() - codegenTime;
     switch (currentRunLevel) {
         case RL_DBG_VERTEX_SHADER:
             shaders[0] = debugCode;
@@ -1418,9 +1534,12 @@ bool MainWindow::getDebugVertexData(DbgCgOptions option, ShChangeableList *cl,
 			break;
 	}
 
-    error = pc->shaderStepVertex(shaders, target, m_primitiveMode,
-                                 forcePointPrimitiveMode, elementsPerVertex,
-	                             &numPrimitives, &numVertices, &data);
+    ShaderStepVertexCommand step(shaders, target, m_primitiveMode,
+                                 forcePointPrimitiveMode, elementsPerVertex);
+    error = runStepCommand(&step);
+    numPrimitives = step.numPrimitives;
+    numVertices = step.numVertices;
+    data = step.vertexData;
 
 	/////// DEBUG 
     UT_NOTIFY(LV_DEBUG, ">>>>> DEBUG CG: ");
@@ -1460,6 +1579,10 @@ bool MainWindow::getDebugVertexData(DbgCgOptions option, ShChangeableList *cl,
 	////////////////
 
     free(debugCode);
+	if (error == PCE_CANCELLED) {
+		setErrorStatus(error);
+		return false;
+	}
 	if (error != PCE_NONE) {
     	setErrorStatus(error);
     	if (isErrorCritical(error)) {
@@ -1479,6 +1602,7 @@ bool MainWindow::getDebugVertexData(DbgCgOptions option, ShChangeableList *cl,
 		return false;
 	}
 
+	reportStepTiming(codegenTime);
 	vdata->setData(data, elementsPerVertex, numVertices, numPrimitives,
 	               coverage);
 	free(data);
@@ -1486,11 +1610,12 @@ bool MainWindow::getDebugVertexData(DbgCgOptions option, ShChangeableList *cl,
 	return true;
 }
 
-bool MainWindow::getDebugImage(DbgCgOptions option, ShChangeableList *cl, 
-                               int rbFormat, bool *coverage, PixelBox **fbData)
+bool MainWindow::stepFragmentShader(DbgCgOptions option, ShChangeableList *cl,
+                                    int rbFormat, int *width, int *height,
+                                    int *numChannels, void **imageData,
+                                    bool sparse, int *numPixels)
 {
-    int width, height, channels;
-    void *imageData;
+    int channels;
     pcErrorCode error;
 
     char *shaders[] = {
@@ -1509,7 +1634,9 @@ bool MainWindow::getDebugImage(DbgCgOptions option, ShChangeableList *cl,
 	}
 
     char *debugCode = NULL;
+    long long codegenTime = getMonotonicTimeNs();
     debugCode = ShDebugGetProg(m_dShCompiler, cl, &m_dShVariableList, option);
+    codegenTime = getMonotonicTimeNs() - codegenTime;
 	shaders[2] = debugCode;
 
     switch (option) {
@@ -1569,8 +1696,20 @@ bool MainWindow::getDebugImage(DbgCgOptions option, ShChangeableList *cl,
 		return false;
 	}
 
-    error = pc->shaderStepFragment(shaders, channels, rbFormat, &width, &height, &imageData);
+    ShaderStepFragmentCommand step(shaders, channels, rbFormat, sparse,
+                                   m_regionOfInterest);
+    error = runStepCommand(&step);
+    *width = step.width;
+    *height = step.height;
+    *imageData = step.image;
+    if (numPixels) {
+        *numPixels = step.numPixels;
+    }
     free(debugCode);
+	if (error == PCE_CANCELLED) {
+		setErrorStatus(error);
+		return false;
+	}
 	if (error != PCE_NONE) {
     	setErrorStatus(error);
     	if (isErrorCritical(error)) {
@@ -1587,38 +1726,186 @@ bool MainWindow::getDebugImage(DbgCgOptions option, ShChangeableList *cl,
                               QMessageBox::Ok);
 		return false;
 	}
+	reportStepTiming(codegenTime);
+	*numChannels = channels;
+	return true;
+}
 
-	if (rbFormat == GL_FLOAT) {
-		PixelBoxFloat *fb = new PixelBoxFloat(width, height, channels, (float*)imageData, coverage);
-		if (*fbData) {
-			PixelBoxFloat *pfbData = dynamic_cast<PixelBoxFloat*>(*fbData);
-			pfbData->addPixelBox(fb);
-			delete fb;
-		} else {
-			*fbData = fb;
+void MainWindow::reportStepTiming(long long codegenTime)
+{
+	const DbgStepTiming *t = pc->getStepTiming();
+	const ALIGNED_DATA *phase = t->phaseTime;
+	long long transferTime = pc->getStepTransferTime();
+
+	dbgPrint(DBGLVL_INFO, "STEP TIMING: codegen %.3f transfer %.3f ms, "
+	         "sources %li/%li/%li bytes\n", codegenTime*1e-6,
+	         transferTime*1e-6, (long)t->sourceSize[0], (long)t->sourceSize[1],
+	         (long)t->sourceSize[2]);
+
+	QString text = QString("Step: codegen %1, transfer %2, region %3, "
+	                       "compile %4, link %5, program %6, state %7, "
+	                       "replay %8, readback %9 ms")
+		.arg(codegenTime*1e-6, 0, 'f', 2)
+		.arg(transferTime*1e-6, 0, 'f', 2)
+		.arg(phase[DBG_STEP_PHASE_REGION]*1e-6, 0, 'f', 2)
+		.arg(phase[DBG_STEP_PHASE_COMPILE]*1e-6, 0, 'f', 2)
+		.arg(phase[DBG_STEP_PHASE_LINK]*1e-6, 0, 'f', 2)
+		.arg(phase[DBG_STEP_PHASE_PROGRAM]*1e-6, 0, 'f', 2)
+		.arg(phase[DBG_STEP_PHASE_STATE]*1e-6, 0, 'f', 2)
+		.arg(phase[DBG_STEP_PHASE_REPLAY]*1e-6, 0, 'f', 2)
+		.arg(phase[DBG_STEP_PHASE_READBACK]*1e-6, 0, 'f', 2);
+	statusbar->showMessage(text, 10000);
+}
+
+/* the window keeps painting while the step runs on the thread of pc, after
+ * STEP_PROGRESS_DELAY ms a modal progress dialog allows to cancel it; the
+ * step ends with commandFinished, so cmd is alive until its delivery
+ */
+pcErrorCode MainWindow::runStepCommand(PcCommand *cmd)
+{
+	QEventLoop loop;
+	QTimer delay;
+
+	m_pStepCommand = cmd;
+	m_pStepLoop = &loop;
+	pc->post(cmd);
+
+	delay.setSingleShot(true);
+	connect(&delay, SIGNAL(timeout()), &loop, SLOT(quit()));
+	delay.start(STEP_PROGRESS_DELAY);
+	loop.exec(QEventLoop::ExcludeUserInputEvents);
+	delay.stop();
+
+	if (m_pStepCommand) {
+		QProgressDialog progress("Debugging shader...", "Cancel", 0, 0, this);
+		progress.setWindowModality(Qt::WindowModal);
+		progress.setMinimumDuration(0);
+		connect(&progress, SIGNAL(canceled()), this, SLOT(cancelStepCommand()));
+		progress.show();
+		loop.exec();
+	}
+	m_pStepLoop = NULL;
+	return cmd->getError();
+}
+
+void MainWindow::stepCommandFinished(PcCommand *cmd)
+{
+	if (cmd == m_pStepCommand) {
+		m_pStepCommand = NULL;
+		m_pStepLoop->quit();
+	}
+}
+
+void MainWindow::cancelStepCommand()
+{
+	if (m_pStepCommand) {
+		m_pStepCommand->cancel();
+	}
+}
+
+bool MainWindow::getDebugCoverage(CoverageMask **mask)
+{
+    int width, height, channels;
+    void *imageData;
+
+	/* the region follows the selection from one coverage pass to the next,
+	 * the steps in between must see the same primitives
+	 */
+	if (aRegionOfInterest->isChecked() &&
+	    m_selectedPixel[0] >= 0 && m_selectedPixel[1] >= 0) {
+		m_regionOfInterest[0] = MAX(m_selectedPixel[0] - REGION_OF_INTEREST_SIZE/2, 0);
+		m_regionOfInterest[1] = MAX(m_selectedPixel[1] - REGION_OF_INTEREST_SIZE/2, 0);
+		m_regionOfInterest[2] = REGION_OF_INTEREST_SIZE;
+		m_regionOfInterest[3] = REGION_OF_INTEREST_SIZE;
+	} else {
+		memset(m_regionOfInterest, 0, sizeof(m_regionOfInterest));
+	}
+
+	if (!stepFragmentShader(DBG_CG_COVERAGE, NULL, GL_BITMAP, &width, &height,
+	                        &channels, &imageData, false, NULL)) {
+		return false;
+	}
+	*mask = new CoverageMask(width, height, (unsigned char*)imageData);
+	free(imageData);
+    UT_NOTIFY(LV_TRACE, "getDebugCoverage done.");
+	return true;
+}
+
+template <typename vType>
+static void storeDebugImage(PixelBox **fbData, int width, int height,
+                            int channels, void *imageData,
+                            const CoverageMask *sparseMask, bool *coverage)
+{
+	TypedPixelBox<vType> *fb;
+
+	if (sparseMask) {
+		fb = new TypedPixelBox<vType>(sparseMask, channels, (vType*)imageData,
+		                              coverage);
+	} else {
+		fb = new TypedPixelBox<vType>(width, height, channels,
+		                              (vType*)imageData, coverage);
+	}
+	if (*fbData) {
+		TypedPixelBox<vType> *pfbData = dynamic_cast<TypedPixelBox<vType>*>(*fbData);
+		pfbData->addPixelBox(fb);
+		delete fb;
+	} else {
+		*fbData = fb;
+	}
+}
+
+bool MainWindow::getDebugImage(DbgCgOptions option, ShChangeableList *cl, 
+                               int rbFormat, bool *coverage, PixelBox **fbData)
+{
+    int width, height, channels, numPixels;
+    void *imageData;
+    const CoverageMask *sparseMask = NULL;
+
+	/* Watch values are only meaningful at covered pixels, so let the
+	 * debuggee send just those when we know the coverage they belong to. */
+	bool sparse = option == DBG_CG_CHANGEABLE && coverage &&
+	              coverage == m_pCoverage && m_pCoverageMask;
+
+	if (!stepFragmentShader(option, cl, rbFormat, &width, &height, &channels,
+	                        &imageData, sparse, &numPixels)) {
+		return false;
+	}
+
+	if (sparse && numPixels < width*height) {
+		if (numPixels != m_pCoverageMask->getNumCovered() ||
+		    width != m_pCoverageMask->getWidth() ||
+		    height != m_pCoverageMask->getHeight()) {
+			free(imageData);
+			UT_NOTIFY(LV_ERROR, "Sparse image does not match coverage: "
+			          << numPixels << " pixels, "
+			          << m_pCoverageMask->getNumCovered() << " covered");
+			QMessageBox::critical(this, "Error", "Could not debug fragment "
+			                      "shader. Result does not match coverage!",
+			                      QMessageBox::Ok);
+			return false;
 		}
+		sparseMask = m_pCoverageMask;
+	}
+
+	/* half floats arrive converted to float */
+	if (rbFormat == GL_FLOAT || rbFormat == GL_HALF_FLOAT_ARB) {
+		storeDebugImage<float>(fbData, width, height, channels, imageData,
+		                       sparseMask, coverage);
 	} else if (rbFormat == GL_INT) {
-		PixelBoxInt *fb = new PixelBoxInt(width, height, channels, (int*)imageData, coverage);
-		if (*fbData) {
-			PixelBoxInt *pfbData = dynamic_cast<PixelBoxInt*>(*fbData);
-			pfbData->addPixelBox(fb);
-			delete fb;
-		} else {
-			*fbData = fb;
-		}
+		storeDebugImage<int>(fbData, width, height, channels, imageData,
+		                     sparseMask, coverage);
 	} else if (rbFormat == GL_UNSIGNED_INT) {
-		PixelBoxUInt *fb = new PixelBoxUInt(width, height, channels,
-		                                   (unsigned int*)imageData, coverage);
-		if (*fbData) {
-			PixelBoxUInt *pfbData = dynamic_cast<PixelBoxUInt*>(*fbData);
-			pfbData->addPixelBox(fb);
-			delete fb;
-		} else {
-			*fbData = fb;
-		}
+		storeDebugImage<unsigned int>(fbData, width, height, channels,
+		                              imageData, sparseMask, coverage);
+	} else if (rbFormat == GL_UNSIGNED_BYTE) {
+		storeDebugImage<unsigned char>(fbData, width, height, channels,
+		                               imageData, sparseMask, coverage);
 	} else {
 		UT_NOTIFY(LV_ERROR, "Invalid image data format");
 	}
+	if (*fbData && coverage && coverage == m_pCoverage) {
+		(*fbData)->setCoverageMask(m_pCoverageMask);
+	}
 
 	free(imageData);
     UT_NOTIFY(LV_TRACE, "getDebugImage done.");
@@ -1635,7 +1922,7 @@ void MainWindow::updateWatchItemData(ShVarItem *watchItem)
     ShChangeable *watchItemCgbl = watchItem->getShChangeable();
     addShChangeable(&cl, watchItemCgbl);
 
-	int rbFormat = watchItem->getReadbackFormat();
+	int rbFormat = watchItem->getReadbackFormat(aReducedPrecision->isChecked());
 
 	if (currentRunLevel == RL_DBG_FRAGMENT_SHADER) {
 		PixelBox *fb = watchItem->getPixelBoxPointer();
@@ -1800,6 +2087,7 @@ void MainWindow::updateWatchItemsCoverage(bool *coverage)
 		if (currentRunLevel == RL_DBG_FRAGMENT_SHADER) {
 	        PixelBox  *fb = item->getPixelBoxPointer();
     	    fb->setNewCoverage(coverage);
+    	    fb->setCoverageMask(m_pCoverageMask);
 			item->setCurrentValue(m_selectedPixel[0], m_selectedPixel[1]);
 		} else if (currentRunLevel == RL_DBG_VERTEX_SHADER) {
             VertexBox *vb = item->getVertexBoxPointer();
@@ -1881,18 +2169,19 @@ void MainWindow::ShaderStep(int action, bool updateWatchData, bool updateCoverma
 
                     if (currentRunLevel == RL_DBG_FRAGMENT_SHADER && updateCovermap) {
                         /* Read cover map */
-                        PixelBoxFloat *pCoverageBox = NULL;
-                        if (!(getDebugImage(DBG_CG_COVERAGE, NULL, GL_FLOAT, NULL,
-										(PixelBox**)&pCoverageBox))) {
+                        CoverageMask *pCoverageMask = NULL;
+                        if (!getDebugCoverage(&pCoverageMask)) {
                             QMessageBox::warning(this, "Warning", "An error "
                                 "occurred while reading coverage.");
                             return;
                         }
 
-                        /* Retrieve covermap from CoverageBox */
-                        int nNewCoverageMap;
+                        /* Views that work on bool maps get an expanded copy */
+                        int nNewCoverageMap = pCoverageMask->getNumCovered();
                         delete[] m_pCoverage;
-                        m_pCoverage = pCoverageBox->getCoverageFromData(&nNewCoverageMap);
+                        delete m_pCoverageMask;
+                        m_pCoverageMask = pCoverageMask;
+                        m_pCoverage = m_pCoverageMask->toBoolArray();
                         updateWatchItemsCoverage(m_pCoverage);
                         
                         if (nNewCoverageMap == nOldCoverageMap) {
@@ -1903,8 +2192,6 @@ void MainWindow::ShaderStep(int action, bool updateWatchData, bool updateCoverma
                             cmstatus = COVERAGEMAP_SHRINKED;
                         }
                         nOldCoverageMap = nNewCoverageMap;
-                        
-                        delete pCoverageBox;
                     } else if ((currentRunLevel == RL_DBG_GEOMETRY_SHADER |
 					            currentRunLevel == RL_DBG_VERTEX_SHADER) &&
                                updateCovermap) {
@@ -3003,6 +3290,9 @@ void MainWindow::leaveDBGState()
             /* TODO: close all windows (obsolete?) */
             delete[] m_pCoverage;
 			m_pCoverage = NULL;
+			delete m_pCoverageMask;
+			m_pCoverageMask = NULL;
+			memset(m_regionOfInterest, 0, sizeof(m_regionOfInterest));
 			break;
 		default:
 			break;
@@ -3748,6 +4038,64 @@ void MainWindow::resetAllStatistics(void)
 	m_pWglExtSt->resetStatistic();
 	m_pWglCallPfst->resetStatistic();
 	m_pWglExtPfst->resetStatistic();
+	m_pGpuDrawSt->resetStatistic();
+}
+
+void MainWindow::updateExecutionStatistics(bool addToStatistics)
+{
+	const DbgCallStatisticsTable *table = pc->getCallStatistics();
+	int i;
+
+	if (m_lastCallCounts.size() != DBG_MAX_PROFILED_FUNCTIONS) {
+		m_lastCallCounts.fill(0, DBG_MAX_PROFILED_FUNCTIONS);
+	}
+
+	for (i = 0; glFunctions[i].fname != NULL &&
+	            i < DBG_MAX_PROFILED_FUNCTIONS; i++) {
+		const DbgCallCounter *counter = &table->counters[i];
+		qint64 calls = counter->calls;
+		int numNewCalls = (int)(calls - m_lastCallCounts[i]);
+		m_lastCallCounts[i] = calls;
+
+		if (!addToStatistics || numNewCalls <= 0) {
+			continue;
+		}
+
+		QString toolTip;
+		if (counter->totalTime > 0) {
+			toolTip = QString("%1 calls without trace, avg. CPU time %2 us")
+				.arg(calls).arg(counter->totalTime / (1000.0 * calls), 0, 'f', 2);
+		}
+		const char *fname = glFunctions[i].fname;
+		const char *extname = glFunctions[i].extname;
+		if (!strcmp(glFunctions[i].prefix, "GL")) {
+			m_pGlCallSt->addCallStatistic(fname, numNewCalls, toolTip);
+			m_pGlExtSt->addCallStatistic(extname, numNewCalls);
+		} else if (!strcmp(glFunctions[i].prefix, "GLX")) {
+			m_pGlxCallSt->addCallStatistic(fname, numNewCalls, toolTip);
+			m_pGlxExtSt->addCallStatistic(extname, numNewCalls);
+		} else if (!strcmp(glFunctions[i].prefix, "WGL")) {
+			m_pWglCallSt->addCallStatistic(fname, numNewCalls, toolTip);
+			m_pWglExtSt->addCallStatistic(extname, numNewCalls);
+		}
+	}
+
+	/* draw timings are resolved some frames late, so always take them */
+	const DbgDrawTimingTable *timings = pc->getDrawTimings();
+	qint64 numWritten = timings->numWritten;
+	if (m_nDrawTimingsRead > numWritten) {
+		/* new debuggee */
+		m_nDrawTimingsRead = 0;
+	}
+	if (numWritten - m_nDrawTimingsRead > DBG_MAX_DRAW_TIMINGS) {
+		m_nDrawTimingsRead = numWritten - DBG_MAX_DRAW_TIMINGS;
+	}
+	if (addToStatistics) {
+		for (; m_nDrawTimingsRead < numWritten; m_nDrawTimingsRead++) {
+			m_pGpuDrawSt->addDrawTiming(
+				&timings->timings[m_nDrawTimingsRead % DBG_MAX_DRAW_TIMINGS]);
+		}
+	}
 }
 
 bool MainWindow::loadMruProgram(QString& outProgram, QString& outArguments, 
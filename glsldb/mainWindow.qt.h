@@ -44,6 +44,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ui_mainWindow.h"
 #include "openProgramDialog.qt.h"
 #include "glCallStatistics.qt.h"
+#include "glDrawTimings.qt.h"
 #include "jumpToDialog.qt.h"
 
 //#include "ShHandle.h"
@@ -65,6 +66,8 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QtGui/QScrollArea>
 #include <QtCore/QStack>
+#include <QtCore/QEventLoop>
+#include <QtCore/QVector>
 
 class QWorkspace;
 
@@ -146,6 +149,14 @@ private slots:
 
 	void singleStep();
 
+	/* end of a run without trace */
+	void checkEndOfExecution();
+	void pollExecutionStatistics();
+
+	/* completion of the shader step posted by runStepCommand */
+	void stepCommandFinished(PcCommand *cmd);
+	void cancelStepCommand();
+
 private:
     void closeEvent(QCloseEvent *event);
 
@@ -156,10 +167,17 @@ private:
 	void setShaderCodeText(char *shaders[3]);
 	void leaveDBGState();
 	void cleanupDBGShader();
+    bool stepFragmentShader(DbgCgOptions option, ShChangeableList *cl,
+                            int rbFormat, int *width, int *height,
+                            int *numChannels, void **imageData,
+                            bool sparse, int *numPixels);
     bool getDebugImage(DbgCgOptions option, ShChangeableList *cl, 
                        int rbFormat, bool *coverage, PixelBox **fbData);
+    bool getDebugCoverage(CoverageMask **mask);
 	bool getDebugVertexData(DbgCgOptions option, ShChangeableList *cl,
 	                        bool *coverage, VertexBox *vdata);
+	void reportStepTiming(long long codegenTime);
+	pcErrorCode runStepCommand(PcCommand *cmd);
 
     /* Gui update handling */
     void setGuiUpdates(bool);
@@ -168,7 +186,7 @@ private:
     void addGlTraceItem();
 	void addGlTraceErrorItem(const char *text);
 	void addGlTraceWarningItem(const char *text);
-    void setGlTraceItemText(const char *text);
+    void setGlTraceItemCall(const FunctionCall *call);
 	void setGlTraceItemIconType(const GlTraceListItem::IconType type);
     void clearGlTraceItemList(void);
 	
@@ -176,7 +194,10 @@ private:
     pcErrorCode nextStep(const FunctionCall *fCall);
 	pcErrorCode recordCall();
 	void recordDrawCall();
+	void startRunStatistics(bool noTrace);
 	void waitForEndOfExecution();
+	void stopWaitingForExecution();
+	void reportBreakpointHit();
     
     /* Workspace */
     QWorkspace *workspace;
@@ -184,6 +205,7 @@ private:
 
     /* GLTrace Model */
     GlTraceListModel *m_pGlTraceModel;
+    GlTraceListFilterModel *m_pGlTraceListFilter;
 	GlTraceFilterModel *m_pGlTraceFilterModel;
 
 	/* watch window controls */
@@ -211,6 +233,7 @@ private:
     void setGlStatisticTabs(int n, int m);
 	void resetPerFrameStatistics(void);
 	void resetAllStatistics(void);
+	void updateExecutionStatistics(bool addToStatistics);
     
     GlCallStatistics    *m_pGlCallSt;
     GlCallStatistics    *m_pGlExtSt;
@@ -225,6 +248,23 @@ private:
 	GlCallStatistics	*m_pWglCallPfst;
 	GlCallStatistics	*m_pWglExtPfst;
 
+	GlDrawTimings       *m_pGpuDrawSt;
+
+	/* call counts of the debuggee at the last poll */
+	QVector<qint64>      m_lastCallCounts;
+	/* number of draw timings taken from the debuggee */
+	qint64               m_nDrawTimingsRead;
+
+	/* set while the debuggee runs without trace, see waitForEndOfExecution */
+	bool                 m_bWaitingForExecution;
+	/* the running no-trace execution stops at a debuggee breakpoint */
+	bool                 m_bBreakpointRun;
+	QTimer              *m_pExecutionStatisticsTimer;
+
+	/* shader step in flight and the event loop waiting for it */
+	PcCommand           *m_pStepCommand;
+	QEventLoop          *m_pStepLoop;
+
     ShHandle            m_dShCompiler;
     TBuiltInResource    m_dShResources;
     ShVariableList      m_dShVariableList;
@@ -246,6 +286,8 @@ private:
 	//GeoShaderDataModel *m_pGeoDataModel;
 	
     bool *m_pCoverage;
+    /* fragment coverage, m_pCoverage is expanded from it */
+    CoverageMask *m_pCoverageMask;
 
     enum CoverageMapStatus {
         COVERAGEMAP_UNCHANGED,
@@ -266,6 +308,10 @@ private:
 	void addToWatchWindowFragment(WatchView *watchView, QModelIndexList &list);
 	
 	int m_selectedPixel[2];
+	/* x, y, width, height of the debugged image region, all 0 for the
+	 * whole image
+	 */
+	int m_regionOfInterest[4];
 
     /* MRU program. */
     bool loadMruProgram(QString& outProgram, QString& outArguments, 
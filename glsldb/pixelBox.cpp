@@ -42,6 +42,7 @@ PixelBox::PixelBox(QObject *i_qParent) : QObject(i_qParent)
 	m_nChannel = 0;
 	m_pDataMap = NULL;
 	m_pCoverage = NULL;
+	m_pCoverageMask = NULL;
 }
 
 PixelBox::~PixelBox()
@@ -51,27 +52,32 @@ PixelBox::~PixelBox()
     delete[] m_pDataMap;
 }
 
+bool PixelBox::isCovered(int x, int y)
+{
+	if (m_pCoverageMask) {
+		return m_pCoverageMask->isCovered(x, y);
+	}
+	return m_pCoverage && m_pCoverage[y*m_nWidth + x];
+}
+
 bool PixelBox::isAllDataAvailable()
 {
     int x, y;
     bool  *pDataMap;
-    bool  *pCoverage;
     
     if (!m_pDataMap) {
         return false;
     }
 
     pDataMap = m_pDataMap;
-    pCoverage  = m_pCoverage;
 
     for (y=0; y<m_nHeight; y++) {
         for (x=0; x<m_nWidth; x++) {
-            if (*pCoverage && !*pDataMap) {
+            if (isCovered(x, y) && !*pDataMap) {
                 dbgPrint(DBGLVL_INFO, "NOT ALL DATA AVILABLE, NEED READBACK =========================\n");
                 return false;
             }
             pDataMap++;
-            pCoverage++;
         }
     }
     return true;
@@ -92,3 +98,6 @@ template <> const int TypedPixelBox<int>::sc_maxVal = INT_MAX;
 template <> const unsigned int TypedPixelBox<unsigned int>::sc_minVal = 0;
 template <> const unsigned int TypedPixelBox<unsigned int>::sc_maxVal = UINT_MAX;
 
+template <> const unsigned char TypedPixelBox<unsigned char>::sc_minVal = 0;
+template <> const unsigned char TypedPixelBox<unsigned char>::sc_maxVal = UCHAR_MAX;
+
@@ -57,6 +57,8 @@ TypedPixelBox<vType>::TypedPixelBox(int i_nWidth, int i_nHeight, int i_nChannel,
 
     m_pData    = new vType[m_nWidth*m_nHeight*m_nChannel];
     m_pDataMap = new bool[m_nWidth*m_nHeight];
+    m_pSparseMask = NULL;
+    m_pSparseData = NULL;
     
     /* Initially use all given data */
     if (i_pData) {
@@ -88,6 +90,37 @@ TypedPixelBox<vType>::TypedPixelBox(int i_nWidth, int i_nHeight, int i_nChannel,
         m_nAbsMaxData = NULL;
     }
 }
+
+template <typename vType>
+TypedPixelBox<vType>::TypedPixelBox(const CoverageMask *i_pMask, int i_nChannel,
+		vType *i_pValues, bool *i_pCoverage, QObject *i_qParent) : PixelBox(i_qParent)
+{
+    int i, n;
+
+    m_nWidth = i_pMask->getWidth();
+    m_nHeight = i_pMask->getHeight();
+    m_nChannel = i_nChannel;
+
+    /* keep our own copy, the coverage of later steps may differ */
+    m_pSparseMask = new CoverageMask(*i_pMask);
+    n = m_pSparseMask->getNumCovered()*m_nChannel;
+    m_pSparseData = new vType[n];
+    memcpy(m_pSparseData, i_pValues, n*sizeof(vType));
+    m_pData = NULL;
+
+    /* data is available exactly at the covered pixels */
+    m_pDataMap = new bool[m_nWidth*m_nHeight];
+    for (i=0; i<m_nWidth*m_nHeight; i++) {
+        m_pDataMap[i] = m_pSparseMask->isCovered(i);
+    }
+    m_pCoverage = i_pCoverage;
+
+    m_nMinData = new vType[m_nChannel];
+    m_nMaxData = new vType[m_nChannel];
+    m_nAbsMinData = new vType[m_nChannel];
+    m_nAbsMaxData = new vType[m_nChannel];
+    calcMinMax(this->m_minMaxArea);
+}
     
 template <typename vType>
 TypedPixelBox<vType>::TypedPixelBox(TypedPixelBox *src)
@@ -97,11 +130,21 @@ TypedPixelBox<vType>::TypedPixelBox(TypedPixelBox *src)
     m_nHeight   = src->m_nHeight;
     m_nChannel  = src->m_nChannel;
     m_pCoverage = src->m_pCoverage;
-
-    m_pData = new vType[m_nWidth*m_nHeight*m_nChannel];
+    m_pCoverageMask = src->m_pCoverageMask;
+
+    if (src->m_pSparseMask) {
+        int n = src->m_pSparseMask->getNumCovered()*m_nChannel;
+        m_pSparseMask = new CoverageMask(*src->m_pSparseMask);
+        m_pSparseData = new vType[n];
+        memcpy(m_pSparseData, src->m_pSparseData, n*sizeof(vType));
+        m_pData = NULL;
+    } else {
+        m_pSparseMask = NULL;
+        m_pSparseData = NULL;
+        m_pData = new vType[m_nWidth*m_nHeight*m_nChannel];
+        memcpy(m_pData, src->m_pData, m_nWidth*m_nHeight*m_nChannel*sizeof(vType));
+    }
     m_pDataMap = new bool[m_nWidth*m_nHeight];
-
-    memcpy(m_pData, src->m_pData, m_nWidth*m_nHeight*m_nChannel*sizeof(vType));
     memcpy(m_pDataMap, src->m_pDataMap, m_nWidth*m_nHeight*sizeof(bool));
 
     m_nMinData = new vType[m_nChannel];
@@ -119,6 +162,8 @@ template <typename vType>
 TypedPixelBox<vType>::~TypedPixelBox()
 {
     delete[] m_pData;
+    delete m_pSparseMask;
+    delete[] m_pSparseData;
     delete[] m_nMinData;
     delete[] m_nMaxData;
     delete[] m_nAbsMinData;
@@ -160,12 +205,18 @@ void TypedPixelBox<vType>::calcMinMax(QRect area)
             ? m_nHeight : area.top() + area.height();        
     }
     /*area.setCoords(0, 0, 2, 2);*/
+
+    if (m_pSparseMask) {
+        calcMinMaxSparse(left, top, right, bottom);
+        return;
+    }
     
     for (y=top; y<bottom; y++) {
         for (x=left; x<right; x++) {
             for (c=0; c<m_nChannel; c++) {
                 int idx = y * m_nWidth + x;
-                if (pCoverage[idx]) {
+                if (m_pCoverageMask ? m_pCoverageMask->isCovered(idx)
+                                    : pCoverage[idx]) {
                     idx += c;
                     if (m_pData[idx] < m_nMinData[c]) {
                         m_nMinData[c] = m_pData[idx];
@@ -185,6 +236,61 @@ void TypedPixelBox<vType>::calcMinMax(QRect area)
     }
 }
     
+/* like calcMinMax, but visits only the pixels that have values */
+template <typename vType>
+void TypedPixelBox<vType>::calcMinMaxSparse(int left, int top, int right,
+                                            int bottom)
+{
+    int i, j, c;
+
+    for (i = m_pSparseMask->nextCovered(0), j = 0; i >= 0;
+         i = m_pSparseMask->nextCovered(i + 1), j++) {
+        int x = i % m_nWidth;
+        int y = i / m_nWidth;
+        if (x < left || x >= right || y < top || y >= bottom ||
+            !isCovered(x, y)) {
+            continue;
+        }
+        for (c=0; c<m_nChannel; c++) {
+            vType v = m_pSparseData[j*m_nChannel + c];
+            if (v < m_nMinData[c]) {
+                m_nMinData[c] = v;
+            }
+            if (m_nMaxData[c] < v) {
+                m_nMaxData[c] = v;
+            }
+            if (fabs((double)v) < m_nAbsMinData[c]) {
+                m_nAbsMinData[c] = fabs((double)v);
+            }
+            if (m_nAbsMaxData[c] < fabs((double)v)) {
+                m_nAbsMaxData[c] = fabs((double)v);
+            }
+        }
+    }
+}
+
+/* scatter the values of a sparse box into dense data */
+template <typename vType>
+void TypedPixelBox<vType>::materialize(void)
+{
+    int i, j;
+
+    if (!m_pSparseMask) {
+        return;
+    }
+    m_pData = new vType[m_nWidth*m_nHeight*m_nChannel];
+    memset(m_pData, 0, m_nWidth*m_nHeight*m_nChannel*sizeof(vType));
+    for (i = m_pSparseMask->nextCovered(0), j = 0; i >= 0;
+         i = m_pSparseMask->nextCovered(i + 1), j++) {
+        memcpy(&m_pData[i*m_nChannel], &m_pSparseData[j*m_nChannel],
+               m_nChannel*sizeof(vType));
+    }
+    delete m_pSparseMask;
+    delete[] m_pSparseData;
+    m_pSparseMask = NULL;
+    m_pSparseData = NULL;
+}
+
 template <typename vType>
 double TypedPixelBox<vType>::getMin(int channel)
 {
@@ -304,6 +410,10 @@ void TypedPixelBox<vType>::setData(int i_nWidth, int i_nHeight, int i_nChannel,
     int i;
 
     delete[] m_pData;
+    delete m_pSparseMask;
+    delete[] m_pSparseData;
+    m_pSparseMask = NULL;
+    m_pSparseData = NULL;
     delete[] m_pDataMap;
     delete[] m_nMinData;
     delete[] m_nMaxData;
@@ -361,6 +471,21 @@ void TypedPixelBox<vType>::addPixelBox(TypedPixelBox<vType> *f)
         return;
     }
 
+    /* the usual step: coverage did not change, just take the new values */
+    if (m_pSparseMask && f->m_pSparseMask &&
+        !m_pSparseMask->differs(f->m_pSparseMask)) {
+        memcpy(m_pSparseData, f->m_pSparseData,
+               m_pSparseMask->getNumCovered()*m_nChannel*sizeof(vType));
+        for (i=0; i<m_nWidth*m_nHeight; i++) {
+            m_pDataMap[i] = m_pDataMap[i] || f->m_pDataMap[i];
+        }
+        calcMinMax(this->m_minMaxArea);
+        emit dataChanged();
+        return;
+    }
+    materialize();
+    f->materialize();
+
     pDstData = m_pData;
     pDstDataMap = m_pDataMap;
 
@@ -398,6 +523,7 @@ bool* TypedPixelBox<vType>::getCoverageFromData(int *i_pActivePixels)
     bool *pCoverage;
     bool *coverage = new bool[m_nWidth*m_nHeight];
     
+    materialize();
     pCoverage     = coverage;
     pData         = m_pData;
     nActivePixels = 0;
@@ -443,6 +569,7 @@ QImage TypedPixelBox<vType>::getByteImage(FBMapping i_eMapping)
     
     QImage image(m_nWidth, m_nHeight, QImage::Format_RGB32);
 
+    materialize();
     pData    = m_pData;
     pDataMap = m_pDataMap;
     for (y=0; y<m_nHeight; y++) {
@@ -498,7 +625,8 @@ void TypedPixelBox<vType>::setByteImageRedChannel(QImage *image,
 		return;
 	}
 
-	if (!m_pCoverage || !m_pData) {
+	materialize();
+	if ((!m_pCoverage && !m_pCoverageMask) || !m_pData) {
 		dbgPrint(DBGLVL_ERROR, "TypedPixelBox::setByteImageRedChannel(..)"
 		                       " no coverage or data!\n");
 		return;
@@ -508,7 +636,7 @@ void TypedPixelBox<vType>::setByteImageRedChannel(QImage *image,
         for (x = 0; x < m_nWidth; x++) {
 			QColor c(image->pixel(x, y));
 			unsigned long idx = y*m_nWidth + x;
-			if (m_pCoverage[idx] &&	m_pDataMap[idx]) {
+			if (isCovered(x, y) && m_pDataMap[idx]) {
 				c.setRed(getMappedValueI(m_pData[idx], mapping, rangeMapping, minmax));
 			} else if (useAlpha) {
 				c.setRed(0);
@@ -536,7 +664,8 @@ void TypedPixelBox<vType>::setByteImageGreenChannel(QImage *image,
 		return;
 	}
 
-	if (!m_pCoverage || !m_pData) {
+	materialize();
+	if ((!m_pCoverage && !m_pCoverageMask) || !m_pData) {
 		dbgPrint(DBGLVL_ERROR, "TypedPixelBox::setByteImageGreenChannel(..)"
 		                       " no coverage or data!\n");
 		return;
@@ -546,7 +675,7 @@ void TypedPixelBox<vType>::setByteImageGreenChannel(QImage *image,
         for (x = 0; x < m_nWidth; x++) {
 			QColor c(image->pixel(x, y));
 			unsigned long idx = y*m_nWidth + x;
-			if (m_pCoverage[idx] &&	m_pDataMap[idx]) {
+			if (isCovered(x, y) && m_pDataMap[idx]) {
 				c.setGreen(getMappedValueI(m_pData[idx], mapping, rangeMapping, minmax));
 			} else if (useAlpha) {
 				c.setGreen(0);
@@ -574,7 +703,8 @@ void TypedPixelBox<vType>::setByteImageBlueChannel(QImage *image,
 		return;
 	}
 
-	if (!m_pCoverage || !m_pData) {
+	materialize();
+	if ((!m_pCoverage && !m_pCoverageMask) || !m_pData) {
 		dbgPrint(DBGLVL_ERROR, "TypedPixelBox::setByteImageBlueChannel(..)"
 		                       " no coverage or data!\n");
 		return;
@@ -584,7 +714,7 @@ void TypedPixelBox<vType>::setByteImageBlueChannel(QImage *image,
         for (x = 0; x < m_nWidth; x++) {
 			QColor c(image->pixel(x, y));
 			unsigned long idx = y*m_nWidth + x;
-			if (m_pCoverage[idx] &&	m_pDataMap[idx]) {
+			if (isCovered(x, y) && m_pDataMap[idx]) {
 				c.setBlue(getMappedValueI(m_pData[idx], mapping, rangeMapping, minmax));
 			} else if (useAlpha) {
 				c.setBlue(0);
@@ -626,8 +756,14 @@ template <typename vType>
 bool TypedPixelBox<vType>::getDataValue(int x, int y, vType *v)
 {
 	int i;
-	if (m_pCoverage && m_pData && m_pCoverage[y*m_nWidth + x] &&
-	    m_pDataMap[y*m_nWidth + x]) {
+	if (m_pSparseMask && isCovered(x, y) && m_pDataMap[y*m_nWidth + x]) {
+		/* the pixel has data, so it is covered in the sparse mask */
+		int j = m_pSparseMask->rank(y*m_nWidth + x);
+		for (i = 0; i < m_nChannel; i++) {
+			v[i] = m_pSparseData[m_nChannel*j + i];
+		}
+		return true;
+	} else if (m_pData && isCovered(x, y) && m_pDataMap[y*m_nWidth + x]) {
 		for (i = 0; i < m_nChannel; i++) {
 			v[i] = m_pData[m_nChannel*(y*m_nWidth + x) + i];
 		}
@@ -40,6 +40,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QtGui/QImage>
 
 #include "mappings.h"
+#include "coverageMask.h"
 
 class PixelBox : public QObject
 {
@@ -50,6 +51,10 @@ public:
     virtual ~PixelBox();
 
     void setNewCoverage(bool* i_pCoverage) { m_pCoverage = i_pCoverage; }
+    /* the bitset the bool map of setNewCoverage was expanded from */
+    void setCoverageMask(const CoverageMask *i_pMask) { m_pCoverageMask = i_pMask; }
+    const CoverageMask* getCoverageMask(void) { return m_pCoverageMask; }
+    bool isCovered(int x, int y);
     
     virtual bool* getCoverageFromData(int *i_pActivePixels = NULL) = 0;
     bool* getCoveragePointer(void) { return m_pCoverage; }
@@ -105,6 +110,7 @@ protected:
     int    m_nChannel;
     bool  *m_pDataMap;
     bool  *m_pCoverage;
+    const CoverageMask *m_pCoverageMask;
     QRect m_minMaxArea;
 };
 
@@ -113,6 +119,11 @@ template <typename vType> class TypedPixelBox : public PixelBox
 public:
     TypedPixelBox(int i_nWidth, int i_nHeight, int i_nChannel,
              vType *i_pData, bool *i_pCoverage = 0, QObject *i_qParent = 0);
+    /* sparse box holding values for the covered pixels of i_pMask only, the
+     * dense data is built when it is first needed
+     */
+    TypedPixelBox(const CoverageMask *i_pMask, int i_nChannel, vType *i_pValues,
+             bool *i_pCoverage = 0, QObject *i_qParent = 0);
     TypedPixelBox(TypedPixelBox *src);
     virtual ~TypedPixelBox();
 
@@ -121,7 +132,8 @@ public:
     void addPixelBox(TypedPixelBox *f);
     
     virtual bool* getCoverageFromData(int *i_pActivePixels = NULL);
-    vType* getDataPointer(void) { return m_pData; }
+    vType* getDataPointer(void) { materialize(); return m_pData; }
+    bool isSparse(void) { return m_pSparseMask != NULL; }
 	bool getDataValue(int x, int y, vType *v);
 	virtual bool getDataValue(int x, int y, QVariant *v);
 
@@ -157,9 +169,14 @@ protected:
 	static const vType sc_maxVal;
 
     void calcMinMax(QRect area);
+    void calcMinMaxSparse(int left, int top, int right, int bottom);
     int mapFromValue(FBMapping i_eMapping, vType i_nF, int i_nC);
+    void materialize(void);
     
     vType *m_pData;
+    /* set while the box is sparse, m_pData is NULL then */
+    CoverageMask *m_pSparseMask;
+    vType *m_pSparseData;
     vType *m_nMinData;
     vType *m_nMaxData;
     vType *m_nAbsMinData;
@@ -169,6 +186,7 @@ protected:
 typedef TypedPixelBox<float> PixelBoxFloat;
 typedef TypedPixelBox<int> PixelBoxInt;
 typedef TypedPixelBox<unsigned int> PixelBoxUInt;
+typedef TypedPixelBox<unsigned char> PixelBoxUByte;
 
 // include template definitions
 #include "pixelBox.inl.h"
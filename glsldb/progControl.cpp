@@ -39,19 +39,25 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif /* _WIN32 */
 
 #include <QtGui/QApplication>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QTimer>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #ifndef _WIN32
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/ptrace.h>
 #include <sys/shm.h>
 #include <sched.h>
+#include <signal.h>
+#include <fcntl.h>
 #endif /* !_WIN32 */
 #include <errno.h>
 #include "utils/dbgprint.h"
+#include "utils/timer.h"
 
 #ifdef GLSLDB_OSX
 #  include <signal.h>
@@ -99,9 +105,101 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DBG_FUNCTIONS_PATH "/../lib/plugins"
 #endif /* _WIN32 */
 
+/* results are copied in chunks of this size, checking for cancellation */
+#define COPY_CHUNK_SIZE (1 << 20)
+
+#ifndef _WIN32
+/* SIGCHLD, i.e. any stop or exit of the debuggee, writes a byte to this pipe
+ * for the event loop
+ */
+static int sigchldPipe[2] = { -1, -1 };
+static struct sigaction prevSigchldAction;
+
+static void sigchldHandler(int sig, siginfo_t *info, void *context)
+{
+	int savedErrno = errno;
+	char c = 0;
+
+	/* fails only if the pipe is full, i.e. a wakeup is pending anyway */
+	if (write(sigchldPipe[1], &c, 1) < 0) {
+	}
+	errno = savedErrno;
+
+	/* chain e.g. to QProcess */
+	if (prevSigchldAction.sa_flags & SA_SIGINFO) {
+		if (prevSigchldAction.sa_sigaction) {
+			prevSigchldAction.sa_sigaction(sig, info, context);
+		}
+	} else if (prevSigchldAction.sa_handler != SIG_DFL &&
+	           prevSigchldAction.sa_handler != SIG_IGN) {
+		prevSigchldAction.sa_handler(sig);
+	}
+}
+
+/* returns the read end of the pipe or -1 */
+static int initSigchldPipe(void)
+{
+	struct sigaction action;
+	int i;
+
+	if (sigchldPipe[0] != -1) {
+		return sigchldPipe[0];
+	}
+	if (pipe(sigchldPipe)) {
+		dbgPrint(DBGLVL_WARNING, "creating SIGCHLD pipe failed: %s\n",
+		         strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < 2; i++) {
+		fcntl(sigchldPipe[i], F_SETFL,
+		      fcntl(sigchldPipe[i], F_GETFL) | O_NONBLOCK);
+		fcntl(sigchldPipe[i], F_SETFD, FD_CLOEXEC);
+	}
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = sigchldHandler;
+	action.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	if (sigaction(SIGCHLD, &action, &prevSigchldAction)) {
+		dbgPrint(DBGLVL_WARNING, "installing SIGCHLD handler failed: %s\n",
+		         strerror(errno));
+		close(sigchldPipe[0]);
+		close(sigchldPipe[1]);
+		sigchldPipe[0] = sigchldPipe[1] = -1;
+		return -1;
+	}
+	return sigchldPipe[0];
+}
+#endif /* !_WIN32 */
+
 ProgramControl::ProgramControl(const char *pname)
 {
     debuggedProgramPID = 0;
+    memset(&stepTiming, 0, sizeof(stepTiming));
+    stepTransferTime = 0;
+    debuggeeNotifier = NULL;
+    debuggeePollTimer = NULL;
+    watchingDebuggee = false;
+	thread = new ProgramControlThread(this, this);
+	connect(thread, SIGNAL(commandFinished(PcCommand*)),
+	        this, SIGNAL(commandFinished(PcCommand*)));
+	thread->start();
+#ifndef _WIN32
+	int fd = initSigchldPipe();
+	if (fd != -1) {
+		debuggeeNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+		connect(debuggeeNotifier, SIGNAL(activated(int)),
+		        this, SLOT(readDebuggeeNotification()));
+	}
+#endif /* !_WIN32 */
+	if (!debuggeeNotifier) {
+		/* the debuggee signals an event that is consumed by
+		 * checkChildStatus, so there is nothing to wait for here
+		 */
+		debuggeePollTimer = new QTimer(this);
+		debuggeePollTimer->setInterval(5);
+		connect(debuggeePollTimer, SIGNAL(timeout()),
+		        this, SIGNAL(debuggeeStateChanged()));
+	}
     buildEnvVars(pname);
     initShmem();
 #ifdef _WIN32
@@ -116,6 +214,7 @@ ProgramControl::ProgramControl(const char *pname)
 
 ProgramControl::~ProgramControl()
 {
+	thread->stop();
     dbgPrint(DBGLVL_DEBUG, "~ProgramControl freeShmem()\n");
     freeShmem();
 	free(debuglib);
@@ -130,19 +229,156 @@ ProgramControl::~ProgramControl()
 #endif /* _WIN32 */
 }
 
+/* forwards one tracer operation of another thread */
+class ProgramControl::TracerCall : public PcCommand {
+public:
+	TracerCall(TracerOp op, void *dst, void *src, size_t size)
+	{
+		this->op = op;
+		this->dst = dst;
+		this->src = src;
+		this->size = size;
+	}
+
+	pcErrorCode execute(ProgramControl *pc)
+	{
+		return pc->tracerOperation(op, dst, src, size);
+	}
+
+private:
+	TracerOp op;
+	void *dst;
+	void *src;
+	size_t size;
+};
+
+pcErrorCode ProgramControl::tracerCall(TracerOp op, void *dst, void *src,
+                                       size_t size)
+{
+	TracerCall cmd(op, dst, src, size);
+	return thread->call(&cmd);
+}
+
+pcErrorCode ProgramControl::tracerOperation(TracerOp op, void *dst, void *src,
+                                            size_t size)
+{
+	switch (op) {
+		case TRACER_RUN_PROGRAM:
+			return runProgram((char**)dst, (char*)src);
+		case TRACER_KILL_PROGRAM:
+			return killProgram((int)size);
+		case TRACER_CHECK_CHILD_STATUS:
+			return checkChildStatus();
+		case TRACER_EXECUTE_DBG_COMMAND:
+			return executeDbgCommand();
+		case TRACER_CONTINUE:
+			return continueDebuggee();
+		case TRACER_COPY_FROM_PROCESS:
+			return copyFromProcess(dst, src, size);
+		case TRACER_COPY_TO_PROCESS:
+			return copyToProcess(dst, src, size);
+		default:
+			return PCE_UNKNOWN_ERROR;
+	}
+}
+
+void ProgramControl::post(PcCommand *cmd)
+{
+	thread->post(cmd);
+}
+
+bool ProgramControl::commandCancelled(void)
+{
+	PcCommand *cmd = thread->isCurrent() ? thread->currentCommand() : NULL;
+	return cmd && cmd->isCancelled();
+}
+
+/* lets the debuggee run without waiting for it to stop again */
+pcErrorCode ProgramControl::continueDebuggee(void)
+{
+	if (!thread->isCurrent()) {
+		return tracerCall(TRACER_CONTINUE);
+	}
+#ifdef _WIN32
+	::SetEvent(this->hEvtDebugee);
+#else /* _WIN32 */
+	ptrace(PTRACE_CONT, debuggedProgramPID, 0, 0);
+#endif /* _WIN32 */
+	return PCE_NONE;
+}
+
+pcErrorCode ProgramControl::copyFromProcess(void *dst, void *src, size_t size)
+{
+	size_t offset, n;
+
+	if (!thread->isCurrent()) {
+		return tracerCall(TRACER_COPY_FROM_PROCESS, dst, src, size);
+	}
+	for (offset = 0; offset < size; offset += n) {
+		if (commandCancelled()) {
+			return PCE_CANCELLED;
+		}
+		n = size - offset < COPY_CHUNK_SIZE ? size - offset : COPY_CHUNK_SIZE;
+		cpyFromProcess(debuggedProgramPID, (char*)dst + offset,
+		               (char*)src + offset, n);
+	}
+	return PCE_NONE;
+}
+
+pcErrorCode ProgramControl::copyToProcess(void *dst, void *src, size_t size)
+{
+	if (!thread->isCurrent()) {
+		return tracerCall(TRACER_COPY_TO_PROCESS, dst, src, size);
+	}
+	cpyToProcess(debuggedProgramPID, dst, src, size);
+	return PCE_NONE;
+}
+
+void ProgramControl::watchDebuggee(bool enable)
+{
+	watchingDebuggee = enable;
+	if (debuggeePollTimer) {
+		if (enable) {
+			debuggeePollTimer->start();
+		} else {
+			debuggeePollTimer->stop();
+		}
+	}
+}
+
+void ProgramControl::readDebuggeeNotification(void)
+{
+#ifndef _WIN32
+	char buffer[64];
+
+	while (read(sigchldPipe[0], buffer, sizeof(buffer)) > 0) {
+	}
+#endif /* !_WIN32 */
+	if (watchingDebuggee) {
+		emit debuggeeStateChanged();
+	}
+}
+
 bool ProgramControl::childAlive(void)
 {
 #ifndef _WIN32
-	int status = 15;
-	pid_t pid = -1;
+	siginfo_t info;
 	
 	dbgPrint(DBGLVL_INFO, "get childStatus...\n");
-	pid = waitpid(debuggedProgramPID, &status, WUNTRACED |WNOHANG);
-		
-	if (pid == -1) {
+
+	/* only peek, a stop must be left for checkChildStatus */
+	info.si_pid = 0;
+	if (waitid(P_PID, debuggedProgramPID, &info,
+	           WEXITED | WSTOPPED | WNOHANG | WNOWAIT) == -1) {
 		dbgPrint(DBGLVL_WARNING, "no child!\n");
 		return false;
 	}
+	if (info.si_pid == debuggedProgramPID &&
+	    (info.si_code == CLD_EXITED || info.si_code == CLD_KILLED ||
+	     info.si_code == CLD_DUMPED)) {
+		dbgPrint(DBGLVL_INFO, "child terminated\n");
+		return false;
+	}
 	return true;
 #else /* !_WIN32 */
 	/* TODO: chekc this code!! */
@@ -184,6 +420,10 @@ pcErrorCode ProgramControl::checkChildStatus(void)
 	pid_t pid = -1;
 	int errorStatus = EINTR;
 	ALIGNED_DATA newPid;
+
+	if (!thread->isCurrent()) {
+		return tracerCall(TRACER_CHECK_CHILD_STATUS);
+	}
 	
 	while (pid == -1 && errorStatus == EINTR) {
 		dbgPrint(DBGLVL_DEBUG, "checkChildStatus...\n");
@@ -370,6 +610,9 @@ pcErrorCode ProgramControl::checkChildStatus(void)
 
 pcErrorCode ProgramControl::executeDbgCommand(void)
 {
+	if (!thread->isCurrent()) {
+		return tracerCall(TRACER_EXECUTE_DBG_COMMAND);
+	}
 #ifdef _WIN32
 	if (!::SetEvent(this->hEvtDebugee)) {
 		OutputDebugStringA("Set event failed\n");
@@ -645,14 +888,14 @@ void* ProgramControl::copyArgumentFromProcess(void *addr, int type)
     void *r = NULL;
     
     r = malloc(getArgumentSize(type));
-    cpyFromProcess(debuggedProgramPID, r, addr, getArgumentSize(type));
+    copyFromProcess(r, addr, getArgumentSize(type));
 
     return r;
 }
 
 void ProgramControl::copyArgumentToProcess(void *dst, void *src, int type)
 {
-    cpyToProcess(debuggedProgramPID, dst, src, getArgumentSize(type));
+    copyToProcess(dst, src, getArgumentSize(type));
 }
 
 char* ProgramControl::printArgument(void *addr, int type)
@@ -664,84 +907,84 @@ char* ProgramControl::printArgument(void *addr, int type)
 
 	switch (type) {
 	case DBG_TYPE_CHAR:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(char));
+		copyFromProcess(tmp, addr, sizeof(char));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%i", *(char*)tmp); 
 		asprintf(&argString, "%i", *(char*)tmp); 
 		break;
 	case DBG_TYPE_UNSIGNED_CHAR:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(unsigned char));
+		copyFromProcess(tmp, addr, sizeof(unsigned char));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%i", *(unsigned char*)tmp); 
 		asprintf(&argString, "%i", *(unsigned char*)tmp); 
 		break;
 	case DBG_TYPE_SHORT_INT:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(short));
+		copyFromProcess(tmp, addr, sizeof(short));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%i", *(short*)tmp); 
 		asprintf(&argString, "%i", *(short*)tmp); 
 		break;
 	case DBG_TYPE_UNSIGNED_SHORT_INT:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(unsigned short));
+		copyFromProcess(tmp, addr, sizeof(unsigned short));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%i", *(unsigned short*)tmp); 
 		asprintf(&argString, "%i", *(unsigned short*)tmp); 
 		break;
 	case DBG_TYPE_INT:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(int));
+		copyFromProcess(tmp, addr, sizeof(int));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%i", *(int*)tmp); 
 		asprintf(&argString, "%i", *(int*)tmp); 
 		break;
 	case DBG_TYPE_UNSIGNED_INT:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(unsigned int));
+		copyFromProcess(tmp, addr, sizeof(unsigned int));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%u", *(unsigned int*)tmp); 
 		asprintf(&argString, "%u", *(unsigned int*)tmp); 
 		break;
 	case DBG_TYPE_LONG_INT:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(long));
+		copyFromProcess(tmp, addr, sizeof(long));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%li", *(long*)tmp); 
 		asprintf(&argString, "%li", *(long*)tmp); 
 		break;
 	case DBG_TYPE_UNSIGNED_LONG_INT:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(unsigned long));
+		copyFromProcess(tmp, addr, sizeof(unsigned long));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%lu", *(unsigned long*)tmp); 
 		asprintf(&argString, "%lu", *(unsigned long*)tmp); 
 		break;
 	case DBG_TYPE_LONG_LONG_INT:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(long long));
+		copyFromProcess(tmp, addr, sizeof(long long));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%lli", *(long long*)tmp); 
 		asprintf(&argString, "%lli", *(long long*)tmp); 
 		break;
 	case DBG_TYPE_UNSIGNED_LONG_LONG_INT:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(unsigned long long));
+		copyFromProcess(tmp, addr, sizeof(unsigned long long));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%llu", *(unsigned long long*)tmp); 
 		asprintf(&argString, "%llu", *(unsigned long long*)tmp); 
 		break;
 	case DBG_TYPE_FLOAT:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(float));
+		copyFromProcess(tmp, addr, sizeof(float));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%f", *(float*)tmp); 
 		asprintf(&argString, "%f", *(float*)tmp); 
 		break;
 	case DBG_TYPE_DOUBLE:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(double));
+		copyFromProcess(tmp, addr, sizeof(double));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%f", *(double*)tmp); 
 		asprintf(&argString, "%f", *(double*)tmp); 
 		break;
 	case DBG_TYPE_POINTER:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(void*));
+		copyFromProcess(tmp, addr, sizeof(void*));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%p", *(void**)tmp); 
 		asprintf(&argString, "%p", *(void**)tmp); 
 		break;
 	case DBG_TYPE_BOOLEAN:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(GLboolean));
+		copyFromProcess(tmp, addr, sizeof(GLboolean));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%s", *(GLboolean*)tmp ? "TRUE" : "FALSE");
 		asprintf(&argString, "%s", *(GLboolean*)tmp ? "TRUE" : "FALSE");
 		break;
 	case DBG_TYPE_BITFIELD:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(GLbitfield));
+		copyFromProcess(tmp, addr, sizeof(GLbitfield));
 		s  = dissectBitfield(*(GLbitfield*)tmp);
 		dbgPrintNoPrefix(DBGLVL_INFO, "%s", s);
 		asprintf(&argString, "%s", s);
 		free(s);
 		break;
 	case DBG_TYPE_ENUM:
-		cpyFromProcess(debuggedProgramPID, tmp, addr, sizeof(GLenum));
+		copyFromProcess(tmp, addr, sizeof(GLenum));
 		dbgPrintNoPrefix(DBGLVL_INFO, "%s", lookupEnum(*(GLenum*)tmp));
 		asprintf(&argString, "%s", lookupEnum(*(GLenum*)tmp));
 		break;
@@ -873,12 +1116,7 @@ pcErrorCode ProgramControl::dbgCommandExecute(bool stopOnGLError)
 	if (error != PCE_NONE) {
 		return error;
 	}
-#ifdef _WIN32
-	::SetEvent(this->hEvtDebugee);
-#else /* _WIN32 */
-	ptrace(PTRACE_CONT, debuggedProgramPID, 0, 0);
-#endif /* _WIN32 */
-	return PCE_NONE;
+	return continueDebuggee();
 }
 
 pcErrorCode ProgramControl::dbgCommandExecuteToDrawCall(bool stopOnGLError)
@@ -892,12 +1130,7 @@ pcErrorCode ProgramControl::dbgCommandExecuteToDrawCall(bool stopOnGLError)
 	if (error != PCE_NONE) {
 		return error;
 	}
-#ifdef _WIN32
-	::SetEvent(this->hEvtDebugee);
-#else /* _WIN32 */
-	ptrace(PTRACE_CONT, debuggedProgramPID, 0, 0);
-#endif /* _WIN32 */
-	return PCE_NONE;
+	return continueDebuggee();
 }
 
 pcErrorCode ProgramControl::dbgCommandExecuteToShaderSwitch(bool stopOnGLError)
@@ -911,12 +1144,7 @@ pcErrorCode ProgramControl::dbgCommandExecuteToShaderSwitch(bool stopOnGLError)
 	if (error != PCE_NONE) {
 		return error;
 	}
-#ifdef _WIN32
-	::SetEvent(this->hEvtDebugee);
-#else /* _WIN32 */
-	ptrace(PTRACE_CONT, debuggedProgramPID, 0, 0);
-#endif /* _WIN32 */
-	return PCE_NONE;
+	return continueDebuggee();
 }
 
 pcErrorCode ProgramControl::dbgCommandExecuteToUserDefined(const char *fname,
@@ -932,12 +1160,22 @@ pcErrorCode ProgramControl::dbgCommandExecuteToUserDefined(const char *fname,
 	if (error != PCE_NONE) {
 		return error;
 	}
-#ifdef _WIN32
-	::SetEvent(this->hEvtDebugee);
-#else /* _WIN32 */
-	ptrace(PTRACE_CONT, debuggedProgramPID, 0, 0);
-#endif /* _WIN32 */
-	return PCE_NONE;
+	return continueDebuggee();
+}
+
+pcErrorCode ProgramControl::dbgCommandExecuteToBreakpoint(bool stopOnGLError)
+{
+	DbgRec *rec = getThreadRecord(debuggedProgramPID);
+	dbgPrint(DBGLVL_INFO, "send: DBG_EXECUTE (DBG_JUMP_TO_BREAKPOINT)\n");
+	getBreakpointTable()->hitBreakpoint = -1;
+	rec->operation = DBG_EXECUTE;
+	rec->items[0] = DBG_JUMP_TO_BREAKPOINT;
+	rec->items[1] = stopOnGLError ? 1 : 0;
+	pcErrorCode error = executeDbgCommand();
+	if (error != PCE_NONE) {
+		return error;
+	}
+	return continueDebuggee();
 }
 
 pcErrorCode ProgramControl::dbgCommandDone()
@@ -1296,18 +1534,41 @@ pcErrorCode ProgramControl::dbgCommandReadRenderBuffer(int numComponents,
 		*height = (int)rec->items[2];
 		/* TODO: check error */
 		*image = (float*)malloc(numComponents*(*width)*(*height)*sizeof(float));
-    	cpyFromProcess(debuggedProgramPID, *image, buffer,
-		               numComponents*(*width)*(*height)*sizeof(float));
+    	copyFromProcess(*image, buffer,
+		                numComponents*(*width)*(*height)*sizeof(float));
 		error = dbgCommandFreeMem(1, &buffer);
 	}
 	return error;
 }
 	
+static float halfToFloat(unsigned short h)
+{
+	unsigned int exponent = (h >> 10) & 0x1f;
+	unsigned int mantissa = h & 0x3ff;
+	unsigned int bits = (h & 0x8000u) << 16;
+	float v;
+
+	if (exponent == 0) {
+		/* zero or denormal */
+		v = (float)ldexp((double)mantissa, -24);
+		return (h & 0x8000) ? -v : v;
+	} else if (exponent == 31) {
+		bits |= 0x7f800000u | (mantissa << 13);
+	} else {
+		bits |= ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
 pcErrorCode ProgramControl::dbgCommandShaderStepFragment(void *shaders[3],
                                                          int numComponents,
                                                          int format,
                                                          int *width, int *height,
-                                                         void **image)
+                                                         void **image,
+                                                         bool sparse,
+                                                         int *numPixels,
+                                                         const int *roi)
 {
 	DbgRec *rec = getThreadRecord(debuggedProgramPID);
 	pcErrorCode error;
@@ -1320,6 +1581,10 @@ pcErrorCode ProgramControl::dbgCommandShaderStepFragment(void *shaders[3],
 	rec->items[3] = (ALIGNED_DATA)DBG_TARGET_FRAGMENT_SHADER;
 	rec->items[4] = (ALIGNED_DATA)numComponents;
 	rec->items[5] = (ALIGNED_DATA)format;
+	rec->items[6] = (ALIGNED_DATA)sparse;
+	for (int i = 0; i < 4; i++) {
+		rec->items[7 + i] = (ALIGNED_DATA)(roi ? roi[i] : 0);
+	}
 	error = executeDbgCommand();
 	if (error != PCE_NONE) {
 		return error;
@@ -1330,14 +1595,28 @@ pcErrorCode ProgramControl::dbgCommandShaderStepFragment(void *shaders[3],
 			void *buffer = (void*)rec->items[0];
 			*width = (int)rec->items[1];
 			*height = (int)rec->items[2];
-			if (!buffer || *width <= 0 || *height <= 0) {
+			int pixels = sparse ? (int)rec->items[3] : (*width)*(*height);
+			if (numPixels) {
+				*numPixels = pixels;
+			}
+			if (!buffer || *width <= 0 || *height <= 0 || pixels < 0 ||
+			    pixels > (*width)*(*height)) {
 				error = PCE_DBG_INVALID_VALUE;
 			} else {
-				int formatSize;
+				int formatSize, size;
 				switch (format) {
 					case GL_FLOAT:
 						formatSize = sizeof(float);
 						break;
+					case GL_BITMAP:
+						formatSize = 0;
+						break;
+					case GL_HALF_FLOAT_ARB:
+						formatSize = sizeof(GLhalfARB);
+						break;
+					case GL_UNSIGNED_BYTE:
+						formatSize = sizeof(GLubyte);
+						break;
 					case GL_INT:
 						formatSize = sizeof(int);
 						break;
@@ -1348,11 +1627,36 @@ pcErrorCode ProgramControl::dbgCommandShaderStepFragment(void *shaders[3],
 						return PCE_DBG_INVALID_VALUE;
 				}
 
-				*image = malloc(numComponents*(*width)*(*height)*formatSize);
-
-    			cpyFromProcess(debuggedProgramPID, *image, buffer,
-			    	           numComponents*(*width)*(*height)*formatSize);
+				if (format == GL_BITMAP) {
+					size = ((*width)*(*height) + 7)/8;
+				} else {
+					size = numComponents*pixels*formatSize;
+				}
+				long long t = getMonotonicTimeNs();
+				storeStepTiming(rec);
+				*image = malloc(size);
+
+    			error = copyFromProcess(*image, buffer, size);
+				if (error != PCE_NONE) {
+					dbgCommandFreeMem(1, &buffer);
+					free(*image);
+					*image = NULL;
+					return error;
+				}
 				error = dbgCommandFreeMem(1, &buffer);
+
+				/* half floats only save the transfer, callers get floats */
+				if (format == GL_HALF_FLOAT_ARB) {
+					int i, n = numComponents*pixels;
+					GLhalfARB *half = (GLhalfARB*)*image;
+					float *data = (float*)malloc(n*sizeof(float));
+					for (i = 0; i < n; i++) {
+						data[i] = halfToFloat(half[i]);
+					}
+					free(*image);
+					*image = data;
+				}
+				stepTransferTime += getMonotonicTimeNs() - t;
 			}
 		} else {
 			error = PCE_DBG_INVALID_VALUE;
@@ -1392,10 +1696,19 @@ pcErrorCode ProgramControl::dbgCommandShaderStepVertex(void *shaders[3],
 			void *buffer = (void*)rec->items[0];
 			*numVertices = (int)rec->items[1];
 			*numPrimitives = (int)rec->items[2];
+			long long t = getMonotonicTimeNs();
+			storeStepTiming(rec);
 			*vertexData = (float*)malloc(*numVertices*numFloatsPerVertex*sizeof(float));
-    		cpyFromProcess(debuggedProgramPID, *vertexData, buffer,
-		    	           *numVertices*numFloatsPerVertex*sizeof(float));
+    		error = copyFromProcess(*vertexData, buffer,
+		    	                    *numVertices*numFloatsPerVertex*sizeof(float));
+			if (error != PCE_NONE) {
+				dbgCommandFreeMem(1, &buffer);
+				free(*vertexData);
+				*vertexData = NULL;
+				return error;
+			}
 			error = dbgCommandFreeMem(1, &buffer);
+			stepTransferTime += getMonotonicTimeNs() - t;
 		} else {
 			error = PCE_DBG_INVALID_VALUE;
 		}
@@ -1406,6 +1719,11 @@ pcErrorCode ProgramControl::dbgCommandShaderStepVertex(void *shaders[3],
 pcErrorCode ProgramControl::runProgram(char **debuggedProgramArgs, char *workDir)
 {
 	pcErrorCode error;
+
+	/* the forking thread becomes the tracer */
+	if (!thread->isCurrent()) {
+		return tracerCall(TRACER_RUN_PROGRAM, debuggedProgramArgs, workDir);
+	}
 #ifndef _WIN32
     clearShmem();
 
@@ -1602,9 +1920,19 @@ FunctionCall* ProgramControl::getCurrentCall(void)
     fCall->setName(rec->fname);
     
     for (i = 0; i < (int)rec->numItems; i++) {
-        fCall->addArgument(rec->items[2*i+1], 
-            copyArgumentFromProcess((void*)rec->items[2*i], rec->items[2*i+1]),
-            (void*)rec->items[2*i]);
+        int type = (int)rec->items[2*i+1];
+        void *value;
+        if (rec->result == DBG_FUNCTION_CALL) {
+            /* the debuggee stored a snapshot of the values behind the
+             * address and type pairs
+             */
+            value = malloc(getArgumentSize(type));
+            memcpy(value, &rec->items[DBG_ARG_VALUE_ITEM(rec->numItems, i)],
+                   getArgumentSize(type));
+        } else {
+            value = copyArgumentFromProcess((void*)rec->items[2*i], type);
+        }
+        fCall->addArgument(type, value, (void*)rec->items[2*i]);
     }
 
     return fCall;
@@ -1669,13 +1997,12 @@ pcErrorCode ProgramControl::getShaderCode(char *shaders[3],
 				error = dbgCommandFreeMem(5, addr);
 				return PCE_MEMORY_ALLOCATION_FAILED;
             }
-            cpyFromProcess(debuggedProgramPID, shaders[i], addr[i], rec->items[2*i+1]);
+            copyFromProcess(shaders[i], addr[i], rec->items[2*i+1]);
 			shaders[i][rec->items[2*i+1]] = '\0';
         }
 
 		/* copy shader resource info */
-		cpyFromProcess(debuggedProgramPID, resource, addr[3],
-		               sizeof(TBuiltInResource));
+		copyFromProcess(resource, addr[3], sizeof(TBuiltInResource));
 
 		if (rec->items[7] > 0) {
 			*numUniforms = rec->items[7];
@@ -1691,8 +2018,7 @@ pcErrorCode ProgramControl::getShaderCode(char *shaders[3],
 				error = dbgCommandFreeMem(5, addr);
 				return PCE_MEMORY_ALLOCATION_FAILED;
             }
-			cpyFromProcess(debuggedProgramPID, *serializedUniforms,
-					addr[4], rec->items[8]);
+			copyFromProcess(*serializedUniforms, addr[4], rec->items[8]);
 		}
 		else
 		{
@@ -1791,7 +2117,7 @@ pcErrorCode ProgramControl::setDbgShaderCode(char *shaders[3], int target)
 				dbgCommandFreeMem(i, addr);
 				return error;
 			}
-			cpyToProcess(debuggedProgramPID, addr[i], shaders[i], size);
+			copyToProcess(addr[i], shaders[i], size);
 		} else {
 			addr[i] = NULL;
 		}
@@ -1985,7 +2311,9 @@ pcErrorCode ProgramControl::endReplay()
 
 pcErrorCode ProgramControl::shaderStepFragment(char *shaders[3],
                                                int numComponents, int format,
-                                               int *width, int *heigh, void **image)
+                                               int *width, int *heigh, void **image,
+                                               bool sparse, int *numPixels,
+                                               const int *roi)
 {
 	pcErrorCode error;
 	void *addr[3];
@@ -1998,6 +2326,7 @@ pcErrorCode ProgramControl::shaderStepFragment(char *shaders[3],
 #endif /* _WIN32 */
 
 	/* allocate client side memory and copy shader src */
+	long long t = getMonotonicTimeNs();
 	for (i = 0; i < 3; i++) {
 		if (shaders[i]) {
 			unsigned int size = strlen(shaders[i]) + 1;
@@ -2006,13 +2335,20 @@ pcErrorCode ProgramControl::shaderStepFragment(char *shaders[3],
 				dbgCommandFreeMem(i, addr);
 				return error;
 			}
-			cpyToProcess(debuggedProgramPID, addr[i], shaders[i], size);
+			copyToProcess(addr[i], shaders[i], size);
 		} else {
 			addr[i] = NULL;
 		}
 	}
+	stepTransferTime = getMonotonicTimeNs() - t;
+
+	if (commandCancelled()) {
+		dbgCommandFreeMem(3, addr);
+		return PCE_CANCELLED;
+	}
 	
-	error = dbgCommandShaderStepFragment(addr, numComponents, format, width, heigh, image);
+	error = dbgCommandShaderStepFragment(addr, numComponents, format, width,
+	                                     heigh, image, sparse, numPixels, roi);
 	if (error) {
 		dbgCommandFreeMem(3, addr);
 		return error;
@@ -2045,6 +2381,7 @@ pcErrorCode ProgramControl::shaderStepVertex(char *shaders[3], int target,
 #endif /* _WIN32 */
 
 	/* allocate client side memory and copy shader src */
+	long long t = getMonotonicTimeNs();
 	for (i = 0; i < 3; i++) {
 		if (shaders[i]) {
 			unsigned int size = strlen(shaders[i]) + 1;
@@ -2053,11 +2390,12 @@ pcErrorCode ProgramControl::shaderStepVertex(char *shaders[3], int target,
 				dbgCommandFreeMem(i, addr);
 				return error;
 			}
-			cpyToProcess(debuggedProgramPID, addr[i], shaders[i], size);
+			copyToProcess(addr[i], shaders[i], size);
 		} else {
 			addr[i] = NULL;
 		}
 	}
+	stepTransferTime = getMonotonicTimeNs() - t;
 
 	switch (primitiveMode) {
 		case GL_POINTS:
@@ -2086,6 +2424,11 @@ pcErrorCode ProgramControl::shaderStepVertex(char *shaders[3], int target,
 			dbgPrint(DBGLVL_WARNING, "Unknown primitive mode\n");
 			return PCE_DBG_INVALID_VALUE;
 	}
+
+	if (commandCancelled()) {
+		dbgCommandFreeMem(3, addr);
+		return PCE_CANCELLED;
+	}
 	
 	error = dbgCommandShaderStepVertex(addr, target, basePrimitiveMode,
 	                                   forcePointPrimitiveMode, numFloatsPerVertex,
@@ -2103,6 +2446,55 @@ pcErrorCode ProgramControl::shaderStepVertex(char *shaders[3], int target,
 	return error;
 }
 
+ShaderStepFragmentCommand::ShaderStepFragmentCommand(char *shaders[3],
+                                                     int numComponents,
+                                                     int format, bool sparse,
+                                                     const int *roi)
+{
+	for (int i = 0; i < 3; i++) {
+		this->shaders[i] = shaders[i];
+	}
+	this->numComponents = numComponents;
+	this->format = format;
+	this->sparse = sparse;
+	hasRoi = roi != NULL;
+	for (int i = 0; i < 4; i++) {
+		this->roi[i] = roi ? roi[i] : 0;
+	}
+	width = height = numPixels = 0;
+	image = NULL;
+}
+
+pcErrorCode ShaderStepFragmentCommand::execute(ProgramControl *pc)
+{
+	return pc->shaderStepFragment(shaders, numComponents, format, &width,
+	                              &height, &image, sparse, &numPixels,
+	                              hasRoi ? roi : NULL);
+}
+
+ShaderStepVertexCommand::ShaderStepVertexCommand(char *shaders[3], int target,
+                                                 int primitiveMode,
+                                                 int forcePointPrimitiveMode,
+                                                 int numFloatsPerVertex)
+{
+	for (int i = 0; i < 3; i++) {
+		this->shaders[i] = shaders[i];
+	}
+	this->target = target;
+	this->primitiveMode = primitiveMode;
+	this->forcePointPrimitiveMode = forcePointPrimitiveMode;
+	this->numFloatsPerVertex = numFloatsPerVertex;
+	numPrimitives = numVertices = 0;
+	vertexData = NULL;
+}
+
+pcErrorCode ShaderStepVertexCommand::execute(ProgramControl *pc)
+{
+	return pc->shaderStepVertex(shaders, target, primitiveMode,
+	                            forcePointPrimitiveMode, numFloatsPerVertex,
+	                            &numPrimitives, &numVertices, &vertexData);
+}
+
 pcErrorCode ProgramControl::callDone(void)
 {
 	pcErrorCode error;
@@ -2162,6 +2554,106 @@ pcErrorCode ProgramControl::executeToUserDefined(const char *fname,
 
 }
 
+pcErrorCode ProgramControl::executeToBreakpoint(bool stopOnGLError)
+{
+#ifdef _WIN32
+	::SwitchToThread();
+#else /* _WIN32 */
+	sched_yield();
+#endif /* _WIN32 */
+	return dbgCommandExecuteToBreakpoint(stopOnGLError);
+}
+
+/* Breakpoints are read by the debuggee directly from shared memory, so they
+ * may only be changed while it is stopped. Hit counts are reset.
+ */
+void ProgramControl::setBreakpoints(const DbgBreakpoint *breakpoints,
+                                    int numBreakpoints)
+{
+	DbgBreakpointTable *table = getBreakpointTable();
+	int i;
+
+	if (numBreakpoints > DBG_MAX_BREAKPOINTS) {
+		dbgPrint(DBGLVL_WARNING, "Only %i of %i breakpoints are used\n",
+		         DBG_MAX_BREAKPOINTS, numBreakpoints);
+		numBreakpoints = DBG_MAX_BREAKPOINTS;
+	}
+	for (i = 0; i < numBreakpoints; i++) {
+		table->breakpoints[i] = breakpoints[i];
+		table->breakpoints[i].hits = 0;
+	}
+	table->numBreakpoints = numBreakpoints;
+	table->hitBreakpoint = -1;
+}
+
+int ProgramControl::getBreakpointHit(int *hits)
+{
+	DbgBreakpointTable *table = getBreakpointTable();
+	int idx = (int)table->hitBreakpoint;
+
+	if (hits) {
+		*hits = idx >= 0 ? (int)table->breakpoints[idx].hits : 0;
+	}
+	return idx;
+}
+
+long ProgramControl::getFrameNumber(void)
+{
+	return (long)getBreakpointTable()->frame;
+}
+
+void ProgramControl::setCallStatisticsMode(int mode)
+{
+	DbgCallStatisticsTable *table = (DbgCallStatisticsTable*)((char*)fcalls +
+	                                     SHM_CALL_STATISTICS_OFFSET);
+	table->mode = mode;
+}
+
+const DbgCallStatisticsTable* ProgramControl::getCallStatistics(void)
+{
+	return (const DbgCallStatisticsTable*)((char*)fcalls +
+	                                       SHM_CALL_STATISTICS_OFFSET);
+}
+
+void ProgramControl::setDrawTimingEnabled(bool enabled)
+{
+	DbgDrawTimingTable *table = (DbgDrawTimingTable*)((char*)fcalls +
+	                                SHM_DRAW_TIMINGS_OFFSET);
+	table->enabled = enabled ? 1 : 0;
+}
+
+const DbgDrawTimingTable* ProgramControl::getDrawTimings(void)
+{
+	return (const DbgDrawTimingTable*)((char*)fcalls +
+	                                   SHM_DRAW_TIMINGS_OFFSET);
+}
+
+void ProgramControl::storeStepTiming(const DbgRec *rec)
+{
+	if (rec->numItems >= (ALIGNED_DATA)(DBG_STEP_TIMING_ITEM +
+	                                    DBG_STEP_TIMING_NUM_ITEMS)) {
+		memcpy(&stepTiming, &rec->items[DBG_STEP_TIMING_ITEM],
+		       sizeof(DbgStepTiming));
+	} else {
+		memset(&stepTiming, 0, sizeof(DbgStepTiming));
+	}
+}
+
+const DbgStepTiming* ProgramControl::getStepTiming(void) const
+{
+	return &stepTiming;
+}
+
+long long ProgramControl::getStepTransferTime(void) const
+{
+	return stepTransferTime;
+}
+
+DbgBreakpointTable* ProgramControl::getBreakpointTable(void)
+{
+	return (DbgBreakpointTable*)((char*)fcalls + SHM_BREAKPOINTS_OFFSET);
+}
+
 pcErrorCode ProgramControl::stop(void)
 {
 #ifdef _WIN32
@@ -2195,16 +2687,17 @@ pcErrorCode ProgramControl::executeContinueOnError(void)
 {
 #ifdef _WIN32
 	::SwitchToThread();
-	::SetEvent(this->hEvtDebugee);
 #else /* _WIN32 */
 	sched_yield();
-    ptrace(PTRACE_CONT, debuggedProgramPID, 0, 0);
 #endif /* _WIN32 */
-	return PCE_NONE;
+	return continueDebuggee();
 }
 
 pcErrorCode ProgramControl::killProgram(int hard)
 {
+	if (!thread->isCurrent()) {
+		return tracerCall(TRACER_KILL_PROGRAM, NULL, NULL, hard);
+	}
 	dbgPrint(DBGLVL_INFO, "CHILD KILLED: %i\n", hard);
 #ifdef _WIN32
     if (this->ai.hProcess != NULL) {
@@ -2270,20 +2763,20 @@ void ProgramControl::initShmem(void)
 
 	_snprintf(shmemName, SHMEM_NAME_LEN, "%uSHM", GetCurrentProcessId());
 	/* this creates a non-inheritable shared memory mapping! */
-	hShMem = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, SHM_SIZE, shmemName);
+	hShMem = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, SHM_TOTAL_SIZE, shmemName);
 	if (hShMem == NULL || hShMem == INVALID_HANDLE_VALUE) {
 		dbgPrint(DBGLVL_ERROR, "Creation of shared mem segment %s failed: %u\n", shmemName, GetLastError());
 		exit(1);
 	}
 	/* FILE_MAP_WRITE implies read */
-	fcalls = (DbgRec*)MapViewOfFile(hShMem, FILE_MAP_WRITE, 0, 0, SHM_SIZE);
+	fcalls = (DbgRec*)MapViewOfFile(hShMem, FILE_MAP_WRITE, 0, 0, SHM_TOTAL_SIZE);
 	if (fcalls == NULL) {
 		dbgPrint(DBGLVL_ERROR, "View mapping of shared mem segment %s failed: %u\n", shmemName, GetLastError());
 		exit(1);
 	}
 #undef SHMEM_NAME_LEN
 #else /* _WIN32 */
-    shmid = shmget(IPC_PRIVATE, SHM_SIZE, SHM_R | SHM_W);
+    shmid = shmget(IPC_PRIVATE, SHM_TOTAL_SIZE, SHM_R | SHM_W);
 
     if (shmid == -1) {
         dbgPrint(DBGLVL_ERROR, "Creation of shared mem segment failed %s\n", strerror(errno));
@@ -2301,7 +2794,9 @@ void ProgramControl::initShmem(void)
 
 void ProgramControl::clearShmem(void)
 {
-    memset(fcalls, 0, SHM_SIZE);
+    memset(fcalls, 0, SHM_TOTAL_SIZE);
+    getBreakpointTable()->hitBreakpoint = -1;
+    setCallStatisticsMode(DBG_CALL_STATISTICS_COUNT);
 }
 
 void ProgramControl::freeShmem(void)
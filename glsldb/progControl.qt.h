@@ -39,10 +39,13 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #else /* _WIN32 */
 #include <sys/wait.h>
 #endif /* _WIN32 */
+#include <QtCore/QObject>
+
 #include "errorCodes.h"
 #include "functionCall.h"
 #include "../GLSLCompiler/glslang/Public/ResourceLimits.h"
 #include "attachToProcess.qt.h"
+#include "progControlThread.qt.h"
 
 
 extern "C" {
@@ -53,7 +56,11 @@ extern "C" {
   #include "utils/p2pcopy.h"
 }
 
-class ProgramControl {
+class QSocketNotifier;
+class QTimer;
+
+class ProgramControl : public QObject {
+	Q_OBJECT
 
 public:
     ProgramControl(const char *pname);
@@ -76,9 +83,36 @@ public:
 	pcErrorCode executeToShaderSwitch(bool stopOnGLError);
 	pcErrorCode executeToDrawCall(bool stopOnGLError);
 	pcErrorCode executeToUserDefined(const char *fname, bool stopOnGLError);
+	pcErrorCode executeToBreakpoint(bool stopOnGLError);
 	pcErrorCode checkExecuteState(int *state);
 	pcErrorCode executeContinueOnError(void);
 	pcErrorCode stop(void);
+
+	/* runs cmd on the thread tracing the debuggee, commandFinished(cmd) is
+	 * emitted here once it finished; other calls must not overlap it
+	 */
+	void post(PcCommand *cmd);
+
+	/* true if the command running on the tracing thread was cancelled */
+	bool commandCancelled(void);
+
+	/* while watching, debuggeeStateChanged is emitted whenever the debuggee
+	 * may have stopped or terminated
+	 */
+	void watchDebuggee(bool enable);
+
+	/* conditional breakpoints evaluated by the debuggee */
+	void setBreakpoints(const DbgBreakpoint *breakpoints, int numBreakpoints);
+	int getBreakpointHit(int *hits = 0);
+	long getFrameNumber(void);
+
+	/* statistics of calls executed without trace, polled while running */
+	void setCallStatisticsMode(int mode);
+	const DbgCallStatisticsTable* getCallStatistics(void);
+
+	/* GPU time of draw calls executed without trace */
+	void setDrawTimingEnabled(bool enabled);
+	const DbgDrawTimingTable* getDrawTimings(void);
 	
 	pcErrorCode callOrigFunc(const FunctionCall *fCall = 0);
     pcErrorCode callDone(void);
@@ -105,14 +139,26 @@ public:
 	pcErrorCode saveActiveShader(void);
 	pcErrorCode restoreActiveShader(void);
 
+	/* with sparse set, image holds only the *numPixels pixels covered in the
+	 * last GL_BITMAP step if *numPixels < width*height; roi (x, y, width,
+	 * height) limits drawing to a region of the image, see debuglib.h
+	 */
 	pcErrorCode shaderStepFragment(char *shaders[3], int numComponents,
-	                               int format, int *width, int *heigh, void **image);
+	                               int format, int *width, int *heigh, void **image,
+	                               bool sparse = false, int *numPixels = NULL,
+	                               const int *roi = NULL);
 	pcErrorCode shaderStepVertex(char *shaders[3], int target,
 	                             int primitiveMode,
 	                             int forcePointPrimitiveMode,
 								 int numFloatsPerVertex,
 	                             int *numPrimitives, int *numVertices,
 	                             float **vertexData);
+
+	/* phases of the last successful shader step inside the debuggee and the
+	 * ns spent copying its shaders and result between the processes
+	 */
+	const DbgStepTiming* getStepTiming(void) const;
+	long long getStepTransferTime(void) const;
 	
 	/* obsolete? */
     pcErrorCode setDbgShaderCode(char *shaders[3], int target);
@@ -126,7 +172,37 @@ public:
 	
 	pcErrorCode insertGlEnd(void);
 
+signals:
+	void debuggeeStateChanged(void);
+	void commandFinished(PcCommand *cmd);
+
+private slots:
+	void readDebuggeeNotification(void);
+
 private:
+	/* ptrace must come from the thread that forked the debuggee, calls of
+	 * these on other threads are forwarded to it
+	 */
+	enum TracerOp {
+		TRACER_RUN_PROGRAM,
+		TRACER_KILL_PROGRAM,
+		TRACER_CHECK_CHILD_STATUS,
+		TRACER_EXECUTE_DBG_COMMAND,
+		TRACER_CONTINUE,
+		TRACER_COPY_FROM_PROCESS,
+		TRACER_COPY_TO_PROCESS
+	};
+	class TracerCall;
+	pcErrorCode tracerCall(TracerOp op, void *dst = NULL, void *src = NULL,
+	                       size_t size = 0);
+	pcErrorCode tracerOperation(TracerOp op, void *dst, void *src,
+	                            size_t size);
+	pcErrorCode continueDebuggee(void);
+	pcErrorCode copyFromProcess(void *dst, void *src, size_t size);
+	pcErrorCode copyToProcess(void *dst, void *src, size_t size);
+
+	ProgramControlThread *thread;
+
     unsigned int getArgumentSize(int type);
     
     /* process environment communication */
@@ -148,6 +224,7 @@ private:
 	pcErrorCode dbgCommandExecuteToShaderSwitch(bool stopOnGLError);
 	pcErrorCode dbgCommandExecuteToUserDefined(const char *fname,
 	                                           bool stopOnGLError);
+	pcErrorCode dbgCommandExecuteToBreakpoint(bool stopOnGLError);
 	pcErrorCode dbgCommandStopExecution(void);
     pcErrorCode dbgCommandCallOrig(void);
     pcErrorCode dbgCommandCallOrig(const FunctionCall *fCall);
@@ -170,7 +247,9 @@ private:
 	pcErrorCode dbgCommandRestartQueries(void);
 	pcErrorCode dbgCommandShaderStepFragment(void *shaders[3],
 	                                         int numComponents, int format,
-	                                         int *width, int *height, void **image);
+	                                         int *width, int *height, void **image,
+	                                         bool sparse, int *numPixels,
+	                                         const int *roi);
 	pcErrorCode dbgCommandShaderStepVertex(void *shaders[3], int target,
 	                                       int primitiveMode,
 	                                       int forcePointPrimitiveMode,
@@ -180,6 +259,7 @@ private:
 	pcErrorCode dbgCommandReadRenderBuffer(int numComponents, int *width,
 	                                       int *height, float **image);
     pcErrorCode dbgCommandDone(void);
+	void storeStepTiming(const DbgRec *rec);
     void* copyArgumentFromProcess(void *addr, int type);
     void  copyArgumentToProcess(void *dst, void *src, int type);
     char* printArgument(void *addr, int type);
@@ -194,6 +274,7 @@ private:
     void initShmem(void);
     void clearShmem(void);
     void freeShmem(void);
+    DbgBreakpointTable* getBreakpointTable(void);
 #ifndef _WIN32
     DbgRec* getThreadRecord(pid_t pid);
 #else /* _WIN32 */
@@ -202,6 +283,16 @@ private:
 
     int shmid;
     DbgRec *fcalls;
+
+	DbgStepTiming stepTiming;
+	long long stepTransferTime;
+
+	/* SIGCHLD of the debuggee, see initSigchldPipe; the timer polls where
+	 * no such notification exists
+	 */
+	QSocketNotifier *debuggeeNotifier;
+	QTimer *debuggeePollTimer;
+	bool watchingDebuggee;
     char *debuglib;
     char *dbgFunctionsPath;
     char *libdlsym;
@@ -230,4 +321,39 @@ private:
 };
 
 
+/* shaderStepFragment as a command, the results are valid once it finished
+ * with PCE_NONE
+ */
+class ShaderStepFragmentCommand : public PcCommand {
+public:
+	ShaderStepFragmentCommand(char *shaders[3], int numComponents, int format,
+	                          bool sparse = false, const int *roi = NULL);
+	pcErrorCode execute(ProgramControl *pc);
+
+	int width, height, numPixels;
+	void *image;
+
+private:
+	char *shaders[3];
+	int numComponents, format;
+	bool sparse, hasRoi;
+	int roi[4];
+};
+
+/* shaderStepVertex as a command */
+class ShaderStepVertexCommand : public PcCommand {
+public:
+	ShaderStepVertexCommand(char *shaders[3], int target, int primitiveMode,
+	                        int forcePointPrimitiveMode,
+	                        int numFloatsPerVertex);
+	pcErrorCode execute(ProgramControl *pc);
+
+	int numPrimitives, numVertices;
+	float *vertexData;
+
+private:
+	char *shaders[3];
+	int target, primitiveMode, forcePointPrimitiveMode, numFloatsPerVertex;
+};
+
 #endif
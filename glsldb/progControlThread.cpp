@@ -0,0 +1,189 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#include <stdlib.h>
+#include <QtCore/QMetaType>
+
+#include "progControlThread.qt.h"
+
+PcCommand::PcCommand()
+{
+	done = false;
+	cancelled = false;
+	notify = false;
+	error = PCE_NONE;
+}
+
+PcCommand::~PcCommand()
+{
+}
+
+void PcCommand::cancel(void)
+{
+	QMutexLocker locker(&mutex);
+	cancelled = true;
+}
+
+bool PcCommand::isCancelled(void) const
+{
+	QMutexLocker locker(&mutex);
+	return cancelled;
+}
+
+bool PcCommand::isFinished(void) const
+{
+	QMutexLocker locker(&mutex);
+	return done;
+}
+
+pcErrorCode PcCommand::getError(void) const
+{
+	QMutexLocker locker(&mutex);
+	return error;
+}
+
+pcErrorCode PcCommand::wait(void)
+{
+	QMutexLocker locker(&mutex);
+	while (!done) {
+		finished.wait(&mutex);
+	}
+	return error;
+}
+
+void PcCommand::finish(pcErrorCode e)
+{
+	QMutexLocker locker(&mutex);
+	error = e;
+	done = true;
+	finished.wakeAll();
+}
+
+ProgramControlThread::ProgramControlThread(ProgramControl *pc, QObject *parent)
+	: QThread(parent)
+{
+	this->pc = pc;
+	current = NULL;
+	stopping = false;
+	qRegisterMetaType<PcCommand*>("PcCommand*");
+}
+
+ProgramControlThread::~ProgramControlThread()
+{
+	stop();
+}
+
+void ProgramControlThread::enqueue(PcCommand *cmd, bool notify)
+{
+	cmd->notify = notify;
+	QMutexLocker locker(&mutex);
+	queue.enqueue(cmd);
+	queued.wakeOne();
+}
+
+void ProgramControlThread::post(PcCommand *cmd)
+{
+	enqueue(cmd, true);
+}
+
+pcErrorCode ProgramControlThread::call(PcCommand *cmd)
+{
+	if (isCurrent()) {
+		/* nested in the running command, which stays current so that
+		 * cancelling it also stops this part
+		 */
+		cmd->finish(cmd->execute(pc));
+		return cmd->getError();
+	}
+	enqueue(cmd, false);
+	return cmd->wait();
+}
+
+void ProgramControlThread::stop(void)
+{
+	mutex.lock();
+	stopping = true;
+	queued.wakeAll();
+	mutex.unlock();
+	wait();
+}
+
+bool ProgramControlThread::isCurrent(void) const
+{
+	return QThread::currentThread() == this;
+}
+
+PcCommand* ProgramControlThread::currentCommand(void) const
+{
+	return current;
+}
+
+void ProgramControlThread::run(void)
+{
+	for (;;) {
+		PcCommand *cmd;
+		pcErrorCode error;
+		bool notify;
+
+		mutex.lock();
+		while (queue.isEmpty() && !stopping) {
+			queued.wait(&mutex);
+		}
+		if (queue.isEmpty()) {
+			mutex.unlock();
+			return;
+		}
+		cmd = queue.dequeue();
+		current = cmd;
+		mutex.unlock();
+
+		if (cmd->isCancelled()) {
+			error = PCE_CANCELLED;
+		} else {
+			error = cmd->execute(pc);
+		}
+
+		mutex.lock();
+		current = NULL;
+		mutex.unlock();
+
+		/* a caller waiting in call() deletes cmd right after finish,
+		 * posted commands live until commandFinished was delivered
+		 */
+		notify = cmd->notify;
+		cmd->finish(error);
+		if (notify) {
+			emit commandFinished(cmd);
+		}
+	}
+}
@@ -0,0 +1,121 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef _PROG_CONTROL_THREAD_H_
+#define _PROG_CONTROL_THREAD_H_
+
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QQueue>
+
+#include "errorCodes.h"
+
+class ProgramControl;
+
+/* A unit of work for the debuggee. Commands execute in order on the
+ * ProgramControlThread, the only thread that may trace the debuggee. The
+ * poster owns a command and must not delete it before commandFinished(cmd)
+ * was delivered.
+ */
+class PcCommand {
+public:
+	PcCommand();
+	virtual ~PcCommand();
+
+	/* runs on the ProgramControlThread */
+	virtual pcErrorCode execute(ProgramControl *pc) = 0;
+
+	/* a queued command is skipped, a running one returns PCE_CANCELLED at
+	 * its next check of isCancelled
+	 */
+	void cancel(void);
+	bool isCancelled(void) const;
+
+	bool isFinished(void) const;
+	pcErrorCode getError(void) const;
+
+	/* blocks until the command finished, returns its error */
+	pcErrorCode wait(void);
+
+private:
+	friend class ProgramControlThread;
+	void finish(pcErrorCode error);
+
+	mutable QMutex mutex;
+	QWaitCondition finished;
+	bool done;
+	bool cancelled;
+	bool notify;
+	pcErrorCode error;
+};
+
+class ProgramControlThread : public QThread {
+	Q_OBJECT
+
+public:
+	ProgramControlThread(ProgramControl *pc, QObject *parent = 0);
+	~ProgramControlThread();
+
+	/* queues cmd, commandFinished(cmd) is emitted once it finished */
+	void post(PcCommand *cmd);
+
+	/* executes cmd and waits for it, directly if called on this thread */
+	pcErrorCode call(PcCommand *cmd);
+
+	/* finishes the queued commands and ends the thread */
+	void stop(void);
+
+	bool isCurrent(void) const;
+
+	/* the command executing, only meaningful on this thread */
+	PcCommand* currentCommand(void) const;
+
+signals:
+	void commandFinished(PcCommand *cmd);
+
+protected:
+	void run(void);
+
+private:
+	void enqueue(PcCommand *cmd, bool notify);
+
+	ProgramControl *pc;
+	QMutex mutex;
+	QWaitCondition queued;
+	QQueue<PcCommand*> queue;
+	PcCommand *current;
+	bool stopping;
+};
+
+#endif
@@ -44,6 +44,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 #include "GL/gl.h"
+#include "GL/glext.h"
 
 typedef enum {
     DF_NAME = 0,
@@ -266,18 +267,22 @@ QString ShVarItem::getFullName(void)
     return data(DF_FULLNAME).toString();
 }
 
-int ShVarItem::getReadbackFormat()
+/* integers are always read exactly, floats as half floats if the user
+ * accepts reduced precision
+ */
+int ShVarItem::getReadbackFormat(bool reducedPrecision)
 {
 	int varType = data(DF_TYPE).toInt();
 
 	switch (varType)
 	{
 		case SH_FLOAT:
-			return GL_FLOAT;
+			return reducedPrecision ? GL_HALF_FLOAT_ARB : GL_FLOAT;
 		case SH_INT:
 			return GL_INT;
-		case SH_UINT:
 		case SH_BOOL:
+			return GL_UNSIGNED_BYTE;
+		case SH_UINT:
 		case SH_SAMPLER_1D:
 		case SH_ISAMPLER_1D:
 		case SH_USAMPLER_1D:
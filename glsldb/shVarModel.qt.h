@@ -177,7 +177,7 @@ public:
 	bool      isUniform(void);
 	bool      isActiveUniform(void);
     QString   getFullName(void);
-	int getReadbackFormat();
+	int getReadbackFormat(bool reducedPrecision = false);
 
 	void setCurrentValue(int key0, int key1, int key2);
 	void setCurrentValue(int key0, int key1);
@@ -0,0 +1,683 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#endif
+
+#include "capture.h"
+#include "dbgprint.h"
+
+#define ALIGN(n) (((n) + CAPTURE_ALIGNMENT - 1) & ~(unsigned long long)(CAPTURE_ALIGNMENT - 1))
+
+/* pad size bytes of data to the alignment */
+static int writePadding(CaptureWriter *w, unsigned long long size)
+{
+	static const char padding[CAPTURE_ALIGNMENT];
+	unsigned long long aligned = ALIGN(size);
+
+	if (aligned != size && fwrite(padding, aligned - size, 1, w->fp) != 1) {
+		return errno ? errno : EIO;
+	}
+	w->offset += aligned - size;
+	return 0;
+}
+
+static int writeData(CaptureWriter *w, const void *data, unsigned long long size)
+{
+	if (size && fwrite(data, size, 1, w->fp) != 1) {
+		return errno ? errno : EIO;
+	}
+	w->offset += size;
+	return writePadding(w, size);
+}
+
+/* chunk data may be given in two parts to avoid copying */
+static int writeChunk(CaptureWriter *w, unsigned int type,
+                      const void *head, unsigned long long headSize,
+                      const void *data, unsigned long long dataSize)
+{
+	CaptureChunk chunk;
+	int error;
+
+	chunk.type = type;
+	chunk.reserved = 0;
+	chunk.size = headSize + dataSize;
+	if ((error = writeData(w, &chunk, sizeof(chunk)))) {
+		return error;
+	}
+	if (headSize && fwrite(head, headSize, 1, w->fp) != 1) {
+		return errno ? errno : EIO;
+	}
+	w->offset += headSize;
+	return writeData(w, data, dataSize);
+}
+
+/* a blob chunk of the capture; lookup keys point to the data instead */
+typedef struct {
+	unsigned long long hash;
+	unsigned long long size;
+	unsigned long long offset;
+	const void *data;
+	CaptureWriter *w;
+} CaptureBlob;
+
+/* compare data with the blob written at offset */
+static int compWrittenBlob(CaptureWriter *w, unsigned long long offset,
+                           const char *data, unsigned long long size)
+{
+	char buffer[4096];
+
+	if (fseek(w->fp, offset + sizeof(CaptureChunk), SEEK_SET)) {
+		return 0;
+	}
+	while (size > 0) {
+		size_t n = size < sizeof(buffer) ? size : sizeof(buffer);
+		if (fread(buffer, n, 1, w->fp) != 1 || memcmp(buffer, data, n)) {
+			return 0;
+		}
+		data += n;
+		size -= n;
+	}
+	return 1;
+}
+
+static unsigned int hashBlob(void *key)
+{
+	return (unsigned int)((CaptureBlob*)key)->hash;
+}
+
+static int compBlob(void *key1, void *key2)
+{
+	CaptureBlob *b1 = (CaptureBlob*)key1;
+	CaptureBlob *b2 = (CaptureBlob*)key2;
+
+	if (b1->hash != b2->hash || b1->size != b2->size) {
+		return 0;
+	}
+	if (b1->data && b2->data) {
+		return !memcmp(b1->data, b2->data, b1->size);
+	}
+	/* the written blobs have distinct contents */
+	if (!b1->data && !b2->data) {
+		return b1->offset == b2->offset;
+	}
+	return b1->data ? compWrittenBlob(b1->w, b2->offset, b1->data, b1->size) :
+	                  compWrittenBlob(b1->w, b1->offset, b2->data, b1->size);
+}
+
+/* offset of the blob chunk holding data, written now if the capture does not
+ * have it yet
+ */
+static int writeBlob(CaptureWriter *w, const void *data,
+                     unsigned long long size, unsigned long long *offset)
+{
+	CaptureBlob key, *blob;
+	int error;
+
+	key.hash = hashBytes(data, size);
+	key.size = size;
+	key.offset = 0;
+	key.data = data;
+	key.w = w;
+	blob = hash_find_prehashed(&w->blobs, &key, (unsigned int)key.hash);
+	/* reading back the candidates moved the file position */
+	if (fseek(w->fp, w->offset, SEEK_SET)) {
+		return errno ? errno : EIO;
+	}
+	if (blob) {
+		w->sharedSize += size;
+		*offset = blob->offset;
+		return 0;
+	}
+
+	if (!(blob = malloc(sizeof(CaptureBlob)))) {
+		return ENOMEM;
+	}
+	*blob = key;
+	blob->data = NULL;
+	blob->offset = w->offset;
+	if ((error = writeChunk(w, CAPTURE_CHUNK_BLOB, NULL, 0, data, size))) {
+		free(blob);
+		return error;
+	}
+	hash_insert_prehashed(&w->blobs, blob, (unsigned int)blob->hash, blob);
+	w->blobSize += size;
+	*offset = blob->offset;
+	return 0;
+}
+
+int captureCreate(CaptureWriter *w, const char *filename, unsigned int slotSize,
+                  int numStrings, const char *const *strings)
+{
+	CaptureHeader header;
+	CaptureStrings table;
+	unsigned int *offsets;
+	char *names;
+	unsigned int length = 0;
+	int i, error;
+
+	memset(w, 0, sizeof(*w));
+	/* blobs are read back to compare their content */
+	if (!(w->fp = fopen(filename, "w+b"))) {
+		return errno;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+	header.version = CAPTURE_VERSION;
+	header.headerSize = sizeof(header);
+	header.slotSize = slotSize;
+	w->slotSize = slotSize;
+	header.pointerSize = sizeof(void*);
+	if ((error = writeData(w, &header, sizeof(header)))) {
+		fclose(w->fp);
+		return error;
+	}
+
+	/* string table: offsets followed by the names */
+	for (i = 0; i < numStrings; i++) {
+		length += (strings[i] ? strlen(strings[i]) : 0) + 1;
+	}
+	offsets = malloc(numStrings*sizeof(unsigned int) + length);
+	if (!offsets) {
+		fclose(w->fp);
+		return ENOMEM;
+	}
+	names = (char*)(offsets + numStrings);
+	length = 0;
+	for (i = 0; i < numStrings; i++) {
+		const char *s = strings[i] ? strings[i] : "";
+		offsets[i] = length;
+		strcpy(names + length, s);
+		length += strlen(s) + 1;
+	}
+	table.numStrings = numStrings;
+	table.reserved = 0;
+	error = writeChunk(w, CAPTURE_CHUNK_STRINGS, &table, sizeof(table), offsets,
+	                   numStrings*sizeof(unsigned int) + length);
+	free(offsets);
+	if (error || fflush(w->fp)) {
+		fclose(w->fp);
+		return error ? error : errno;
+	}
+	hash_create(&w->blobs, hashBlob, compBlob, 256, 1);
+	return 0;
+}
+
+int captureWriteState(CaptureWriter *w, unsigned int version,
+                      const void *state, unsigned int size)
+{
+	CaptureState head;
+
+	head.version = version;
+	head.size = size;
+	w->pendingStateOffset = w->offset;
+	return writeChunk(w, CAPTURE_CHUNK_STATE, &head, sizeof(head), state, size);
+}
+
+int captureWriteStream(CaptureWriter *w, const CaptureStream *head,
+                       const void *code, const void *payload,
+                       const CapturePayloadRange *shared, int numShared)
+{
+	CaptureStream s = *head;
+	CaptureChunk chunk;
+	CaptureIndexEntry *entry;
+	CaptureBlobRef *refs = NULL;
+	unsigned long long codeSize, storedSize = s.payloadSize, offset = 0;
+	int i, error;
+
+	if (w->numIndexEntries == w->maxIndexEntries) {
+		int maxEntries = w->maxIndexEntries ? 2*w->maxIndexEntries : 256;
+		entry = realloc(w->index, maxEntries*sizeof(CaptureIndexEntry));
+		if (!entry) {
+			return ENOMEM;
+		}
+		w->index = entry;
+		w->maxIndexEntries = maxEntries;
+	}
+
+	/* blobs go before the stream, which then only has to refer to them */
+	if (numShared && !(refs = malloc(numShared*sizeof(CaptureBlobRef)))) {
+		return ENOMEM;
+	}
+	for (i = 0; i < numShared; i++) {
+		refs[i].payloadOffset = shared[i].offset;
+		refs[i].size = shared[i].size;
+		if ((error = writeBlob(w, (const char*)payload + shared[i].offset,
+		                       shared[i].size, &refs[i].blobOffset))) {
+			free(refs);
+			return error;
+		}
+		storedSize -= shared[i].size;
+	}
+
+	entry = &w->index[w->numIndexEntries];
+	entry->frame = s.frame;
+	entry->call = s.call;
+	entry->offset = w->offset;
+	entry->stateOffset = w->pendingStateOffset;
+
+	s.numBlobRefs = numShared;
+	s.reserved = 0;
+	codeSize = (unsigned long long)s.numSlots*w->slotSize;
+
+	chunk.type = CAPTURE_CHUNK_STREAM;
+	chunk.reserved = 0;
+	chunk.size = sizeof(s) + numShared*sizeof(CaptureBlobRef) + codeSize +
+	             storedSize;
+	if ((error = writeData(w, &chunk, sizeof(chunk))) ||
+	    (error = writeData(w, &s, sizeof(s))) ||
+	    (error = writeData(w, refs, numShared*sizeof(CaptureBlobRef))) ||
+	    (error = writeData(w, code, codeSize))) {
+		free(refs);
+		return error;
+	}
+	/* the payload between the blob ranges */
+	for (i = 0; i <= numShared; i++) {
+		unsigned long long end = i < numShared ? shared[i].offset :
+		                                         s.payloadSize;
+		if (end > offset && fwrite((const char*)payload + offset, end - offset,
+		                           1, w->fp) != 1) {
+			free(refs);
+			return errno ? errno : EIO;
+		}
+		if (i < numShared) {
+			offset = shared[i].offset + shared[i].size;
+		}
+	}
+	free(refs);
+	w->offset += storedSize;
+	if ((error = writePadding(w, storedSize))) {
+		return error;
+	}
+	if (fflush(w->fp)) {
+		return errno;
+	}
+	w->numIndexEntries++;
+	w->pendingStateOffset = 0;
+	return 0;
+}
+
+int captureClose(CaptureWriter *w)
+{
+	unsigned long long indexOffset = w->offset;
+	int error;
+
+	error = writeChunk(w, CAPTURE_CHUNK_INDEX, NULL, 0, w->index,
+	                   w->numIndexEntries*sizeof(CaptureIndexEntry));
+	if (!error) {
+		if (fseek(w->fp, offsetof(CaptureHeader, indexOffset), SEEK_SET) ||
+		    fwrite(&indexOffset, sizeof(indexOffset), 1, w->fp) != 1) {
+			error = errno ? errno : EIO;
+		}
+	}
+	if (fclose(w->fp) && !error) {
+		error = errno;
+	}
+	dbgPrint(DBGLVL_INFO, "capture: %i blobs with %llu bytes, %llu bytes "
+	         "shared\n", hash_count(&w->blobs), w->blobSize, w->sharedSize);
+	hash_free(&w->blobs);
+	free(w->index);
+	memset(w, 0, sizeof(*w));
+	return error;
+}
+
+static const CaptureChunk *chunkAt(const CaptureFile *f,
+                                   unsigned long long offset,
+                                   unsigned int type)
+{
+	const CaptureChunk *chunk;
+
+	if (offset + sizeof(CaptureChunk) > f->size) {
+		return NULL;
+	}
+	chunk = (const CaptureChunk*)(f->data + offset);
+	if (chunk->type != type ||
+	    chunk->size > f->size - offset - sizeof(CaptureChunk)) {
+		return NULL;
+	}
+	return chunk;
+}
+
+/* rebuild the index of a capture that was not closed */
+static int scanChunks(CaptureFile *f, unsigned long long offset)
+{
+	unsigned long long stateOffset = 0;
+	int maxEntries = 0;
+
+	while (offset + sizeof(CaptureChunk) <= f->size) {
+		const CaptureChunk *chunk = (const CaptureChunk*)(f->data + offset);
+		if (chunk->size > f->size - offset - sizeof(CaptureChunk)) {
+			/* truncated by a crash */
+			break;
+		}
+		if (chunk->type == CAPTURE_CHUNK_STATE) {
+			stateOffset = offset;
+		} else if (chunk->type == CAPTURE_CHUNK_STREAM &&
+		           chunk->size >= sizeof(CaptureStream)) {
+			const CaptureStream *s = (const CaptureStream*)(chunk + 1);
+			CaptureIndexEntry *entry;
+			if (f->numIndexEntries == maxEntries) {
+				maxEntries = maxEntries ? 2*maxEntries : 256;
+				entry = realloc(f->scannedIndex,
+				                maxEntries*sizeof(CaptureIndexEntry));
+				if (!entry) {
+					return ENOMEM;
+				}
+				f->scannedIndex = entry;
+			}
+			entry = &f->scannedIndex[f->numIndexEntries++];
+			entry->frame = s->frame;
+			entry->call = s->call;
+			entry->offset = offset;
+			entry->stateOffset = stateOffset;
+			stateOffset = 0;
+		}
+		offset += ALIGN(sizeof(CaptureChunk) + chunk->size);
+	}
+	f->index = f->scannedIndex;
+	dbgPrint(DBGLVL_WARNING, "capture was not closed, found %i streams\n",
+	         f->numIndexEntries);
+	return 0;
+}
+
+static int mapFile(CaptureFile *f, const char *filename)
+{
+#ifdef _WIN32
+	LARGE_INTEGER size;
+
+	f->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+	                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (f->file == INVALID_HANDLE_VALUE) {
+		return ENOENT;
+	}
+	if (!GetFileSizeEx(f->file, &size) || size.QuadPart == 0) {
+		CloseHandle(f->file);
+		return EINVAL;
+	}
+	f->size = size.QuadPart;
+	f->mapping = CreateFileMappingA(f->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!f->mapping) {
+		CloseHandle(f->file);
+		return EIO;
+	}
+	f->data = MapViewOfFile(f->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!f->data) {
+		CloseHandle(f->mapping);
+		CloseHandle(f->file);
+		return ENOMEM;
+	}
+#else
+	struct stat st;
+	void *data;
+
+	if ((f->fd = open(filename, O_RDONLY)) < 0) {
+		return errno;
+	}
+	if (fstat(f->fd, &st) || st.st_size == 0) {
+		close(f->fd);
+		return EINVAL;
+	}
+	f->size = st.st_size;
+	data = mmap(NULL, f->size, PROT_READ, MAP_SHARED, f->fd, 0);
+	if (data == MAP_FAILED) {
+		int error = errno;
+		close(f->fd);
+		return error;
+	}
+	f->data = data;
+#endif
+	return 0;
+}
+
+/* every offset of the table has to point to a name that ends in the chunk */
+static int readStrings(CaptureFile *f, const CaptureChunk *chunk)
+{
+	const CaptureStrings *strings = (const CaptureStrings*)(chunk + 1);
+	unsigned long long namesSize;
+	int i;
+
+	if (chunk->size < sizeof(CaptureStrings) ||
+	    strings->numStrings > (chunk->size - sizeof(CaptureStrings))/
+	                          sizeof(unsigned int)) {
+		return EINVAL;
+	}
+	f->numStrings = strings->numStrings;
+	f->stringOffsets = (const unsigned int*)(strings + 1);
+	f->strings = (const char*)(f->stringOffsets + f->numStrings);
+	namesSize = chunk->size - sizeof(CaptureStrings) -
+	            f->numStrings*sizeof(unsigned int);
+	for (i = 0; i < f->numStrings; i++) {
+		unsigned int o = f->stringOffsets[i];
+		if (o >= namesSize || !memchr(f->strings + o, '\0', namesSize - o)) {
+			f->numStrings = 0;
+			return EINVAL;
+		}
+	}
+	return 0;
+}
+
+int captureOpen(CaptureFile *f, const char *filename)
+{
+	const CaptureChunk *chunk;
+	unsigned long long offset;
+	int error;
+
+	memset(f, 0, sizeof(*f));
+	if ((error = mapFile(f, filename))) {
+		return error;
+	}
+	f->header = (const CaptureHeader*)f->data;
+	if (f->size < sizeof(CaptureHeader) ||
+	    memcmp(f->header->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) ||
+	    f->header->version != CAPTURE_VERSION ||
+	    f->header->pointerSize != sizeof(void*)) {
+		dbgPrint(DBGLVL_ERROR, "%s is not a supported capture\n", filename);
+		captureRelease(f);
+		return EINVAL;
+	}
+
+	offset = ALIGN(f->header->headerSize);
+	if (!(chunk = chunkAt(f, offset, CAPTURE_CHUNK_STRINGS))) {
+		captureRelease(f);
+		return EINVAL;
+	}
+	if ((error = readStrings(f, chunk))) {
+		dbgPrint(DBGLVL_ERROR, "%s has a corrupt string table\n", filename);
+		captureRelease(f);
+		return error;
+	}
+	offset += ALIGN(sizeof(CaptureChunk) + chunk->size);
+
+	if (f->header->indexOffset &&
+	    (chunk = chunkAt(f, f->header->indexOffset, CAPTURE_CHUNK_INDEX))) {
+		f->index = (const CaptureIndexEntry*)(chunk + 1);
+		f->numIndexEntries = chunk->size/sizeof(CaptureIndexEntry);
+	} else if ((error = scanChunks(f, offset))) {
+		captureRelease(f);
+		return error;
+	}
+	return 0;
+}
+
+void captureRelease(CaptureFile *f)
+{
+	if (f->data) {
+#ifdef _WIN32
+		UnmapViewOfFile(f->data);
+		CloseHandle(f->mapping);
+		CloseHandle(f->file);
+#else
+		munmap((void*)f->data, f->size);
+		close(f->fd);
+#endif
+	}
+	free(f->scannedIndex);
+	memset(f, 0, sizeof(*f));
+}
+
+const char *captureFunctionName(const CaptureFile *f, int id)
+{
+	if (id < 0 || id >= f->numStrings) {
+		return NULL;
+	}
+	return f->strings + f->stringOffsets[id];
+}
+
+int captureFindFrame(const CaptureFile *f, unsigned long long frame)
+{
+	int low = 0, high = f->numIndexEntries;
+
+	/* streams are written in frame order */
+	while (low < high) {
+		int mid = low + (high - low)/2;
+		if (f->index[mid].frame < frame) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+int captureGetStream(const CaptureFile *f, int n, CaptureStreamView *stream)
+{
+	const CaptureIndexEntry *entry;
+	const CaptureChunk *chunk;
+	const CaptureStream *s;
+	const CaptureBlobRef *refs;
+	unsigned long long codeSize, refsSize, storedSize, end = 0;
+	int i;
+
+	if (n < 0 || n >= f->numIndexEntries) {
+		return EINVAL;
+	}
+	entry = &f->index[n];
+	if (!(chunk = chunkAt(f, entry->offset, CAPTURE_CHUNK_STREAM)) ||
+	    chunk->size < sizeof(CaptureStream)) {
+		return EINVAL;
+	}
+	s = (const CaptureStream*)(chunk + 1);
+	refs = (const CaptureBlobRef*)(s + 1);
+	refsSize = (unsigned long long)s->numBlobRefs*sizeof(CaptureBlobRef);
+	codeSize = (unsigned long long)s->numSlots*f->header->slotSize;
+	if (refsSize + codeSize > chunk->size - sizeof(CaptureStream)) {
+		return EINVAL;
+	}
+
+	/* the blob ranges must lie in the payload, in order, and in blobs that
+	 * are large enough
+	 */
+	storedSize = s->payloadSize;
+	for (i = 0; i < (int)s->numBlobRefs; i++) {
+		const CaptureChunk *blob = chunkAt(f, refs[i].blobOffset,
+		                                   CAPTURE_CHUNK_BLOB);
+		if (refs[i].payloadOffset < end ||
+		    refs[i].payloadOffset > s->payloadSize ||
+		    refs[i].size > s->payloadSize - refs[i].payloadOffset ||
+		    !blob || blob->size < refs[i].size) {
+			return EINVAL;
+		}
+		end = refs[i].payloadOffset + refs[i].size;
+		storedSize -= refs[i].size;
+	}
+	if (storedSize > chunk->size - sizeof(CaptureStream) - refsSize - codeSize) {
+		return EINVAL;
+	}
+	if (s->drawSlot > s->numSlots ||
+	    s->objectsOffset > s->payloadSize ||
+	    (unsigned long long)s->numObjects*sizeof(CaptureObject) >
+	    s->payloadSize - s->objectsOffset) {
+		return EINVAL;
+	}
+
+	stream->frame = s->frame;
+	stream->call = s->call;
+	stream->numCalls = s->numCalls;
+	stream->numSlots = s->numSlots;
+	stream->numBlobRefs = s->numBlobRefs;
+	stream->blobRefs = refs;
+	stream->code = (const char*)refs + refsSize;
+	stream->payloadSize = s->payloadSize;
+	stream->payload = (const char*)stream->code + codeSize;
+	stream->drawSlot = s->drawSlot;
+	stream->objectsOffset = s->objectsOffset;
+	stream->numObjects = s->numObjects;
+	stream->state = NULL;
+	stream->stateSize = 0;
+	stream->stateVersion = 0;
+	if (entry->stateOffset &&
+	    (chunk = chunkAt(f, entry->stateOffset, CAPTURE_CHUNK_STATE))) {
+		const CaptureState *state = (const CaptureState*)(chunk + 1);
+		if (sizeof(CaptureState) + state->size <= chunk->size) {
+			stream->state = state + 1;
+			stream->stateSize = state->size;
+			stream->stateVersion = state->version;
+		}
+	}
+	return 0;
+}
+
+void captureReadPayload(const CaptureFile *f, const CaptureStreamView *stream,
+                        void *payload)
+{
+	const char *stored = stream->payload;
+	char *dst = payload;
+	unsigned long long offset = 0;
+	int i;
+
+	/* captureGetStream checked the refs */
+	for (i = 0; i <= stream->numBlobRefs; i++) {
+		const CaptureBlobRef *ref = &stream->blobRefs[i];
+		unsigned long long end = i < stream->numBlobRefs ? ref->payloadOffset :
+		                                                   stream->payloadSize;
+		memcpy(dst + offset, stored, end - offset);
+		stored += end - offset;
+		if (i < stream->numBlobRefs) {
+			memcpy(dst + end, f->data + ref->blobOffset + sizeof(CaptureChunk),
+			       ref->size);
+			offset = end + ref->size;
+		}
+	}
+}
@@ -0,0 +1,314 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <stdio.h>
+
+#include "common.h"
+#include "hash.h"
+
+/* Binary capture of recorded GL streams.
+ *
+ * A capture starts with a CaptureHeader followed by chunks, each of them a
+ * CaptureChunk and size bytes of data. The first chunk is the string table
+ * that maps the function ids used in the stream bytecode to names. Streams
+ * and optional state snapshots are appended as they are recorded; closing
+ * the capture appends an index of all streams sorted by frame and call and
+ * patches its offset into the header. Captures that were not closed, e.g.
+ * because the application crashed, are indexed by scanning their chunks.
+ *
+ * A stream usually ends with a draw call and then carries a snapshot of the
+ * objects the draw uses, see CaptureObject.
+ *
+ * Large read-only arrays are written once per capture as blob chunks; a
+ * stream leaves them out of its payload and refers to the blob instead, so
+ * vertex data or textures that do not change are stored only once for all
+ * frames.
+ *
+ * All values are stored in the byte order of the writer.
+ */
+
+#define CAPTURE_MAGIC   "GLSLCAP"
+#define CAPTURE_VERSION 3
+
+#define CAPTURE_CHUNK_STRINGS 1
+#define CAPTURE_CHUNK_STATE   2
+#define CAPTURE_CHUNK_STREAM  3
+#define CAPTURE_CHUNK_INDEX   4
+#define CAPTURE_CHUNK_BLOB    5
+
+/* every chunk starts at a multiple of this */
+#define CAPTURE_ALIGNMENT 8
+
+typedef struct {
+	char magic[8];
+	unsigned int version;
+	unsigned int headerSize;
+	/* size of a bytecode slot and of a pointer stored in it */
+	unsigned int slotSize;
+	unsigned int pointerSize;
+	/* 0 until the capture is closed */
+	unsigned long long indexOffset;
+} CaptureHeader;
+
+typedef struct {
+	unsigned int type;
+	unsigned int reserved;
+	unsigned long long size;
+} CaptureChunk;
+
+/* CAPTURE_CHUNK_STRINGS: numStrings offsets relative to the end of the
+ * offset array, each pointing to a NUL terminated name
+ */
+typedef struct {
+	unsigned int numStrings;
+	unsigned int reserved;
+} CaptureStrings;
+
+/* CAPTURE_CHUNK_STATE: an opaque state blob that belongs to the next stream
+ * chunk; version identifies the layout of the blob
+ */
+typedef struct {
+	unsigned int version;
+	unsigned int size;
+} CaptureState;
+
+/* CAPTURE_CHUNK_STREAM: numBlobRefs CaptureBlobRefs, numSlots bytecode slots
+ * and the payload of array arguments; payloadSize includes the ranges stored
+ * in blobs, which are left out of the chunk
+ */
+typedef struct {
+	unsigned long long frame;
+	unsigned long long call;
+	unsigned int numCalls;
+	unsigned int numSlots;
+	unsigned long long payloadSize;
+	unsigned int numBlobRefs;
+	/* slot of the draw call the objects were taken at, numSlots if the
+	 * stream has no draw call
+	 */
+	unsigned int drawSlot;
+	/* payload offset of numObjects CaptureObjects */
+	unsigned long long objectsOffset;
+	unsigned int numObjects;
+	unsigned int reserved;
+} CaptureStream;
+
+/* Objects bound for the draw call of a stream, taken right before it was
+ * executed. Names are the names the application used; data is a range of the
+ * stream payload. The fields that are not listed for a type are 0.
+ */
+/* name: program, 0 for fixed function; the shader, attribute and uniform
+ * objects that follow belong to it
+ */
+#define CAPTURE_OBJECT_PROGRAM   1
+/* target: shader type, data: NUL terminated source */
+#define CAPTURE_OBJECT_SHADER    2
+/* index: location, data: NUL terminated name */
+#define CAPTURE_OBJECT_ATTRIBUTE 3
+/* target: uniform type, data: NUL terminated name, padded to a multiple of
+ * 4 bytes, followed by the GLfloat, GLint or GLuint components
+ */
+#define CAPTURE_OBJECT_UNIFORM   4
+/* name, target; params: min and mag filter, wrap s, t and r, compare mode
+ * and function, base level, max level
+ */
+#define CAPTURE_OBJECT_TEXTURE   5
+/* an image of the last texture: target: face or texture target, level,
+ * format: internal format, size, dataFormat and dataType of data
+ */
+#define CAPTURE_OBJECT_IMAGE     6
+/* name, data: contents of the buffer */
+#define CAPTURE_OBJECT_BUFFER    7
+/* name bound to target on texture unit index, or to a buffer target */
+#define CAPTURE_OBJECT_BINDING   8
+/* a vertex array: target: 0 for generic attribute index, else the array
+ * (GL_VERTEX_ARRAY etc., index: texture unit of GL_TEXTURE_COORD_ARRAY);
+ * size[0]: components, dataType, params: enabled, normalized, stride, buffer;
+ * pointer: buffer offset, or client address with data holding vertices from
+ * 0 up to the largest index of the draw; the current value of a disabled
+ * generic attribute is data
+ */
+#define CAPTURE_OBJECT_ARRAY     9
+/* client index array of the draw: pointer: client address, dataType */
+#define CAPTURE_OBJECT_INDICES  10
+/* target: matrix mode, index: texture unit, data: 16 GLfloats */
+#define CAPTURE_OBJECT_MATRIX   11
+
+typedef struct {
+	unsigned int type;
+	unsigned int name;
+	unsigned int target;
+	int index;
+	int level;
+	unsigned int format;
+	int size[3];
+	unsigned int dataFormat;
+	unsigned int dataType;
+	int params[9];
+	unsigned long long pointer;
+	unsigned long long dataOffset;
+	unsigned long long dataSize;
+} CaptureObject;
+
+/* payload range of a stream stored in the blob chunk at blobOffset; the refs
+ * of a stream are sorted by payloadOffset and do not overlap
+ */
+typedef struct {
+	unsigned long long payloadOffset;
+	unsigned long long size;
+	unsigned long long blobOffset;
+} CaptureBlobRef;
+
+/* range of a payload the writer may store as a blob */
+typedef struct {
+	unsigned long long offset;
+	unsigned long long size;
+} CapturePayloadRange;
+
+/* CAPTURE_CHUNK_INDEX: an array of entries; offsets point to chunk headers,
+ * stateOffset is 0 if the stream has no state snapshot
+ */
+typedef struct {
+	unsigned long long frame;
+	unsigned long long call;
+	unsigned long long offset;
+	unsigned long long stateOffset;
+} CaptureIndexEntry;
+
+typedef struct {
+	FILE *fp;
+	unsigned int slotSize;
+	unsigned long long offset;
+	unsigned long long pendingStateOffset;
+	CaptureIndexEntry *index;
+	int numIndexEntries;
+	int maxIndexEntries;
+	/* content -> offset of the blob chunks written so far */
+	Hash blobs;
+	unsigned long long blobSize;
+	unsigned long long sharedSize;
+} CaptureWriter;
+
+/* a stream as seen through the mapping of a capture */
+typedef struct {
+	unsigned long long frame;
+	unsigned long long call;
+	int numCalls;
+	int numSlots;
+	const void *code;
+	/* payload only holds the ranges that are not in blobs, the complete
+	 * payloadSize bytes are assembled by captureReadPayload
+	 */
+	unsigned long long payloadSize;
+	const void *payload;
+	int numBlobRefs;
+	const CaptureBlobRef *blobRefs;
+	/* see CaptureStream */
+	int drawSlot;
+	unsigned long long objectsOffset;
+	int numObjects;
+	/* NULL if the stream has no state snapshot */
+	const void *state;
+	unsigned int stateSize;
+	unsigned int stateVersion;
+} CaptureStreamView;
+
+typedef struct {
+	const char *data;
+	unsigned long long size;
+	const CaptureHeader *header;
+	int numStrings;
+	const unsigned int *stringOffsets;
+	const char *strings;
+	const CaptureIndexEntry *index;
+	int numIndexEntries;
+	/* index built by scanning when the capture was not closed */
+	CaptureIndexEntry *scannedIndex;
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#else
+	int fd;
+#endif
+} CaptureFile;
+
+/* Create a capture and write its header and string table; the functions
+ * return 0 on success and an errno value else.
+ */
+UTILSLOCAL int captureCreate(CaptureWriter *w, const char *filename,
+                             unsigned int slotSize, int numStrings,
+                             const char *const *strings);
+
+/* append a state snapshot for the next stream */
+UTILSLOCAL int captureWriteState(CaptureWriter *w, unsigned int version,
+                                 const void *state, unsigned int size);
+
+/* append a recorded stream described by head, numBlobRefs is set by the
+ * writer; it is flushed so that it survives a crash. The shared ranges of the
+ * payload, sorted by offset, are stored as blobs unless an earlier stream of
+ * the capture had the same content.
+ */
+UTILSLOCAL int captureWriteStream(CaptureWriter *w, const CaptureStream *head,
+                                  const void *code, const void *payload,
+                                  const CapturePayloadRange *shared,
+                                  int numShared);
+
+/* append the index, patch the header, and close the file */
+UTILSLOCAL int captureClose(CaptureWriter *w);
+
+/* map a capture read-only; this does not touch the streams themselves */
+UTILSLOCAL int captureOpen(CaptureFile *f, const char *filename);
+
+UTILSLOCAL void captureRelease(CaptureFile *f);
+
+/* name of a function id, NULL if it is unknown */
+UTILSLOCAL const char *captureFunctionName(const CaptureFile *f, int id);
+
+/* index of the first stream of the first frame >= frame, numIndexEntries if
+ * there is none
+ */
+UTILSLOCAL int captureFindFrame(const CaptureFile *f, unsigned long long frame);
+
+/* the n-th stream in frame and call order; returns 0 on success */
+UTILSLOCAL int captureGetStream(const CaptureFile *f, int n,
+                                CaptureStreamView *stream);
+
+/* copy the complete payload of a stream, payloadSize bytes, to payload */
+UTILSLOCAL void captureReadPayload(const CaptureFile *f,
+                                   const CaptureStreamView *stream,
+                                   void *payload);
+
+#endif
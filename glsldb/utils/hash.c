@@ -35,146 +35,230 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "hash.h"
 
+/* robin hood hashing with backward shift deletion: an element never sits
+ * further from its home bucket than the one it displaced, which keeps probe
+ * sequences short even at high load
+ */
+
+#define HASH_MIN_BITS 4
+
+static int homeBucket(Hash *hash, unsigned int h)
+{
+	/* Fibonacci hashing spreads weak hash functions over the table */
+	return (int)((h * 2654435761u) >> (32 - hash->bits));
+}
+
+static void allocTable(Hash *hash, int bits)
+{
+	hash->bits = bits;
+	hash->numBuckets = 1 << bits;
+	/* TODO: mem check */
+	hash->table = (HashNode*)calloc(hash->numBuckets, sizeof(HashNode));
+}
+
+/* place a node known not to be in the table */
+static void placeNode(Hash *hash, HashNode node)
+{
+	int mask = hash->numBuckets - 1;
+	int i = homeBucket(hash, node.hash);
+
+	node.dist = 1;
+	for (;;) {
+		HashNode *slot = &hash->table[i];
+		if (slot->dist == 0) {
+			*slot = node;
+			return;
+		}
+		if (slot->dist < node.dist) {
+			HashNode tmp = *slot;
+			*slot = node;
+			node = tmp;
+		}
+		i = (i + 1) & mask;
+		node.dist++;
+	}
+}
+
+static void growTable(Hash *hash)
+{
+	HashNode *oldTable = hash->table;
+	int i, oldNumBuckets = hash->numBuckets;
+
+	allocTable(hash, hash->bits + 1);
+	for (i = 0; i < oldNumBuckets; i++) {
+		if (oldTable[i].dist) {
+			placeNode(hash, oldTable[i]);
+		}
+	}
+	free(oldTable);
+}
+
+static int findBucket(Hash *hash, void *key, unsigned int h)
+{
+	int mask = hash->numBuckets - 1;
+	int i = homeBucket(hash, h);
+	unsigned int dist = 1;
+
+	for (;;) {
+		HashNode *slot = &hash->table[i];
+		/* a richer slot means the key would have been placed before */
+		if (slot->dist < dist) {
+			return -1;
+		}
+		if (slot->hash == h && hash->compFunc(slot->key, key)) {
+			return i;
+		}
+		i = (i + 1) & mask;
+		dist++;
+	}
+}
+
 void hash_create(Hash *hash, HashFunc hashFunc, CompFunc compFunc,
                  int numBuckets, int freeDataPointers)
 {
-	int i;
-	hash->numBuckets = numBuckets;
+	int bits = HASH_MIN_BITS;
+
+	/* room for numBuckets elements below the maximum load */
+	while ((1 << bits) * 3 < numBuckets * 4) {
+		bits++;
+	}
 	hash->hashFunc = hashFunc;
 	hash->compFunc = compFunc;
 	hash->freeDataPointers = freeDataPointers;
-	/* TODO: mem check */
-	hash->table = (HashNode**)malloc(numBuckets*sizeof(HashNode*));
-	for (i = 0; i < numBuckets; i++) {
-		hash->table[i] = NULL;
-	}
+	hash->numElements = 0;
+	allocTable(hash, bits);
 }
 
 void hash_free(Hash *hash)
 {
 	int i;
 	
-	for (i = 0; i < hash->numBuckets; i++) {
-		if (hash->table[i]) {
-			HashNode *node = hash->table[i];
-			while (node) {
-				HashNode *next = node->next;
-				if (hash->freeDataPointers && node->data) {
-					free(node->data);
-				}
-				free(node);
-				node = next;
+	if (hash->freeDataPointers) {
+		for (i = 0; i < hash->numBuckets; i++) {
+			if (hash->table[i].dist && hash->table[i].data) {
+				free(hash->table[i].data);
 			}
 		}
 	}
 	free(hash->table);
 	hash->table = NULL;
 	hash->numBuckets = 0;
+	hash->numElements = 0;
 }
 
-int hash_insert(Hash *hash, void *key, void *data)
+unsigned int hash_key(Hash *hash, void *key)
 {
-	int n = hash->hashFunc(key, hash->numBuckets);
-	HashNode *node = hash->table[n];
-	HashNode *prev = NULL;
-	while (node) {
-		if (hash->compFunc(node->key, key)) {
-			node->data = data;
-			return 1;
-		}
-		prev = node;
-		node = node->next;
+	return hash->hashFunc(key);
+}
+
+int hash_insert_prehashed(Hash *hash, void *key, unsigned int h, void *data)
+{
+	HashNode node;
+	int i = findBucket(hash, key, h);
+
+	if (i >= 0) {
+		hash->table[i].data = data;
+		return 1;
 	}
-	if (prev == NULL) {
-		/* TODO: mem check */
-		hash->table[n] = (HashNode*)malloc(sizeof(HashNode));
-		node = hash->table[n];
-	} else {
-		/* TODO: mem check */
-		prev->next = (HashNode*)malloc(sizeof(HashNode));
-		node = prev->next;
+	/* keep the load below 3/4 */
+	if ((hash->numElements + 1) * 4 > hash->numBuckets * 3) {
+		growTable(hash);
 	}
-	node->data = data;
-	node->key = key;
-	node->next = NULL;
+	node.key = key;
+	node.data = data;
+	node.hash = h;
+	placeNode(hash, node);
+	hash->numElements++;
 	return 0;
 }
 
+int hash_insert(Hash *hash, void *key, void *data)
+{
+	return hash_insert_prehashed(hash, key, hash->hashFunc(key), data);
+}
+
 void hash_remove(Hash *hash, void *key)
 {
-	int n = hash->hashFunc(key, hash->numBuckets);
-	HashNode *node = hash->table[n];
-	HashNode *prev = node;
-	while (node) {
-		if (hash->compFunc(node->key, key)) {
-			if (prev == node) {
-				hash->table[n] = node->next;
-			} else {
-				prev->next = node->next;
-			}
-			if (hash->freeDataPointers && node->data) {
-				free(node->data);
-			}
-			free(node);
-			return;
-		}
-		prev = node;
-		node = node->next;
+	int mask = hash->numBuckets - 1;
+	int i = findBucket(hash, key, hash->hashFunc(key));
+	int next;
+
+	if (i < 0) {
+		return;
+	}
+	if (hash->freeDataPointers && hash->table[i].data) {
+		free(hash->table[i].data);
+	}
+	/* shift the following displaced nodes one bucket back */
+	next = (i + 1) & mask;
+	while (hash->table[next].dist > 1) {
+		hash->table[i] = hash->table[next];
+		hash->table[i].dist--;
+		i = next;
+		next = (next + 1) & mask;
 	}
+	hash->table[i].dist = 0;
+	hash->numElements--;
+}
+
+void *hash_find_prehashed(Hash *hash, void *key, unsigned int h)
+{
+	int i = findBucket(hash, key, h);
+
+	return i < 0 ? NULL : hash->table[i].data;
 }
 
 void *hash_find(Hash *hash, void *key)
 {
-	HashNode *node = hash->table[hash->hashFunc(key, hash->numBuckets)];
-	while (node) {
-		if (hash->compFunc(node->key, key)) {
-			return node->data;
-		}
-		node = node->next;
-	}
-	return NULL;
+	return hash_find_prehashed(hash, key, hash->hashFunc(key));
 }
 
 int hash_count(Hash *hash)
 {
-	int i, count = 0;
+	return hash->numElements;
+}
 
-	for (i = 0; i < hash->numBuckets; i++) {
-		if (hash->table[i]) {
-			HashNode *node = hash->table[i];
-			while (node) {
-				node = node->next;
-				count++;
-			}
+void *hash_element(Hash *hash, int n)
+{
+	HashIterator it;
+	void *data;
+
+	hash_iterator_init(hash, &it);
+	while (hash_next(hash, &it, NULL, &data)) {
+		if (n-- == 0) {
+			return data;
 		}
 	}
-	return count;
+	return NULL;
 }
 
-void *hash_element(Hash *hash, int n)
+void hash_iterator_init(Hash *hash, HashIterator *it)
+{
+	it->bucket = 0;
+}
+
+int hash_next(Hash *hash, HashIterator *it, void **key, void **data)
 {
-	int i, count = 0;
-
-	for (i = 0; i < hash->numBuckets; i++) {
-		if (hash->table[i]) {
-			HashNode *node = hash->table[i];
-			while (node) {
-				if (count == n) {
-					return node->data;
-				}
-				node = node->next;
-				count++;
+	while (it->bucket < hash->numBuckets) {
+		HashNode *slot = &hash->table[it->bucket++];
+		if (slot->dist) {
+			if (key) {
+				*key = slot->key;
+			}
+			if (data) {
+				*data = slot->data;
 			}
+			return 1;
 		}
 	}
-	return NULL;
+	return 0;
 }
 
 /* some common hash and comparison functions */
 
-int hashInt(void *key, int numBuckets)
+unsigned int hashInt(void *key)
 {
-	return *(int*)key % numBuckets;
+	return (unsigned int)*(int*)key;
 }
 
 int compInt(void *key1, void *key2)
@@ -182,15 +266,15 @@ int compInt(void *key1, void *key2)
 	return *(int*)key1 == *(int*)key2;
 }
 
-int hashString(void *key, int numBuckets)
+unsigned int hashString(void *key)
 {
-	char *s = (char *)key;
-	/* universal hash function, R. Sedgewick, Algorithms in C++, p. 593 */
-	int h, a = 31415, b = 27183;
-	for (h = 0; *s != 0; s++, a = a*b % (numBuckets - 1)) {
-		h = (a*h + *s) % numBuckets;
+	const unsigned char *s = (const unsigned char *)key;
+	/* FNV-1a */
+	unsigned int h = 2166136261u;
+	for (; *s != 0; s++) {
+		h = (h ^ *s) * 16777619u;
 	}
-	return (h < 0) ? (h + numBuckets) : h;
+	return h;
 }
 
 int compString(void *key1, void *key2)
@@ -198,4 +282,93 @@ int compString(void *key1, void *key2)
 	return !strcmp((const char*)key1, (const char*)key2);
 }
 
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
 
+static unsigned long long rotl64(unsigned long long x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static unsigned long long read64(const unsigned char *p)
+{
+	unsigned long long v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static unsigned long long read32(const unsigned char *p)
+{
+	unsigned int v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static unsigned long long round64(unsigned long long acc,
+                                  unsigned long long input)
+{
+	acc += input * PRIME64_2;
+	acc = rotl64(acc, 31);
+	return acc * PRIME64_1;
+}
+
+static unsigned long long mergeRound64(unsigned long long acc,
+                                       unsigned long long v)
+{
+	acc ^= round64(0, v);
+	return acc * PRIME64_1 + PRIME64_4;
+}
+
+unsigned long long hashBytes(const void *data, size_t size)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	const unsigned char *end = p + size;
+	unsigned long long h;
+
+	if (size >= 32) {
+		/* four independent lanes keep the multipliers busy */
+		unsigned long long v1 = PRIME64_1 + PRIME64_2;
+		unsigned long long v2 = PRIME64_2;
+		unsigned long long v3 = 0;
+		unsigned long long v4 = -PRIME64_1;
+		do {
+			v1 = round64(v1, read64(p));
+			v2 = round64(v2, read64(p + 8));
+			v3 = round64(v3, read64(p + 16));
+			v4 = round64(v4, read64(p + 24));
+			p += 32;
+		} while (p + 32 <= end);
+		h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+		h = mergeRound64(h, v1);
+		h = mergeRound64(h, v2);
+		h = mergeRound64(h, v3);
+		h = mergeRound64(h, v4);
+	} else {
+		h = PRIME64_5;
+	}
+	h += (unsigned long long)size;
+
+	for (; p + 8 <= end; p += 8) {
+		h ^= round64(0, read64(p));
+		h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+	}
+	if (p + 4 <= end) {
+		h ^= read32(p) * PRIME64_1;
+		h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= (*p) * PRIME64_5;
+		h = rotl64(h, 11) * PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
@@ -38,24 +38,40 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "common.h"
 
-typedef int (*HashFunc)(void *key, int numBuckets);
+/* hash functions return the full 32 bit hash value of a key, the table
+ * reduces it to its current size itself
+ */
+typedef unsigned int (*HashFunc)(void *key);
 typedef int (*CompFunc)(void *key1, void *key2);
 
-typedef struct tHashNode {
-	struct tHashNode *next;
+/* open addressing slot; dist is the probe distance plus one, 0 marks an
+ * empty slot
+ */
+typedef struct {
 	void *key;
 	void *data;
+	unsigned int hash;
+	unsigned int dist;
 } HashNode;
 
 typedef struct {
 	int numBuckets;
-	HashNode **table;
+	int numElements;
+	int bits;
+	HashNode *table;
 	HashFunc hashFunc;
 	CompFunc compFunc;
 	int freeDataPointers;
 } Hash;
 
-/* initialize hash */
+/* position of a traversal, see hash_next */
+typedef struct {
+	int bucket;
+} HashIterator;
+
+/* initialize hash; numBuckets is a hint for the expected number of elements,
+ * the table grows as needed
+ */
 UTILSLOCAL void hash_create(Hash *hash, HashFunc hashFunc, CompFunc compFunc,
                  int numBuckets, int freeDataPointers);
 
@@ -73,18 +89,43 @@ UTILSLOCAL void hash_remove(Hash *hash, void *key);
 /* return data associated with key */
 UTILSLOCAL void *hash_find(Hash *hash, void *key);
 
+/* return the hash value of key for use with the *_prehashed functions; it
+ * stays valid across inserts, removals and resizes
+ */
+UTILSLOCAL unsigned int hash_key(Hash *hash, void *key);
+
+/* like hash_insert and hash_find, but with a hash value from hash_key */
+UTILSLOCAL int hash_insert_prehashed(Hash *hash, void *key, unsigned int h,
+                                     void *data);
+UTILSLOCAL void *hash_find_prehashed(Hash *hash, void *key, unsigned int h);
+
 /* return number of elements in hash */
 UTILSLOCAL int hash_count(Hash *hash);
 
-/* return the n-th elemnt in the hash */
+/* return the n-th elemnt in the hash; this is linear in the table size, use
+ * hash_next to visit all elements
+ */
 UTILSLOCAL void *hash_element(Hash *hash, int n);
 
+/* start a traversal of all elements */
+UTILSLOCAL void hash_iterator_init(Hash *hash, HashIterator *it);
+
+/* store key and data of the next element in *key and *data, either may be
+ * NULL; returns 0 at the end. The order is stable as long as the hash is not
+ * modified.
+ */
+UTILSLOCAL int hash_next(Hash *hash, HashIterator *it, void **key,
+                         void **data);
+
 /* some common hash and comparison functions */
 
-UTILSLOCAL int hashInt(void *key, int numBuckets);
+UTILSLOCAL unsigned int hashInt(void *key);
 UTILSLOCAL int compInt(void *key1, void *key2);
 
-UTILSLOCAL int hashString(void *key, int numBuckets);
+UTILSLOCAL unsigned int hashString(void *key);
 UTILSLOCAL int compString(void *key1, void *key2);
 
+/* 64 bit hash of a memory block, fast enough to hash large arrays (XXH64) */
+UTILSLOCAL unsigned long long hashBytes(const void *data, size_t size);
+
 #endif
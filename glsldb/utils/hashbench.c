@@ -0,0 +1,296 @@
+/******************************************************************************
+
+Copyright (C) 2006-2009 Institute for Visualization and Interactive Systems
+(VIS), Universität Stuttgart.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+  * Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+
+  * Redistributions in binary form must reproduce the above copyright notice, this
+	list of conditions and the following disclaimer in the documentation and/or
+	other materials provided with the distribution.
+
+  * Neither the name of the name of VIS, Universität Stuttgart nor the names
+	of its contributors may be used to endorse or promote products derived from
+	this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT,
+INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/* Micro benchmark of the hash table in hash.c against the former fixed size
+ * chained table. Build with -DGLSLDB_BENCHMARKS=ON and run bin/hashbench.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "hash.h"
+
+/* the chained table hash.c used before, kept here for comparison */
+
+typedef struct tChainNode {
+	struct tChainNode *next;
+	void *key;
+	void *data;
+} ChainNode;
+
+typedef struct {
+	int numBuckets;
+	ChainNode **table;
+} Chain;
+
+static int chainHashString(void *key, int numBuckets)
+{
+	char *s = (char *)key;
+	/* universal hash function, R. Sedgewick, Algorithms in C++, p. 593 */
+	int h, a = 31415, b = 27183;
+	for (h = 0; *s != 0; s++, a = a*b % (numBuckets - 1)) {
+		h = (a*h + *s) % numBuckets;
+	}
+	return (h < 0) ? (h + numBuckets) : h;
+}
+
+static void chain_create(Chain *c, int numBuckets)
+{
+	c->numBuckets = numBuckets;
+	c->table = (ChainNode**)calloc(numBuckets, sizeof(ChainNode*));
+}
+
+static void chain_free(Chain *c)
+{
+	int i;
+	for (i = 0; i < c->numBuckets; i++) {
+		ChainNode *node = c->table[i];
+		while (node) {
+			ChainNode *next = node->next;
+			free(node);
+			node = next;
+		}
+	}
+	free(c->table);
+}
+
+static void chain_insert(Chain *c, void *key, void *data)
+{
+	int n = chainHashString(key, c->numBuckets);
+	ChainNode *node = c->table[n];
+	ChainNode *prev = NULL;
+	while (node) {
+		if (compString(node->key, key)) {
+			node->data = data;
+			return;
+		}
+		prev = node;
+		node = node->next;
+	}
+	node = (ChainNode*)malloc(sizeof(ChainNode));
+	if (prev == NULL) {
+		c->table[n] = node;
+	} else {
+		prev->next = node;
+	}
+	node->data = data;
+	node->key = key;
+	node->next = NULL;
+}
+
+static void *chain_find(Chain *c, void *key)
+{
+	ChainNode *node = c->table[chainHashString(key, c->numBuckets)];
+	while (node) {
+		if (compString(node->key, key)) {
+			return node->data;
+		}
+		node = node->next;
+	}
+	return NULL;
+}
+
+static int chain_count(Chain *c)
+{
+	int i, count = 0;
+	for (i = 0; i < c->numBuckets; i++) {
+		ChainNode *node = c->table[i];
+		while (node) {
+			node = node->next;
+			count++;
+		}
+	}
+	return count;
+}
+
+/* benchmark driver */
+
+static double now(void)
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static char **makeKeys(int n, const char *prefix)
+{
+	char **keys = (char**)malloc(n*sizeof(char*));
+	int i;
+	for (i = 0; i < n; i++) {
+		keys[i] = (char*)malloc(32);
+		sprintf(keys[i], "%s%i", prefix, i);
+	}
+	return keys;
+}
+
+static void freeKeys(char **keys, int n)
+{
+	int i;
+	for (i = 0; i < n; i++) {
+		free(keys[i]);
+	}
+	free(keys);
+}
+
+static void report(const char *table, const char *op, int n, long ops,
+                   double seconds)
+{
+	printf("%-7s %-8s %7i %10.1f ns/op\n", table, op, n,
+	       seconds * 1e9 / (double)ops);
+}
+
+static void bench(int n)
+{
+	/* roughly constant work per size */
+	int rounds = 2000000 / n + 1;
+	char **keys = makeKeys(n, "glFunction");
+	char **misses = makeKeys(n, "glMissing");
+	long found = 0;
+	double t;
+	int r, i;
+
+	/* former table; 512 buckets as used for the function pointer cache */
+	t = now();
+	for (r = 0; r < rounds; r++) {
+		Chain c;
+		chain_create(&c, 512);
+		for (i = 0; i < n; i++) {
+			chain_insert(&c, keys[i], keys[i]);
+		}
+		chain_free(&c);
+	}
+	report("chained", "insert", n, (long)rounds*n, now() - t);
+	{
+		Chain c;
+		chain_create(&c, 512);
+		for (i = 0; i < n; i++) {
+			chain_insert(&c, keys[i], keys[i]);
+		}
+		t = now();
+		for (r = 0; r < rounds; r++) {
+			for (i = 0; i < n; i++) {
+				found += chain_find(&c, keys[i]) != NULL;
+			}
+		}
+		report("chained", "hit", n, (long)rounds*n, now() - t);
+		t = now();
+		for (r = 0; r < rounds; r++) {
+			for (i = 0; i < n; i++) {
+				found += chain_find(&c, misses[i]) != NULL;
+			}
+		}
+		report("chained", "miss", n, (long)rounds*n, now() - t);
+		t = now();
+		for (r = 0; r < rounds; r++) {
+			found += chain_count(&c);
+		}
+		report("chained", "count", n, rounds, now() - t);
+		chain_free(&c);
+	}
+
+	/* current table */
+	t = now();
+	for (r = 0; r < rounds; r++) {
+		Hash h;
+		hash_create(&h, hashString, compString, 512, 0);
+		for (i = 0; i < n; i++) {
+			hash_insert(&h, keys[i], keys[i]);
+		}
+		hash_free(&h);
+	}
+	report("robin", "insert", n, (long)rounds*n, now() - t);
+	{
+		Hash h;
+		HashIterator it;
+		unsigned int *hashes = (unsigned int*)malloc(n*sizeof(unsigned int));
+		hash_create(&h, hashString, compString, 512, 0);
+		for (i = 0; i < n; i++) {
+			hash_insert(&h, keys[i], keys[i]);
+			hashes[i] = hash_key(&h, keys[i]);
+		}
+		t = now();
+		for (r = 0; r < rounds; r++) {
+			for (i = 0; i < n; i++) {
+				found += hash_find(&h, keys[i]) != NULL;
+			}
+		}
+		report("robin", "hit", n, (long)rounds*n, now() - t);
+		t = now();
+		for (r = 0; r < rounds; r++) {
+			for (i = 0; i < n; i++) {
+				found += hash_find_prehashed(&h, keys[i], hashes[i]) != NULL;
+			}
+		}
+		report("robin", "prehash", n, (long)rounds*n, now() - t);
+		t = now();
+		for (r = 0; r < rounds; r++) {
+			for (i = 0; i < n; i++) {
+				found += hash_find(&h, misses[i]) != NULL;
+			}
+		}
+		report("robin", "miss", n, (long)rounds*n, now() - t);
+		t = now();
+		for (r = 0; r < rounds; r++) {
+			found += hash_count(&h);
+		}
+		report("robin", "count", n, rounds, now() - t);
+		t = now();
+		for (r = 0; r < rounds; r++) {
+			hash_iterator_init(&h, &it);
+			while (hash_next(&h, &it, NULL, NULL)) {
+				found++;
+			}
+		}
+		report("robin", "iterate", n, (long)rounds*n, now() - t);
+		free(hashes);
+		hash_free(&h);
+	}
+
+	/* keep the lookups from being optimized away */
+	if (found == 0) {
+		printf("nothing found\n");
+	}
+	freeKeys(keys, n);
+	freeKeys(misses, n);
+}
+
+int main(int argc, char **argv)
+{
+	int sizes[] = {10, 1000, 100000};
+	int i;
+
+	for (i = 0; i < (int)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+		bench(sizes[i]);
+	}
+	return 0;
+}